@@ -0,0 +1,403 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <thread>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "memory_pool.h"
+#include "thread_caching_memory_pool.h"
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#define MEMORY_POOL_HAS_STATM
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using memory_pool::MemoryPool;
+using memory_pool::SizeT;
+using memory_pool::ThreadCachingMemoryPool;
+
+// Runs the same workloads against MemoryPool and the allocators it would otherwise be replaced
+// by: new/delete, malloc/free and the std::pmr pool resources. Every workload allocates and
+// frees 64-byte objects, writing to each object it allocates. The total number of objects
+// (range(0)) is split evenly between the threads. Each benchmark reports
+//
+//   ops_per_second: Allocations plus deallocations per second, summed over every thread
+//   rss_mb:         The resident set size of the process when thread 0 has the most objects
+//                   allocated, in the last iteration
+
+
+// The objects every workload allocates
+using Object = memory_pool::RawBlock<64, 8>;
+
+// The number of threads the multithreaded benchmarks go up to (even, for the producer/consumer
+// pairs)
+const int g_MaxNumThreads =
+  std::max(2, static_cast<int>(std::thread::hardware_concurrency()) / 2 * 2);
+
+
+// The resident set size of the process in bytes, or 0 if it cannot be read
+static double resident_bytes()
+{
+#ifdef MEMORY_POOL_HAS_STATM
+  std::FILE* file = std::fopen("/proc/self/statm", "r");
+  if (file == nullptr) return 0.0;
+  unsigned long long num_pages = 0;
+  unsigned long long num_resident_pages = 0;
+  const int num_read = std::fscanf(file, "%llu %llu", &num_pages, &num_resident_pages);
+  std::fclose(file);
+  if (num_read != 2) return 0.0;
+  return static_cast<double>(num_resident_pages) * static_cast<double>(::sysconf(_SC_PAGESIZE));
+#else
+  return 0.0;
+#endif
+}
+
+
+// The allocators. Each benchmark thread constructs its own instance; allocators that share
+// state between threads keep it in a static that set_up() creates before the threads start and
+// tear_down() destroys after they finish. 'Is_thread_safe' is true if a block may be freed by
+// a different thread than the one that allocated it
+
+// The global operator new and operator delete
+struct NewDelete {
+  static constexpr bool Is_thread_safe = true;
+  static void set_up() {}
+  static void tear_down() {}
+
+  Object* allocate() { return new Object; }
+  void deallocate(Object* obj_pt) { delete obj_pt; }
+};
+
+// malloc() and free()
+struct Malloc {
+  static constexpr bool Is_thread_safe = true;
+  static void set_up() {}
+  static void tear_down() {}
+
+  Object* allocate() { return static_cast<Object*>(std::malloc(sizeof(Object))); }
+  void deallocate(Object* obj_pt) { std::free(obj_pt); }
+};
+
+// One std::pmr::unsynchronized_pool_resource per thread
+struct PmrUnsynchronizedPool {
+  static constexpr bool Is_thread_safe = false;
+  static void set_up() {}
+  static void tear_down() {}
+
+  Object* allocate() { return static_cast<Object*>(Resource.allocate(sizeof(Object), 8)); }
+  void deallocate(Object* obj_pt) { Resource.deallocate(obj_pt, sizeof(Object), 8); }
+
+  std::pmr::unsynchronized_pool_resource Resource;
+};
+
+// One std::pmr::synchronized_pool_resource shared by every thread
+struct PmrSynchronizedPool {
+  static constexpr bool Is_thread_safe = true;
+  static void set_up() { Resource_pt = std::make_unique<std::pmr::synchronized_pool_resource>(); }
+  static void tear_down() { Resource_pt.reset(); }
+
+  Object* allocate() { return static_cast<Object*>(Resource_pt->allocate(sizeof(Object), 8)); }
+  void deallocate(Object* obj_pt) { Resource_pt->deallocate(obj_pt, sizeof(Object), 8); }
+
+  static inline std::unique_ptr<std::pmr::synchronized_pool_resource> Resource_pt;
+};
+
+// One growable MemoryPool per thread
+struct ThreadLocalMemoryPool {
+  static constexpr bool Is_thread_safe = false;
+  static void set_up() {}
+  static void tear_down() {}
+
+  Object* allocate() { return Pool.new_block_pt(); }
+  void deallocate(Object* obj_pt) { Pool.delete_block_pt(obj_pt); }
+
+  MemoryPool<Object> Pool{1 << 10, 2};
+};
+
+// One growable ThreadCachingMemoryPool shared by every thread
+struct SharedThreadCachingPool {
+  static constexpr bool Is_thread_safe = true;
+  static void set_up()
+  {
+    Pool_pt = std::make_unique<ThreadCachingMemoryPool<Object>>(
+      1 << 12, memory_pool::g_DefaultMagazineSize, 2);
+  }
+  static void tear_down() { Pool_pt.reset(); }
+
+  Object* allocate() { return Pool_pt->new_block_pt(); }
+  void deallocate(Object* obj_pt) { Pool_pt->delete_block_pt(obj_pt); }
+
+  static inline std::unique_ptr<ThreadCachingMemoryPool<Object>> Pool_pt;
+};
+
+
+// Creates the shared state of an allocator before the threads of a benchmark start. Also
+// hands memory that malloc kept from earlier benchmarks back to the OS, so it does not mask
+// the resident set size of this one
+template<class Allocator>
+static void set_up(const benchmark::State&)
+{
+#if defined(__GLIBC__)
+  ::malloc_trim(0);
+#endif
+  Allocator::set_up();
+}
+
+// Destroys the shared state of an allocator once the threads of a benchmark have finished
+template<class Allocator>
+static void tear_down(const benchmark::State&)
+{
+  Allocator::tear_down();
+}
+
+
+// Records the resident set size if this is thread 0 in the last iteration. Not timed
+static void record_peak_rss(benchmark::State& state, const benchmark::IterationCount& iteration,
+                            double& rss_bytes)
+{
+  if ((state.thread_index() != 0) || (iteration != state.max_iterations)) return;
+  state.PauseTiming();
+  rss_bytes = resident_bytes();
+  state.ResumeTiming();
+}
+
+// Sets the counters every benchmark reports
+static void set_counters(benchmark::State& state, const SizeT& num_ops, const double& rss_bytes)
+{
+  state.counters["ops_per_second"] =
+    benchmark::Counter(static_cast<double>(num_ops), benchmark::Counter::kIsRate);
+  if (state.thread_index() == 0) state.counters["rss_mb"] = rss_bytes / (1 << 20);
+}
+
+
+// Allocates every object, then frees them newest first
+template<class Allocator>
+static void benchmark_lifo(benchmark::State& state)
+{
+  const SizeT num_objects = state.range(0) / state.threads();
+  Allocator allocator;
+  std::vector<Object*> objects(num_objects);
+  benchmark::IterationCount iteration = 0;
+  double rss_bytes = 0.0;
+  for (auto _ : state) {
+    for (Object*& obj_pt : objects) {
+      obj_pt = allocator.allocate();
+      obj_pt->Bytes[0] = std::byte{1};
+    }
+    record_peak_rss(state, ++iteration, rss_bytes);
+    for (auto it = objects.rbegin(); it != objects.rend(); ++it) allocator.deallocate(*it);
+  }
+  set_counters(state, state.iterations() * num_objects * 2, rss_bytes);
+}
+
+
+// Allocates every object, then frees them oldest first
+template<class Allocator>
+static void benchmark_fifo(benchmark::State& state)
+{
+  const SizeT num_objects = state.range(0) / state.threads();
+  Allocator allocator;
+  std::vector<Object*> objects(num_objects);
+  benchmark::IterationCount iteration = 0;
+  double rss_bytes = 0.0;
+  for (auto _ : state) {
+    for (Object*& obj_pt : objects) {
+      obj_pt = allocator.allocate();
+      obj_pt->Bytes[0] = std::byte{1};
+    }
+    record_peak_rss(state, ++iteration, rss_bytes);
+    for (Object* obj_pt : objects) allocator.deallocate(obj_pt);
+  }
+  set_counters(state, state.iterations() * num_objects * 2, rss_bytes);
+}
+
+
+// Keeps every object allocated and replaces them one at a time in random order, so that the
+// free blocks (and the memory an allocator hands out next) end up scattered
+template<class Allocator>
+static void benchmark_random_churn(benchmark::State& state)
+{
+  const SizeT num_objects = state.range(0) / state.threads();
+  Allocator allocator;
+  std::vector<Object*> objects(num_objects);
+  for (Object*& obj_pt : objects) obj_pt = allocator.allocate();
+  std::vector<uint32_t> indices(num_objects);
+  std::mt19937 generator(state.thread_index());
+  std::uniform_int_distribution<uint32_t> distribution(0, num_objects - 1);
+  for (uint32_t& index : indices) index = distribution(generator);
+
+  benchmark::IterationCount iteration = 0;
+  double rss_bytes = 0.0;
+  for (auto _ : state) {
+    for (const uint32_t index : indices) {
+      allocator.deallocate(objects[index]);
+      objects[index] = allocator.allocate();
+      objects[index]->Bytes[0] = std::byte{1};
+    }
+    record_peak_rss(state, ++iteration, rss_bytes);
+  }
+  for (Object* obj_pt : objects) allocator.deallocate(obj_pt);
+  set_counters(state, state.iterations() * num_objects * 2, rss_bytes);
+}
+
+
+// Allocates objects of which one in ten lives until the end of the iteration and the rest are
+// freed again 16 allocations later, as with long-lived state and short-lived temporaries
+template<class Allocator>
+static void benchmark_lifetime_mix(benchmark::State& state)
+{
+  constexpr SizeT num_short_lived = 16;
+  const SizeT num_objects = state.range(0) / state.threads();
+  Allocator allocator;
+  std::vector<Object*> long_lived;
+  long_lived.reserve(num_objects / 10 + 1);
+  Object* short_lived[num_short_lived] = {};
+  benchmark::IterationCount iteration = 0;
+  double rss_bytes = 0.0;
+  for (auto _ : state) {
+    for (SizeT i = 0; i < num_objects; i++) {
+      Object* obj_pt = allocator.allocate();
+      obj_pt->Bytes[0] = std::byte{1};
+      if (i % 10 == 0) {
+        long_lived.push_back(obj_pt);
+        continue;
+      }
+      Object*& slot = short_lived[i % num_short_lived];
+      if (slot != nullptr) allocator.deallocate(slot);
+      slot = obj_pt;
+    }
+    record_peak_rss(state, ++iteration, rss_bytes);
+    for (Object*& slot : short_lived) {
+      if (slot != nullptr) allocator.deallocate(slot);
+      slot = nullptr;
+    }
+    for (Object* obj_pt : long_lived) allocator.deallocate(obj_pt);
+    long_lived.clear();
+  }
+  set_counters(state, state.iterations() * num_objects * 2, rss_bytes);
+}
+
+
+// A single-producer single-consumer queue of object pointers
+class ObjectQueue {
+public:
+  void push(Object* obj_pt)
+  {
+    const auto tail = Tail.load(std::memory_order_relaxed);
+    while (tail - Head.load(std::memory_order_acquire) == Capacity) std::this_thread::yield();
+    Objects[tail % Capacity] = obj_pt;
+    Tail.store(tail + 1, std::memory_order_release);
+  }
+
+  Object* pop()
+  {
+    const auto head = Head.load(std::memory_order_relaxed);
+    while (Tail.load(std::memory_order_acquire) == head) std::this_thread::yield();
+    Object* obj_pt = Objects[head % Capacity];
+    Head.store(head + 1, std::memory_order_release);
+    return obj_pt;
+  }
+
+private:
+  static constexpr std::size_t Capacity = 1024;
+  Object* Objects[Capacity];
+  alignas(64) std::atomic<std::size_t> Head{0};
+  alignas(64) std::atomic<std::size_t> Tail{0};
+};
+
+// One queue per pair of threads in the producer/consumer benchmarks
+static std::unique_ptr<ObjectQueue[]> g_Queues;
+
+template<class Allocator>
+static void set_up_producer_consumer(const benchmark::State& state)
+{
+  g_Queues = std::make_unique<ObjectQueue[]>(state.threads() / 2);
+  set_up<Allocator>(state);
+}
+
+template<class Allocator>
+static void tear_down_producer_consumer(const benchmark::State& state)
+{
+  tear_down<Allocator>(state);
+  g_Queues.reset();
+}
+
+// Even-numbered threads allocate objects and pass them to the next thread, which frees them.
+// Only for allocators that allow a block to be freed by another thread
+template<class Allocator>
+static void benchmark_producer_consumer(benchmark::State& state)
+{
+  static_assert(Allocator::Is_thread_safe);
+  const SizeT num_objects = state.range(0) / state.threads();
+  Allocator allocator;
+  ObjectQueue& queue = g_Queues[state.thread_index() / 2];
+  const bool is_producer = (state.thread_index() % 2 == 0);
+  benchmark::IterationCount iteration = 0;
+  double rss_bytes = 0.0;
+  for (auto _ : state) {
+    for (SizeT i = 0; i < num_objects; i++) {
+      if (is_producer) {
+        Object* obj_pt = allocator.allocate();
+        obj_pt->Bytes[0] = std::byte{1};
+        queue.push(obj_pt);
+      }
+      else {
+        allocator.deallocate(queue.pop());
+      }
+    }
+    record_peak_rss(state, ++iteration, rss_bytes);
+  }
+  set_counters(state, state.iterations() * num_objects, rss_bytes);
+}
+
+
+// Registers a workload for an allocator with 1K, 64K and 4M objects in total and 1, 2, 4, ...
+// threads
+#define BENCHMARK_WORKLOAD(workload, Allocator)                                              \
+  BENCHMARK_TEMPLATE(workload, Allocator)                                                    \
+    ->Setup(set_up<Allocator>)                                                               \
+    ->Teardown(tear_down<Allocator>)                                                         \
+    ->RangeMultiplier(64)                                                                    \
+    ->Range(1 << 10, 1 << 22)                                                                \
+    ->ThreadRange(1, g_MaxNumThreads)                                                        \
+    ->UseRealTime()
+
+// Registers the producer/consumer workload for an allocator with 2, 4, ... threads
+#define BENCHMARK_PRODUCER_CONSUMER(Allocator)                                               \
+  BENCHMARK_TEMPLATE(benchmark_producer_consumer, Allocator)                                 \
+    ->Setup(set_up_producer_consumer<Allocator>)                                             \
+    ->Teardown(tear_down_producer_consumer<Allocator>)                                       \
+    ->RangeMultiplier(64)                                                                    \
+    ->Range(1 << 10, 1 << 22)                                                                \
+    ->ThreadRange(2, g_MaxNumThreads)                                                        \
+    ->UseRealTime()
+
+// Registers the single-threaded-or-not workloads for an allocator
+#define BENCHMARK_WORKLOADS(Allocator)                                                       \
+  BENCHMARK_WORKLOAD(benchmark_lifo, Allocator);                                             \
+  BENCHMARK_WORKLOAD(benchmark_fifo, Allocator);                                             \
+  BENCHMARK_WORKLOAD(benchmark_random_churn, Allocator);                                     \
+  BENCHMARK_WORKLOAD(benchmark_lifetime_mix, Allocator)
+
+
+// Register the benchmarking functions as a benchmark
+BENCHMARK_WORKLOADS(ThreadLocalMemoryPool);
+BENCHMARK_WORKLOADS(SharedThreadCachingPool);
+BENCHMARK_WORKLOADS(NewDelete);
+BENCHMARK_WORKLOADS(Malloc);
+BENCHMARK_WORKLOADS(PmrUnsynchronizedPool);
+BENCHMARK_WORKLOADS(PmrSynchronizedPool);
+BENCHMARK_PRODUCER_CONSUMER(SharedThreadCachingPool);
+BENCHMARK_PRODUCER_CONSUMER(NewDelete);
+BENCHMARK_PRODUCER_CONSUMER(Malloc);
+BENCHMARK_PRODUCER_CONSUMER(PmrSynchronizedPool);
+
+
+// Run the benchmark
+BENCHMARK_MAIN();
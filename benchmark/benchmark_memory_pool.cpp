@@ -1,10 +1,56 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory_resource>
+#include <mutex>
 #include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 #include <benchmark/benchmark.h>
 #include "ExampleClasses.h"
+#include "bitmap_tracker.h"
+#include "concurrent_memory_pool.h"
 #include "memory_pool.h"
+#include "monotonic_arena.h"
+#if __has_include(<sys/mman.h>)
+#include <sys/socket.h>
+#include "mmap_storage.h"
+#include "persistent_memory_pool.h"
+#include "shared_memory_pool.h"
+#define MEMORY_POOL_HAS_MMAP_STORAGE
+#endif
+#include "pool_allocator.h"
+#include "pool_policies.h"
+#include "pool_stats.h"
+#include "pool_trace.h"
+#include "size_class_allocator.h"
+#include "slot_layout.h"
+#include "soa_pool.h"
+#include "static_memory_pool.h"
+#include "thread_caching_memory_pool.h"
 
+using memory_pool::ConcurrentMemoryPool;
 using memory_pool::MemoryPool;
+using memory_pool::PoolAllocator;
+using memory_pool::PoolMemoryResource;
+using memory_pool::SizeClassAllocator;
+using memory_pool::SizeT;
+using memory_pool::StaticMemoryPool;
+using memory_pool::StructSoaPool;
+using memory_pool::ThreadCachingMemoryPool;
+
+
+// Describe Point to StructSoaPool, which stores each of its members in its own column
+template<>
+struct memory_pool::SoaFields<Point> {
+  static constexpr auto Members = std::make_tuple(&Point::x, &Point::y, &Point::z);
+};
 
 
 static void benchmark_point_multiple_pool_allocations_with_memory_pool(benchmark::State& state)
@@ -35,6 +81,75 @@ static void benchmark_point_multiple_pool_allocations_with_vector(benchmark::Sta
 }
 
 
+// One "request" allocates 'pool_size' points that all die together at the end of it. The pool
+// and the arena are kept across requests; the pool is emptied with reset(), the arena with its
+// O(1) reset()
+static void benchmark_point_requests_with_memory_pool(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<Point> pool(pool_size);
+  for (auto _ : state) {
+    for (auto i = 0; i < 1000; i++) {
+      for (auto j = 0; j < pool_size; j++) benchmark::DoNotOptimize(pool.new_block_pt());
+      pool.reset();
+    }
+  }
+}
+
+
+static void benchmark_point_requests_with_arena(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  memory_pool::MonotonicArena<> arena(pool_size * sizeof(Point));
+  for (auto _ : state) {
+    for (auto i = 0; i < 1000; i++) {
+      for (auto j = 0; j < pool_size; j++) benchmark::DoNotOptimize(arena.allocate<Point>());
+      arena.reset();
+    }
+  }
+}
+
+
+// As above with objects of mixed types, which a single MemoryPool cannot hold, against
+// new/delete
+static void benchmark_mixed_requests_with_arena(benchmark::State& state)
+{
+  const auto& num_objects = state.range(0);
+  memory_pool::MonotonicArena<> arena(num_objects * sizeof(FixedStringType));
+  for (auto _ : state) {
+    for (auto i = 0; i < 1000; i++) {
+      for (auto j = 0; j < num_objects; j += 2) {
+        benchmark::DoNotOptimize(arena.emplace<Point>(Point{j, j, j}));
+        benchmark::DoNotOptimize(arena.allocate<FixedStringType>());
+      }
+      arena.reset();
+    }
+  }
+}
+
+
+static void benchmark_mixed_requests_with_new_delete(benchmark::State& state)
+{
+  const auto& num_objects = state.range(0);
+  std::vector<Point*> points(num_objects / 2);
+  std::vector<char*> strings(num_objects / 2);
+  for (auto _ : state) {
+    for (auto i = 0; i < 1000; i++) {
+      for (auto j = 0; j < num_objects / 2; j++) {
+        points[j] = new Point{j, j, j};
+        strings[j] = new FixedStringType;
+        benchmark::DoNotOptimize(points[j]);
+        benchmark::DoNotOptimize(strings[j]);
+      }
+      for (auto j = 0; j < num_objects / 2; j++) {
+        delete points[j];
+        delete[] strings[j];
+      }
+    }
+  }
+}
+
+
 static void benchmark_point_with_memory_pool(benchmark::State& state)
 {
   const auto& pool_size = state.range(0);
@@ -51,6 +166,23 @@ static void benchmark_point_with_memory_pool(benchmark::State& state)
 }
 
 
+template<int PoolSize>
+static void benchmark_point_with_static_memory_pool(benchmark::State& state)
+{
+  for (auto _ : state) {
+    StaticMemoryPool<Point, PoolSize> pool;
+    Point* block_pt = nullptr;
+    for (auto i = 0; i < PoolSize; i++) {
+      block_pt = pool.new_block_pt();
+      block_pt->x = i;
+      block_pt->y = i + 1;
+      block_pt->z = i + 2;
+    }
+    benchmark::DoNotOptimize(block_pt);
+  }
+}
+
+
 static void benchmark_base1_with_memory_pool(benchmark::State& state)
 {
   const auto& pool_size = state.range(0);
@@ -98,6 +230,36 @@ static void benchmark_derived_with_memory_pool(benchmark::State& state)
 }
 
 
+static void benchmark_derived_emplace_with_memory_pool(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  for (auto _ : state) {
+    MemoryPool<Derived> pool(pool_size);
+    Derived* block_pt = nullptr;
+    for (auto i = 0; i < pool_size; i++) {
+      block_pt = pool.emplace();
+      block_pt->p.x = i;
+      block_pt->p.y = i + 1;
+      block_pt->p.z = i + 2;
+    }
+  }
+}
+
+
+static void benchmark_no_default_constructor_emplace_with_memory_pool(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  for (auto _ : state) {
+    MemoryPool<NoDefaultConstructor> pool(pool_size);
+    NoDefaultConstructor* block_pt = nullptr;
+    for (auto i = 0; i < pool_size; i++) {
+      block_pt = pool.emplace(i);
+      auto v = block_pt->GetNumber();
+    }
+  }
+}
+
+
 static void benchmark_derived_with_vector(benchmark::State& state)
 {
   const auto& pool_size = state.range(0);
@@ -146,83 +308,71 @@ static void benchmark_derived_random_allocations_and_deallocations_with_memory_p
 }
 
 
-static void benchmark_no_default_constructor_with_memory_pool(benchmark::State& state)
-{
-  const auto& pool_size = state.range(0);
-  for (auto _ : state) {
-    MemoryPool<NoDefaultConstructor> pool(pool_size);
-    NoDefaultConstructor* block_pt = nullptr;
-    for (auto i = 0; i < pool_size; i++) {
-      block_pt = pool.new_block_pt(NoDefaultConstructor(i));
-      auto v = block_pt->GetNumber();
-    }
-  }
-}
-
-
-static void benchmark_table_pool_creation(benchmark::State& state)
+static void benchmark_derived_random_allocations_and_deallocations_with_memory_pool_batched(
+  benchmark::State& state)
 {
   const auto& pool_size = state.range(0);
+  const auto& batch_size = state.range(1);
   for (auto _ : state) {
     MemoryPool<Derived> pool(pool_size);
-  }
-  state.SetComplexityN(state.range(0));
-}
-
+    std::vector<Derived*> block_pointers(pool_size);
 
-static void benchmark_table_pool_destruction(benchmark::State& state)
-{
-  const auto& pool_size = state.range(0);
-  for (auto _ : state) {
-    state.PauseTiming();
-    MemoryPool<Derived> pool(pool_size);
-    state.ResumeTiming();
-    pool.clear();
-  }
-  state.SetComplexityN(state.range(0));
-}
+    // Allocate all blocks
+    pool.new_blocks(pool_size, block_pointers.data());
 
+    // Shuffle the pointers so we deallocate/allocate in a random order
+    auto rng = std::default_random_engine{};
+    std::shuffle(block_pointers.begin(), block_pointers.end(), rng);
 
-static void benchmark_table_pool_block_allocation(benchmark::State& state)
-{
-  const auto& pool_size = state.range(0);
-  for (auto _ : state) {
-    state.PauseTiming();
-    MemoryPool<Derived> pool(pool_size);
-    state.ResumeTiming();
-    for (auto i = 0; i < pool_size; i++) {
-      pool.new_block_pt();
+    // Complete several rounds of random allocation/deallocation, 'batch_size' blocks at a time
+    for (auto round = 0; round < 100; round++) {
+      for (auto i = 0; i < pool_size; i += batch_size) {
+        pool.delete_blocks(block_pointers.data() + i, std::min(batch_size, pool_size - i));
+      }
+      for (auto i = 0; i < pool_size; i += batch_size) {
+        pool.new_blocks(std::min(batch_size, pool_size - i), block_pointers.data() + i);
+      }
     }
   }
-  state.SetComplexityN(state.range(0));
 }
 
-static void benchmark_table_pool_block_deallocation(benchmark::State& state)
+
+template<int PoolSize>
+static void benchmark_derived_random_allocations_and_deallocations_with_static_memory_pool(
+  benchmark::State& state)
 {
-  const auto& pool_size = state.range(0);
   for (auto _ : state) {
-    state.PauseTiming();
-    MemoryPool<Derived> pool(pool_size);
-    std::vector<Derived*> block_pointers(pool_size);
-    for (auto i = 0; i < pool_size; i++) {
-      block_pointers[i] = pool.new_block_pt();
-    }
-    state.ResumeTiming();
+    StaticMemoryPool<Derived, PoolSize> pool;
+    std::vector<Derived*> block_pointers(PoolSize);
 
-    for (auto i = 0; i < pool_size; i++) {
-      pool.delete_block_pt(block_pointers[i]);
+    // Allocate all blocks
+    for (auto i = 0; i < PoolSize; i++) block_pointers[i] = pool.new_block_pt();
+
+    // Shuffle the pointers so we deallocate/allocate in a random order
+    auto rng = std::default_random_engine{};
+    std::shuffle(block_pointers.begin(), block_pointers.end(), rng);
+
+    // Complete several rounds of random allocation/deallocation
+    for (auto round = 0; round < 100; round++) {
+      for (auto i = 0; i < PoolSize; i++) {
+        pool.delete_block_pt(block_pointers[i]);
+      }
+      for (auto i = 0; i < PoolSize; i++) {
+        block_pointers[i] = pool.new_block_pt();
+      }
     }
   }
-  state.SetComplexityN(state.range(0));
 }
 
-static void benchmark_table_pool_random_block_allocations(benchmark::State& state)
+
+template<class Tracker>
+static void benchmark_derived_random_allocations_and_deallocations_with_tracker(
+  benchmark::State& state)
 {
   const auto& pool_size = state.range(0);
   for (auto _ : state) {
-    state.PauseTiming();
-
-    MemoryPool<Derived> pool(pool_size);
+    MemoryPool<Derived, memory_pool::HeapStorage, memory_pool::NaturalLayout, Tracker> pool(
+      pool_size);
     std::vector<Derived*> block_pointers(pool_size);
 
     // Allocate all blocks
@@ -232,31 +382,32 @@ static void benchmark_table_pool_random_block_allocations(benchmark::State& stat
     auto rng = std::default_random_engine{};
     std::shuffle(block_pointers.begin(), block_pointers.end(), rng);
 
-    state.ResumeTiming();
-
     // Complete several rounds of random allocation/deallocation
     for (auto round = 0; round < 100; round++) {
-      state.PauseTiming();
       for (auto i = 0; i < pool_size; i++) {
         pool.delete_block_pt(block_pointers[i]);
       }
-      state.ResumeTiming();
-
       for (auto i = 0; i < pool_size; i++) {
         block_pointers[i] = pool.new_block_pt();
       }
     }
   }
-  state.SetComplexityN(state.range(0));
 }
 
-static void benchmark_table_pool_random_block_deallocations(benchmark::State& state)
+
+// As above with the BlockTracker, but with the pool keeping statistics (or not) as 'Stats' says
+template<class Stats>
+static void benchmark_derived_random_allocations_and_deallocations_with_stats(
+  benchmark::State& state)
 {
+  using Pool = MemoryPool<Derived,
+                          memory_pool::HeapStorage,
+                          memory_pool::NaturalLayout,
+                          memory_pool::BlockTracker,
+                          Stats>;
   const auto& pool_size = state.range(0);
   for (auto _ : state) {
-    state.PauseTiming();
-
-    MemoryPool<Derived> pool(pool_size);
+    Pool pool(pool_size);
     std::vector<Derived*> block_pointers(pool_size);
 
     // Allocate all blocks
@@ -266,70 +417,1343 @@ static void benchmark_table_pool_random_block_deallocations(benchmark::State& st
     auto rng = std::default_random_engine{};
     std::shuffle(block_pointers.begin(), block_pointers.end(), rng);
 
-    state.ResumeTiming();
-
     // Complete several rounds of random allocation/deallocation
     for (auto round = 0; round < 100; round++) {
       for (auto i = 0; i < pool_size; i++) {
         pool.delete_block_pt(block_pointers[i]);
       }
-
-      state.PauseTiming();
       for (auto i = 0; i < pool_size; i++) {
         block_pointers[i] = pool.new_block_pt();
       }
-      state.ResumeTiming();
     }
   }
-  state.SetComplexityN(state.range(0));
 }
 
 
-// Register the benchmarking functions as a benchmark. The Arg(...) arguments are passed in the
-// benchmark::Start object
-BENCHMARK(benchmark_point_multiple_pool_allocations_with_memory_pool)
-  ->Arg(8)
-  ->Arg(32)
-  ->Arg(128)
-  ->Arg(512);
-BENCHMARK(benchmark_point_multiple_pool_allocations_with_vector)
-  ->Arg(8)
-  ->Arg(32)
-  ->Arg(128)
-  ->Arg(512);
-BENCHMARK(benchmark_point_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
-BENCHMARK(benchmark_base1_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
-BENCHMARK(benchmark_base2_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
-BENCHMARK(benchmark_derived_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
-BENCHMARK(benchmark_derived_with_vector)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
-BENCHMARK(benchmark_derived_random_allocations_and_deallocations_with_memory_pool)
-  ->Arg(8)
-  ->Arg(32)
-  ->Arg(128)
-  ->Arg(512)
-  ->Arg(1000);
-BENCHMARK(benchmark_no_default_constructor_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
-BENCHMARK(benchmark_table_pool_creation)->Arg(8)->Arg(32)->Arg(128)->Arg(512)->Complexity();
-BENCHMARK(benchmark_table_pool_destruction)->Arg(8)->Arg(32)->Arg(128)->Arg(512)->Complexity();
-BENCHMARK(benchmark_table_pool_block_allocation)->Arg(8)->Arg(32)->Arg(128)->Arg(512)->Complexity();
-BENCHMARK(benchmark_table_pool_block_deallocation)
-  ->Arg(8)
-  ->Arg(32)
-  ->Arg(128)
-  ->Arg(512)
-  ->Complexity();
-BENCHMARK(benchmark_table_pool_random_block_allocations)
-  ->Arg(8)
-  ->Arg(32)
-  ->Arg(128)
-  ->Arg(512)
-  ->Complexity();
-BENCHMARK(benchmark_table_pool_random_block_deallocations)
-  ->Arg(8)
-  ->Arg(32)
-  ->Arg(128)
-  ->Arg(512)
-  ->Complexity();
+// Measures how quickly a set of "hot" objects can be traversed (in the order they were
+// allocated) after the pool has been churned. Every block is allocated then freed in a random
+// order before half the pool is allocated again. The LIFO BlockTracker hands those blocks out
+// in the random order they were freed; BitmapTracker hands them out lowest address first
+template<class Tracker>
+static void benchmark_derived_traversal_after_churn_with_tracker(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<Derived, memory_pool::HeapStorage, memory_pool::NaturalLayout, Tracker> pool(
+    pool_size);
+  std::vector<Derived*> block_pointers(pool_size);
+  pool.emplace_blocks(pool_size, block_pointers.data());
+  std::shuffle(block_pointers.begin(), block_pointers.end(), std::default_random_engine{});
+  pool.destroy_blocks(block_pointers.data(), pool_size);
+
+  std::vector<Derived*> hot_pointers(pool_size / 2);
+  pool.emplace_blocks(hot_pointers.size(), hot_pointers.data());
+
+  for (auto _ : state) {
+    int sum = 0;
+    for (Derived* obj_pt : hot_pointers) sum += obj_pt->GetNumber3();
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * hot_pointers.size());
+  pool.destroy_blocks(hot_pointers.data(), hot_pointers.size());
+}
+
+
+// Fills a pool with 'pool_size' objects and frees a random half of them again, as after a busy
+// period. Returns pointers to the surviving objects in the order they were allocated; i.e. the
+// side vector one would otherwise keep to be able to visit every live object
+static std::vector<Derived*> churn_half_of_pool(MemoryPool<Derived>& pool, const int64_t& pool_size)
+{
+  std::vector<Derived*> block_pointers(pool_size);
+  pool.emplace_blocks(pool_size, block_pointers.data());
+  std::vector<Derived*> shuffled_pointers(block_pointers);
+  std::shuffle(shuffled_pointers.begin(), shuffled_pointers.end(), std::default_random_engine{});
+  shuffled_pointers.resize(pool_size / 2);
+  std::sort(shuffled_pointers.begin(), shuffled_pointers.end());
+  std::vector<Derived*> live_pointers;
+  for (Derived* obj_pt : block_pointers) {
+    if (!std::binary_search(shuffled_pointers.begin(), shuffled_pointers.end(), obj_pt)) {
+      live_pointers.push_back(obj_pt);
+    }
+  }
+  pool.destroy_blocks(shuffled_pointers.data(), shuffled_pointers.size());
+  return live_pointers;
+}
+
+
+// Updates every live object in a half-empty pool (as in a tick update) through a side vector
+// of pointers
+static void benchmark_derived_update_live_with_side_vector(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<Derived> pool(pool_size);
+  std::vector<Derived*> live_pointers = churn_half_of_pool(pool, pool_size);
+  for (auto _ : state) {
+    for (Derived* obj_pt : live_pointers) obj_pt->p.x += 1.0f;
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * live_pointers.size());
+  pool.destroy_blocks(live_pointers.data(), live_pointers.size());
+}
+
+
+// Updates every live object in a half-empty pool with for_each_live(); the cost of taking the
+// occupancy snapshot is included
+static void benchmark_derived_update_live_with_for_each_live(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<Derived> pool(pool_size);
+  std::vector<Derived*> live_pointers = churn_half_of_pool(pool, pool_size);
+  for (auto _ : state) {
+    pool.for_each_live([](Derived& obj) { obj.p.x += 1.0f; });
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * live_pointers.size());
+  pool.destroy_blocks(live_pointers.data(), live_pointers.size());
+}
+
+
+// As above, but with the live objects walked by several threads
+static void benchmark_derived_update_live_with_parallel_for_each_live(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<Derived> pool(pool_size);
+  std::vector<Derived*> live_pointers = churn_half_of_pool(pool, pool_size);
+  for (auto _ : state) {
+    pool.for_each_live(memory_pool::g_Parallel, [](Derived& obj) { obj.p.x += 1.0f; });
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * live_pointers.size());
+  pool.destroy_blocks(live_pointers.data(), live_pointers.size());
+}
+
+
+// Updates the objects in a pool in a random order through a table of references to them, as
+// an entity table would; once with raw pointers and once with 4-byte generational handles
+static void benchmark_derived_update_through_pointers(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<Derived> pool(pool_size);
+  std::vector<Derived*> references(pool_size);
+  for (auto i = 0; i < pool_size; i++) references[i] = pool.emplace();
+  std::shuffle(references.begin(), references.end(), std::default_random_engine{});
+  for (auto _ : state) {
+    for (Derived* obj_pt : references) obj_pt->p.x += 1.0f;
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * pool_size);
+  state.counters["reference_bytes"] = sizeof(Derived*);
+  pool.destroy_blocks(references.data(), references.size());
+}
+
+
+static void benchmark_derived_update_through_handles(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<Derived> pool(pool_size);
+  std::vector<memory_pool::Handle<Derived>> references(pool_size);
+  for (auto i = 0; i < pool_size; i++) references[i] = pool.emplace_handle();
+  std::shuffle(references.begin(), references.end(), std::default_random_engine{});
+  for (auto _ : state) {
+    for (const auto& handle : references) {
+      Derived* obj_pt = pool.resolve(handle);
+      if (obj_pt != nullptr) obj_pt->p.x += 1.0f;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * pool_size);
+  state.counters["reference_bytes"] = sizeof(memory_pool::Handle<Derived>);
+  for (auto& handle : references) pool.destroy(handle);
+}
+
+
+// Leaves one object in ten alive, at random, in a pool of 'pool_size' objects
+static std::vector<Derived*> make_sparse_pool(MemoryPool<Derived>& pool, const SizeT& pool_size)
+{
+  std::vector<Derived*> block_pointers(pool_size);
+  pool.emplace_blocks(pool_size, block_pointers.data());
+  std::shuffle(block_pointers.begin(), block_pointers.end(), std::default_random_engine{});
+  pool.destroy_blocks(block_pointers.data(), pool_size - pool_size / 10);
+  block_pointers.erase(block_pointers.begin(), block_pointers.end() - pool_size / 10);
+  return block_pointers;
+}
+
+
+// Walks the live objects of a sparse pool, before or after it has been compacted
+template<bool IsCompacted>
+static void benchmark_derived_walk_sparse_pool(benchmark::State& state)
+{
+  const SizeT pool_size = state.range(0);
+  MemoryPool<Derived> pool(pool_size);
+  make_sparse_pool(pool, pool_size);
+  if (IsCompacted) pool.compact();
+  for (auto _ : state) {
+    pool.for_each_live([](Derived& obj) { obj.p.x += 1.0f; });
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * (pool_size / 10));
+}
+
+
+// Compacts a sparse pool in steps of at most 'state.range(1)' moves; reports the time taken
+// per object moved and the longest step
+static void benchmark_derived_incremental_compaction(benchmark::State& state)
+{
+  const SizeT pool_size = state.range(0);
+  memory_pool::CompactionBudget budget;
+  budget.Max_moves = state.range(1);
+  SizeT num_moved = 0;
+  double longest_step = 0.0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    MemoryPool<Derived> pool(pool_size);
+    make_sparse_pool(pool, pool_size);
+    state.ResumeTiming();
+
+    memory_pool::CompactionProgress progress;
+    do {
+      const auto start = std::chrono::steady_clock::now();
+      progress = pool.compact(budget);
+      const std::chrono::duration<double> step = std::chrono::steady_clock::now() - start;
+      longest_step = std::max(longest_step, step.count());
+      num_moved += progress.Num_moved;
+    } while (!progress.Is_complete);
+
+    state.PauseTiming();
+    pool.for_each_live([&](Derived& obj) { obj.~Derived(); });
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(num_moved);
+  state.counters["longest_step_us"] = longest_step * 1e6;
+}
+
+
+// Sums one field (x) or every field of 'pool_size' points, stored as an array of structs in a
+// MemoryPool (walked with for_each_live() or through the pool's contiguous block) or as a struct
+// of arrays in a StructSoaPool. Reading one field of a Point from the MemoryPool uses a third of
+// every cache line loaded; the SoaPool column uses all of it and the loop vectorises
+template<bool AllFields>
+static void benchmark_point_reduction_with_memory_pool(benchmark::State& state)
+{
+  const SizeT pool_size = state.range(0);
+  MemoryPool<Point> pool(pool_size);
+  for (SizeT i = 0; i < pool_size; i++) *pool.new_block_pt() = Point{int(i), 1, 2};
+  for (auto _ : state) {
+    int sum = 0;
+    pool.for_each_live([&sum](const Point& point) {
+      sum += AllFields ? point.x + point.y + point.z : point.x;
+    });
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * pool_size);
+}
+
+
+template<bool AllFields>
+static void benchmark_point_reduction_with_memory_pool_array(benchmark::State& state)
+{
+  const SizeT pool_size = state.range(0);
+  MemoryPool<Point> pool(pool_size);
+  Point* points = pool.new_block_pt();
+  *points = Point{0, 1, 2};
+  for (SizeT i = 1; i < pool_size; i++) *pool.new_block_pt() = Point{int(i), 1, 2};
+
+  // A fresh pool hands out its blocks in address order, so the points form an array
+  for (auto _ : state) {
+    int sum = 0;
+    for (SizeT i = 0; i < pool_size; i++) {
+      sum += AllFields ? points[i].x + points[i].y + points[i].z : points[i].x;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * pool_size);
+}
+
+
+template<bool AllFields>
+static void benchmark_point_reduction_with_soa_pool(benchmark::State& state)
+{
+  const SizeT pool_size = state.range(0);
+  StructSoaPool<Point> pool(pool_size);
+  for (SizeT i = 0; i < pool_size; i++) pool.insert(Point{int(i), 1, 2});
+  for (auto _ : state) {
+    const int* xs = pool.column<&Point::x>().data();
+    const int* ys = pool.column<&Point::y>().data();
+    const int* zs = pool.column<&Point::z>().data();
+    int sum = 0;
+    for (SizeT i = 0; i < pool_size; i++) sum += AllFields ? xs[i] + ys[i] + zs[i] : xs[i];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * pool_size);
+}
+
+
+static void benchmark_no_default_constructor_with_memory_pool(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  for (auto _ : state) {
+    MemoryPool<NoDefaultConstructor> pool(pool_size);
+    NoDefaultConstructor* block_pt = nullptr;
+    for (auto i = 0; i < pool_size; i++) {
+      block_pt = pool.new_block_pt(NoDefaultConstructor(i));
+      auto v = block_pt->GetNumber();
+    }
+  }
+}
+
+
+static void benchmark_table_pool_creation(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  for (auto _ : state) {
+    MemoryPool<Derived> pool(pool_size);
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+
+static void benchmark_table_pool_destruction(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+    MemoryPool<Derived> pool(pool_size);
+    state.ResumeTiming();
+    pool.clear();
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+
+static void benchmark_table_pool_reset(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<Derived> pool(pool_size);
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (auto i = 0; i < pool_size; i++) {
+      pool.new_block_pt();
+    }
+    state.ResumeTiming();
+    pool.reset();
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+
+static void benchmark_table_pool_block_allocation(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+    MemoryPool<Derived> pool(pool_size);
+    state.ResumeTiming();
+    for (auto i = 0; i < pool_size; i++) {
+      pool.new_block_pt();
+    }
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+static void benchmark_table_pool_block_deallocation(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+    MemoryPool<Derived> pool(pool_size);
+    std::vector<Derived*> block_pointers(pool_size);
+    for (auto i = 0; i < pool_size; i++) {
+      block_pointers[i] = pool.new_block_pt();
+    }
+    state.ResumeTiming();
+
+    for (auto i = 0; i < pool_size; i++) {
+      pool.delete_block_pt(block_pointers[i]);
+    }
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+static void benchmark_table_pool_random_block_allocations(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+
+    MemoryPool<Derived> pool(pool_size);
+    std::vector<Derived*> block_pointers(pool_size);
+
+    // Allocate all blocks
+    for (auto i = 0; i < pool_size; i++) block_pointers[i] = pool.new_block_pt();
+
+    // Shuffle the pointers so we deallocate/allocate in a random order
+    auto rng = std::default_random_engine{};
+    std::shuffle(block_pointers.begin(), block_pointers.end(), rng);
+
+    state.ResumeTiming();
+
+    // Complete several rounds of random allocation/deallocation
+    for (auto round = 0; round < 100; round++) {
+      state.PauseTiming();
+      for (auto i = 0; i < pool_size; i++) {
+        pool.delete_block_pt(block_pointers[i]);
+      }
+      state.ResumeTiming();
+
+      for (auto i = 0; i < pool_size; i++) {
+        block_pointers[i] = pool.new_block_pt();
+      }
+    }
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+static void benchmark_table_pool_random_block_deallocations(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+
+    MemoryPool<Derived> pool(pool_size);
+    std::vector<Derived*> block_pointers(pool_size);
+
+    // Allocate all blocks
+    for (auto i = 0; i < pool_size; i++) block_pointers[i] = pool.new_block_pt();
+
+    // Shuffle the pointers so we deallocate/allocate in a random order
+    auto rng = std::default_random_engine{};
+    std::shuffle(block_pointers.begin(), block_pointers.end(), rng);
+
+    state.ResumeTiming();
+
+    // Complete several rounds of random allocation/deallocation
+    for (auto round = 0; round < 100; round++) {
+      for (auto i = 0; i < pool_size; i++) {
+        pool.delete_block_pt(block_pointers[i]);
+      }
+
+      state.PauseTiming();
+      for (auto i = 0; i < pool_size; i++) {
+        block_pointers[i] = pool.new_block_pt();
+      }
+      state.ResumeTiming();
+    }
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+
+static void benchmark_table_growable_pool_block_allocation(benchmark::State& state)
+{
+  const auto& num_blocks = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+    MemoryPool<Derived> pool(8, 2);
+    state.ResumeTiming();
+    for (auto i = 0; i < num_blocks; i++) {
+      pool.new_block_pt();
+    }
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+
+static void benchmark_table_growable_pool_random_block_deallocations(benchmark::State& state)
+{
+  const auto& num_blocks = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+
+    MemoryPool<Derived> pool(8, 2);
+    std::vector<Derived*> block_pointers(num_blocks);
+
+    // Allocate all blocks (spread over many segments)
+    for (auto i = 0; i < num_blocks; i++) block_pointers[i] = pool.new_block_pt();
+
+    // Shuffle the pointers so each deallocation has to look up a random segment
+    auto rng = std::default_random_engine{};
+    std::shuffle(block_pointers.begin(), block_pointers.end(), rng);
+
+    state.ResumeTiming();
+
+    for (auto i = 0; i < num_blocks; i++) {
+      pool.delete_block_pt(block_pointers[i]);
+    }
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+
+// Number of blocks each thread allocates (then deallocates) per iteration in the multithreaded
+// benchmarks, and the maximum number of threads the shared pools are sized for
+const int g_NumBlocksPerThread = 64;
+const int g_MaxNumThreads = 64;
+
+
+static void benchmark_derived_threaded_allocations_with_mutex_memory_pool(benchmark::State& state)
+{
+  static MemoryPool<Derived> pool(g_NumBlocksPerThread * g_MaxNumThreads);
+  static std::mutex pool_mutex;
+  std::vector<Derived*> block_pointers(g_NumBlocksPerThread);
+  for (auto _ : state) {
+    for (auto i = 0; i < g_NumBlocksPerThread; i++) {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      block_pointers[i] = pool.new_block_pt();
+    }
+    for (auto i = 0; i < g_NumBlocksPerThread; i++) {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      pool.delete_block_pt(block_pointers[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * g_NumBlocksPerThread * 2);
+}
+
+
+// As above, but with the pool doing its own locking as its locking policy 'Lock' says
+template<class Lock>
+static void benchmark_derived_threaded_allocations_with_lock_policy(benchmark::State& state)
+{
+  static MemoryPool<Derived, Lock> pool(g_NumBlocksPerThread * g_MaxNumThreads);
+  std::vector<Derived*> block_pointers(g_NumBlocksPerThread);
+  for (auto _ : state) {
+    for (auto i = 0; i < g_NumBlocksPerThread; i++) {
+      block_pointers[i] = pool.new_block_pt();
+    }
+    for (auto i = 0; i < g_NumBlocksPerThread; i++) {
+      pool.delete_block_pt(block_pointers[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * g_NumBlocksPerThread * 2);
+}
+
+
+static void benchmark_derived_threaded_allocations_with_concurrent_memory_pool(
+  benchmark::State& state)
+{
+  static ConcurrentMemoryPool<Derived> pool(g_NumBlocksPerThread * g_MaxNumThreads);
+  std::vector<Derived*> block_pointers(g_NumBlocksPerThread);
+  for (auto _ : state) {
+    for (auto i = 0; i < g_NumBlocksPerThread; i++) {
+      block_pointers[i] = pool.new_block_pt();
+    }
+    for (auto i = 0; i < g_NumBlocksPerThread; i++) {
+      pool.delete_block_pt(block_pointers[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * g_NumBlocksPerThread * 2);
+}
+
+
+static void benchmark_derived_threaded_allocations_with_thread_caching_memory_pool(
+  benchmark::State& state)
+{
+  // Leave room for every thread to fill its magazine
+  static ThreadCachingMemoryPool<Derived> pool(
+    (g_NumBlocksPerThread + memory_pool::g_DefaultMagazineSize) * g_MaxNumThreads);
+  std::vector<Derived*> block_pointers(g_NumBlocksPerThread);
+  for (auto _ : state) {
+    for (auto i = 0; i < g_NumBlocksPerThread; i++) {
+      block_pointers[i] = pool.new_block_pt();
+    }
+    for (auto i = 0; i < g_NumBlocksPerThread; i++) {
+      pool.delete_block_pt(block_pointers[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * g_NumBlocksPerThread * 2);
+}
+
+
+// A single-producer/single-consumer queue of block pointers, used to hand blocks allocated by
+// one thread to another thread which deallocates them
+template<class T>
+class BlockQueue {
+public:
+  void push(T* block_pt)
+  {
+    const auto tail = Tail.load(std::memory_order_relaxed);
+    while (tail - Head.load(std::memory_order_acquire) == Capacity) std::this_thread::yield();
+    Blocks[tail % Capacity] = block_pt;
+    Tail.store(tail + 1, std::memory_order_release);
+  }
+
+  T* pop()
+  {
+    const auto head = Head.load(std::memory_order_relaxed);
+    while (Tail.load(std::memory_order_acquire) == head) std::this_thread::yield();
+    T* block_pt = Blocks[head % Capacity];
+    Head.store(head + 1, std::memory_order_release);
+    return block_pt;
+  }
+
+private:
+  static constexpr std::size_t Capacity = 1024;
+  T* Blocks[Capacity];
+  alignas(64) std::atomic<std::size_t> Head{0};
+  alignas(64) std::atomic<std::size_t> Tail{0};
+};
+
+
+// Thread 0 allocates blocks and hands them to thread 1, which deallocates them
+template<class Pool>
+static void run_producer_consumer(benchmark::State& state, Pool& pool, BlockQueue<Derived>& queue)
+{
+  for (auto _ : state) {
+    if (state.thread_index() == 0) {
+      for (auto i = 0; i < g_NumBlocksPerThread; i++) queue.push(pool.new_block_pt());
+    }
+    else {
+      for (auto i = 0; i < g_NumBlocksPerThread; i++) {
+        Derived* block_pt = queue.pop();
+        pool.delete_block_pt(block_pt);
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * g_NumBlocksPerThread);
+}
+
+
+// Wraps a MemoryPool with a mutex so it can be shared between threads
+struct MutexMemoryPool {
+  MutexMemoryPool(const memory_pool::SizeT& num_blocks) : Pool(num_blocks) {}
+
+  Derived* new_block_pt()
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Pool.new_block_pt();
+  }
+
+  void delete_block_pt(Derived*& block_pt)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Pool.delete_block_pt(block_pt);
+  }
+
+  MemoryPool<Derived> Pool;
+  std::mutex Mutex;
+};
+
+
+static void benchmark_derived_producer_consumer_with_mutex_memory_pool(benchmark::State& state)
+{
+  static MutexMemoryPool pool(4096);
+  static BlockQueue<Derived> queue;
+  run_producer_consumer(state, pool, queue);
+}
+
+
+static void benchmark_derived_producer_consumer_with_concurrent_memory_pool(benchmark::State& state)
+{
+  static ConcurrentMemoryPool<Derived> pool(4096);
+  static BlockQueue<Derived> queue;
+  run_producer_consumer(state, pool, queue);
+}
+
+
+template<int MagazineSize>
+static void benchmark_derived_producer_consumer_with_thread_caching_memory_pool(
+  benchmark::State& state)
+{
+  // The consumer's magazine fills up and is flushed back to the depot in batches, which the
+  // producer then refills its magazine from
+  static ThreadCachingMemoryPool<Derived> pool(4096, MagazineSize);
+  static BlockQueue<Derived> queue;
+  run_producer_consumer(state, pool, queue);
+}
+
+
+// Inserts 'num_entries' randomly ordered keys into 'map' then erases them all again
+template<class Map>
+static void fill_and_empty_map(Map& map, const std::vector<int>& keys)
+{
+  for (const auto& key : keys) map.emplace(key, Point{key, key + 1, key + 2});
+  for (const auto& key : keys) map.erase(key);
+}
+
+
+static std::vector<int> shuffled_keys(const int& num_keys)
+{
+  std::vector<int> keys(num_keys);
+  for (auto i = 0; i < num_keys; i++) keys[i] = i;
+  std::shuffle(keys.begin(), keys.end(), std::default_random_engine{});
+  return keys;
+}
+
+
+static void benchmark_point_map_with_default_allocator(benchmark::State& state)
+{
+  const auto keys = shuffled_keys(state.range(0));
+  std::map<int, Point> map;
+  for (auto _ : state) {
+    fill_and_empty_map(map, keys);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+
+static void benchmark_point_map_with_pool_allocator(benchmark::State& state)
+{
+  using Allocator = PoolAllocator<std::pair<const int, Point>>;
+  const auto keys = shuffled_keys(state.range(0));
+  std::map<int, Point, std::less<int>, Allocator> map(Allocator(state.range(0)));
+  for (auto _ : state) {
+    fill_and_empty_map(map, keys);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+
+static void benchmark_point_map_with_pool_memory_resource(benchmark::State& state)
+{
+  const auto keys = shuffled_keys(state.range(0));
+  PoolMemoryResource<64> resource(state.range(0));
+  std::pmr::map<int, Point> map(&resource);
+  for (auto _ : state) {
+    fill_and_empty_map(map, keys);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+
+// Variable-sized allocators compared by the benchmark below, with the same interface as
+// SizeClassAllocator
+struct MallocAllocator {
+  void* allocate(const std::size_t& bytes) { return std::malloc(bytes); }
+  void deallocate(void* pt, const std::size_t& /* bytes */) { std::free(pt); }
+};
+
+struct PmrPoolAllocator {
+  void* allocate(const std::size_t& bytes)
+  {
+    return Resource.allocate(bytes, alignof(std::max_align_t));
+  }
+  void deallocate(void* pt, const std::size_t& bytes)
+  {
+    Resource.deallocate(pt, bytes, alignof(std::max_align_t));
+  }
+  std::pmr::unsynchronized_pool_resource Resource{std::pmr::pool_options{0, 4096}};
+};
+
+
+// Keeps 'num_live' variable-sized allocations alive, repeatedly freeing a random one and
+// allocating a new one in its place. The sizes follow a log-uniform distribution between
+// 16 bytes and 4 KiB, like the message payloads of a typical service: most are small, with a
+// long tail of larger ones
+template<class Allocator>
+static void benchmark_variable_size_churn(benchmark::State& state)
+{
+  const auto& num_live = state.range(0);
+  const std::size_t num_ops = 1 << 14;
+  std::default_random_engine engine;
+  std::uniform_real_distribution<double> log_size_distribution(std::log(16.0), std::log(4096.0));
+  std::uniform_int_distribution<std::size_t> slot_distribution(0, num_live - 1);
+  std::vector<std::size_t> sizes(num_ops);
+  std::vector<std::size_t> slots(num_ops);
+  for (std::size_t i = 0; i < num_ops; i++) {
+    sizes[i] = static_cast<std::size_t>(std::exp(log_size_distribution(engine)));
+    slots[i] = slot_distribution(engine);
+  }
+
+  Allocator allocator;
+  std::vector<std::pair<char*, std::size_t>> live(num_live);
+  for (std::size_t i = 0; i < live.size(); i++) {
+    const std::size_t bytes = sizes[i % num_ops];
+    live[i] = {static_cast<char*>(allocator.allocate(bytes)), bytes};
+  }
+
+  std::size_t op = 0;
+  for (auto _ : state) {
+    auto& [pt, bytes] = live[slots[op]];
+    allocator.deallocate(pt, bytes);
+    bytes = sizes[op];
+    pt = static_cast<char*>(allocator.allocate(bytes));
+    pt[0] = 1;
+    op = (op + 1) % num_ops;
+  }
+  state.SetItemsProcessed(state.iterations());
+  for (auto& [pt, bytes] : live) allocator.deallocate(pt, bytes);
+}
+
+
+// The Point inside a Point or Derived, which the layout benchmarks read and write
+static Point& point_of(Point& point) { return point; }
+static Point& point_of(Derived& derived) { return derived.p; }
+
+
+// Creates 'pool_size' objects in a pool with the given slot layout, updates each of them a
+// number of times, then destroys them again
+template<class T, class Layout>
+static void benchmark_layout_single_thread(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<T, memory_pool::HeapStorage, Layout> pool(pool_size);
+  std::vector<T*> block_pointers(pool_size);
+  for (auto _ : state) {
+    pool.emplace_blocks(pool_size, block_pointers.data());
+    for (auto round = 0; round < 10; round++) {
+      for (T* block_pt : block_pointers) point_of(*block_pt).x++;
+    }
+    pool.destroy_blocks(block_pointers.data(), pool_size);
+  }
+  state.SetItemsProcessed(state.iterations() * pool_size);
+}
+
+
+// Each thread repeatedly updates its own objects in a shared pool. The objects are handed
+// out round-robin, so with a packed layout neighbouring objects belong to different threads
+// and share cache lines (false sharing); padding each block to a cache line avoids this
+template<class T, class Layout>
+static void benchmark_layout_multiple_threads(benchmark::State& state)
+{
+  static ConcurrentMemoryPool<T, Layout> pool(g_NumBlocksPerThread * g_MaxNumThreads);
+  static const std::vector<T*> all_block_pointers = []() {
+    std::vector<T*> block_pointers(g_NumBlocksPerThread * g_MaxNumThreads);
+    for (auto& block_pt : block_pointers) block_pt = pool.emplace();
+    return block_pointers;
+  }();
+
+  std::vector<T*> block_pointers;
+  for (auto i = 0; i < g_NumBlocksPerThread; i++) {
+    block_pointers.push_back(all_block_pointers[i * state.threads() + state.thread_index()]);
+  }
+  for (auto _ : state) {
+    for (T* block_pt : block_pointers) {
+      Point& point = point_of(*block_pt);
+      benchmark::DoNotOptimize(point.x++);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * g_NumBlocksPerThread);
+}
+
+
+#ifdef MEMORY_POOL_HAS_MMAP_STORAGE
+using memory_pool::Decommit;
+using memory_pool::HugePages;
+using memory_pool::MmapStorage;
+using memory_pool::Prefault;
+
+// A cache line sized block, so every access in the benchmarks below touches its own line
+using CacheLineBlock = memory_pool::RawBlock<64, 64>;
+
+// The storage backends compared below
+using NormalPages = MmapStorage<HugePages::None>;
+using PrefaultedNormalPages = MmapStorage<HugePages::None, Prefault::Populate>;
+using TransparentHugePages = MmapStorage<HugePages::Transparent>;
+using PrefaultedTransparentHugePages = MmapStorage<HugePages::Transparent, Prefault::Populate>;
+using PrefaultedExplicitHugePages = MmapStorage<HugePages::Explicit, Prefault::Populate>;
+using LazilyFreedNormalPages = MmapStorage<HugePages::None, Prefault::None, Decommit::Free>;
+
+
+// Measures how long it takes to hand out and first write to every block in a freshly created
+// pool; i.e. the cost of the page faults (if any) that happen on the allocation path
+template<class Storage>
+static void benchmark_first_touch_with_storage(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto pool_pt = std::make_unique<MemoryPool<CacheLineBlock, Storage>>(pool_size);
+    state.ResumeTiming();
+
+    for (auto i = 0; i < pool_size; i++) {
+      CacheLineBlock* block_pt = pool_pt->new_block_pt();
+      block_pt->Bytes[0] = std::byte{1};
+      benchmark::DoNotOptimize(block_pt);
+    }
+
+    state.PauseTiming();
+    pool_pt.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * pool_size);
+}
+
+
+// Measures the throughput of reading the blocks of a (fully allocated) pool in a random order,
+// which is dominated by cache and TLB misses for large pools
+template<class Storage>
+static void benchmark_random_access_with_storage(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<CacheLineBlock, Storage> pool(pool_size);
+  std::vector<CacheLineBlock*> block_pointers(pool_size);
+  pool.new_blocks(pool_size, block_pointers.data());
+  for (auto i = 0; i < pool_size; i++) block_pointers[i]->Bytes[0] = std::byte(i);
+  std::shuffle(block_pointers.begin(), block_pointers.end(), std::default_random_engine{});
+
+  for (auto _ : state) {
+    unsigned sum = 0;
+    for (CacheLineBlock* block_pt : block_pointers) {
+      sum += std::to_integer<unsigned>(block_pt->Bytes[0]);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * pool_size);
+}
+
+
+// The resident set size of the process in bytes, or 0 if it cannot be read
+static double resident_bytes()
+{
+  std::FILE* file = std::fopen("/proc/self/statm", "r");
+  if (file == nullptr) return 0.0;
+  unsigned long long num_pages = 0;
+  unsigned long long num_resident_pages = 0;
+  const int num_read = std::fscanf(file, "%llu %llu", &num_pages, &num_resident_pages);
+  std::fclose(file);
+  if (num_read != 2) return 0.0;
+  return static_cast<double>(num_resident_pages) * static_cast<double>(::sysconf(_SC_PAGESIZE));
+}
+
+
+// Allocates and writes to every block in a pool, frees them all, idles (trimming the pool or
+// not) and then does the same again. Times the second burst, which pays for committing any
+// released pages again, and reports the resident set size at the end of the first burst and
+// while idle
+template<class Storage, bool IsTrimmed>
+static void benchmark_burst_idle_burst_with_storage(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  MemoryPool<CacheLineBlock, Storage> pool(pool_size);
+  std::vector<CacheLineBlock*> block_pointers(pool_size);
+  auto burst = [&]() {
+    pool.new_blocks(pool_size, block_pointers.data());
+    for (CacheLineBlock* block_pt : block_pointers) block_pt->Bytes[0] = std::byte{1};
+    pool.delete_blocks(block_pointers.data(), pool_size);
+  };
+
+  double busy_bytes = 0.0;
+  double idle_bytes = 0.0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    burst();
+    busy_bytes = resident_bytes();
+    if (IsTrimmed) pool.trim();
+    idle_bytes = resident_bytes();
+    state.ResumeTiming();
+
+    burst();
+  }
+  state.SetItemsProcessed(state.iterations() * pool_size);
+  state.counters["busy_rss_mb"] = busy_bytes / (1 << 20);
+  state.counters["idle_rss_mb"] = idle_bytes / (1 << 20);
+}
+
+
+// Where the persistent pool benchmarks keep their pool
+static std::string benchmark_pool_path()
+{
+  return "/tmp/mempool-benchmark." + std::to_string(::getpid()) + ".pool";
+}
+
+
+// Starts a process cold: creates a new persistent pool and fills it with the objects it would
+// otherwise have restored, then reads them once
+static void benchmark_cold_start_with_persistent_pool(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  const std::string path = benchmark_pool_path();
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::remove(path.c_str());
+    state.ResumeTiming();
+
+    memory_pool::PersistentMemoryPool<Point> pool(path, pool_size);
+    for (int i = 0; i < pool_size; i++) pool.emplace(Point{i, i + 1, i + 2});
+    long long sum = 0;
+    pool.for_each_live([&sum](const Point& point) { sum += point.z; });
+    benchmark::DoNotOptimize(sum);
+  }
+  std::remove(path.c_str());
+  state.SetItemsProcessed(state.iterations() * pool_size);
+}
+
+
+// Restarts a process warm: reopens a full persistent pool written by an earlier "process" and
+// reads every object in it once
+static void benchmark_warm_restart_with_persistent_pool(benchmark::State& state)
+{
+  const auto& pool_size = state.range(0);
+  const std::string path = benchmark_pool_path();
+  std::remove(path.c_str());
+  {
+    memory_pool::PersistentMemoryPool<Point> pool(path, pool_size);
+    for (int i = 0; i < pool_size; i++) pool.emplace(Point{i, i + 1, i + 2});
+  }
+  for (auto _ : state) {
+    memory_pool::PersistentMemoryPool<Point> pool(path, pool_size);
+    long long sum = 0;
+    pool.for_each_live([&sum](const Point& point) { sum += point.z; });
+    benchmark::DoNotOptimize(sum);
+  }
+  std::remove(path.c_str());
+  state.SetItemsProcessed(state.iterations() * pool_size);
+}
+
+
+// Hands 4 KiB records from a sender to a receiver over a Unix socket pair, 64 at a time. With
+// 'IsZeroCopy', the sender builds each record in a SharedMemoryPool and sends its 8-byte offset,
+// and the receiver reads the record in place through a second mapping of the pool and frees
+// it. Otherwise each record is copied through the socket
+template<bool IsZeroCopy>
+static void benchmark_handoff_over_socket(benchmark::State& state)
+{
+  using Record = memory_pool::RawBlock<4096, 64>;
+  constexpr int batch_size = 64;
+  const std::string name = "/mempool-benchmark." + std::to_string(::getpid());
+  memory_pool::SharedMemoryPool<Record>::unlink(name);
+  memory_pool::SharedMemoryPool<Record> sender_pool(name, batch_size);
+  memory_pool::SharedMemoryPool<Record> receiver_pool(name, batch_size);
+  int socket_fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds) != 0) {
+    state.SkipWithError("socketpair() failed");
+    return;
+  }
+  int buffer_size = 1 << 20;
+  ::setsockopt(socket_fds[0], SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+  ::setsockopt(socket_fds[1], SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+  Record record;
+  unsigned sum = 0;
+  for (auto _ : state) {
+    for (int i = 0; i < batch_size; i++) {
+      if (IsZeroCopy) {
+        Record* record_pt = sender_pool.new_block_pt();
+        record_pt->Bytes[0] = std::byte(i);
+        const auto offset = sender_pool.offset_of(record_pt);
+        benchmark::DoNotOptimize(::write(socket_fds[0], &offset, sizeof(offset)));
+      }
+      else {
+        record.Bytes[0] = std::byte(i);
+        benchmark::DoNotOptimize(::write(socket_fds[0], &record, sizeof(record)));
+      }
+    }
+    for (int i = 0; i < batch_size; i++) {
+      if (IsZeroCopy) {
+        memory_pool::SharedOffset<Record> offset;
+        benchmark::DoNotOptimize(::read(socket_fds[1], &offset, sizeof(offset)));
+        Record* record_pt = receiver_pool.from_offset(offset);
+        sum += std::to_integer<unsigned>(record_pt->Bytes[0]);
+        receiver_pool.delete_block_pt(record_pt);
+      }
+      else {
+        for (SizeT num_read = 0; num_read < sizeof(record);) {
+          const auto result =
+            ::read(socket_fds[1], record.Bytes + num_read, sizeof(record) - num_read);
+          if (result <= 0) break;
+          num_read += static_cast<SizeT>(result);
+        }
+        sum += std::to_integer<unsigned>(record.Bytes[0]);
+      }
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  ::close(socket_fds[0]);
+  ::close(socket_fds[1]);
+  memory_pool::SharedMemoryPool<Record>::unlink(name);
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+#endif
+
+
+// Register the benchmarking functions as a benchmark. The Arg(...) arguments are passed in the
+// benchmark::Start object
+BENCHMARK(benchmark_point_multiple_pool_allocations_with_memory_pool)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512);
+BENCHMARK(benchmark_point_multiple_pool_allocations_with_vector)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512);
+BENCHMARK(benchmark_point_requests_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK(benchmark_point_requests_with_arena)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK(benchmark_mixed_requests_with_arena)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK(benchmark_mixed_requests_with_new_delete)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK(benchmark_point_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK_TEMPLATE(benchmark_point_with_static_memory_pool, 8);
+BENCHMARK_TEMPLATE(benchmark_point_with_static_memory_pool, 32);
+BENCHMARK_TEMPLATE(benchmark_point_with_static_memory_pool, 128);
+BENCHMARK_TEMPLATE(benchmark_point_with_static_memory_pool, 512);
+BENCHMARK(benchmark_base1_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK(benchmark_base2_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK(benchmark_derived_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK(benchmark_derived_emplace_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK(benchmark_derived_with_vector)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK(benchmark_derived_random_allocations_and_deallocations_with_memory_pool)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512)
+  ->Arg(1000);
+BENCHMARK(benchmark_derived_random_allocations_and_deallocations_with_memory_pool_batched)
+  ->ArgsProduct({{8, 32, 128, 512, 1000}, {16, 64, 1000}});
+BENCHMARK_TEMPLATE(
+  benchmark_derived_random_allocations_and_deallocations_with_static_memory_pool, 8);
+BENCHMARK_TEMPLATE(
+  benchmark_derived_random_allocations_and_deallocations_with_static_memory_pool, 32);
+BENCHMARK_TEMPLATE(
+  benchmark_derived_random_allocations_and_deallocations_with_static_memory_pool, 128);
+BENCHMARK_TEMPLATE(
+  benchmark_derived_random_allocations_and_deallocations_with_static_memory_pool, 512);
+BENCHMARK_TEMPLATE(
+  benchmark_derived_random_allocations_and_deallocations_with_static_memory_pool, 1000);
+BENCHMARK_TEMPLATE(benchmark_derived_random_allocations_and_deallocations_with_tracker,
+                   memory_pool::BlockTracker)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_derived_random_allocations_and_deallocations_with_tracker,
+                   memory_pool::BitmapTracker)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_derived_random_allocations_and_deallocations_with_stats,
+                   memory_pool::NoStats)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_derived_random_allocations_and_deallocations_with_stats,
+                   memory_pool::PoolStats)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_derived_random_allocations_and_deallocations_with_stats,
+                   memory_pool::PoolTrace<>)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_derived_traversal_after_churn_with_tracker, memory_pool::BlockTracker)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_derived_traversal_after_churn_with_tracker, memory_pool::BitmapTracker)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16)
+  ->Arg(1 << 20);
+BENCHMARK(benchmark_derived_update_live_with_side_vector)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK(benchmark_derived_update_live_with_for_each_live)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16)
+  ->Arg(1 << 20);
+BENCHMARK(benchmark_derived_update_live_with_parallel_for_each_live)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16)
+  ->Arg(1 << 20)
+  ->UseRealTime();
+BENCHMARK(benchmark_derived_update_through_pointers)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 19);
+BENCHMARK(benchmark_derived_update_through_handles)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 19);
+BENCHMARK_TEMPLATE(benchmark_derived_walk_sparse_pool, false)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_derived_walk_sparse_pool, true)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK(benchmark_derived_incremental_compaction)
+  ->Args({1 << 16, 1 << 16})
+  ->Args({1 << 16, 1 << 10})
+  ->Args({1 << 16, 1 << 6});
+BENCHMARK_TEMPLATE(benchmark_point_reduction_with_memory_pool, false)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16)
+  ->Arg(1 << 22);
+BENCHMARK_TEMPLATE(benchmark_point_reduction_with_memory_pool_array, false)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16)
+  ->Arg(1 << 22);
+BENCHMARK_TEMPLATE(benchmark_point_reduction_with_soa_pool, false)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16)
+  ->Arg(1 << 22);
+BENCHMARK_TEMPLATE(benchmark_point_reduction_with_memory_pool, true)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16)
+  ->Arg(1 << 22);
+BENCHMARK_TEMPLATE(benchmark_point_reduction_with_memory_pool_array, true)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16)
+  ->Arg(1 << 22);
+BENCHMARK_TEMPLATE(benchmark_point_reduction_with_soa_pool, true)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16)
+  ->Arg(1 << 22);
+BENCHMARK(benchmark_no_default_constructor_with_memory_pool)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+BENCHMARK(benchmark_no_default_constructor_emplace_with_memory_pool)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512);
+BENCHMARK(benchmark_table_pool_creation)->Arg(8)->Arg(32)->Arg(128)->Arg(512)->Complexity();
+BENCHMARK(benchmark_table_pool_destruction)->Arg(8)->Arg(32)->Arg(128)->Arg(512)->Complexity();
+BENCHMARK(benchmark_table_pool_reset)->Arg(8)->Arg(32)->Arg(128)->Arg(512)->Complexity();
+BENCHMARK(benchmark_table_pool_block_allocation)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512)
+  ->Arg(1000000)
+  ->Complexity();
+BENCHMARK(benchmark_table_pool_block_deallocation)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512)
+  ->Arg(1000000)
+  ->Complexity();
+BENCHMARK(benchmark_table_pool_random_block_allocations)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512)
+  ->Complexity();
+BENCHMARK(benchmark_table_pool_random_block_deallocations)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512)
+  ->Complexity();
+
+BENCHMARK(benchmark_table_growable_pool_block_allocation)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512)
+  ->Arg(1000000)
+  ->Complexity();
+BENCHMARK(benchmark_table_growable_pool_random_block_deallocations)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512)
+  ->Arg(1000000)
+  ->Complexity();
+
+BENCHMARK(benchmark_derived_threaded_allocations_with_mutex_memory_pool)
+  ->ThreadRange(1, g_MaxNumThreads)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_derived_threaded_allocations_with_lock_policy, memory_pool::NoLock)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_derived_threaded_allocations_with_lock_policy, std::mutex)
+  ->ThreadRange(1, g_MaxNumThreads)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_derived_threaded_allocations_with_lock_policy, memory_pool::SpinLock)
+  ->ThreadRange(1, g_MaxNumThreads)
+  ->UseRealTime();
+BENCHMARK(benchmark_derived_threaded_allocations_with_concurrent_memory_pool)
+  ->ThreadRange(1, g_MaxNumThreads)
+  ->UseRealTime();
+
+BENCHMARK(benchmark_derived_threaded_allocations_with_thread_caching_memory_pool)
+  ->ThreadRange(1, g_MaxNumThreads)
+  ->UseRealTime();
+BENCHMARK(benchmark_derived_producer_consumer_with_mutex_memory_pool)->Threads(2)->UseRealTime();
+BENCHMARK(benchmark_derived_producer_consumer_with_concurrent_memory_pool)
+  ->Threads(2)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_derived_producer_consumer_with_thread_caching_memory_pool, 16)
+  ->Threads(2)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_derived_producer_consumer_with_thread_caching_memory_pool, 64)
+  ->Threads(2)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_derived_producer_consumer_with_thread_caching_memory_pool, 256)
+  ->Threads(2)
+  ->UseRealTime();
+
+BENCHMARK(benchmark_point_map_with_default_allocator)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK(benchmark_point_map_with_pool_allocator)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK(benchmark_point_map_with_pool_memory_resource)
+  ->Arg(8)
+  ->Arg(32)
+  ->Arg(128)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_variable_size_churn, MallocAllocator)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_variable_size_churn, PmrPoolAllocator)->Arg(1 << 10)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_variable_size_churn, SizeClassAllocator<4096>)
+  ->Arg(1 << 10)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_layout_single_thread, Point, memory_pool::NaturalLayout)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_layout_single_thread, Point, memory_pool::PowerOfTwoLayout)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_layout_single_thread, Point, memory_pool::CacheLineLayout)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_layout_single_thread, Derived, memory_pool::NaturalLayout)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_layout_single_thread, Derived, memory_pool::PowerOfTwoLayout)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_layout_single_thread, Derived, memory_pool::CacheLineLayout)
+  ->Arg(512)
+  ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(benchmark_layout_multiple_threads, Point, memory_pool::NaturalLayout)
+  ->ThreadRange(1, 8)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_layout_multiple_threads, Point, memory_pool::PowerOfTwoLayout)
+  ->ThreadRange(1, 8)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_layout_multiple_threads, Point, memory_pool::CacheLineLayout)
+  ->ThreadRange(1, 8)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_layout_multiple_threads, Derived, memory_pool::NaturalLayout)
+  ->ThreadRange(1, 8)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_layout_multiple_threads, Derived, memory_pool::PowerOfTwoLayout)
+  ->ThreadRange(1, 8)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(benchmark_layout_multiple_threads, Derived, memory_pool::CacheLineLayout)
+  ->ThreadRange(1, 8)
+  ->UseRealTime();
+#ifdef MEMORY_POOL_HAS_MMAP_STORAGE
+BENCHMARK_TEMPLATE(benchmark_first_touch_with_storage, memory_pool::HeapStorage)
+  ->Arg(1 << 14)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_first_touch_with_storage, NormalPages)->Arg(1 << 14)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_first_touch_with_storage, PrefaultedNormalPages)
+  ->Arg(1 << 14)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_first_touch_with_storage, TransparentHugePages)
+  ->Arg(1 << 14)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_first_touch_with_storage, PrefaultedTransparentHugePages)
+  ->Arg(1 << 14)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_first_touch_with_storage, PrefaultedExplicitHugePages)
+  ->Arg(1 << 14)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_random_access_with_storage, memory_pool::HeapStorage)
+  ->Arg(1 << 14)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_random_access_with_storage, NormalPages)->Arg(1 << 14)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_random_access_with_storage, TransparentHugePages)
+  ->Arg(1 << 14)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_random_access_with_storage, PrefaultedExplicitHugePages)
+  ->Arg(1 << 14)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_burst_idle_burst_with_storage, NormalPages, false)
+  ->Arg(1 << 16)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_burst_idle_burst_with_storage, NormalPages, true)
+  ->Arg(1 << 16)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_burst_idle_burst_with_storage, LazilyFreedNormalPages, true)
+  ->Arg(1 << 16)
+  ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_burst_idle_burst_with_storage, TransparentHugePages, true)
+  ->Arg(1 << 16)
+  ->Arg(1 << 20);
+BENCHMARK(benchmark_cold_start_with_persistent_pool)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK(benchmark_warm_restart_with_persistent_pool)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(benchmark_handoff_over_socket, false);
+BENCHMARK_TEMPLATE(benchmark_handoff_over_socket, true);
+#endif
 
 
 // Run the benchmark
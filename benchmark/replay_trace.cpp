@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "ExampleClasses.h"
+#include "bitmap_tracker.h"
+#include "concurrent_memory_pool.h"
+#include "memory_pool.h"
+#include "pool_trace.h"
+#include "slot_layout.h"
+#include "thread_caching_memory_pool.h"
+
+using memory_pool::BitmapTracker;
+using memory_pool::BlockTracker;
+using memory_pool::HeapStorage;
+using memory_pool::MemoryPool;
+using memory_pool::NaturalLayout;
+using memory_pool::PoolSummary;
+using memory_pool::SizeT;
+using memory_pool::Trace;
+using memory_pool::TraceOp;
+using memory_pool::TraceRecord;
+
+// Replays a trace recorded with PoolTrace (see pool_trace.h) against several pool
+// configurations:
+//
+//   ./benchmark/replay_trace [<benchmark flags>] [workload.trace]
+//
+// Every traced pool gets a pool of the configuration under test, sized for the most objects
+// the traced pool ever had allocated at once. Objects are replaced by raw blocks of their size
+// rounded up to a power of two. The events are applied as fast as possible, in the recorded
+// order; the recorded times are not waited for. Without a trace file, a sample trace is
+// recorded first.
+
+
+// The largest object size that can be replayed
+constexpr SizeT g_MaxObjectSize = 4096;
+
+
+// A stand-in for the new/delete a pool would replace
+template<class Object>
+struct NewDeletePool {
+  explicit NewDeletePool(const SizeT& /* num_blocks */) {}
+  Object* new_block_pt() { return new Object; }
+  void delete_block_pt(Object*& obj_pt)
+  {
+    delete obj_pt;
+    obj_pt = nullptr;
+  }
+};
+
+// The pool configurations to compare
+template<class Object>
+using BlockTrackerPool = MemoryPool<Object>;
+template<class Object>
+using BitmapTrackerPool = MemoryPool<Object, HeapStorage, NaturalLayout, BitmapTracker>;
+template<class Object>
+using CacheLinePool = MemoryPool<Object, HeapStorage, memory_pool::CacheLineLayout>;
+template<class Object>
+using ConcurrentPool = memory_pool::ConcurrentMemoryPool<Object>;
+template<class Object>
+struct ThreadCachingPool : memory_pool::ThreadCachingMemoryPool<Object> {
+  // Leave room for the magazine of the replaying thread
+  explicit ThreadCachingPool(const SizeT& num_blocks)
+    : memory_pool::ThreadCachingMemoryPool<Object>(
+        num_blocks + memory_pool::g_DefaultMagazineSize)
+  {}
+};
+
+
+// Replays the events of one traced pool
+class PoolReplay {
+public:
+  virtual ~PoolReplay() = default;
+
+  // Applies a recorded event
+  virtual void apply(const TraceRecord& record) = 0;
+};
+
+// Replays the events of one traced pool against a pool of type Pool. Keeps the object
+// allocated in each slot of the traced pool, so deallocations free the same object
+template<class Pool, class Object>
+class PoolReplayWith : public PoolReplay {
+public:
+  PoolReplayWith(const SizeT& num_blocks, const SizeT& num_slots)
+    : Replay_pool(num_blocks), Slots(num_slots, nullptr), Moving_pt(nullptr)
+  {}
+
+  ~PoolReplayWith() override { free_all(); }
+
+  void apply(const TraceRecord& record) override
+  {
+    Object*& slot_pt = Slots[record.Slot];
+    switch (record.Op) {
+      case TraceOp::Allocate:
+        slot_pt = Replay_pool.new_block_pt();
+        slot_pt->Bytes[0] = std::byte{1};
+        break;
+      case TraceOp::Deallocate:
+        if (slot_pt != nullptr) Replay_pool.delete_block_pt(slot_pt);
+        break;
+      case TraceOp::Relocate_from:
+        Moving_pt = slot_pt;
+        slot_pt = nullptr;
+        break;
+      case TraceOp::Relocate_to:
+        slot_pt = Moving_pt;
+        break;
+      case TraceOp::Reset:
+        free_all();
+        break;
+    }
+  }
+
+private:
+  void free_all()
+  {
+    for (Object*& obj_pt : Slots) {
+      if (obj_pt != nullptr) Replay_pool.delete_block_pt(obj_pt);
+    }
+  }
+
+  Pool Replay_pool;
+  std::vector<Object*> Slots;
+  Object* Moving_pt;
+};
+
+
+// Creates the replay of a traced pool with Pool<RawBlock<size>>, where 'size' is the object
+// size rounded up to a power of two
+template<template<class> class Pool, SizeT Size = 8>
+static std::unique_ptr<PoolReplay> make_replay(const PoolSummary& summary)
+{
+  if constexpr (Size > g_MaxObjectSize) {
+    return nullptr;
+  }
+  else if (summary.Object_size > Size) {
+    return make_replay<Pool, 2 * Size>(summary);
+  }
+  else {
+    using Object = memory_pool::RawBlock<Size, 8>;
+    return std::make_unique<PoolReplayWith<Pool<Object>, Object>>(
+      std::max<SizeT>(summary.Peak_live, 1), summary.Num_slots);
+  }
+}
+
+// Replays the trace once per iteration. Creating and destroying the pools is not timed
+template<template<class> class Pool>
+static void benchmark_replay(benchmark::State& state, const Trace& trace)
+{
+  const std::vector<PoolSummary> summaries = memory_pool::summarise_trace(trace);
+  std::vector<std::unique_ptr<PoolReplay>> replays(summaries.size());
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (SizeT i = 0; i < summaries.size(); i++) {
+      if (summaries[i].Num_slots > 0) replays[i] = make_replay<Pool>(summaries[i]);
+    }
+    state.ResumeTiming();
+
+    for (const TraceRecord& record : trace.Records) {
+      if ((record.Pool_id < replays.size()) && (replays[record.Pool_id] != nullptr)) {
+        replays[record.Pool_id]->apply(record);
+      }
+    }
+
+    state.PauseTiming();
+    for (auto& replay : replays) replay.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * trace.Records.size());
+}
+
+
+// An object in the sample workload
+struct Order {
+  Point Position;
+  double Price;
+  char Note[36];
+};
+
+// Records a sample trace: a mix of long-lived orders and short-lived points, in two traced
+// pools, with some orders freed in random order and a compaction part way through
+static Trace record_sample_trace()
+{
+  using memory_pool::PoolTrace;
+  MemoryPool<Order, HeapStorage, NaturalLayout, BlockTracker, PoolTrace<>> orders(1 << 10, 2);
+  MemoryPool<Point, HeapStorage, NaturalLayout, BlockTracker, PoolTrace<>> points(1 << 6, 2);
+  std::vector<Order*> live_orders;
+  std::vector<Point*> live_points;
+  std::mt19937 generator(42);
+  for (int round = 0; round < 1 << 16; round++) {
+    live_points.push_back(points.new_block_pt());
+    if (live_points.size() == 16) {
+      for (Point*& point_pt : live_points) points.delete_block_pt(point_pt);
+      live_points.clear();
+    }
+    if (round % 4 == 0) live_orders.push_back(orders.new_block_pt());
+    if ((round % 8 == 0) && !live_orders.empty()) {
+      std::swap(live_orders[generator() % live_orders.size()], live_orders.back());
+      orders.delete_block_pt(live_orders.back());
+      live_orders.pop_back();
+    }
+    if (round == 1 << 15) {
+      orders.compact(memory_pool::CompactionBudget(), [&](Order* from_pt, Order* to_pt) {
+        for (Order*& order_pt : live_orders) {
+          if (order_pt == from_pt) order_pt = to_pt;
+        }
+      });
+    }
+  }
+  for (Order*& order_pt : live_orders) orders.delete_block_pt(order_pt);
+  for (Point*& point_pt : live_points) points.delete_block_pt(point_pt);
+  return memory_pool::TraceRegistry::instance().collect();
+}
+
+
+int main(int argc, char** argv)
+{
+  benchmark::Initialize(&argc, argv);
+  Trace trace;
+  try {
+    trace = (argc > 1) ? memory_pool::read_trace(argv[1]) : record_sample_trace();
+  }
+  catch (const std::exception& error) {
+    std::fprintf(stderr, "replay_trace: %s\n", error.what());
+    return 1;
+  }
+  for (const memory_pool::TracedPool& pool : trace.Pools) {
+    if (pool.Object_size > g_MaxObjectSize) {
+      std::fprintf(stderr, "replay_trace: skipping pool %u of %zu-byte %s objects\n",
+                   unsigned(pool.Id), static_cast<std::size_t>(pool.Object_size),
+                   pool.Type_name.c_str());
+    }
+  }
+  std::printf("Replaying %zu events in %zu pools\n", trace.Records.size(), trace.Pools.size());
+
+  // Register the benchmarking functions as a benchmark
+  auto register_replay = [&trace](const char* name, auto function) {
+    benchmark::RegisterBenchmark(name, [&trace, function](benchmark::State& state) {
+      function(state, trace);
+    });
+  };
+  register_replay("replay<NewDelete>", benchmark_replay<NewDeletePool>);
+  register_replay("replay<BlockTracker>", benchmark_replay<BlockTrackerPool>);
+  register_replay("replay<BitmapTracker>", benchmark_replay<BitmapTrackerPool>);
+  register_replay("replay<CacheLineLayout>", benchmark_replay<CacheLinePool>);
+  register_replay("replay<ConcurrentMemoryPool>", benchmark_replay<ConcurrentPool>);
+  register_replay("replay<ThreadCachingMemoryPool>", benchmark_replay<ThreadCachingPool>);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -13,7 +13,7 @@ void run_point()
 
 void run_base1()
 {
-  MemoryPool<Base1> pool(memory_pool::g_MaxNumberOfObjectsInPool);
+  MemoryPool<Base1> pool(memory_pool::g_DefaultNumberOfObjectsInPool);
   std::cout << "\nBase1 allocated pool size: " << pool.size() << std::endl;
 }
 
@@ -33,7 +33,7 @@ void run_derived()
 
   std::cout << "Derived unallocated pool size: " << pool.size() << std::endl;
 
-  pool.allocate(memory_pool::g_MaxNumberOfObjectsInPool);
+  pool.allocate(memory_pool::g_DefaultNumberOfObjectsInPool);
 
   std::cout << "Derived allocated pool size: " << pool.size() << std::endl;
 
@@ -64,7 +64,7 @@ void run_no_default_constructor()
 int main()
 {
   run_point();
-  // run_base1(); // Will throw an assert error
+  run_base1();
   run_base2();
   run_derived();
   run_no_default_constructor();
@@ -13,7 +13,6 @@ struct MyStruct {
 
 int main()
 {
-  // NOTE: Number of objects in pool cannot exceed memory_pool::g_MaxNumberOfObjectsInPool
   const unsigned desired_pool_size = 100;
   const unsigned mid = unsigned(desired_pool_size / 2);
 
@@ -31,15 +30,10 @@ int main()
     auto* obj_pt = pool.new_block_pt(MyStruct{1, 0.0, 42.0, -9});
   }
 
-  // Do not try to allocate space than you have. Following line will lead to out of range error
-#ifdef NDEBUG
-  std::cout << "\nAttempting to allocate memory when the pool is already full."
-            << "\nExpect a segmentation fault.\n"
-            << std::endl;
-#else
+  // Do not try to allocate more space than you have (unless the pool is growable). Following
+  // line will lead to out of range error
   std::cout << "\nAttempting to allocate memory when the pool is already full."
             << "\nExpect an std::out_of_range error.\n"
             << std::endl;
-#endif
   pool.new_block_pt(MyStruct{1, 0.0, 42.0, -9});
 }
\ No newline at end of file
@@ -0,0 +1,391 @@
+#ifndef MEMORY_POOL_AWAITABLE_MEMORY_POOL_HEADER
+#define MEMORY_POOL_AWAITABLE_MEMORY_POOL_HEADER
+
+// Needs C++20 coroutines; with an older standard this header declares nothing
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <cassert>
+#include <coroutine>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief Gives 'Pool' with the policies in 'Policies' appended, leaving out the locking
+   *        policy, so the result is a MemoryPool that takes no lock of its own.
+   *
+   ****************************************************************************************/
+  template<class Pool, class... Policies>
+  struct without_lock_policy {
+    using type = Pool;
+  };
+
+  template<class T, class... Kept, class First, class... Rest>
+  struct without_lock_policy<MemoryPool<T, Kept...>, First, Rest...> {
+    using type = typename without_lock_policy<std::conditional_t<is_lock_policy<First>::value,
+                                                                 MemoryPool<T, Kept...>,
+                                                                 MemoryPool<T, Kept..., First>>,
+                                              Rest...>::type;
+  };
+
+  /****************************************************************************************
+   * @brief A fixed-size memory pool whose blocks can be awaited from a C++20 coroutine.
+   *        When every block is in use, 'co_await pool.acquire()' suspends the coroutine
+   *        until another task releases a block, instead of failing. The capacity of the
+   *        pool then limits the amount of work in flight: producers simply wait while their
+   *        consumers are behind.
+   *
+   *          Message* message_pt = co_await pool.acquire();
+   *          ...
+   *          pool.release(message_pt);
+   *
+   *        Waiters are served first in, first out. A released block is handed straight to
+   *        the coroutine that has waited longest, so a new request can never overtake a
+   *        waiting one. Blocks are only returned to the pool once nobody is waiting. By
+   *        default the waiter is resumed inside release() on the releasing thread; if it
+   *        releases a block in turn, the next waiter is resumed inside that call, and so on,
+   *        so a long chain of waiters can run deep into the stack. Pass an executor to
+   *        release() to schedule the waiter instead.
+   *
+   *        The pool takes the same policies as MemoryPool. Its locking policy protects the
+   *        pool and the queue together with one lock (the MemoryPool inside takes none):
+   *        with the default NoLock every coroutine must run on one thread (e.g. one event
+   *        loop), while with std::mutex or SpinLock blocks can be acquired and released from
+   *        any thread. A coroutine that is destroyed while it waits leaves the queue.
+   *        Destroying the pool while coroutines wait on it is an error.
+   *
+   * @tparam T: The type of the objects to be allocated for in the memory pool.
+   * @tparam Policies: The policies of the underlying MemoryPool; see MemoryPool.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  class AwaitableMemoryPool {
+  public:
+    using Pool = typename without_lock_policy<MemoryPool<T>, Policies...>::type;
+    using Lock = typename MemoryPool<T, Policies...>::Lock;
+
+    // Awaited by a coroutine to get a block; see acquire()
+    class AcquireAwaiter {
+    public:
+      explicit AcquireAwaiter(AwaitableMemoryPool& pool) : Owner(pool) {}
+
+      // Leaves the queue if the coroutine is destroyed while it waits, or passes the block on
+      // if it is destroyed after being handed one but before being resumed
+      ~AcquireAwaiter()
+      {
+        if (Handle) Owner.cancel(*this);
+      }
+
+      AcquireAwaiter(const AcquireAwaiter&) = delete;
+      AcquireAwaiter& operator=(const AcquireAwaiter&) = delete;
+
+      bool await_ready()
+      {
+        Block_pt = Owner.try_acquire();
+        return Block_pt != nullptr;
+      }
+
+      bool await_suspend(std::coroutine_handle<> handle)
+      {
+        Handle = handle;
+        return Owner.wait(*this);
+      }
+
+      T* await_resume() { return std::exchange(Block_pt, nullptr); }
+
+    private:
+      friend class AwaitableMemoryPool;
+
+      AwaitableMemoryPool& Owner;
+
+      // The waiting coroutine; null unless the block was not available straight away
+      std::coroutine_handle<> Handle;
+
+      // The block handed to the coroutine, until the coroutine takes it
+      T* Block_pt = nullptr;
+
+      // The neighbouring waiters in the queue, and whether this one is in it
+      AcquireAwaiter* Prev = nullptr;
+      AcquireAwaiter* Next = nullptr;
+      bool Is_waiting = false;
+    };
+
+    // Immediately creates a pool for 'num_blocks' objects of type T
+    explicit AwaitableMemoryPool(const SizeT& num_blocks) : Blocks(num_blocks) {}
+
+    // Destructor. No coroutine may still be waiting
+    ~AwaitableMemoryPool() { assert(Waiters_head == nullptr); }
+
+    // The pool owns raw memory and is referred to by its waiters, so it cannot be copied
+    AwaitableMemoryPool(const AwaitableMemoryPool&) = delete;
+    AwaitableMemoryPool& operator=(const AwaitableMemoryPool&) = delete;
+
+    // Returns an awaitable that gives a pointer to an available block. The coroutine is
+    // only suspended if every block is in use. The block is uninitialised memory
+    [[nodiscard]] AcquireAwaiter acquire() { return AcquireAwaiter(*this); }
+
+    // Returns a pointer to an available block, or nullptr (without waiting) if every block
+    // is in use
+    T* try_acquire();
+
+    // Hands the block pointed to by 'obj_pt' to the coroutine that has waited longest and
+    // resumes it, or returns the block to the pool if no coroutine is waiting. Nullifies the
+    // input pointer. Does not run the destructor
+    void release(T*& obj_pt);
+
+    // As release(), but rather than resuming the waiting coroutine itself, passes its
+    // std::coroutine_handle<> to 'executor' (e.g. to queue it on an event loop)
+    template<class Executor>
+    void release(T*& obj_pt, Executor&& executor);
+
+    // Runs the destructor of the object pointed to by 'obj_pt' then releases its block as
+    // with release()
+    void destroy(T*& obj_pt);
+
+    // The total number of objects this pool can hold
+    SizeT size() const;
+
+    // The number of blocks that can be acquired without waiting
+    SizeT available_capacity() const;
+
+    // The number of coroutines waiting for a block
+    SizeT num_waiting() const;
+
+  private:
+    // Gives the block to the oldest waiter and returns the waiter's coroutine, or returns the
+    // block to the pool and a null handle if nobody is waiting
+    std::coroutine_handle<> hand_over(T*& obj_pt);
+
+    // Takes a block for 'awaiter' if one has come free since await_ready(); otherwise adds
+    // it to the back of the queue. Returns true if the coroutine should stay suspended
+    bool wait(AcquireAwaiter& awaiter);
+
+    // Removes 'awaiter' from the queue if it is still in it, or releases the block it was
+    // handed but never took
+    void cancel(AcquireAwaiter& awaiter);
+
+    // Removes 'awaiter' from the queue; the caller must hold the lock
+    void unlink(AcquireAwaiter& awaiter);
+
+    // The blocks
+    Pool Blocks;
+
+    // The queue of waiting coroutines, oldest first
+    AcquireAwaiter* Waiters_head = nullptr;
+    AcquireAwaiter* Waiters_tail = nullptr;
+    SizeT Num_waiting = 0;
+
+    // Held while the pool or the queue is used
+    mutable Lock Waiters_lock;
+  };
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block without waiting. Nobody can be waiting
+   *        while the pool has a free block, so this never overtakes a waiting coroutine.
+   *
+   * @return T*: A pointer to an (uninitialised) block, or nullptr if every block is in use.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  T* AwaitableMemoryPool<T, Policies...>::try_acquire()
+  {
+    std::lock_guard<Lock> guard(Waiters_lock);
+    return Blocks.try_new_block_pt();
+  }
+
+  /****************************************************************************************
+   * @brief Hands the block pointed to by 'obj_pt' to the oldest waiting coroutine, which is
+   *        resumed before this function returns, or returns it to the pool if no coroutine
+   *        is waiting. The resumed coroutine runs on this stack until it next suspends.
+   *
+   * @param obj_pt: A reference to the pointer to a block acquired from this pool. Will be
+   *                set to 'nullptr'.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void AwaitableMemoryPool<T, Policies...>::release(T*& obj_pt)
+  {
+    std::coroutine_handle<> handle = hand_over(obj_pt);
+    if (handle) {
+      handle.resume();
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Hands the block pointed to by 'obj_pt' to the oldest waiting coroutine and passes
+   *        the coroutine to 'executor' to be resumed, or returns the block to the pool if no
+   *        coroutine is waiting. The coroutine owns the block from now on; if it is
+   *        destroyed before it is resumed, the block is released again.
+   *
+   * @param obj_pt: A reference to the pointer to a block acquired from this pool. Will be
+   *                set to 'nullptr'.
+   * @param executor: A callable taking the std::coroutine_handle<> to resume.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  template<class Executor>
+  void AwaitableMemoryPool<T, Policies...>::release(T*& obj_pt, Executor&& executor)
+  {
+    std::coroutine_handle<> handle = hand_over(obj_pt);
+    if (handle) {
+      std::forward<Executor>(executor)(handle);
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Gives the block pointed to by 'obj_pt' to the oldest waiting coroutine, without
+   *        resuming it, or returns the block to the pool if no coroutine is waiting.
+   *
+   * @param obj_pt: A reference to the pointer to a block acquired from this pool. Will be
+   *                set to 'nullptr'.
+   * @return std::coroutine_handle<>: The coroutine that was given the block, or a null
+   *                                  handle if nobody was waiting.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  std::coroutine_handle<> AwaitableMemoryPool<T, Policies...>::hand_over(T*& obj_pt)
+  {
+    if (obj_pt == nullptr) {
+      return nullptr;
+    }
+    std::lock_guard<Lock> guard(Waiters_lock);
+    AcquireAwaiter* waiter_pt = Waiters_head;
+    if (waiter_pt == nullptr) {
+      Blocks.delete_block_pt(obj_pt);
+      return nullptr;
+    }
+    unlink(*waiter_pt);
+    waiter_pt->Block_pt = obj_pt;
+    obj_pt = nullptr;
+    return waiter_pt->Handle;
+  }
+
+  /****************************************************************************************
+   * @brief Runs the destructor of the object pointed to by 'obj_pt', then releases its
+   *        block as with release().
+   *
+   * @param obj_pt: A reference to the pointer to a (constructed) object in the pool. Will
+   *                be set to 'nullptr'.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void AwaitableMemoryPool<T, Policies...>::destroy(T*& obj_pt)
+  {
+    if (obj_pt == nullptr) {
+      return;
+    }
+    obj_pt->~T();
+    release(obj_pt);
+  }
+
+  /****************************************************************************************
+   * @brief The total number of objects this pool can hold.
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  SizeT AwaitableMemoryPool<T, Policies...>::size() const
+  {
+    std::lock_guard<Lock> guard(Waiters_lock);
+    return Blocks.size();
+  }
+
+  /****************************************************************************************
+   * @brief The number of blocks that can be acquired without waiting.
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  SizeT AwaitableMemoryPool<T, Policies...>::available_capacity() const
+  {
+    std::lock_guard<Lock> guard(Waiters_lock);
+    return Blocks.available_capacity();
+  }
+
+  /****************************************************************************************
+   * @brief The number of coroutines waiting for a block.
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  SizeT AwaitableMemoryPool<T, Policies...>::num_waiting() const
+  {
+    std::lock_guard<Lock> guard(Waiters_lock);
+    return Num_waiting;
+  }
+
+  /****************************************************************************************
+   * @brief Called when a coroutine is about to be suspended by 'co_await acquire()'. A
+   *        block may have been released between await_ready() and now, so the pool is
+   *        tried again under the lock before the coroutine joins the back of the queue.
+   *
+   * @param awaiter: The awaiter of the coroutine.
+   * @return bool: True if the coroutine was queued and should stay suspended; false if
+   *               it got a block and can carry on.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  bool AwaitableMemoryPool<T, Policies...>::wait(AcquireAwaiter& awaiter)
+  {
+    std::lock_guard<Lock> guard(Waiters_lock);
+    awaiter.Block_pt = Blocks.try_new_block_pt();
+    if (awaiter.Block_pt != nullptr) {
+      return false;
+    }
+    awaiter.Prev = Waiters_tail;
+    awaiter.Next = nullptr;
+    if (Waiters_tail != nullptr) {
+      Waiters_tail->Next = &awaiter;
+    }
+    else {
+      Waiters_head = &awaiter;
+    }
+    Waiters_tail = &awaiter;
+    awaiter.Is_waiting = true;
+    Num_waiting++;
+    return true;
+  }
+
+  /****************************************************************************************
+   * @brief Removes 'awaiter' from the queue if its coroutine is destroyed while it waits. If
+   *        the coroutine had been handed a block (by a release() with an executor) but was
+   *        destroyed before it was resumed, the block is released again.
+   *
+   * @param awaiter: The awaiter of the coroutine being destroyed.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void AwaitableMemoryPool<T, Policies...>::cancel(AcquireAwaiter& awaiter)
+  {
+    {
+      std::lock_guard<Lock> guard(Waiters_lock);
+      if (awaiter.Is_waiting) {
+        unlink(awaiter);
+        return;
+      }
+    }
+    release(awaiter.Block_pt);
+  }
+
+  /****************************************************************************************
+   * @brief Removes 'awaiter' from the queue. The caller must hold the lock.
+   *
+   * @param awaiter: A waiter in the queue.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void AwaitableMemoryPool<T, Policies...>::unlink(AcquireAwaiter& awaiter)
+  {
+    assert(awaiter.Is_waiting);
+    if (awaiter.Prev != nullptr) {
+      awaiter.Prev->Next = awaiter.Next;
+    }
+    else {
+      Waiters_head = awaiter.Next;
+    }
+    if (awaiter.Next != nullptr) {
+      awaiter.Next->Prev = awaiter.Prev;
+    }
+    else {
+      Waiters_tail = awaiter.Prev;
+    }
+    awaiter.Prev = nullptr;
+    awaiter.Next = nullptr;
+    awaiter.Is_waiting = false;
+    Num_waiting--;
+  }
+} // namespace memory_pool
+
+#endif // defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#endif // MEMORY_POOL_AWAITABLE_MEMORY_POOL_HEADER
@@ -0,0 +1,392 @@
+#ifndef MEMORY_POOL_BITMAP_TRACKER_HEADER
+#define MEMORY_POOL_BITMAP_TRACKER_HEADER
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief Returns the index of the first non-zero word in 'words[begin, end)', or 'end' if
+   *        they are all zero. Checks several words per instruction with AVX2 or SSE2 when
+   *        the build targets them.
+   *
+   ****************************************************************************************/
+  inline SizeT find_first_nonzero_word(const uint64_t* words, SizeT begin, const SizeT& end)
+  {
+#if defined(__AVX2__)
+    for (; begin + 4 <= end; begin += 4) {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + begin));
+      if (!_mm256_testz_si256(v, v)) break;
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; begin + 2 <= end; begin += 2) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + begin));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, zero)) != 0xFFFF) break;
+    }
+#endif
+    while ((begin < end) && (words[begin] == 0)) begin++;
+    return begin;
+  }
+
+  /****************************************************************************************
+   * @brief Tracks the blocks in the pool that can be allocated to, always handing out the
+   *        free block with the lowest address. Use it in place of BlockTracker, e.g.
+   *
+   *          MemoryPool<Point, HeapStorage, NaturalLayout, BitmapTracker> pool(1000);
+   *
+   *        With BlockTracker, blocks are reused last in, first out, so after a few rounds
+   *        of random allocation/deallocation the live objects end up scattered over the
+   *        whole pool. Handing out the lowest free block instead keeps them packed at the
+   *        start of the pool, which is better for spatial locality (caches, TLB, prefetch).
+   *
+   *        Freed blocks are marked in a bitmap of 64-bit words, with a summary bitmap on
+   *        top in which each bit says whether a word has any free block. The lowest free
+   *        block is found with two count-trailing-zeros instructions after skipping any
+   *        empty summary words (with SIMD where available), so the cost does not grow
+   *        linearly with the size of the pool. As in BlockTracker, blocks that have never
+   *        been handed out are served from a bump index; they always lie above every freed
+   *        block, so the order is preserved.
+   *
+   *        Unlike BlockTracker, nothing is stored in the free blocks themselves, so blocks
+   *        can be as small as a single byte. The bitmaps take one bit per block (plus 1/64
+   *        of that for the summary). Setting up the tracker is O(num_blocks / 64) and
+   *        resetting it is O(number of blocks ever handed out / 64).
+   *
+   ****************************************************************************************/
+  class BitmapTracker {
+  public:
+    // Nothing is stored in free blocks, so any block size will do
+    static constexpr SizeT min_block_size() { return 1; }
+    static constexpr SizeT min_block_alignment() { return 1; }
+
+    BitmapTracker() = default;
+    BitmapTracker(Byte* storage_pt, const SizeT& block_size, const SizeT& num_blocks)
+      : BitmapTracker()
+    {
+      setup(storage_pt, block_size, num_blocks);
+    }
+    ~BitmapTracker() = default;
+
+    void setup(Byte* storage_pt, const SizeT& block_size, const SizeT& num_blocks);
+    void clear();
+    void reset();
+    SizeT size() const { return Num_available; }
+    void push(SizeT block_index);
+    SizeT pop();
+
+    // Batch versions of push()/pop(); see BlockTracker. pop_n() hands out the lowest free
+    // blocks in ascending order and takes whole bitmap words at a time where it can
+    template<class IndexOf>
+    void push_n(const SizeT& n, IndexOf&& index_of);
+    template<class OnPop>
+    SizeT pop_n(const SizeT& n, OnPop&& on_pop);
+
+    // Writes a bitmap of the blocks that are currently handed out; see BlockTracker
+    void occupancy(uint64_t* words) const;
+
+    // Makes the blocks set in 'words' exactly the ones that are handed out; see BlockTracker
+    void rebuild(const uint64_t* words);
+
+    // Calls 'release(first, last)' for every run of free blocks [first, last); nothing is
+    // stored in free blocks, so all of them can be given back to the OS. See BlockTracker
+    template<class Release>
+    void trim(const uint64_t* words, Release&& release) const;
+
+  private:
+    static constexpr SizeT Bits_per_word = 64;
+
+    // The number of free blocks that are in the bitmap (rather than never handed out)
+    inline SizeT num_freed() const { return Num_available - (Num_blocks - Next_untouched); }
+
+    // Returns the index of the lowest word in the bitmap with a free block; there must be one
+    SizeT lowest_free_word();
+
+    // Marks the blocks whose bits are set in 'bits' in word 'word_index' as handed out
+    void take(const SizeT& word_index, const uint64_t& bits);
+
+    // The total number of blocks being tracked
+    SizeT Num_blocks = 0;
+
+    // The number of blocks that can currently be handed out
+    SizeT Num_available = 0;
+
+    // Blocks with an index at or above this value have never been handed out
+    SizeT Next_untouched = 0;
+
+    // Bit i of word w is set if block '64 * w + i' has been freed (and not handed out since)
+    std::vector<uint64_t> Free_words;
+
+    // Bit j of word k is set if word '64 * k + j' of 'Free_words' is non-zero
+    std::vector<uint64_t> Summary_words;
+
+    // No summary word below this index has a bit set
+    SizeT First_summary_word = 0;
+  };
+
+  /****************************************************************************************
+   * @brief Starts tracking 'num_blocks' blocks. The blocks themselves are never touched.
+   *
+   * @param storage_pt: A pointer to the start of the storage holding the blocks (unused).
+   * @param block_size: The number of bytes between the start of consecutive blocks (unused).
+   * @param num_blocks: The number of blocks to track.
+   ****************************************************************************************/
+  inline void BitmapTracker::setup(Byte* /* storage_pt */,
+                                   const SizeT& /* block_size */,
+                                   const SizeT& num_blocks)
+  {
+    const SizeT num_words = (num_blocks + Bits_per_word - 1) / Bits_per_word;
+    Free_words.assign(num_words, 0);
+    Summary_words.assign((num_words + Bits_per_word - 1) / Bits_per_word, 0);
+    Num_blocks = num_blocks;
+    Next_untouched = 0;
+    reset();
+  }
+
+  /****************************************************************************************
+   * @brief Stops tracking any blocks and releases the bitmaps.
+   *
+   ****************************************************************************************/
+  inline void BitmapTracker::clear()
+  {
+    Free_words.clear();
+    Summary_words.clear();
+    Num_blocks = 0;
+    Next_untouched = 0;
+    reset();
+  }
+
+  /****************************************************************************************
+   * @brief Marks every block as free again. Only the part of the bitmap covering blocks
+   *        that have been handed out (and so may have bits set) has to be cleared.
+   *
+   ****************************************************************************************/
+  inline void BitmapTracker::reset()
+  {
+    const SizeT num_touched_words = (Next_untouched + Bits_per_word - 1) / Bits_per_word;
+    std::fill(Free_words.begin(), Free_words.begin() + num_touched_words, 0);
+    std::fill(Summary_words.begin(), Summary_words.end(), 0);
+    First_summary_word = Summary_words.size();
+    Num_available = Num_blocks;
+    Next_untouched = 0;
+  }
+
+  /****************************************************************************************
+   * @brief Adds a block back to the set of blocks to be tracked.
+   *
+   * @param block_index: The index of the block to be stored.
+   ****************************************************************************************/
+  inline void BitmapTracker::push(SizeT block_index)
+  {
+    assert(block_index < Next_untouched);
+    const SizeT word_index = block_index / Bits_per_word;
+    const uint64_t bit = uint64_t(1) << (block_index % Bits_per_word);
+    assert((Free_words[word_index] & bit) == 0);
+    Free_words[word_index] |= bit;
+
+    const SizeT summary_index = word_index / Bits_per_word;
+    Summary_words[summary_index] |= uint64_t(1) << (word_index % Bits_per_word);
+    First_summary_word = std::min(First_summary_word, summary_index);
+    Num_available++;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the index of the free block with the lowest address.
+   *
+   ****************************************************************************************/
+  inline SizeT BitmapTracker::pop()
+  {
+    if (num_freed() > 0) {
+      const SizeT word_index = lowest_free_word();
+      const SizeT bit_index = count_trailing_zeros(Free_words[word_index]);
+      take(word_index, uint64_t(1) << bit_index);
+      Num_available--;
+      return word_index * Bits_per_word + bit_index;
+    }
+    if (Next_untouched < Num_blocks) {
+      Num_available--;
+      return Next_untouched++;
+    }
+    throw std::runtime_error("BitmapTracker is empty; cannot pop any more elements.");
+  }
+
+  /****************************************************************************************
+   * @brief Adds 'n' blocks back to the set of blocks to be tracked.
+   *
+   * @param n: The number of blocks to add.
+   * @param index_of: A callable returning the index of the i-th block, for i in [0, n).
+   ****************************************************************************************/
+  template<class IndexOf>
+  inline void BitmapTracker::push_n(const SizeT& n, IndexOf&& index_of)
+  {
+    for (SizeT i = 0; i < n; i++) {
+      push(index_of(i));
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Hands out up to 'n' blocks, lowest address first. A bitmap word whose free
+   *        blocks are all needed is taken in one go.
+   *
+   * @param n: The maximum number of blocks to hand out.
+   * @param on_pop: A callable that is passed the index of each block handed out.
+   * @return SizeT: The number of blocks handed out; less than 'n' only if the tracker ran
+   *                out of blocks.
+   ****************************************************************************************/
+  template<class OnPop>
+  inline SizeT BitmapTracker::pop_n(const SizeT& n, OnPop&& on_pop)
+  {
+    SizeT num_popped = 0;
+    while ((num_popped < n) && (num_freed() > 0)) {
+      const SizeT word_index = lowest_free_word();
+      uint64_t bits = Free_words[word_index];
+      uint64_t taken = bits;
+      const SizeT num_wanted = n - num_popped;
+      if (count_set_bits(bits) > num_wanted) {
+        // Only take the lowest 'num_wanted' blocks in this word
+        taken = 0;
+        for (SizeT i = 0; i < num_wanted; i++) {
+          taken |= bits & (~bits + 1);
+          bits &= bits - 1;
+        }
+      }
+      take(word_index, taken);
+      const SizeT num_taken = count_set_bits(taken);
+      Num_available -= num_taken;
+      num_popped += num_taken;
+      for (; taken != 0; taken &= taken - 1) {
+        on_pop(word_index * Bits_per_word + count_trailing_zeros(taken));
+      }
+    }
+
+    const SizeT num_untouched = std::min(n - num_popped, Num_blocks - Next_untouched);
+    for (SizeT i = 0; i < num_untouched; i++) {
+      on_pop(Next_untouched + i);
+    }
+    Next_untouched += num_untouched;
+    Num_available -= num_untouched;
+    num_popped += num_untouched;
+    return num_popped;
+  }
+
+  /****************************************************************************************
+   * @brief Writes a bitmap of the blocks that are currently handed out to 'words': the
+   *        blocks below the bump index that are not marked free. Takes O(num_blocks / 64)
+   *        time and never touches the blocks themselves.
+   *
+   * @param words: A pointer to (at least) bitmap_words(num_blocks) words.
+   ****************************************************************************************/
+  inline void BitmapTracker::occupancy(uint64_t* words) const
+  {
+    std::fill(words, words + Free_words.size(), uint64_t(0));
+    set_bits(words, 0, Next_untouched);
+    const SizeT num_touched_words = bitmap_words(Next_untouched);
+    for (SizeT i = 0; i < num_touched_words; i++) {
+      words[i] &= ~Free_words[i];
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Makes the blocks set in 'words' exactly the ones that are handed out. The bump
+   *        index is moved down to just above the highest live block and the bitmaps are
+   *        rewritten, in O(num_blocks / 64) time.
+   *
+   * @param words: A bitmap of the blocks to mark as handed out, as written by occupancy().
+   ****************************************************************************************/
+  inline void BitmapTracker::rebuild(const uint64_t* words)
+  {
+    const SizeT old_num_touched_words = bitmap_words(Next_untouched);
+    Next_untouched = end_of_set_bits(words, Free_words.size());
+    const SizeT num_touched_words = bitmap_words(Next_untouched);
+
+    std::fill(Summary_words.begin(), Summary_words.end(), 0);
+    SizeT num_freed = 0;
+    for (SizeT i = 0; i < num_touched_words; i++) {
+      Free_words[i] = ~words[i];
+      if ((i + 1 == num_touched_words) && (Next_untouched % Bits_per_word != 0)) {
+        Free_words[i] &= (uint64_t(1) << (Next_untouched % Bits_per_word)) - 1;
+      }
+      if (Free_words[i] != 0) {
+        Summary_words[i / Bits_per_word] |= uint64_t(1) << (i % Bits_per_word);
+        num_freed += count_set_bits(Free_words[i]);
+      }
+    }
+    std::fill(Free_words.begin() + num_touched_words,
+              Free_words.begin() + std::max(num_touched_words, old_num_touched_words),
+              0);
+    First_summary_word = 0;
+    Num_available = num_freed + (Num_blocks - Next_untouched);
+  }
+
+  /****************************************************************************************
+   * @brief Hands every maximal run of free blocks to 'release', scanning the occupancy
+   *        bitmap a word at a time with count-trailing-zeros.
+   *
+   * @param words: A bitmap of the blocks that are handed out, as written by occupancy().
+   * @param release: A callable taking the first and one past the last index of a run of
+   *                 free blocks.
+   ****************************************************************************************/
+  template<class Release>
+  void BitmapTracker::trim(const uint64_t* words, Release&& release) const
+  {
+    SizeT first = 0;
+    while (first < Num_blocks) {
+      // Find the next free block, then the next live block after it
+      const uint64_t free_bits = ~words[first / 64] & (~uint64_t(0) << (first % 64));
+      if (free_bits == 0) {
+        first = 64 * (first / 64 + 1);
+        continue;
+      }
+      first = 64 * (first / 64) + count_trailing_zeros(free_bits);
+      SizeT last = first;
+      while (last < Num_blocks) {
+        const uint64_t live_bits = words[last / 64] & (~uint64_t(0) << (last % 64));
+        if (live_bits != 0) {
+          last = 64 * (last / 64) + count_trailing_zeros(live_bits);
+          break;
+        }
+        last = 64 * (last / 64 + 1);
+      }
+      last = std::min(last, Num_blocks);
+      if (first < last) release(first, last);
+      first = last;
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Returns the index of the lowest word in the bitmap with a free block. Skips the
+   *        summary words that have become empty since the last call.
+   *
+   ****************************************************************************************/
+  inline SizeT BitmapTracker::lowest_free_word()
+  {
+    First_summary_word =
+      find_first_nonzero_word(Summary_words.data(), First_summary_word, Summary_words.size());
+    assert(First_summary_word < Summary_words.size());
+    return First_summary_word * Bits_per_word +
+           count_trailing_zeros(Summary_words[First_summary_word]);
+  }
+
+  /****************************************************************************************
+   * @brief Marks the blocks whose bits are set in 'bits' in word 'word_index' as handed
+   *        out, clearing the word's summary bit if it has no free blocks left.
+   *
+   ****************************************************************************************/
+  inline void BitmapTracker::take(const SizeT& word_index, const uint64_t& bits)
+  {
+    assert((Free_words[word_index] & bits) == bits);
+    Free_words[word_index] &= ~bits;
+    if (Free_words[word_index] == 0) {
+      Summary_words[word_index / Bits_per_word] &= ~(uint64_t(1) << (word_index % Bits_per_word));
+    }
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_BITMAP_TRACKER_HEADER
@@ -0,0 +1,332 @@
+#ifndef MEMORY_POOL_CONCURRENT_MEMORY_POOL_HEADER
+#define MEMORY_POOL_CONCURRENT_MEMORY_POOL_HEADER
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief A lock-free LIFO stack of block indices (a Treiber stack). The stack does not
+   *        own any memory: it operates on a head word and an array of 'next' links that
+   *        live elsewhere, which allows the same code to be used for memory that is shared
+   *        between processes.
+   *
+   *        The head packs the index of the top block in its low 32 bits and a tag in its
+   *        high 32 bits. The tag is incremented on every update of the head so that a
+   *        compare-and-swap cannot succeed on a stale head that happens to hold the same
+   *        index again (the ABA problem).
+   ****************************************************************************************/
+  class TaggedIndexStack {
+  public:
+    // Marks the end of the stack
+    static constexpr uint32_t Null_index = std::numeric_limits<uint32_t>::max();
+
+    // The value the head must be initialised to for an empty stack
+    static constexpr uint64_t Empty_head = Null_index;
+
+    TaggedIndexStack(std::atomic<uint64_t>* head_pt, std::atomic<uint32_t>* next_pt)
+      : Head_pt(head_pt), Next_pt(next_pt)
+    {
+    }
+
+    // Pushes 'index' onto the stack
+    void push(const uint32_t& index);
+
+    // Pops an index off the stack. Returns 'Null_index' if the stack is empty
+    uint32_t pop();
+
+    // Returns the number of indices on the stack. Only meaningful while no other thread is
+    // modifying the stack
+    SizeT size() const;
+
+  private:
+    static uint32_t index_of(const uint64_t& head) { return uint32_t(head); }
+    static uint32_t tag_of(const uint64_t& head) { return uint32_t(head >> 32); }
+    static uint64_t pack(const uint32_t& index, const uint32_t& tag)
+    {
+      return (uint64_t(tag) << 32) | index;
+    }
+
+    // The head of the stack
+    std::atomic<uint64_t>* Head_pt;
+
+    // The index of the next block in the stack, for every block
+    std::atomic<uint32_t>* Next_pt;
+  };
+
+  /****************************************************************************************
+   * @brief Pushes 'index' onto the stack. The release ordering on success makes any
+   *        writes to the block visible to the thread that pops it next.
+   *
+   * @param index: The index of the block to push.
+   ****************************************************************************************/
+  inline void TaggedIndexStack::push(const uint32_t& index)
+  {
+    uint64_t head = Head_pt->load(std::memory_order_relaxed);
+    uint64_t new_head;
+    do {
+      Next_pt[index].store(index_of(head), std::memory_order_relaxed);
+      new_head = pack(index, tag_of(head) + 1);
+    } while (!Head_pt->compare_exchange_weak(
+      head, new_head, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  /****************************************************************************************
+   * @brief Pops an index off the stack.
+   *
+   * @return uint32_t: The index of the popped block, or 'Null_index' if the stack is empty.
+   ****************************************************************************************/
+  inline uint32_t TaggedIndexStack::pop()
+  {
+    uint64_t head = Head_pt->load(std::memory_order_acquire);
+    while (index_of(head) != Null_index) {
+      // If another thread pops this block first, the tag will have changed and the CAS
+      // below fails, so reading a stale 'next' link here is harmless
+      const uint32_t next = Next_pt[index_of(head)].load(std::memory_order_relaxed);
+      if (Head_pt->compare_exchange_weak(head,
+                                         pack(next, tag_of(head) + 1),
+                                         std::memory_order_acquire,
+                                         std::memory_order_acquire)) {
+        return index_of(head);
+      }
+    }
+    return Null_index;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the number of indices on the stack by walking it. Only meaningful while
+   *        no other thread is modifying the stack.
+   *
+   ****************************************************************************************/
+  inline SizeT TaggedIndexStack::size() const
+  {
+    SizeT count = 0;
+    uint32_t index = index_of(Head_pt->load(std::memory_order_acquire));
+    while (index != Null_index) {
+      index = Next_pt[index].load(std::memory_order_relaxed);
+      count++;
+    }
+    return count;
+  }
+
+  /****************************************************************************************
+   * @brief A fixed-size memory pool whose new_block_pt() and delete_block_pt() can be
+   *        called from many threads at once without any locking.
+   *
+   *        Free blocks are kept on a lock-free stack (see TaggedIndexStack). Blocks that
+   *        have never been handed out are served from an atomic bump index, so creating a
+   *        pool does not touch its memory. Unlike MemoryPool, the 'next' links are kept in
+   *        a separate array (4 bytes per block) rather than in the free blocks themselves:
+   *        a thread may read the link of a block that another thread has just popped and is
+   *        writing to, which must not be a data race.
+   *
+   *        NOTE: allocate() and clear() are not thread-safe.
+   *
+   * @tparam T: The type of the objects to be allocated for in the memory pool.
+   * @tparam Layout: How the blocks are laid out in the pool; see NaturalLayout. Padding the
+   *                 blocks to a cache line (CacheLineLayout) stops threads working on
+   *                 neighbouring objects from sharing cache lines.
+   ****************************************************************************************/
+  template<class T, class Layout = NaturalLayout>
+  class ConcurrentMemoryPool : public PoolObjects<T, ConcurrentMemoryPool<T, Layout>> {
+  public:
+    // Default constructor. Initialises an empty pool. You must call allocate() separately
+    // to create the pool
+    ConcurrentMemoryPool() : Pool_pt(nullptr), Pool_size(0), Head(TaggedIndexStack::Empty_head)
+    {
+      Next_untouched.store(0, std::memory_order_relaxed);
+    }
+
+    // Immediately creates a pool for 'num_blocks' objects of type T
+    ConcurrentMemoryPool(const SizeT& num_blocks) : ConcurrentMemoryPool() { allocate(num_blocks); }
+
+    // Destructor. Handles the clean-up
+    ~ConcurrentMemoryPool() { clear(); }
+
+    // The pool owns raw memory so it cannot be copied
+    ConcurrentMemoryPool(const ConcurrentMemoryPool&) = delete;
+    ConcurrentMemoryPool& operator=(const ConcurrentMemoryPool&) = delete;
+
+    // Allocate space for 'num_blocks' objects of type T. Not thread-safe
+    void allocate(const SizeT& num_blocks = g_DefaultNumberOfObjectsInPool);
+
+    // Clean up. Not thread-safe
+    void clear();
+
+    // Returns a pointer to an available block in the memory pool. Throws a std::out_of_range
+    // exception if the pool is full
+    T* new_block_pt();
+
+    // Returns a pointer to an available block in the memory pool, into which 'obj' has been
+    // moved
+    T* new_block_pt(T&& obj);
+
+    // "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. Do not try
+    // to access obj_pt after this function has been called. Does not run the destructor
+    void delete_block_pt(T*& obj_pt);
+
+    // The total number of objects this pool can hold
+    inline SizeT size() const { return Pool_size; }
+
+    // The remaining number of objects this pool can hold. Walks the free list, so it is
+    // O(N) and only exact while no other thread is using the pool
+    SizeT available_capacity() const;
+
+  private:
+    // Returns true if obj_pt points to an object of type T in the pool. Returns false otherwise
+    bool is_pool_member(const T* const obj_pt) const;
+
+    // The number of bytes between the start of consecutive blocks
+    static constexpr SizeT block_size() { return Layout::stride(sizeof(T), alignof(T)); }
+
+    // The alignment of the blocks (and of the memory used for the pool)
+    static constexpr SizeT block_alignment() { return Layout::alignment(sizeof(T), alignof(T)); }
+
+    // Returns a view of the free block stack
+    inline TaggedIndexStack free_blocks() const { return TaggedIndexStack(&Head, Next_pt.get()); }
+
+    // A pointer to the underlying block of memory used for the memory pool
+    Byte* Pool_pt;
+
+    // The number of objects this pool can hold
+    SizeT Pool_size;
+
+    // The 'next' link of every block for the free block stack
+    std::unique_ptr<std::atomic<uint32_t>[]> Next_pt;
+
+    // The head of the free block stack. Kept on its own cache line as every thread writes it
+    alignas(g_CacheLineSize) mutable std::atomic<uint64_t> Head;
+
+    // Blocks with an index at or above this value have never been handed out
+    alignas(g_CacheLineSize) std::atomic<SizeT> Next_untouched;
+  };
+
+  /****************************************************************************************
+   * @brief Allocate space for 'num_blocks' objects of type T. Not thread-safe.
+   *
+   * @param num_blocks: The number of objects the pool should be capable of holding; must
+   *                    be less than 2^32 - 1
+   ****************************************************************************************/
+  template<class T, class Layout>
+  void ConcurrentMemoryPool<T, Layout>::allocate(const SizeT& num_blocks)
+  {
+    if (num_blocks >= TaggedIndexStack::Null_index) {
+      throw std::length_error("ConcurrentMemoryPool cannot hold more than " +
+                              std::to_string(TaggedIndexStack::Null_index - 1) + " objects");
+    }
+    if (Pool_pt != nullptr) {
+      this->clear();
+    }
+    Pool_pt = HeapStorage::allocate(num_blocks * block_size(), block_alignment());
+    Next_pt.reset(new std::atomic<uint32_t>[num_blocks]);
+    Pool_size = num_blocks;
+  }
+
+  /****************************************************************************************
+   * @brief Cleans up any memory used for the memory pool. Not thread-safe.
+   *
+   ****************************************************************************************/
+  template<class T, class Layout>
+  void ConcurrentMemoryPool<T, Layout>::clear()
+  {
+    if (Pool_pt != nullptr) {
+      HeapStorage::deallocate(Pool_pt, Pool_size * block_size(), block_alignment());
+      Pool_pt = nullptr;
+    }
+    Next_pt.reset();
+    Pool_size = 0;
+    Head.store(TaggedIndexStack::Empty_head, std::memory_order_relaxed);
+    Next_untouched.store(0, std::memory_order_relaxed);
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block in the memory pool. Thread-safe and
+   *        lock-free.
+   *
+   * @return T*: A pointer to a new object in the memory pool.
+   ****************************************************************************************/
+  template<class T, class Layout>
+  T* ConcurrentMemoryPool<T, Layout>::new_block_pt()
+  {
+    SizeT block_index = free_blocks().pop();
+    if (block_index == TaggedIndexStack::Null_index) {
+      // Only claim an untouched block if there is one left, so the bump index never runs
+      // past the end of the pool
+      block_index = Next_untouched.load(std::memory_order_relaxed);
+      do {
+        if (block_index >= Pool_size) {
+          throw std::out_of_range("No more space available; all " + std::to_string(Pool_size) +
+                                  " blocks allocated!");
+        }
+      } while (!Next_untouched.compare_exchange_weak(
+        block_index, block_index + 1, std::memory_order_relaxed));
+    }
+    return reinterpret_cast<T*>(Pool_pt + block_index * block_size());
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block in the memory pool, into which 'obj'
+   *        has been moved.
+   *
+   * @param obj: The object to move (using the move constructor of T) to the new block.
+   * @return T*: A pointer to a new object in the memory pool.
+   ****************************************************************************************/
+  template<class T, class Layout>
+  T* ConcurrentMemoryPool<T, Layout>::new_block_pt(T&& obj)
+  {
+    return this->emplace(std::move(obj));
+  }
+
+  /****************************************************************************************
+   * @brief "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. The
+   *        block may be deallocated by a different thread to the one that allocated it.
+   *        Thread-safe and lock-free.
+   *
+   * @param obj_pt: A reference to the pointer to the underlying block in the memory pool.
+   *                Will be set to 'nullptr' after the underlying data has been deallocated.
+   ****************************************************************************************/
+  template<class T, class Layout>
+  void ConcurrentMemoryPool<T, Layout>::delete_block_pt(T*& obj_pt)
+  {
+    if (obj_pt == nullptr) {
+      return;
+    }
+    assert(is_pool_member(obj_pt));
+    auto byte_pt = reinterpret_cast<const Byte*>(obj_pt);
+    free_blocks().push(uint32_t((byte_pt - Pool_pt) / block_size()));
+    obj_pt = nullptr;
+  }
+
+  /****************************************************************************************
+   * @brief The remaining number of objects this pool can hold. Only exact while no other
+   *        thread is using the pool.
+   *
+   ****************************************************************************************/
+  template<class T, class Layout>
+  SizeT ConcurrentMemoryPool<T, Layout>::available_capacity() const
+  {
+    const SizeT num_untouched = Pool_size - Next_untouched.load(std::memory_order_relaxed);
+    return num_untouched + free_blocks().size();
+  }
+
+  /****************************************************************************************
+   * @brief Returns true if 'obj_pt' points to an object of type T in the pool. Returns
+   *        false otherwise.
+   *
+   * @param obj_pt: A pointer to an object of type T.
+   ****************************************************************************************/
+  template<class T, class Layout>
+  bool ConcurrentMemoryPool<T, Layout>::is_pool_member(const T* const obj_pt) const
+  {
+    std::ptrdiff_t offset = reinterpret_cast<const Byte*>(obj_pt) - Pool_pt;
+    return (offset >= 0) && (SizeT(offset) < Pool_size * block_size()) &&
+           (offset % block_size() == 0);
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_CONCURRENT_MEMORY_POOL_HEADER
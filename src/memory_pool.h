@@ -1,13 +1,27 @@
 #ifndef MEMORY_POOL_MEMORY_POOL_HEADER
 #define MEMORY_POOL_MEMORY_POOL_HEADER
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
-#include <stack>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace memory_pool {
   /****************************************************************************************
@@ -18,53 +32,262 @@ namespace memory_pool {
   using SizeT = uint64_t;
 
   /****************************************************************************************
-   * @brief Maximum number of objects in any pool
+   * @brief Number of objects in a pool if no size is given
    *
    ****************************************************************************************/
-  const SizeT g_MaxNumberOfObjectsInPool = 1000;
+  const SizeT g_DefaultNumberOfObjectsInPool = 1000;
+
+  /****************************************************************************************
+   * @brief The (assumed) size of a cache line in bytes
+   *
+   ****************************************************************************************/
+  constexpr SizeT g_CacheLineSize = 64;
+
+  /****************************************************************************************
+   * @brief Rounds 'value' up to the next multiple of 'multiple'
+   *
+   ****************************************************************************************/
+  constexpr SizeT round_up(const SizeT& value, const SizeT& multiple)
+  {
+    return ((value + multiple - 1) / multiple) * multiple;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the index of the lowest set bit in 'word', which must not be zero
+   *
+   ****************************************************************************************/
+  inline SizeT count_trailing_zeros(const uint64_t& word)
+  {
+    assert(word != 0);
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<SizeT>(__builtin_ctzll(word));
+#else
+    SizeT count = 0;
+    while (((word >> count) & 1) == 0) count++;
+    return count;
+#endif
+  }
+
+  /****************************************************************************************
+   * @brief Returns the number of set bits in 'word'
+   *
+   ****************************************************************************************/
+  inline SizeT count_set_bits(const uint64_t& word)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<SizeT>(__builtin_popcountll(word));
+#else
+    SizeT count = 0;
+    for (uint64_t bits = word; bits != 0; bits &= bits - 1) count++;
+    return count;
+#endif
+  }
+
+  /****************************************************************************************
+   * @brief Returns the index of the highest set bit in 'value', which must not be zero;
+   *        i.e. floor(log2(value))
+   *
+   ****************************************************************************************/
+  constexpr SizeT floor_log2(const uint64_t& value)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - static_cast<SizeT>(__builtin_clzll(value));
+#else
+    SizeT log = 0;
+    while ((value >> log) > 1) log++;
+    return log;
+#endif
+  }
+
+  /****************************************************************************************
+   * @brief The number of 64-bit words needed for a bitmap of 'num_bits' bits
+   *
+   ****************************************************************************************/
+  constexpr SizeT bitmap_words(const SizeT& num_bits)
+  {
+    return (num_bits + 63) / 64;
+  }
+
+  /****************************************************************************************
+   * @brief Sets bits 'first_bit' up to (but not including) 'last_bit' of the bitmap at
+   *        'words', a word at a time
+   *
+   ****************************************************************************************/
+  inline void set_bits(uint64_t* words, const SizeT& first_bit, const SizeT& last_bit)
+  {
+    for (SizeT bit = first_bit; bit < last_bit;) {
+      const SizeT offset = bit % 64;
+      const SizeT count = std::min<SizeT>(64 - offset, last_bit - bit);
+      words[bit / 64] |= (count == 64) ? ~uint64_t(0) : ((uint64_t(1) << count) - 1) << offset;
+      bit += count;
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Returns one past the index of the highest set bit in the 'num_words' words at
+   *        'words', or 0 if no bit is set
+   *
+   ****************************************************************************************/
+  inline SizeT end_of_set_bits(const uint64_t* words, const SizeT& num_words)
+  {
+    for (SizeT i = num_words; i > 0; i--) {
+      if (words[i - 1] != 0) return 64 * (i - 1) + floor_log2(words[i - 1]) + 1;
+    }
+    return 0;
+  }
+
+  /****************************************************************************************
+   * @brief Asks the CPU to start loading the cache line holding 'pt'. A hint only; does
+   *        nothing on compilers without a prefetch builtin
+   *
+   ****************************************************************************************/
+  inline void prefetch([[maybe_unused]] const void* pt)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(pt);
+#endif
+  }
+
+  /****************************************************************************************
+   * @brief An uninitialised, suitably aligned block of 'Size' bytes. A MemoryPool of these
+   *        serves untyped, fixed-size requests for memory.
+   *
+   ****************************************************************************************/
+  template<SizeT Size, SizeT Alignment>
+  struct alignas(Alignment) RawBlock {
+    Byte Bytes[Size];
+  };
 
   /****************************************************************************************
    * @brief Tracks the blocks in the pool that can be allocated to.
    *
+   *        The free list is intrusive: each free block stores the index of the next free
+   *        block in its own (unused) bytes, so no separate storage is needed for the
+   *        indices. Blocks that have never been handed out are not on the list at all;
+   *        they are served in order from a bump index instead. This makes both setting up
+   *        and resetting the tracker O(1). Freed blocks are handed out again last in, first
+   *        out; see BitmapTracker for a tracker that hands out the lowest free block.
+   *
+   *        The tracker keeps no record of which blocks are handed out, so allocating and
+   *        freeing cost nothing extra for pools whose live objects are never listed. When
+   *        they are, occupancy() works the bitmap out by walking the free list.
+   *
+   *        NOTE: Every block must be at least sizeof(SizeT) bytes wide so that it can hold
+   *        the index of the next free block.
    ****************************************************************************************/
   class BlockTracker {
   public:
+    // Marks the end of the free list
+    static constexpr SizeT Null_index = std::numeric_limits<SizeT>::max();
+
     BlockTracker() = default;
-    BlockTracker(const SizeT& num_blocks) : BlockTracker() { setup(num_blocks); }
+    BlockTracker(Byte* storage_pt, const SizeT& block_size, const SizeT& num_blocks)
+      : BlockTracker()
+    {
+      setup(storage_pt, block_size, num_blocks);
+    }
     ~BlockTracker() = default;
 
-    void setup(const SizeT& num_blocks);
+    // The smallest size/alignment a block can have; a free block holds a SizeT index
+    static constexpr SizeT min_block_size() { return sizeof(SizeT); }
+    static constexpr SizeT min_block_alignment() { return alignof(SizeT); }
+
+    void setup(Byte* storage_pt, const SizeT& block_size, const SizeT& num_blocks);
     void clear();
-    SizeT size() const { return Blocks.size(); }
+    void reset();
+    SizeT size() const { return Num_available; }
     void push(SizeT block_index);
     SizeT pop();
 
+    // Batch versions of push()/pop(). push_n() adds the 'n' blocks 'index_of(0)' ...
+    // 'index_of(n - 1)' back in one go; pop_n() hands up to 'n' blocks to 'on_pop' and
+    // returns how many it handed out
+    template<class IndexOf>
+    void push_n(const SizeT& n, IndexOf&& index_of);
+    template<class OnPop>
+    SizeT pop_n(const SizeT& n, OnPop&& on_pop);
+
+    // Writes a bitmap of the blocks that are currently handed out (bit i of word w set if
+    // block '64 * w + i' is) to the bitmap_words(num_blocks) words at 'words'. Walks the free
+    // list, so it takes O(number of blocks / 64 + number of free blocks) time
+    void occupancy(uint64_t* words) const;
+
+    // Makes the blocks set in the bitmap at 'words' (laid out as for occupancy()) exactly
+    // the ones that are handed out. The free blocks are handed out lowest address first
+    // afterwards. Used when the pool has moved objects between blocks itself
+    void rebuild(const uint64_t* words);
+
+    // Calls 'release(first, last)' for runs of free blocks [first, last) whose memory the
+    // tracker will not read again before handing them out, so the pool can give the memory
+    // back to the OS. 'words' is the occupancy bitmap of the blocks, as for rebuild()
+    template<class Release>
+    void trim(const uint64_t* words, Release&& release);
+
   private:
-    SizeT Num_blocks;
-    std::stack<SizeT> Blocks;
+    // Reads/writes the index of the free block that follows 'block_index' in the free list
+    SizeT next_index(const SizeT& block_index) const;
+    void set_next_index(const SizeT& block_index, const SizeT& next_index);
+
+    // The storage the blocks live in; the free list is threaded through it
+    Byte* Storage_pt = nullptr;
+
+    // The number of bytes between the start of consecutive blocks
+    SizeT Block_size = 0;
+
+    // The total number of blocks being tracked
+    SizeT Num_blocks = 0;
+
+    // The number of blocks that can currently be handed out
+    SizeT Num_available = 0;
+
+    // Blocks with an index at or above this value have never been handed out
+    SizeT Next_untouched = 0;
+
+    // The index of the first block in the free list
+    SizeT Head = Null_index;
   };
 
   /****************************************************************************************
-   * @brief Allocates an index for each of the blocks.
+   * @brief Starts tracking 'num_blocks' blocks in the given storage. Runs in O(1) time;
+   *        no block is touched until it is handed out.
    *
+   * @param storage_pt: A pointer to the start of the storage holding the blocks.
+   * @param block_size: The number of bytes between the start of consecutive blocks; must
+   *                    be at least sizeof(SizeT).
    * @param num_blocks: The number of blocks to track.
    ****************************************************************************************/
-  void BlockTracker::setup(const SizeT& num_blocks)
+  inline void BlockTracker::setup(Byte* storage_pt,
+                                  const SizeT& block_size,
+                                  const SizeT& num_blocks)
   {
+    assert(block_size >= sizeof(SizeT));
+    Storage_pt = storage_pt;
+    Block_size = block_size;
     Num_blocks = num_blocks;
-    for (SizeT i = 0; i < Num_blocks; i++) {
-      Blocks.push(i);
-    }
+    reset();
   }
 
   /****************************************************************************************
-   * @brief Clears up any data used for the block tracking.
+   * @brief Stops tracking the storage; the tracker will be empty afterwards.
    *
    ****************************************************************************************/
-  void BlockTracker::clear()
+  inline void BlockTracker::clear()
   {
-    Blocks = {};
+    Storage_pt = nullptr;
+    Block_size = 0;
     Num_blocks = 0;
+    reset();
+  }
+
+  /****************************************************************************************
+   * @brief Marks every block as free again in O(1) time. The storage is kept.
+   *
+   ****************************************************************************************/
+  inline void BlockTracker::reset()
+  {
+    Num_available = Num_blocks;
+    Next_untouched = 0;
+    Head = Null_index;
   }
 
   /****************************************************************************************
@@ -72,216 +295,2426 @@ namespace memory_pool {
    *
    * @param block_index: The index of the block to be stored.
    ****************************************************************************************/
-  void BlockTracker::push(SizeT block_index)
+  inline void BlockTracker::push(SizeT block_index)
   {
-    assert(block_index < Num_blocks);
-    Blocks.push(block_index);
+    assert(block_index < Next_untouched);
+    set_next_index(block_index, Head);
+    Head = block_index;
+    Num_available++;
   }
 
   /****************************************************************************************
    * @brief Returns the index of a block from the set of blocks to be tracked.
    *
    ****************************************************************************************/
-  SizeT BlockTracker::pop()
+  inline SizeT BlockTracker::pop()
   {
-    if (Blocks.empty()) {
-      throw std::runtime_error("BlockTracker is empty; cannot pop any more elements.");
+    if (Head != Null_index) {
+      SizeT index = Head;
+      Head = next_index(index);
+      Num_available--;
+      return index;
     }
-    SizeT index = Blocks.top();
-    Blocks.pop();
-    return index;
+    if (Next_untouched < Num_blocks) {
+      Num_available--;
+      return Next_untouched++;
+    }
+    throw std::runtime_error("BlockTracker is empty; cannot pop any more elements.");
   }
 
   /****************************************************************************************
-   * @brief The MemoryPool class. A generic memory pool that provides quick memory
-   *        allocation/deallocation for objects of a given type.
+   * @brief Adds 'n' blocks back to the set of blocks to be tracked. The blocks are first
+   *        linked to each other and the resulting chain is then spliced onto the front of
+   *        the free list, so the head is only updated once.
    *
-   * @tparam T: The type of the objects to be allocated for in the memory pool.
+   * @param n: The number of blocks to add.
+   * @param index_of: A callable returning the index of the i-th block, for i in [0, n).
    ****************************************************************************************/
-  template<class T>
-  class MemoryPool {
-  public:
-    // Default constructor. Initialises an empty pool. You must call allocate() separately
-    // to create the pool
-    MemoryPool() : Pool_pt(nullptr), Pool_size(0), Free_blocks_tracker() {}
-
-    // Immediately creates a pool for 'num_blocks' objects of type T. The argument must
-    // not exceed the value of 'g_MaxNumberOfObjectsInPool' in the 'memory_pool' namespace
-    MemoryPool(const SizeT& num_blocks) : MemoryPool() { allocate(num_blocks); }
-
-    // Destructor. Handles the clean-up
-    ~MemoryPool() { clear(); }
-
-    // Allocate space for 'num_blocks' objects of type T
-    void allocate(const SizeT& num_blocks = g_MaxNumberOfObjectsInPool);
-
-    // Clean up
-    void clear();
-
-    // Returns a pointer to an available block in the memory pool
-    T* new_block_pt();
+  template<class IndexOf>
+  inline void BlockTracker::push_n(const SizeT& n, IndexOf&& index_of)
+  {
+    if (n == 0) return;
+    const SizeT first_index = index_of(0);
+    assert(first_index < Next_untouched);
+    SizeT last_index = first_index;
+    for (SizeT i = 1; i < n; i++) {
+      const SizeT block_index = index_of(i);
+      assert(block_index < Next_untouched);
+      set_next_index(last_index, block_index);
+      last_index = block_index;
+    }
+    set_next_index(last_index, Head);
+    Head = first_index;
+    Num_available += n;
+  }
 
-    // Returns a pointer to an available block in the memory pool and assigns 'obj' to the
-    // location addressed by the pointer
-    T* new_block_pt(T&& obj);
+  /****************************************************************************************
+   * @brief Hands out up to 'n' blocks. Blocks are taken from the free list first, which is
+   *        detached up to the last block taken in one go; any remainder is carved off the
+   *        never-used blocks at the end of the storage without touching them.
+   *
+   * @param n: The maximum number of blocks to hand out.
+   * @param on_pop: A callable that is passed the index of each block handed out.
+   * @return SizeT: The number of blocks handed out; less than 'n' only if the tracker ran
+   *                out of blocks.
+   ****************************************************************************************/
+  template<class OnPop>
+  inline SizeT BlockTracker::pop_n(const SizeT& n, OnPop&& on_pop)
+  {
+    SizeT num_popped = 0;
+    SizeT block_index = Head;
+    while ((num_popped < n) && (block_index != Null_index)) {
+      const SizeT next = next_index(block_index);
+      on_pop(block_index);
+      block_index = next;
+      num_popped++;
+    }
+    Head = block_index;
 
-    // "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. Do not try
-    // to access obj_pt after this function has been called
-    void delete_block_pt(T*& obj_pt);
+    const SizeT num_untouched = std::min(n - num_popped, Num_blocks - Next_untouched);
+    for (SizeT i = 0; i < num_untouched; i++) {
+      on_pop(Next_untouched + i);
+    }
+    Next_untouched += num_untouched;
+    num_popped += num_untouched;
 
-    // The total number of objects this pool can hold
-    inline SizeT size() { return Pool_size; }
+    Num_available -= num_popped;
+    return num_popped;
+  }
 
-    // The remaining number of objects this pool can hold
-    inline SizeT available_capacity() { return Free_blocks_tracker.size(); }
+  /****************************************************************************************
+   * @brief Writes a bitmap of the blocks that are currently handed out to 'words'. Every
+   *        block below the bump index is marked, then the blocks on the free list are
+   *        cleared again, so only free blocks are read.
+   *
+   * @param words: A pointer to (at least) bitmap_words(num_blocks) words.
+   ****************************************************************************************/
+  inline void BlockTracker::occupancy(uint64_t* words) const
+  {
+    std::fill(words, words + bitmap_words(Num_blocks), uint64_t(0));
+    set_bits(words, 0, Next_untouched);
+    for (SizeT block_index = Head; block_index != Null_index;
+         block_index = next_index(block_index)) {
+      words[block_index / 64] &= ~(uint64_t(1) << (block_index % 64));
+    }
+  }
 
-  private:
-    // Returns true if obj_pt points to an object of type T in the pool. Returns false otherwise
-    bool is_pool_member(const T* const obj_pt) const;
+  /****************************************************************************************
+   * @brief Makes the blocks set in 'words' exactly the ones that are handed out. The bump
+   *        index is moved down to just above the highest live block, and the free blocks
+   *        below it are threaded onto the free list in ascending order, so only those
+   *        blocks are written to.
+   *
+   * @param words: A bitmap of the blocks to mark as handed out, as written by occupancy().
+   ****************************************************************************************/
+  inline void BlockTracker::rebuild(const uint64_t* words)
+  {
+    const SizeT num_words = bitmap_words(Num_blocks);
+    Next_untouched = end_of_set_bits(words, num_words);
+    const SizeT num_live_words = bitmap_words(Next_untouched);
 
-    // Computes the number of bytes allocated in the pool for the objects of type T
-    inline SizeT size_in_bytes() { return Pool_size * sizeof(T); }
+    // Link the free blocks from the highest down, so the lowest ends up at the head
+    Head = Null_index;
+    SizeT num_freed = 0;
+    for (SizeT i = num_live_words; i > 0; i--) {
+      uint64_t free_bits = ~words[i - 1];
+      if ((i == num_live_words) && (Next_untouched % 64 != 0)) {
+        free_bits &= (uint64_t(1) << (Next_untouched % 64)) - 1;
+      }
+      for (; free_bits != 0; free_bits &= ~(uint64_t(1) << floor_log2(free_bits))) {
+        const SizeT block_index = 64 * (i - 1) + floor_log2(free_bits);
+        set_next_index(block_index, Head);
+        Head = block_index;
+        num_freed++;
+      }
+    }
+    Num_available = num_freed + (Num_blocks - Next_untouched);
+  }
 
-    // Returns a pointer to the start of the memory block used for the memory pool
-    inline Byte* start() { return Pool_pt; }
+  /****************************************************************************************
+   * @brief Hands the blocks above the highest live block to 'release'. Free blocks below it
+   *        hold the links of the free list, so they are kept. If any free block lies above
+   *        the highest live block, the tracker is first rebuilt to move the bump index down.
+   *
+   * @param words: A bitmap of the blocks that are handed out, as written by occupancy().
+   * @param release: A callable taking the first and one past the last index of a run of
+   *                 free blocks.
+   ****************************************************************************************/
+  template<class Release>
+  void BlockTracker::trim(const uint64_t* words, Release&& release)
+  {
+    if (Next_untouched > end_of_set_bits(words, bitmap_words(Num_blocks))) {
+      rebuild(words);
+    }
+    if (Next_untouched < Num_blocks) {
+      release(Next_untouched, Num_blocks);
+    }
+  }
 
-    // Returns a (off-the-end) pointer that points to the first byte after the memory block
-    // used for the memory pool
-    inline Byte* end() { return Pool_pt + this->size_in_bytes(); }
+  /****************************************************************************************
+   * @brief Returns the index of the free block that follows 'block_index' in the free
+   *        list. The index is stored in the first bytes of the (free) block itself.
+   *
+   * @param block_index: The index of a block in the free list.
+   ****************************************************************************************/
+  inline SizeT BlockTracker::next_index(const SizeT& block_index) const
+  {
+    SizeT next;
+    std::memcpy(&next, Storage_pt + block_index * Block_size, sizeof(SizeT));
+    return next;
+  }
 
-    // Checks if there is any more available space in the pool and throws if there is no
-    // more space available. Does nothing otherwise
-    void throw_if_pool_has_no_more_available_space();
+  /****************************************************************************************
+   * @brief Stores 'next_index' in the first bytes of the (free) block 'block_index'.
+   *
+   * @param block_index: The index of a block being added to the free list.
+   * @param next_index: The index of the block that follows it in the free list.
+   ****************************************************************************************/
+  inline void BlockTracker::set_next_index(const SizeT& block_index, const SizeT& next_index)
+  {
+    std::memcpy(Storage_pt + block_index * Block_size, &next_index, sizeof(SizeT));
+  }
 
-    // A pointer to the underlying block of memory used for the memory pool
-    Byte* Pool_pt;
+  /****************************************************************************************
+   * @brief The default storage for the segments of a MemoryPool; the memory comes from the
+   *        global operator new. A storage policy provides static allocate()/deallocate()
+   *        functions; see mmap_storage.h for an alternative.
+   *
+   ****************************************************************************************/
+  class HeapStorage {
+  public:
+    // Returns 'num_bytes' bytes of (uninitialised) memory aligned to 'alignment'
+    static Byte* allocate(const SizeT& num_bytes, const SizeT& alignment)
+    {
+      if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        return static_cast<Byte*>(::operator new(num_bytes, std::align_val_t(alignment)));
+      }
+      return static_cast<Byte*>(::operator new(num_bytes));
+    }
 
-    // The number of objects this pool can hold
-    SizeT Pool_size;
+    // Releases memory returned by allocate(num_bytes, alignment)
+    static void deallocate(Byte* pt, const SizeT& /* num_bytes */, const SizeT& alignment)
+    {
+      if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        ::operator delete(pt, std::align_val_t(alignment));
+        return;
+      }
+      ::operator delete(pt);
+    }
 
-    // Tracks the blocks in the pool that can be allocated to
-    BlockTracker Free_blocks_tracker;
+    // Gives the whole pages in the 'num_bytes' bytes at 'pt' back to the OS and returns how
+    // many bytes that was. Memory from operator new cannot be handed back piecemeal, so
+    // this does nothing; see MmapStorage
+    static SizeT decommit(Byte* /* pt */, const SizeT& /* num_bytes */) { return 0; }
   };
 
   /****************************************************************************************
-   * @brief Allocate space for 'num_blocks' objects of type T.
+   * @brief The default slot layout for a pool: slots are packed as tightly as the alignment
+   *        of the objects allows. A slot layout maps the smallest size and alignment a slot
+   *        could have to the stride and alignment the pool actually uses, and says how many
+   *        cache colours segments are spread over; see slot_layout.h for alternatives.
    *
-   * @param num_blocks: A positive integer indicating the number of objects the pool should
-   *                    be capable of holding; must not exceed 'g_MaxNumberOfObjectsInPool'
    ****************************************************************************************/
-  template<class T>
-  void MemoryPool<T>::allocate(const SizeT& num_blocks)
-  {
-    if (num_blocks > g_MaxNumberOfObjectsInPool) {
-      throw std::bad_alloc();
+  class NaturalLayout {
+  public:
+    static constexpr SizeT stride(const SizeT& size, const SizeT& alignment)
+    {
+      return round_up(size, alignment);
     }
-    if (Pool_pt != nullptr) {
-      this->clear();
+    static constexpr SizeT alignment(const SizeT& /* size */, const SizeT& alignment)
+    {
+      return alignment;
     }
-    Pool_size = num_blocks;
-    Pool_pt = new Byte[this->size_in_bytes()];
-    Free_blocks_tracker.setup(Pool_size);
-  }
+    static constexpr SizeT num_colours() { return 1; }
+  };
 
   /****************************************************************************************
-   * @brief Cleans up any memory used for the memory pool.
+   * @brief Returns the cache colour for the next segment to be created, cycling through
+   *        'num_colours' colours. Shared by all pools so that their segments start at
+   *        different offsets within a page (and so map to different cache sets).
    *
    ****************************************************************************************/
-  template<class T>
-  void MemoryPool<T>::clear()
+  inline SizeT next_cache_colour(const SizeT& num_colours)
   {
-    if (Pool_pt != nullptr) {
-      delete[] Pool_pt;
-      Pool_pt = nullptr;
-    }
-    Pool_size = 0;
-    Free_blocks_tracker.clear();
+    static std::atomic<SizeT> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) % num_colours;
   }
 
   /****************************************************************************************
-   * @brief Returns a pointer to an available block in the memory pool.
+   * @brief Returns the name of the type T as the compiler spells it (e.g. "Point" or
+   *        "std::pair<int, float>"), or "unknown" if it cannot be worked out. Used to label
+   *        pools in the pool statistics.
    *
-   * @return T*: A pointer to a new object in the memory pool.
    ****************************************************************************************/
   template<class T>
-  T* MemoryPool<T>::new_block_pt()
+  constexpr std::string_view type_name()
   {
-#ifndef NDEBUG
-    throw_if_pool_has_no_more_available_space();
-#endif // NDEBUG
-    const auto block_index = Free_blocks_tracker.pop();
-    T* block_pt = reinterpret_cast<T*>(this->start()) + block_index;
-    return block_pt;
+#if defined(__clang__) || defined(__GNUC__)
+    // e.g. "... type_name() [with T = Point; std::string_view = ...]" (GCC) or
+    // "... type_name() [T = Point]" (Clang)
+    constexpr std::string_view signature = __PRETTY_FUNCTION__;
+    constexpr std::string_view marker = "T = ";
+    const SizeT start = signature.find(marker);
+    if (start == std::string_view::npos) return "unknown";
+    const SizeT first = start + marker.size();
+    const SizeT last = signature.find_first_of(";]", first);
+    return signature.substr(first, last - first);
+#elif defined(_MSC_VER)
+    // e.g. "... type_name<struct Point>(void)"
+    constexpr std::string_view signature = __FUNCSIG__;
+    constexpr std::string_view marker = "type_name<";
+    const SizeT first = signature.find(marker) + marker.size();
+    const SizeT last = signature.rfind(">(void)");
+    return signature.substr(first, last - first);
+#else
+    return "unknown";
+#endif
   }
 
+  /****************************************************************************************
+   * @brief The default statistics policy for MemoryPool: records nothing. Every hook is an
+   *        empty inline function and the class has no members, so (as MemoryPool derives
+   *        from its statistics policy) a pool without statistics is exactly as large and as
+   *        fast as it was before statistics existed. See PoolStats in pool_stats.h for the
+   *        policy that does record statistics.
+   *
+   *        A statistics policy is constructed from the type name and the size of the pool's
+   *        objects and is told about the following events, always by the thread that owns
+   *        the pool at the time:
+   *          - on_allocate(n, num_live): 'n' blocks were handed out
+   *          - on_deallocate(n, num_live): 'n' blocks were given back
+   *          - on_exhausted(): a request found every block in use
+   *          - on_grow(): a growable pool added a segment
+   *          - on_resize(capacity, num_live): the pool was allocated, grown, reset or cleared
+   *
+   *        A policy that sets 'Traces_blocks' is also told which block each event concerns
+   *        (see PoolTrace in pool_trace.h). Blocks are identified by their slot: their index
+   *        in the pool, counting across the segments in the order they were added:
+   *          - on_allocate_block(slot): the block was handed out
+   *          - on_deallocate_block(slot): the block was given back
+   *          - on_relocate_block(from_slot, to_slot): compact() moved an object
+   *
+   ****************************************************************************************/
+  class NoStats {
+  public:
+    static constexpr bool Traces_blocks = false;
+
+    explicit constexpr NoStats(std::string_view /* type_name */, const SizeT& /* object_size */)
+    {}
+
+    void on_allocate(const SizeT& /* n */, const SizeT& /* num_live */) {}
+    void on_deallocate(const SizeT& /* n */, const SizeT& /* num_live */) {}
+    void on_exhausted() {}
+    void on_grow() {}
+    void on_resize(const SizeT& /* capacity */, const SizeT& /* num_live */) {}
+    void on_allocate_block(const SizeT& /* slot */) {}
+    void on_deallocate_block(const SizeT& /* slot */) {}
+    void on_relocate_block(const SizeT& /* from_slot */, const SizeT& /* to_slot */) {}
+  };
 
   /****************************************************************************************
-   * @brief Returns a pointer to an available block in the memory pool and assigns 'obj' to
-   *        the location addressed by the pointer.
+   * @brief The default locking policy for MemoryPool: does no locking, so the pool must
+   *        only be used by one thread at a time. A locking policy is anything with lock()
+   *        and unlock() member functions, such as std::mutex or SpinLock (see
+   *        pool_policies.h). The pool holds its lock while it hands out or takes back
+   *        blocks and handles; see MemoryPool for the functions that are covered.
    *
-   * @param obj: The input to assign to the new memory block. If the input is an lvalue, it
-   *             will be copied to the new memory block. If an rvalue object then it will
-   *             be moved to the new memory block.
-   * @return T*: A pointer to a new object in the memory pool.
    ****************************************************************************************/
-  template<class T>
-  T* MemoryPool<T>::new_block_pt(T&& obj)
-  {
-#ifndef NDEBUG
-    throw_if_pool_has_no_more_available_space();
-#endif // NDEBUG
-    T* block_pt = new_block_pt();
-    *block_pt = std::move(obj);
-    return block_pt;
-  }
+  class NoLock {
+  public:
+    void lock() {}
+    void unlock() {}
+  };
 
   /****************************************************************************************
-   * @brief "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. Do
-   *        not try to access obj_pt after this function has been called.
+   * @brief The default growth policy for MemoryPool: a growth factor set at run time (see
+   *        MemoryPool::set_growth_factor()). Each new segment holds 'growth_factor' times as
+   *        many objects as the one before it; a factor of 0 (the default) gives a fixed-size
+   *        pool.
    *
-   *        NOTE: The underlying block in memory pointed to 'obj_pt' is not wiped. It is
-   *        simply added back to the memory pool for use by another object.
+   *        A growth policy provides next_segment_size(num_blocks), which returns how many
+   *        objects a new segment should hold given the size of the most recently added one,
+   *        or 0 if the pool must not grow. See pool_policies.h for alternatives.
    *
-   * @param obj_pt: A reference to the pointer to the underlying block in the memory pool.
-   *                Will be set to 'nullptr' after the underlying data has been deallocated.
    ****************************************************************************************/
-  template<class T>
-  void MemoryPool<T>::delete_block_pt(T*& obj_pt)
-  {
-    if (obj_pt == nullptr) {
-      return;
+  class GrowthFactor {
+  public:
+    // Saturates rather than wraps around, so a segment too large to address fails to
+    // allocate instead of coming out tiny
+    constexpr SizeT next_segment_size(const SizeT& num_blocks) const
+    {
+      if ((Factor != 0) && (num_blocks > std::numeric_limits<SizeT>::max() / Factor)) {
+        return std::numeric_limits<SizeT>::max();
+      }
+      return num_blocks * Factor;
     }
-    assert(is_pool_member(obj_pt));
-    auto byte_pt = static_cast<const Byte* const>((void*)obj_pt);
-    SizeT pos = (byte_pt - this->start()) / sizeof(T);
-    Free_blocks_tracker.push(pos);
-    obj_pt = nullptr;
-  }
+    void set_growth_factor(const SizeT& growth_factor) { Factor = growth_factor; }
+    constexpr SizeT growth_factor() const { return Factor; }
+
+  private:
+    SizeT Factor = 0;
+  };
 
   /****************************************************************************************
-   * @brief Returns true if 'obj_pt' points to an object of type T in the pool. Returns
-   *        false otherwise.
+   * @brief Recognise the kind of a MemoryPool policy by the interface it provides, so the
+   *        policies can be given to MemoryPool in any order (see MemoryPool)
    *
-   * @param obj_pt: A pointer to an object of type T.
-   * @return true: If 'obj_pt' points to an object of type T in the pool.
-   * @return false: If 'obj_pt' does not point to an object of type T in the pool.
    ****************************************************************************************/
-  template<class T>
-  bool MemoryPool<T>::is_pool_member(const T* const obj_pt) const
+  template<class Policy, class = void>
+  struct is_storage_policy : std::false_type {};
+  template<class Policy>
+  struct is_storage_policy<Policy,
+                           std::void_t<decltype(Policy::allocate(SizeT(), SizeT())),
+                                       decltype(Policy::deallocate(nullptr, SizeT(), SizeT()))>>
+    : std::true_type {};
+
+  template<class Policy, class = void>
+  struct is_layout_policy : std::false_type {};
+  template<class Policy>
+  struct is_layout_policy<Policy,
+                          std::void_t<decltype(Policy::stride(SizeT(), SizeT())),
+                                      decltype(Policy::num_colours())>> : std::true_type {};
+
+  template<class Policy, class = void>
+  struct is_tracker_policy : std::false_type {};
+  template<class Policy>
+  struct is_tracker_policy<Policy,
+                           std::void_t<decltype(Policy::min_block_size()),
+                                       decltype(std::declval<Policy&>().pop())>>
+    : std::true_type {};
+
+  template<class Policy, class = void>
+  struct is_stats_policy : std::false_type {};
+  template<class Policy>
+  struct is_stats_policy<Policy,
+                         std::void_t<decltype(Policy::Traces_blocks),
+                                     decltype(std::declval<Policy&>().on_grow())>>
+    : std::true_type {};
+
+  template<class Policy, class = void>
+  struct is_lock_policy : std::false_type {};
+  template<class Policy>
+  struct is_lock_policy<Policy,
+                        std::void_t<decltype(std::declval<Policy&>().lock()),
+                                    decltype(std::declval<Policy&>().unlock())>>
+    : std::true_type {};
+
+  template<class Policy, class = void>
+  struct is_growth_policy : std::false_type {};
+  template<class Policy>
+  struct is_growth_policy<
+    Policy,
+    std::void_t<decltype(std::declval<const Policy&>().next_segment_size(SizeT()))>>
+    : std::true_type {};
+
+  // The number of kinds of policy 'Policy' could be taken for; must be exactly 1
+  template<class Policy>
+  constexpr SizeT num_policy_kinds()
+  {
+    return SizeT(is_storage_policy<Policy>::value) + SizeT(is_layout_policy<Policy>::value) +
+           SizeT(is_tracker_policy<Policy>::value) + SizeT(is_stats_policy<Policy>::value) +
+           SizeT(is_lock_policy<Policy>::value) + SizeT(is_growth_policy<Policy>::value);
+  }
+
+  // The number of 'Policies' of the kind 'IsKind' recognises
+  template<template<class, class> class IsKind, class... Policies>
+  constexpr SizeT num_policies_of_kind()
+  {
+    return (SizeT(IsKind<Policies, void>::value) + ... + 0);
+  }
+
+  // True if none of 'Policies' are of the same kind
+  template<class... Policies>
+  constexpr bool has_one_policy_of_each_kind()
   {
-    std::ptrdiff_t offset = static_cast<const Byte* const>(obj_pt) - this->start();
-    return (offset >= 0) && (offset < (Pool_size * sizeof(T))) && (offset % sizeof(T) == 0);
+    return (num_policies_of_kind<is_storage_policy, Policies...>() <= 1) &&
+           (num_policies_of_kind<is_layout_policy, Policies...>() <= 1) &&
+           (num_policies_of_kind<is_tracker_policy, Policies...>() <= 1) &&
+           (num_policies_of_kind<is_stats_policy, Policies...>() <= 1) &&
+           (num_policies_of_kind<is_lock_policy, Policies...>() <= 1) &&
+           (num_policies_of_kind<is_growth_policy, Policies...>() <= 1);
   }
 
   /****************************************************************************************
-   * @brief Checks if there is any more available space in the pool and throws if there is
-   *        no more space available. Does nothing otherwise.
+   * @brief Picks the first of 'Policies' of the kind 'IsKind' recognises, or 'Default' if
+   *        there is none
    *
    ****************************************************************************************/
-  template<class T>
-  void MemoryPool<T>::throw_if_pool_has_no_more_available_space()
+  template<template<class, class> class IsKind, class Default, class... Policies>
+  struct select_policy {
+    using type = Default;
+  };
+
+  template<template<class, class> class IsKind, class Default, class First, class... Rest>
+  struct select_policy<IsKind, Default, First, Rest...> {
+    using type = std::conditional_t<IsKind<First, void>::value,
+                                    First,
+                                    typename select_policy<IsKind, Default, Rest...>::type>;
+  };
+
+  template<template<class, class> class IsKind, class Default, class... Policies>
+  using select_policy_t = typename select_policy<IsKind, Default, Policies...>::type;
+
+  template<class T, class... Policies>
+  class MemoryPool;
+
+  /****************************************************************************************
+   * @brief A deleter that destroys an object and returns its block to the pool it came
+   *        from. Used by pool_unique_ptr.
+   *
+   * @tparam T: The type of the objects in the pool.
+   * @tparam Pool: The type of the pool; must provide destroy(T*&).
+   ****************************************************************************************/
+  template<class T, class Pool = MemoryPool<T>>
+  class PoolDeleter {
+  public:
+    PoolDeleter() noexcept : Pool_pt(nullptr) {}
+    explicit PoolDeleter(Pool* pool_pt) noexcept : Pool_pt(pool_pt) {}
+
+    void operator()(T* obj_pt) const { Pool_pt->destroy(obj_pt); }
+
+    // The pool the object is returned to
+    inline Pool* pool() const { return Pool_pt; }
+
+  private:
+    Pool* Pool_pt;
+  };
+
+  /****************************************************************************************
+   * @brief A std::unique_ptr that owns an object in a pool; the object is destroyed and its
+   *        block returned to the pool when the pointer goes out of scope
+   *
+   ****************************************************************************************/
+  template<class T, class Pool = MemoryPool<T>>
+  using pool_unique_ptr = std::unique_ptr<T, PoolDeleter<T, Pool>>;
+
+  /****************************************************************************************
+   * @brief Gives a pool the functions that construct and destroy objects in its blocks,
+   *        built on the pool's own new_block_pt() and delete_block_pt(). Every pool derives
+   *        from it publicly, passing itself as 'Pool':
+   *
+   *          class MyPool : public PoolObjects<T, MyPool> { ... };
+   *
+   *        A pool that declares other overloads of destroy() must bring these in with a
+   *        using-declaration.
+   *
+   * @tparam T: The type of the objects in the pool.
+   * @tparam Pool: The pool; must provide T* new_block_pt() and delete_block_pt(T*&).
+   ****************************************************************************************/
+  template<class T, class Pool>
+  class PoolObjects {
+  public:
+    // Constructs an object of type T in an available block in the pool, forwarding 'args'
+    // to its constructor, and returns a pointer to it
+    template<class... Args>
+    T* emplace(Args&&... args);
+
+    // Constructs an object of type T as with emplace() and returns a pool_unique_ptr that
+    // destroys the object and returns its block to the pool when it goes out of scope
+    template<class... Args>
+    pool_unique_ptr<T, Pool> make_unique(Args&&... args);
+
+    // Runs the destructor of the object pointed to by 'obj_pt' then deletes its block as with
+    // delete_block_pt(). Use for objects created with emplace() or new_block_pt(T&&)
+    void destroy(T*& obj_pt);
+
+  protected:
+    // Only a pool deriving from this can create it
+    PoolObjects() = default;
+
+  private:
+    inline Pool& pool() { return static_cast<Pool&>(*this); }
+  };
+
+  /****************************************************************************************
+   * @brief Constructs an object of type T in an available block in the pool using placement
+   *        new, so no temporary is created. If the constructor throws, the block is returned
+   *        to the pool and the exception is rethrown.
+   *
+   * @param args: The arguments to forward to the constructor of T.
+   * @return T*: A pointer to the new object in the pool.
+   ****************************************************************************************/
+  template<class T, class Pool>
+  template<class... Args>
+  T* PoolObjects<T, Pool>::emplace(Args&&... args)
+  {
+    T* block_pt = pool().new_block_pt();
+    try {
+      return ::new (static_cast<void*>(block_pt)) T(std::forward<Args>(args)...);
+    }
+    catch (...) {
+      pool().delete_block_pt(block_pt);
+      throw;
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Constructs an object of type T as with emplace() and returns a pool_unique_ptr
+   *        owning it. The object is destroyed, and its block returned to the pool, when
+   *        the pointer goes out of scope. The pool must outlive the pointer.
+   *
+   * @param args: The arguments to forward to the constructor of T.
+   * @return pool_unique_ptr<T, Pool>: A pointer owning the new object.
+   ****************************************************************************************/
+  template<class T, class Pool>
+  template<class... Args>
+  pool_unique_ptr<T, Pool> PoolObjects<T, Pool>::make_unique(Args&&... args)
+  {
+    return pool_unique_ptr<T, Pool>(emplace(std::forward<Args>(args)...),
+                                    PoolDeleter<T, Pool>(&pool()));
+  }
+
+  /****************************************************************************************
+   * @brief Runs the destructor of the object pointed to by 'obj_pt', then returns its block
+   *        to the pool and nullifies the input pointer.
+   *
+   * @param obj_pt: A reference to the pointer to a (constructed) object in the pool. Will
+   *                be set to 'nullptr' after the object has been destroyed.
+   ****************************************************************************************/
+  template<class T, class Pool>
+  void PoolObjects<T, Pool>::destroy(T*& obj_pt)
+  {
+    if (obj_pt == nullptr) {
+      return;
+    }
+    obj_pt->~T();
+    pool().delete_block_pt(obj_pt);
+  }
+
+  /****************************************************************************************
+   * @brief A generational handle to an object in a MemoryPool; an alternative to the raw
+   *        T* returned by new_block_pt(). The low 'IndexBits' bits of a 'Word' hold the index
+   *        of an entry in the pool's handle table and the remaining bits hold the generation
+   *        of that entry when the handle was created. Freeing the object bumps the entry's
+   *        generation, so MemoryPool::resolve() can tell in O(1) time that a handle is stale
+   *        and return nullptr instead of a dangling pointer.
+   *
+   *        By default a handle is 4 bytes (half the size of a pointer), which allows up to
+   *        2^20 - 1 live handles per pool and detects reuse of a slot up to 4095 times over;
+   *        use Handle<T, uint64_t> (32-bit index, 32-bit generation) for more. A default
+   *        constructed handle is null.
+   *
+   * @tparam T: The type of the object the handle refers to.
+   * @tparam Word: The unsigned integer type the index and generation are packed into.
+   * @tparam IndexBits: The number of bits used for the index.
+   ****************************************************************************************/
+  template<class T, class Word = uint32_t, unsigned IndexBits = (sizeof(Word) < 8) ? 20 : 32>
+  class Handle {
+  public:
+    static_assert(std::is_unsigned_v<Word>, "Handles must be packed into an unsigned type");
+    static_assert((IndexBits > 0) && (IndexBits < 8 * sizeof(Word)) && (IndexBits <= 32),
+                  "There must be between 1 and 32 index bits, and some generation bits");
+
+    // The number of bits used for the generation
+    static constexpr unsigned Generation_bits = 8 * sizeof(Word) - IndexBits;
+
+    // Masks for the index and generation (once shifted down)
+    static constexpr Word Index_mask = static_cast<Word>((Word(1) << IndexBits) - 1);
+    static constexpr Word Generation_mask = static_cast<Word>(~Word(0) >> IndexBits);
+
+    // The largest index a handle can refer to; an index of all ones marks a null handle
+    static constexpr SizeT Max_index = Index_mask - 1;
+
+    // Creates a null handle
+    constexpr Handle() : Value(Index_mask) {}
+
+    // Creates a handle to table entry 'index' in generation 'generation' (of which only the
+    // low Generation_bits bits are kept)
+    constexpr Handle(const SizeT& index, const SizeT& generation)
+      : Value(static_cast<Word>((index & Index_mask) |
+                                (static_cast<Word>(generation & Generation_mask) << IndexBits)))
+    {}
+
+    // The index of the handle table entry the handle refers to
+    constexpr SizeT index() const { return Value & Index_mask; }
+
+    // The generation of the entry the handle was created in
+    constexpr SizeT generation() const { return Value >> IndexBits; }
+
+    // Returns true if the handle does not refer to anything
+    constexpr bool is_null() const { return index() == Index_mask; }
+    explicit constexpr operator bool() const { return !is_null(); }
+
+    // The packed index and generation, e.g. to store the handle somewhere that only takes
+    // integers, and the handle with a given packed value
+    constexpr Word value() const { return Value; }
+    static constexpr Handle from_value(const Word& value)
+    {
+      Handle handle;
+      handle.Value = value;
+      return handle;
+    }
+
+    friend constexpr bool operator==(const Handle& lhs, const Handle& rhs)
+    {
+      return lhs.Value == rhs.Value;
+    }
+    friend constexpr bool operator!=(const Handle& lhs, const Handle& rhs)
+    {
+      return lhs.Value != rhs.Value;
+    }
+
+  private:
+    Word Value;
+  };
+
+  /****************************************************************************************
+   * @brief Asks for a walk over the live objects in a pool to be split across threads, in
+   *        the style of std::execution::par; e.g. pool.for_each_live(g_Parallel, f).
+   *
+   ****************************************************************************************/
+  struct ParallelPolicy {
+    // The number of threads to use (including the calling thread); 0 means one per core
+    SizeT Num_threads = 0;
+
+    // Fewer threads are used if each would get fewer live objects than this
+    SizeT Min_objects_per_thread = 4096;
+  };
+
+  // The default parallel policy
+  constexpr ParallelPolicy g_Parallel{};
+
+  /****************************************************************************************
+   * @brief Limits how much work one call to MemoryPool::compact() does, so compaction can
+   *        be spread over many calls (e.g. one per frame). The call stops at whichever
+   *        limit it reaches first; by default there is no limit.
+   *
+   ****************************************************************************************/
+  struct CompactionBudget {
+    // The most objects to move
+    SizeT Max_moves = std::numeric_limits<SizeT>::max();
+
+    // The most time to spend moving objects. The clock is read before the first move and then
+    // every 16 moves, so the budget can be overrun by up to 15 moves; a budget of zero moves
+    // nothing
+    std::chrono::steady_clock::duration Max_time = std::chrono::steady_clock::duration::max();
+  };
+
+  /****************************************************************************************
+   * @brief What a call to MemoryPool::compact() did.
+   *
+   ****************************************************************************************/
+  struct CompactionProgress {
+    // The number of objects moved by the call
+    SizeT Num_moved = 0;
+
+    // True if the live objects now occupy the lowest blocks of the pool, so further calls
+    // have nothing to do until objects are freed again
+    bool Is_complete = false;
+  };
+
+  /****************************************************************************************
+   * @brief The objects that were live (allocated) in a pool when the pool's live_objects()
+   *        was called, as a range that can be walked in address order with a forward
+   *        iterator or for_each(). Holds one occupancy bit per block of the pool, so taking
+   *        the snapshot costs O(pool size / 64) and never touches the objects themselves.
+   *        The walk scans the words of the bitmap with count-trailing-zeros, so runs of
+   *        free blocks cost next to nothing, and prefetches the live objects a little ahead
+   *        of the one being visited to hide cache misses when they are spread thinly.
+   *
+   *        Objects allocated after the snapshot was taken are not visited. An object may be
+   *        destroyed while it is being visited, but no other object in the range may be.
+   *
+   * @tparam T: The type of the objects in the pool.
+   ****************************************************************************************/
+  template<class T>
+  class LiveObjects {
+  private:
+    // The occupancy bits of one segment of the pool
+    struct Span {
+      // A pointer to the first block in the segment
+      Byte* Pt;
+
+      // The index of the segment's first word in 'Words'
+      SizeT First_word;
+    };
+
+    // Walks the set bits in a range of words, returning the block each belongs to
+    class Cursor {
+    public:
+      Cursor() = default;
+      Cursor(const LiveObjects* live, const SizeT& begin_word, const SizeT& end_word);
+
+      // Returns a pointer to the next live block, or nullptr at the end of the range
+      Byte* next();
+
+    private:
+      const LiveObjects* Live = nullptr;
+      SizeT Span_index = 0;
+      SizeT Span_end_word = 0;
+      SizeT Word_index = 0;
+      SizeT End_word = 0;
+
+      // The first block covered by word 'Word_index'
+      Byte* Word_pt = nullptr;
+
+      // The bits of word 'Word_index' that have not been visited yet
+      uint64_t Bits = 0;
+    };
+
+  public:
+    // How many live objects ahead of the current one the iterator prefetches
+    static constexpr SizeT Prefetch_distance = 8;
+
+    // How many bitmap words (of 64 blocks each) ahead for_each() prefetches
+    static constexpr SizeT Prefetch_word_distance = 4;
+
+    class iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = T*;
+      using reference = T&;
+
+      // Creates an end iterator
+      iterator() = default;
+
+      T& operator*() const { return *Obj_pt; }
+      T* operator->() const { return Obj_pt; }
+      iterator& operator++();
+      iterator operator++(int)
+      {
+        iterator copy = *this;
+        ++(*this);
+        return copy;
+      }
+      bool operator==(const iterator& other) const { return Obj_pt == other.Obj_pt; }
+      bool operator!=(const iterator& other) const { return Obj_pt != other.Obj_pt; }
+
+    private:
+      friend class LiveObjects;
+      iterator(const LiveObjects* live, const SizeT& begin_word, const SizeT& end_word);
+
+      // Finds the objects to visit
+      Cursor Current;
+
+      // Runs 'Prefetch_distance' objects ahead of 'Current' to prefetch them
+      Cursor Ahead;
+
+      // The object the iterator points to; nullptr for an end iterator
+      T* Obj_pt = nullptr;
+    };
+
+    iterator begin() const { return iterator(this, 0, Words.size()); }
+    iterator end() const { return iterator(); }
+
+    // The number of live objects in the range
+    inline SizeT size() const { return Num_live; }
+    inline bool empty() const { return Num_live == 0; }
+
+    // Calls 'function' with a reference to each live object, in address order
+    template<class Function>
+    void for_each(Function&& function) const;
+
+    // Calls 'function' with a reference to each live object, splitting the objects into
+    // contiguous ranges of (about) equal size that are walked by different threads. The
+    // function is called concurrently, but never twice for the same object. If any call
+    // throws, the first exception is rethrown once every thread has finished
+    template<class Function>
+    void for_each(const ParallelPolicy& policy, Function&& function) const;
+
+  private:
+    template<class, class...>
+    friend class MemoryPool;
+
+    explicit LiveObjects(const SizeT& block_size) : Block_size(block_size), Num_live(0) {}
+
+    // Returns the index of the span that word 'word_index' belongs to
+    SizeT span_of(const SizeT& word_index) const;
+
+    // The index of the first word after span 'span_index'
+    inline SizeT span_end_word(const SizeT& span_index) const
+    {
+      return (span_index + 1 < Spans.size()) ? Spans[span_index + 1].First_word : Words.size();
+    }
+
+    // Calls 'function' with a reference to each live object in the words
+    // '[begin_word, end_word)', in address order
+    template<class Function>
+    void walk(const SizeT& begin_word, const SizeT& end_word, Function& function) const;
+
+    // The number of bytes between the start of consecutive blocks
+    SizeT Block_size;
+
+    // The occupancy bits of every segment, segment after segment in address order
+    std::vector<uint64_t> Words;
+
+    // Where each segment's bits start in 'Words', in address order
+    std::vector<Span> Spans;
+
+    // The number of set bits in 'Words'
+    SizeT Num_live;
+  };
+
+  /****************************************************************************************
+   * @brief Creates a cursor over the set bits in 'words[begin_word, end_word)'.
+   *
+   ****************************************************************************************/
+  template<class T>
+  LiveObjects<T>::Cursor::Cursor(const LiveObjects* live,
+                                 const SizeT& begin_word,
+                                 const SizeT& end_word)
+    : Live(live), Word_index(begin_word), End_word(end_word)
+  {
+    if (Word_index < End_word) {
+      Span_index = Live->span_of(Word_index);
+      const Span& span = Live->Spans[Span_index];
+      Word_pt = span.Pt + (Word_index - span.First_word) * 64 * Live->Block_size;
+      Span_end_word = Live->span_end_word(Span_index);
+      Bits = Live->Words[Word_index];
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to the block of the next set bit and clears the bit, moving on
+   *        to the next word (and segment) as needed.
+   *
+   * @return Byte*: The next live block, or nullptr if there are no more in the range.
+   ****************************************************************************************/
+  template<class T>
+  Byte* LiveObjects<T>::Cursor::next()
+  {
+    while (Bits == 0) {
+      if (Word_index + 1 >= End_word) {
+        Word_index = End_word;
+        return nullptr;
+      }
+      Word_index++;
+      if (Word_index == Span_end_word) {
+        Span_index++;
+        Word_pt = Live->Spans[Span_index].Pt;
+        Span_end_word = Live->span_end_word(Span_index);
+      }
+      else {
+        Word_pt += 64 * Live->Block_size;
+      }
+      Bits = Live->Words[Word_index];
+    }
+    Byte* block_pt = Word_pt + count_trailing_zeros(Bits) * Live->Block_size;
+    Bits &= Bits - 1;
+    return block_pt;
+  }
+
+  /****************************************************************************************
+   * @brief Creates an iterator pointing to the first live object in the words
+   *        '[begin_word, end_word)' and starts prefetching the objects after it.
+   *
+   ****************************************************************************************/
+  template<class T>
+  LiveObjects<T>::iterator::iterator(const LiveObjects* live,
+                                     const SizeT& begin_word,
+                                     const SizeT& end_word)
+    : Current(live, begin_word, end_word), Ahead(Current)
+  {
+    Obj_pt = reinterpret_cast<T*>(Current.next());
+    Ahead.next();
+    for (SizeT i = 0; i < Prefetch_distance; i++) {
+      if (Byte* ahead_pt = Ahead.next()) prefetch(ahead_pt);
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Moves on to the next live object, prefetching the one 'Prefetch_distance'
+   *        objects further on.
+   *
+   ****************************************************************************************/
+  template<class T>
+  typename LiveObjects<T>::iterator& LiveObjects<T>::iterator::operator++()
+  {
+    Obj_pt = reinterpret_cast<T*>(Current.next());
+    if (Byte* ahead_pt = Ahead.next()) prefetch(ahead_pt);
+    return *this;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the index of the span (segment) that word 'word_index' belongs to.
+   *
+   ****************************************************************************************/
+  template<class T>
+  SizeT LiveObjects<T>::span_of(const SizeT& word_index) const
+  {
+    auto it = std::upper_bound(Spans.begin(),
+                               Spans.end(),
+                               word_index,
+                               [](const SizeT& index, const Span& span) {
+                                 return index < span.First_word;
+                               });
+    return static_cast<SizeT>(it - Spans.begin()) - 1;
+  }
+
+  /****************************************************************************************
+   * @brief Calls 'function' with a reference to each live object in the words
+   *        '[begin_word, end_word)'. Each word covers 64 consecutive blocks; its set bits
+   *        are visited with count-trailing-zeros, so runs of free blocks cost nothing. The
+   *        first live object of the word 'Prefetch_word_distance' words ahead is prefetched.
+   *
+   * @param begin_word: The first word to visit.
+   * @param end_word: One past the last word to visit.
+   * @param function: A callable taking a T&.
+   ****************************************************************************************/
+  template<class T>
+  template<class Function>
+  void LiveObjects<T>::walk(const SizeT& begin_word,
+                            const SizeT& end_word,
+                            Function& function) const
+  {
+    if (begin_word >= end_word) return;
+    const SizeT word_stride = 64 * Block_size;
+    SizeT word_index = begin_word;
+    for (SizeT span_index = span_of(begin_word); word_index < end_word; span_index++) {
+      const Span& span = Spans[span_index];
+      const SizeT span_end = std::min(end_word, span_end_word(span_index));
+      Byte* word_pt = span.Pt + (word_index - span.First_word) * word_stride;
+      for (; word_index < span_end; word_index++, word_pt += word_stride) {
+        if (word_index + Prefetch_word_distance < span_end) {
+          const uint64_t ahead_bits = Words[word_index + Prefetch_word_distance];
+          if (ahead_bits != 0) {
+            prefetch(word_pt + Prefetch_word_distance * word_stride +
+                     count_trailing_zeros(ahead_bits) * Block_size);
+          }
+        }
+        for (uint64_t bits = Words[word_index]; bits != 0; bits &= bits - 1) {
+          function(*reinterpret_cast<T*>(word_pt + count_trailing_zeros(bits) * Block_size));
+        }
+      }
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Calls 'function' with a reference to each live object, in address order.
+   *
+   * @param function: A callable taking a T&.
+   ****************************************************************************************/
+  template<class T>
+  template<class Function>
+  void LiveObjects<T>::for_each(Function&& function) const
+  {
+    walk(0, Words.size(), function);
+  }
+
+  /****************************************************************************************
+   * @brief Calls 'function' with a reference to each live object, walking contiguous
+   *        ranges of the pool on different threads. The ranges are chosen (at word
+   *        granularity) so that each holds about the same number of live objects; the
+   *        calling thread walks the first one.
+   *
+   * @param policy: How many threads to use.
+   * @param function: A callable taking a T&; called concurrently from several threads.
+   ****************************************************************************************/
+  template<class T>
+  template<class Function>
+  void LiveObjects<T>::for_each(const ParallelPolicy& policy, Function&& function) const
+  {
+    static const SizeT num_cores = std::max<SizeT>(std::thread::hardware_concurrency(), 1);
+    SizeT num_threads = (policy.Num_threads > 0) ? policy.Num_threads : num_cores;
+    num_threads = std::min(num_threads,
+                           Num_live / std::max<SizeT>(policy.Min_objects_per_thread, 1));
+    if (num_threads <= 1) {
+      for_each(function);
+      return;
+    }
+
+    // Split the words so that each range has about Num_live / num_threads live objects
+    std::vector<SizeT> boundaries{0};
+    SizeT num_counted = 0;
+    for (SizeT word_index = 0; word_index < Words.size(); word_index++) {
+      num_counted += count_set_bits(Words[word_index]);
+      if (num_counted * num_threads >= boundaries.size() * Num_live) {
+        boundaries.push_back(word_index + 1);
+        if (boundaries.size() == num_threads) break;
+      }
+    }
+    boundaries.push_back(Words.size());
+
+    const SizeT num_ranges = boundaries.size() - 1;
+    std::vector<std::exception_ptr> exceptions(num_ranges);
+    auto walk_range = [&](const SizeT& range_index) {
+      try {
+        walk(boundaries[range_index], boundaries[range_index + 1], function);
+      }
+      catch (...) {
+        exceptions[range_index] = std::current_exception();
+      }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_ranges - 1);
+    try {
+      for (SizeT range_index = 1; range_index < num_ranges; range_index++) {
+        threads.emplace_back(walk_range, range_index);
+      }
+    }
+    catch (...) {
+      for (auto& thread : threads) thread.join();
+      throw;
+    }
+    walk_range(0);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (const auto& exception : exceptions) {
+      if (exception) std::rethrow_exception(exception);
+    }
+  }
+
+  /****************************************************************************************
+   * @brief The MemoryPool class. A generic memory pool that provides quick memory
+   *        allocation/deallocation for objects of a given type.
+   *
+   *        The pool is made up of one or more segments; each segment is a contiguous block
+   *        of memory with its own free block tracking. By default a pool has a fixed size
+   *        and consists of a single segment. If a growth factor is set, the pool instead
+   *        adds a new segment whenever it runs out of space. Existing segments are never
+   *        moved, so pointers to allocated blocks stay valid when the pool grows.
+   *
+   *        Everything else about the pool is chosen at compile time by policies, which can
+   *        be given in any order; each is recognised by the interface it provides and any
+   *        kind left out takes its default. There is no runtime dispatch: the policies'
+   *        functions are called directly and empty policies take up no space, so
+   *        MemoryPool<T> is exactly the pool it was before the policies existed. E.g.
+   *
+   *          MemoryPool<Point, BitmapTracker, std::mutex, FixedCapacity> pool(1000);
+   *
+   *        The kinds of policy, with their defaults, are:
+   *          - Storage (HeapStorage): where the memory for the segments comes from
+   *          - Layout (NaturalLayout): how the blocks are laid out in a segment
+   *          - Tracker (BlockTracker): how the free blocks in a segment are tracked
+   *          - Stats (NoStats): what statistics the pool keeps about itself
+   *          - Lock (NoLock): what the pool locks while it hands out or takes back blocks
+   *          - Growth (GrowthFactor): how large each new segment is
+   *
+   *        With a locking policy other than NoLock, new_block_pt(), delete_block_pt(),
+   *        new_blocks(), delete_blocks(), new_handle(), resolve() and delete_handle() (and
+   *        the functions built on them, such as emplace() and destroy()) may be called from
+   *        several threads at once. Every other function still needs the pool to itself.
+   *
+   * @tparam T: The type of the objects to be allocated for in the memory pool.
+   * @tparam Policies: Any of the policies above, at most one of each kind.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  class MemoryPool : public PoolObjects<T, MemoryPool<T, Policies...>>,
+                     private select_policy_t<is_stats_policy, NoStats, Policies...> {
+  public:
+    using Storage = select_policy_t<is_storage_policy, HeapStorage, Policies...>;
+    using Layout = select_policy_t<is_layout_policy, NaturalLayout, Policies...>;
+    using Tracker = select_policy_t<is_tracker_policy, BlockTracker, Policies...>;
+    using Stats = select_policy_t<is_stats_policy, NoStats, Policies...>;
+    using Lock = select_policy_t<is_lock_policy, NoLock, Policies...>;
+    using Growth = select_policy_t<is_growth_policy, GrowthFactor, Policies...>;
+
+    static_assert(((num_policy_kinds<Policies>() == 1) && ...),
+                  "Every MemoryPool policy must be exactly one kind of policy");
+    static_assert(has_one_policy_of_each_kind<Policies...>(),
+                  "A MemoryPool can only be given one policy of each kind");
+
+    // Default constructor. Initialises an empty pool. You must call allocate() separately
+    // to create the pool (unless the pool is growable)
+    MemoryPool() : Stats(type_name<T>(), sizeof(T)), Pool_size(0), Num_available(0) {}
+
+    // Immediately creates a pool for 'num_blocks' objects of type T. If 'growth_factor' is
+    // non-zero, the pool is growable; see set_growth_factor(). Only the GrowthFactor policy
+    // takes a growth factor; with any other growth policy a non-zero factor throws
+    MemoryPool(const SizeT& num_blocks, const SizeT& growth_factor = 0) : MemoryPool()
+    {
+      if constexpr (std::is_same_v<Growth, GrowthFactor>) {
+        set_growth_factor(growth_factor);
+      }
+      else if (growth_factor != 0) {
+        throw std::invalid_argument("The growth policy of this pool takes no growth factor");
+      }
+      allocate(num_blocks);
+    }
+
+    // Destructor. Handles the clean-up
+    ~MemoryPool() { clear(); }
+
+    // The pool owns raw memory so it cannot be copied
+    MemoryPool(const MemoryPool&) = delete;
+    MemoryPool& operator=(const MemoryPool&) = delete;
+
+    // Allocate space for 'num_blocks' objects of type T
+    void allocate(const SizeT& num_blocks = g_DefaultNumberOfObjectsInPool);
+
+    // Clean up. Does not run the destructors of any objects still in the pool
+    void clear();
+
+    // Marks every block in the pool as free again without releasing or reallocating the
+    // pool. Do not try to access previously allocated blocks afterwards. Does not run the
+    // destructors of any objects still in the pool
+    void reset();
+
+    // As reset(), but first runs the destructor of every object still in the pool. Use when
+    // the objects own resources and were not all destroyed one by one
+    void destroy_all();
+
+    // Makes the pool growable. When the pool is full, a new segment is added that holds
+    // 'growth_factor' times as many objects as the most recently added segment. A growth
+    // factor of 0 (the default) gives a fixed-size pool. Only with the GrowthFactor policy
+    void set_growth_factor(const SizeT& growth_factor)
+    {
+      Growth_policy.set_growth_factor(growth_factor);
+    }
+
+    // Returns true if the pool adds a new segment when it runs out of space
+    inline bool is_growable() const { return Growth_policy.next_segment_size(1) > 0; }
+
+    // Gives memory holding only free blocks back to the OS and returns how many bytes were
+    // released. Empty segments added by growth are freed; in the remaining segments, whole
+    // pages of free blocks are decommitted if the storage supports it (see MmapStorage).
+    // Decommitted pages are committed again when blocks in them are next handed out
+    SizeT trim();
+
+    // Makes decay() trim the pool once it has gone 'decay_time' without the number of live
+    // objects rising. A decay time of 0 (the default) turns decay off
+    void set_decay_time(const std::chrono::steady_clock::duration& decay_time);
+
+    // Trims the pool if it has been idle for the decay time (see set_decay_time()) and
+    // returns how many bytes were released. Meant to be called regularly, e.g. once per
+    // frame or from a housekeeping timer; it costs one clock read when there is nothing to do
+    SizeT decay();
+
+    // Returns a pointer to an available block in the memory pool. The block is uninitialised
+    // memory; use emplace() to construct an object in it
+    T* new_block_pt()
+    {
+      std::lock_guard<Lock> guard(Pool_lock);
+      return pop_block();
+    }
+
+    // As new_block_pt(), but returns nullptr instead of throwing if the pool is full and
+    // cannot grow (or growing it fails for lack of memory)
+    T* try_new_block_pt();
+
+    // Returns a pointer to an available block in the memory pool, into which 'obj' has been
+    // moved
+    T* new_block_pt(T&& obj);
+
+    // Writes pointers to 'n' available blocks to 'obj_pts' (which must have room for 'n'
+    // pointers). Either all 'n' blocks are allocated or, if that is not possible, none are
+    void new_blocks(const SizeT& n, T** obj_pts)
+    {
+      std::lock_guard<Lock> guard(Pool_lock);
+      pop_blocks(n, obj_pts);
+    }
+
+    // Constructs 'n' objects of type T as with new_blocks() followed by emplace(), passing
+    // each a copy of 'args', and writes pointers to them to 'obj_pts'
+    template<class... Args>
+    void emplace_blocks(const SizeT& n, T** obj_pts, const Args&... args);
+
+    // "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. Do not try
+    // to access obj_pt after this function has been called. Does not run the destructor
+    void delete_block_pt(T*& obj_pt)
+    {
+      if (obj_pt == nullptr) return;
+      std::lock_guard<Lock> guard(Pool_lock);
+      push_block(obj_pt);
+      obj_pt = nullptr;
+    }
+
+    // emplace(), make_unique() and destroy(T*&) come from PoolObjects
+    using PoolObjects<T, MemoryPool>::destroy;
+
+    // Batch versions of delete_block_pt() and destroy() for the 'n' pointers starting at
+    // 'obj_pts'. Each pointer is nullified; null pointers are skipped
+    void delete_blocks(T** obj_pts, const SizeT& n)
+    {
+      std::lock_guard<Lock> guard(Pool_lock);
+      push_blocks(obj_pts, n);
+    }
+    void destroy_blocks(T** obj_pts, const SizeT& n);
+
+    // Returns a handle to an available block in the memory pool (see Handle). The block is
+    // uninitialised memory. A block allocated through a handle must be freed through it
+    template<class HandleT = Handle<T>>
+    HandleT new_handle();
+
+    // Constructs an object of type T as with emplace() and returns a handle to it
+    template<class HandleT = Handle<T>, class... Args>
+    HandleT emplace_handle(Args&&... args);
+
+    // Returns a pointer to the object 'handle' refers to, or nullptr if the handle is null or
+    // stale (i.e. the object has since been freed). Takes O(1) time
+    template<class Word, unsigned IndexBits>
+    T* resolve(const Handle<T, Word, IndexBits>& handle) const
+    {
+      std::lock_guard<Lock> guard(Pool_lock);
+      return find_handle(handle);
+    }
+
+    // Frees the block 'handle' refers to, as with delete_block_pt(), and nullifies the
+    // handle. Every other copy of the handle becomes stale. Does nothing if the handle is
+    // already null or stale. The second version runs the destructor of the object first
+    template<class Word, unsigned IndexBits>
+    void delete_handle(Handle<T, Word, IndexBits>& handle);
+    template<class Word, unsigned IndexBits>
+    void destroy(Handle<T, Word, IndexBits>& handle);
+
+    // Returns the objects currently allocated in the pool as a range that can be walked in
+    // address order; see LiveObjects
+    LiveObjects<T> live_objects();
+
+    // Calls 'function' with a reference to each object allocated in the pool, in address
+    // order. The second version splits the pool into ranges walked by different threads
+    template<class Function>
+    void for_each_live(Function&& function);
+    template<class Function>
+    void for_each_live(const ParallelPolicy& policy, Function&& function);
+
+    // Moves live objects from the highest blocks of the pool into the lowest free ones (the
+    // first segment added counting as lowest), using T's move constructor, until the budget
+    // runs out. Handles are updated automatically; the second version also calls
+    // 'on_relocate(old_pt, new_pt)' for every object moved so other references can be fixed
+    // up. Pointers to moved objects, and live_objects() snapshots, become invalid
+    CompactionProgress compact(const CompactionBudget& budget = CompactionBudget())
+    {
+      return compact(budget, [](T*, T*) {});
+    }
+    template<class Function>
+    CompactionProgress compact(const CompactionBudget& budget, Function&& on_relocate);
+
+    // The total number of objects this pool can hold
+    inline SizeT size() const { return Pool_size; }
+
+    // The remaining number of objects this pool can hold (before it next has to grow)
+    inline SizeT available_capacity() const { return Num_available; }
+
+    // The number of segments the pool is made up of
+    inline SizeT num_segments() const { return Segments.size(); }
+
+    // The statistics the pool keeps about itself (nothing with the default NoStats policy)
+    inline const Stats& stats() const { return *this; }
+
+    // The growth policy of the pool
+    inline const Growth& growth() const { return Growth_policy; }
+
+  private:
+    // A contiguous block of memory holding some of the blocks in the pool
+    struct Segment {
+      // A pointer to the first block in the segment
+      Byte* Pt;
+
+      // The number of bytes the first block is offset from the start of the memory used for
+      // the segment; non-zero only if the layout uses cache colouring
+      SizeT Colour_offset;
+
+      // The number of objects the segment can hold
+      SizeT Num_blocks;
+
+      // The slot of the first block in the segment: the number of blocks in the segments
+      // added before it (see NoStats)
+      SizeT First_slot;
+
+      // Tracks the blocks in the segment that can be allocated to
+      Tracker Free_blocks_tracker;
+
+      // The index of the handle table entry referring to each block, so compact() can
+      // update the entry when it moves the object. Empty until a handle refers to a block in
+      // the segment. Entries for freed blocks are left behind; they are recognised as stale
+      // because the handle table entry no longer points at the block
+      std::vector<uint32_t> Handle_entry_indices;
+    };
+
+    // The address range covered by a segment; used to find the segment owning a block
+    struct SegmentRange {
+      const Byte* Start;
+      const Byte* End;
+      SizeT Segment_index;
+    };
+
+    // Returned by find_segment() if a pointer does not belong to any segment
+    static constexpr SizeT Null_segment = std::numeric_limits<SizeT>::max();
+
+    // An entry in the handle table: the object a handle refers to (nullptr while the entry is
+    // free) and the entry's generation, which is bumped every time the entry is freed
+    struct HandleEntry {
+      T* Pt;
+      uint32_t Generation;
+      uint32_t Next_free;
+    };
+
+    // Marks the end of the list of free handle table entries
+    static constexpr uint32_t Null_handle_entry = std::numeric_limits<uint32_t>::max();
+
+    // Takes an entry from the handle table for 'obj_pt' and returns its index. Throws if
+    // every index up to 'max_index' is in use
+    SizeT acquire_handle_entry(T* obj_pt, const SizeT& max_index);
+
+    // Frees a handle table entry, making every handle to it stale
+    void release_handle_entry(const SizeT& index);
+
+    // Makes every handle to the pool stale. Called when every block is freed at once
+    void release_all_handle_entries();
+
+    // The versions of new_block_pt(), new_blocks(), delete_block_pt(), delete_blocks() and
+    // resolve() that do not take the lock; the caller must hold it
+    T* pop_block();
+    void pop_blocks(const SizeT& n, T** obj_pts);
+    void push_block(T* obj_pt);
+    void push_blocks(T** obj_pts, const SizeT& n);
+    template<class Word, unsigned IndexBits>
+    T* find_handle(const Handle<T, Word, IndexBits>& handle) const;
+
+    // Returns true if obj_pt points to an object of type T in the pool. Returns false otherwise
+    bool is_pool_member(const T* const obj_pt) const;
+
+    // The number of bytes between the start of consecutive blocks. A block must be able to
+    // hold either an object of type T or, while free, the index of the next free block
+    static constexpr SizeT block_size();
+
+    // The alignment of the blocks (and of the memory used for each segment)
+    static constexpr SizeT block_alignment();
+
+    // Computes the number of bytes allocated in the pool for the objects of type T
+    inline SizeT size_in_bytes() const { return Pool_size * block_size(); }
+
+    // Adds a segment with space for 'num_blocks' objects of type T
+    void add_segment(const SizeT& num_blocks);
+
+    // Adds a new segment if the pool is growable, otherwise throws. Called when the pool
+    // has no more available space
+    void grow();
+
+    // Frees the most recently added segment, which must be empty, and returns its size in
+    // bytes
+    SizeT remove_last_segment();
+
+    // Returns the index of the segment containing 'byte_pt', or 'Null_segment' if no
+    // segment contains it
+    SizeT find_segment(const Byte* byte_pt) const;
+
+    // Checks if there is any more available space in the pool and throws if there is no
+    // more space available. Does nothing otherwise
+    void throw_if_pool_has_no_more_available_space();
+
+    // The segments making up the pool, in the order they were added
+    std::vector<Segment> Segments;
+
+    // The address ranges of the segments, sorted by start address
+    std::vector<SegmentRange> Segment_ranges;
+
+    // The indices of the segments that have at least one available block. Blocks are
+    // taken from the segment at the back
+    std::vector<SizeT> Available_segments;
+
+    // The number of objects this pool can hold
+    SizeT Pool_size;
+
+    // The number of blocks that can currently be allocated (across all segments)
+    SizeT Num_available;
+
+    // How large each new segment is; see GrowthFactor
+    Growth Growth_policy;
+
+    // The objects handles refer to; handles hold an index into the table
+    std::vector<HandleEntry> Handle_entries;
+
+    // The index of the first free entry in the handle table
+    uint32_t Free_handle_entry = Null_handle_entry;
+
+    // How long the pool must go without the number of live objects rising before decay()
+    // trims it; zero if decay is off
+    std::chrono::steady_clock::duration Decay_time = std::chrono::steady_clock::duration::zero();
+
+    // When the number of live objects last rose (as seen by decay()), and what it was then
+    std::chrono::steady_clock::time_point Decay_start;
+    SizeT Decay_num_live = 0;
+
+    // True if decay() has trimmed the pool since the number of live objects last rose
+    bool Is_decayed = false;
+
+    // Held while blocks and handles are handed out or taken back; see NoLock
+    mutable Lock Pool_lock;
+  };
+
+  /****************************************************************************************
+   * @brief Allocate space for 'num_blocks' objects of type T.
+   *
+   * @param num_blocks: A positive integer indicating the number of objects the pool should
+   *                    initially be capable of holding
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::allocate(const SizeT& num_blocks)
+  {
+    if (!Segments.empty()) {
+      this->clear();
+    }
+    if (num_blocks > 0) {
+      add_segment(num_blocks);
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Cleans up any memory used for the memory pool.
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::clear()
+  {
+    for (auto& segment : Segments) {
+      Storage::deallocate(segment.Pt - segment.Colour_offset,
+                          segment.Colour_offset + segment.Num_blocks * block_size(),
+                          block_alignment());
+    }
+    Segments.clear();
+    Segment_ranges.clear();
+    Available_segments.clear();
+    Pool_size = 0;
+    Num_available = 0;
+    release_all_handle_entries();
+    Stats::on_resize(0, 0);
+  }
+
+  /****************************************************************************************
+   * @brief Marks every block in the pool as free again. The memory used for the pool is
+   *        kept so it can be reused straight away; this takes O(1) time per segment (plus
+   *        O(1) time per handle table entry, if handles have been used).
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::reset()
+  {
+    Available_segments.clear();
+    for (SizeT i = Segments.size(); i > 0; i--) {
+      Segments[i - 1].Free_blocks_tracker.reset();
+      Available_segments.push_back(i - 1);
+    }
+    Num_available = Pool_size;
+    release_all_handle_entries();
+    Stats::on_resize(Pool_size, 0);
+  }
+
+  /****************************************************************************************
+   * @brief Runs the destructor of every object allocated in the pool, in address order,
+   *        then marks every block as free again as with reset(). Every allocated block must
+   *        hold a constructed object. Nothing is visited if T is trivially destructible.
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::destroy_all()
+  {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      for_each_live([](T& obj) { obj.~T(); });
+    }
+    reset();
+  }
+
+  /****************************************************************************************
+   * @brief Gives memory holding only free blocks back to the OS. The most recently added
+   *        segments of a growable pool are freed while they are empty (the first segment is
+   *        always kept). Then each remaining segment's tracker picks the runs of free blocks
+   *        it no longer needs (with BlockTracker, the blocks above the highest live block;
+   *        with BitmapTracker, every free block) and the storage decommits the whole pages
+   *        among them. Takes O(pool size / 64) time plus one system call per run.
+   *
+   * @return SizeT: The number of bytes freed or decommitted. Pages decommitted by an
+   *                earlier call are counted again.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  SizeT MemoryPool<T, Policies...>::trim()
+  {
+    SizeT num_released = 0;
+    const SizeT num_segments = Segments.size();
+    while (is_growable() && (Segments.size() > 1) &&
+           (Segments.back().Free_blocks_tracker.size() == Segments.back().Num_blocks)) {
+      num_released += remove_last_segment();
+    }
+    if (Segments.size() != num_segments) {
+      Stats::on_resize(Pool_size, Pool_size - Num_available);
+    }
+
+    std::vector<uint64_t> words;
+    for (Segment& segment : Segments) {
+      words.assign(bitmap_words(segment.Num_blocks), 0);
+      segment.Free_blocks_tracker.occupancy(words.data());
+      segment.Free_blocks_tracker.trim(words.data(), [&](const SizeT& first, const SizeT& last) {
+        num_released +=
+          Storage::decommit(segment.Pt + first * block_size(), (last - first) * block_size());
+      });
+    }
+    return num_released;
+  }
+
+  /****************************************************************************************
+   * @brief Sets how long the pool must be idle before decay() trims it, and starts timing
+   *        from now.
+   *
+   * @param decay_time: The decay time; zero turns decay off.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::set_decay_time(
+    const std::chrono::steady_clock::duration& decay_time)
+  {
+    Decay_time = decay_time;
+    Decay_start = std::chrono::steady_clock::now();
+    Decay_num_live = Pool_size - Num_available;
+    Is_decayed = false;
+  }
+
+  /****************************************************************************************
+   * @brief Trims the pool once it has gone the decay time without the number of live
+   *        objects rising. Only the number of live objects at each call is compared, so a
+   *        burst that comes and goes between two calls is not noticed. Once the pool has
+   *        been trimmed it is not trimmed again until the number of live objects has risen
+   *        and the decay time has passed once more.
+   *
+   * @return SizeT: The number of bytes released; see trim().
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  SizeT MemoryPool<T, Policies...>::decay()
+  {
+    if (Decay_time <= std::chrono::steady_clock::duration::zero()) return 0;
+    const auto now = std::chrono::steady_clock::now();
+    const SizeT num_live = Pool_size - Num_available;
+    if (num_live > Decay_num_live) {
+      Decay_start = now;
+      Is_decayed = false;
+    }
+    Decay_num_live = num_live;
+    if (Is_decayed || (now - Decay_start < Decay_time)) return 0;
+    Is_decayed = true;
+    return trim();
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block in the memory pool. If the pool is full
+   *        it grows (if it is growable) or throws a std::out_of_range exception. The caller
+   *        must hold the pool's lock.
+   *
+   * @return T*: A pointer to a new object in the memory pool.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  T* MemoryPool<T, Policies...>::pop_block()
+  {
+    if (Available_segments.empty()) {
+      grow();
+    }
+    Segment& segment = Segments[Available_segments.back()];
+    const auto block_index = segment.Free_blocks_tracker.pop();
+    if (segment.Free_blocks_tracker.size() == 0) {
+      Available_segments.pop_back();
+    }
+    Num_available--;
+    Stats::on_allocate(1, Pool_size - Num_available);
+    Stats::on_allocate_block(segment.First_slot + block_index);
+    T* block_pt = reinterpret_cast<T*>(segment.Pt + block_index * block_size());
+    return block_pt;
+  }
+
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block in the memory pool, or nullptr if there
+   *        is none. A growable pool grows first; if the memory for the new segment cannot
+   *        be allocated, nullptr is returned as well.
+   *
+   * @return T*: A pointer to a new object in the memory pool, or nullptr.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  T* MemoryPool<T, Policies...>::try_new_block_pt()
+  {
+    std::lock_guard<Lock> guard(Pool_lock);
+    if (Available_segments.empty()) {
+      if (!is_growable()) {
+        if (Pool_size > 0) Stats::on_exhausted();
+        return nullptr;
+      }
+      try {
+        grow();
+      }
+      catch (const std::bad_alloc&) {
+        return nullptr;
+      }
+    }
+    return pop_block();
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block in the memory pool, into which 'obj'
+   *        has been moved.
+   *
+   * @param obj: The object to move (using the move constructor of T) to the new block.
+   * @return T*: A pointer to a new object in the memory pool.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  T* MemoryPool<T, Policies...>::new_block_pt(T&& obj)
+  {
+    return this->emplace(std::move(obj));
+  }
+
+  /****************************************************************************************
+   * @brief Writes pointers to 'n' available blocks to 'obj_pts'. The blocks are taken from
+   *        each segment's free list in one go rather than one at a time. A growable pool
+   *        grows as often as needed; a fixed-size pool throws a std::out_of_range exception
+   *        (without allocating anything) if it has fewer than 'n' available blocks. The
+   *        caller must hold the pool's lock.
+   *
+   * @param n: The number of blocks to allocate.
+   * @param obj_pts: A pointer to an array with room for (at least) 'n' pointers.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::pop_blocks(const SizeT& n, T** obj_pts)
+  {
+    if (!is_growable() && (n > Num_available)) {
+      Stats::on_exhausted();
+      throw std::out_of_range("Cannot allocate " + std::to_string(n) + " blocks; only " +
+                              std::to_string(Num_available) + " available!");
+    }
+    SizeT num_allocated = 0;
+    try {
+      while (num_allocated < n) {
+        if (Available_segments.empty()) {
+          grow();
+        }
+        Segment& segment = Segments[Available_segments.back()];
+        Byte* const segment_pt = segment.Pt;
+        T** out_pt = obj_pts + num_allocated;
+        const SizeT num_popped =
+          segment.Free_blocks_tracker.pop_n(n - num_allocated, [&](const SizeT& block_index) {
+            *out_pt++ = reinterpret_cast<T*>(segment_pt + block_index * block_size());
+            if constexpr (Stats::Traces_blocks) {
+              Stats::on_allocate_block(segment.First_slot + block_index);
+            }
+          });
+        if (segment.Free_blocks_tracker.size() == 0) {
+          Available_segments.pop_back();
+        }
+        Num_available -= num_popped;
+        num_allocated += num_popped;
+        Stats::on_allocate(num_popped, Pool_size - Num_available);
+      }
+    }
+    catch (...) {
+      // Growing failed part way through; hand back what was allocated so far
+      push_blocks(obj_pts, num_allocated);
+      throw;
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Constructs 'n' objects of type T, each from a copy of 'args', in blocks taken
+   *        from the pool with new_blocks(). If a constructor throws, the objects already
+   *        constructed are destroyed, all 'n' blocks are returned to the pool and the
+   *        exception is rethrown.
+   *
+   * @param n: The number of objects to construct.
+   * @param obj_pts: A pointer to an array with room for (at least) 'n' pointers.
+   * @param args: The arguments to pass to the constructor of each object.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  template<class... Args>
+  void MemoryPool<T, Policies...>::emplace_blocks(const SizeT& n, T** obj_pts, const Args&... args)
+  {
+    new_blocks(n, obj_pts);
+    SizeT num_constructed = 0;
+    try {
+      for (; num_constructed < n; num_constructed++) {
+        ::new (static_cast<void*>(obj_pts[num_constructed])) T(args...);
+      }
+    }
+    catch (...) {
+      for (SizeT i = 0; i < num_constructed; i++) {
+        obj_pts[i]->~T();
+      }
+      delete_blocks(obj_pts, n);
+      throw;
+    }
+  }
+
+  /****************************************************************************************
+   * @brief "Deletes" the data pointed to by 'obj_pt', which must not be null. The caller
+   *        must hold the pool's lock.
+   *
+   *        NOTE: The underlying block in memory pointed to 'obj_pt' is not wiped. It is
+   *        simply added back to the memory pool for use by another object.
+   *
+   * @param obj_pt: A pointer to the underlying block in the memory pool.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::push_block(T* obj_pt)
+  {
+    assert(is_pool_member(obj_pt));
+    auto byte_pt = reinterpret_cast<const Byte*>(obj_pt);
+    const SizeT segment_index = find_segment(byte_pt);
+    Segment& segment = Segments[segment_index];
+    SizeT pos = (byte_pt - segment.Pt) / block_size();
+    segment.Free_blocks_tracker.push(pos);
+    if (segment.Free_blocks_tracker.size() == 1) {
+      Available_segments.push_back(segment_index);
+    }
+    Num_available++;
+    Stats::on_deallocate(1, Pool_size - Num_available);
+    Stats::on_deallocate_block(segment.First_slot + pos);
+  }
+
+  /****************************************************************************************
+   * @brief "Deletes" the 'n' blocks pointed to by 'obj_pts[0]' ... 'obj_pts[n - 1]' and
+   *        nullifies the pointers. Consecutive pointers into the same segment are linked
+   *        into a chain that is spliced onto the segment's free list in one go, so the
+   *        owning segment is only looked up once per run. The caller must hold the pool's
+   *        lock.
+   *
+   * @param obj_pts: A pointer to an array of 'n' pointers to blocks in the pool. Null
+   *                 pointers are skipped.
+   * @param n: The number of pointers in the array.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::push_blocks(T** obj_pts, const SizeT& n)
+  {
+    const std::less<const Byte*> less;
+    SizeT first = 0;
+    while (first < n) {
+      if (obj_pts[first] == nullptr) {
+        first++;
+        continue;
+      }
+      assert(is_pool_member(obj_pts[first]));
+      const SizeT segment_index = find_segment(reinterpret_cast<const Byte*>(obj_pts[first]));
+      Segment& segment = Segments[segment_index];
+      const Byte* const segment_pt = segment.Pt;
+      const Byte* const segment_end = segment_pt + segment.Num_blocks * block_size();
+
+      // Find the run of pointers that belong to this segment
+      SizeT last = first + 1;
+      while ((last < n) && (obj_pts[last] != nullptr)) {
+        auto byte_pt = reinterpret_cast<const Byte*>(obj_pts[last]);
+        if (less(byte_pt, segment_pt) || !less(byte_pt, segment_end)) break;
+        assert(is_pool_member(obj_pts[last]));
+        last++;
+      }
+
+      const SizeT num_blocks = last - first;
+      const bool was_full = (segment.Free_blocks_tracker.size() == 0);
+      segment.Free_blocks_tracker.push_n(num_blocks, [&](const SizeT& i) {
+        auto byte_pt = reinterpret_cast<const Byte*>(obj_pts[first + i]);
+        const SizeT block_index = static_cast<SizeT>(byte_pt - segment_pt) / block_size();
+        if constexpr (Stats::Traces_blocks) {
+          Stats::on_deallocate_block(segment.First_slot + block_index);
+        }
+        return block_index;
+      });
+      if (was_full) {
+        Available_segments.push_back(segment_index);
+      }
+      Num_available += num_blocks;
+      Stats::on_deallocate(num_blocks, Pool_size - Num_available);
+      std::fill(obj_pts + first, obj_pts + last, nullptr);
+      first = last;
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Runs the destructors of the 'n' objects pointed to by 'obj_pts' then deletes
+   *        their blocks as with delete_blocks().
+   *
+   * @param obj_pts: A pointer to an array of 'n' pointers to (constructed) objects in the
+   *                 pool. Null pointers are skipped.
+   * @param n: The number of pointers in the array.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::destroy_blocks(T** obj_pts, const SizeT& n)
+  {
+    for (SizeT i = 0; i < n; i++) {
+      if (obj_pts[i] != nullptr) {
+        obj_pts[i]->~T();
+      }
+    }
+    delete_blocks(obj_pts, n);
+  }
+
+  /****************************************************************************************
+   * @brief Returns a handle to an available block in the memory pool. The block is
+   *        allocated as with new_block_pt() and recorded in a free handle table entry.
+   *        Throws a std::out_of_range exception if the pool is full (and not growable) or
+   *        if every index 'HandleT' can represent is in use.
+   *
+   * @return HandleT: A handle to the new block.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  template<class HandleT>
+  HandleT MemoryPool<T, Policies...>::new_handle()
+  {
+    std::lock_guard<Lock> guard(Pool_lock);
+    T* obj_pt = pop_block();
+    SizeT index;
+    try {
+      // Remember which entry refers to the block, so compact() can update it
+      Segment& segment = Segments[find_segment(reinterpret_cast<const Byte*>(obj_pt))];
+      if (segment.Handle_entry_indices.empty()) {
+        segment.Handle_entry_indices.assign(segment.Num_blocks, Null_handle_entry);
+      }
+      index = acquire_handle_entry(obj_pt, HandleT::Max_index);
+      const auto byte_pt = reinterpret_cast<const Byte*>(obj_pt);
+      segment.Handle_entry_indices[static_cast<SizeT>(byte_pt - segment.Pt) / block_size()] =
+        static_cast<uint32_t>(index);
+    }
+    catch (...) {
+      push_block(obj_pt);
+      throw;
+    }
+    return HandleT(index, Handle_entries[index].Generation);
+  }
+
+  /****************************************************************************************
+   * @brief Constructs an object of type T in an available block as with emplace() and
+   *        returns a handle to it. If the constructor throws, the block and handle table
+   *        entry are returned to the pool and the exception is rethrown.
+   *
+   * @param args: The arguments to forward to the constructor of T.
+   * @return HandleT: A handle to the new object.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  template<class HandleT, class... Args>
+  HandleT MemoryPool<T, Policies...>::emplace_handle(Args&&... args)
+  {
+    HandleT handle = new_handle<HandleT>();
+    try {
+      ::new (static_cast<void*>(resolve(handle))) T(std::forward<Args>(args)...);
+    }
+    catch (...) {
+      delete_handle(handle);
+      throw;
+    }
+    return handle;
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to the object 'handle' refers to. The handle is checked
+   *        against the size of the handle table and the generation of its entry, so a null
+   *        or stale handle gives nullptr rather than a dangling pointer. The caller must
+   *        hold the pool's lock.
+   *
+   * @param handle: A handle returned by new_handle() or emplace_handle().
+   * @return T*: The object the handle refers to, or nullptr.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  template<class Word, unsigned IndexBits>
+  T* MemoryPool<T, Policies...>::find_handle(const Handle<T, Word, IndexBits>& handle) const
+  {
+    using HandleT = Handle<T, Word, IndexBits>;
+    const SizeT index = handle.index();
+    if (index >= Handle_entries.size()) return nullptr;
+    const HandleEntry& entry = Handle_entries[index];
+    if ((entry.Generation & HandleT::Generation_mask) != handle.generation()) return nullptr;
+    return entry.Pt;
+  }
+
+  /****************************************************************************************
+   * @brief Frees the block 'handle' refers to and nullifies the handle. The handle table
+   *        entry's generation is bumped, so every other copy of the handle becomes stale.
+   *        Does nothing (other than nullifying the handle) if the handle is null or stale.
+   *
+   * @param handle: A reference to the handle. Will be null afterwards.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  template<class Word, unsigned IndexBits>
+  void MemoryPool<T, Policies...>::delete_handle(Handle<T, Word, IndexBits>& handle)
+  {
+    std::lock_guard<Lock> guard(Pool_lock);
+    T* obj_pt = find_handle(handle);
+    if (obj_pt != nullptr) {
+      release_handle_entry(handle.index());
+      push_block(obj_pt);
+    }
+    handle = Handle<T, Word, IndexBits>();
+  }
+
+  /****************************************************************************************
+   * @brief Runs the destructor of the object 'handle' refers to, then frees its block as
+   *        with delete_handle(). Does nothing if the handle is null or stale.
+   *
+   * @param handle: A reference to the handle to a (constructed) object. Will be null
+   *                afterwards.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  template<class Word, unsigned IndexBits>
+  void MemoryPool<T, Policies...>::destroy(Handle<T, Word, IndexBits>& handle)
+  {
+    T* obj_pt = resolve(handle);
+    if (obj_pt != nullptr) {
+      obj_pt->~T();
+    }
+    delete_handle(handle);
+  }
+
+  /****************************************************************************************
+   * @brief Returns the objects currently allocated in the pool as a range that can be
+   *        walked in address order. Each segment's tracker writes a bitmap of the blocks
+   *        it has handed out, and the segments are laid end to end in address order.
+   *
+   * @return LiveObjects<T>: A snapshot of the live objects.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  LiveObjects<T> MemoryPool<T, Policies...>::live_objects()
+  {
+    LiveObjects<T> live(block_size());
+    SizeT num_words = 0;
+    for (const auto& segment : Segments) {
+      num_words += bitmap_words(segment.Num_blocks);
+    }
+    live.Words.resize(num_words);
+    live.Spans.reserve(Segments.size());
+
+    SizeT first_word = 0;
+    for (const auto& range : Segment_ranges) {
+      const Segment& segment = Segments[range.Segment_index];
+      live.Spans.push_back({segment.Pt, first_word});
+      segment.Free_blocks_tracker.occupancy(live.Words.data() + first_word);
+      first_word += bitmap_words(segment.Num_blocks);
+    }
+    live.Num_live = Pool_size - Num_available;
+    return live;
+  }
+
+  /****************************************************************************************
+   * @brief Calls 'function' with a reference to each object allocated in the pool, in
+   *        address order. The objects to visit are fixed when the call starts; 'function'
+   *        may destroy the object it is passed but must not free any other.
+   *
+   * @param function: A callable taking a T&.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  template<class Function>
+  void MemoryPool<T, Policies...>::for_each_live(Function&& function)
+  {
+    live_objects().for_each(std::forward<Function>(function));
+  }
+
+  /****************************************************************************************
+   * @brief Calls 'function' with a reference to each object allocated in the pool, with
+   *        contiguous ranges of the pool walked by different threads. 'function' is called
+   *        concurrently, so it must be safe to call on different objects at the same time.
+   *        It must not allocate from or free to the pool.
+   *
+   * @param policy: How many threads to use; see ParallelPolicy.
+   * @param function: A callable taking a T&.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  template<class Function>
+  void MemoryPool<T, Policies...>::for_each_live(const ParallelPolicy& policy, Function&& function)
+  {
+    live_objects().for_each(policy, std::forward<Function>(function));
+  }
+
+  /****************************************************************************************
+   * @brief Moves live objects from the highest blocks of the pool into the lowest free
+   *        ones. Each call starts from a fresh occupancy bitmap of the pool, so it costs
+   *        O(pool size / 64) on top of the moves. One cursor finds the lowest free block
+   *        and another the highest live block; the object in the latter is moved into the
+   *        former until the cursors meet or the budget runs out. The trackers of the
+   *        segments that changed are then rebuilt, so the free blocks are handed out lowest
+   *        address first. If T's move constructor or 'on_relocate' throws, the pool is left
+   *        consistent with the moves made so far and the exception is rethrown.
+   *
+   * @param budget: The most work to do in this call; see CompactionBudget.
+   * @param on_relocate: A callable taking the old and new addresses of each object moved,
+   *                     as (T* old_pt, T* new_pt). The object at 'old_pt' has been destroyed.
+   * @return CompactionProgress: How many objects were moved and whether the pool is now
+   *                             fully compacted.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  template<class Function>
+  CompactionProgress MemoryPool<T, Policies...>::compact(
+    const CompactionBudget& budget,
+    Function&& on_relocate)
+  {
+    static_assert(std::is_move_constructible_v<T>, "compact() needs T to be move constructible");
+    using Clock = std::chrono::steady_clock;
+    const bool is_timed = (budget.Max_time != Clock::duration::max());
+    const Clock::time_point deadline = is_timed ? Clock::now() + budget.Max_time
+                                                : Clock::time_point::max();
+    CompactionProgress progress;
+    if (Segments.empty()) {
+      progress.Is_complete = true;
+      return progress;
+    }
+
+    // The occupancy bitmaps of the segments, one after another in the order they were added
+    std::vector<SizeT> first_words(Segments.size() + 1, 0);
+    for (SizeT i = 0; i < Segments.size(); i++) {
+      first_words[i + 1] = first_words[i] + bitmap_words(Segments[i].Num_blocks);
+    }
+    std::vector<uint64_t> words(first_words.back());
+    for (SizeT i = 0; i < Segments.size(); i++) {
+      Segments[i].Free_blocks_tracker.occupancy(words.data() + first_words[i]);
+    }
+    std::vector<bool> is_changed(Segments.size(), false);
+
+    // Moves (segment_index, block_index) forward to the lowest free block at or after it
+    auto find_free = [&](SizeT& segment_index, SizeT& block_index) {
+      for (; segment_index < Segments.size(); segment_index++, block_index = 0) {
+        const uint64_t* segment_words = words.data() + first_words[segment_index];
+        const SizeT num_blocks = Segments[segment_index].Num_blocks;
+        while (block_index < num_blocks) {
+          const SizeT word_index = block_index / 64;
+          const uint64_t free_bits =
+            ~segment_words[word_index] & (~uint64_t(0) << (block_index % 64));
+          if (free_bits != 0) {
+            block_index = 64 * word_index + count_trailing_zeros(free_bits);
+            if (block_index < num_blocks) return true;
+            break;
+          }
+          block_index = 64 * (word_index + 1);
+        }
+      }
+      return false;
+    };
+
+    // Moves (segment_index, block_end) back to just above the highest live block below it
+    auto find_live = [&](SizeT& segment_index, SizeT& block_end) {
+      while (true) {
+        const uint64_t* segment_words = words.data() + first_words[segment_index];
+        while (block_end > 0) {
+          const SizeT word_index = (block_end - 1) / 64;
+          const SizeT num_bits = block_end - 64 * word_index;
+          uint64_t live_bits = segment_words[word_index];
+          if (num_bits < 64) live_bits &= (uint64_t(1) << num_bits) - 1;
+          if (live_bits != 0) {
+            block_end = 64 * word_index + floor_log2(live_bits) + 1;
+            return true;
+          }
+          block_end = 64 * word_index;
+        }
+        if (segment_index == 0) return false;
+        segment_index--;
+        block_end = Segments[segment_index].Num_blocks;
+      }
+    };
+
+    // Rebuilds the trackers of the segments that changed and the list of segments with
+    // available blocks, lowest segment at the back so it is allocated from first
+    auto finish = [&]() {
+      Available_segments.clear();
+      for (SizeT i = Segments.size(); i > 0; i--) {
+        Segment& segment = Segments[i - 1];
+        if (is_changed[i - 1]) {
+          segment.Free_blocks_tracker.rebuild(words.data() + first_words[i - 1]);
+        }
+        if (segment.Free_blocks_tracker.size() > 0) {
+          Available_segments.push_back(i - 1);
+        }
+      }
+    };
+
+    SizeT to_segment = 0;
+    SizeT to_block = 0;
+    SizeT from_segment = Segments.size() - 1;
+    SizeT from_end = Segments.back().Num_blocks;
+    try {
+      while (true) {
+        if (!find_free(to_segment, to_block) || !find_live(from_segment, from_end) ||
+            (to_segment > from_segment) ||
+            ((to_segment == from_segment) && (to_block >= from_end - 1))) {
+          progress.Is_complete = true;
+          break;
+        }
+        if (progress.Num_moved == budget.Max_moves) break;
+        if (is_timed && (progress.Num_moved % 16 == 0) && (Clock::now() >= deadline)) {
+          break;
+        }
+
+        Segment& to = Segments[to_segment];
+        Segment& from = Segments[from_segment];
+        const SizeT from_block = from_end - 1;
+        T* from_pt = reinterpret_cast<T*>(from.Pt + from_block * block_size());
+        T* to_pt = reinterpret_cast<T*>(to.Pt + to_block * block_size());
+
+        // Find the handle table entry referring to the object, if there is one
+        uint32_t entry_index = Null_handle_entry;
+        if (!from.Handle_entry_indices.empty()) {
+          entry_index = from.Handle_entry_indices[from_block];
+          if ((entry_index >= Handle_entries.size()) ||
+              (Handle_entries[entry_index].Pt != from_pt)) {
+            entry_index = Null_handle_entry;
+          }
+          else if (to.Handle_entry_indices.empty()) {
+            to.Handle_entry_indices.assign(to.Num_blocks, Null_handle_entry);
+          }
+        }
+
+        ::new (static_cast<void*>(to_pt)) T(std::move(*from_pt));
+        from_pt->~T();
+        words[first_words[to_segment] + to_block / 64] |= uint64_t(1) << (to_block % 64);
+        words[first_words[from_segment] + from_block / 64] &= ~(uint64_t(1) << (from_block % 64));
+        is_changed[to_segment] = true;
+        is_changed[from_segment] = true;
+        if (entry_index != Null_handle_entry) {
+          Handle_entries[entry_index].Pt = to_pt;
+          to.Handle_entry_indices[to_block] = entry_index;
+        }
+        Stats::on_relocate_block(from.First_slot + from_block, to.First_slot + to_block);
+        progress.Num_moved++;
+        to_block++;
+        from_end--;
+        on_relocate(from_pt, to_pt);
+      }
+    }
+    catch (...) {
+      finish();
+      throw;
+    }
+    finish();
+    return progress;
+  }
+
+  /****************************************************************************************
+   * @brief Returns true if 'obj_pt' points to an object of type T in the pool. Returns
+   *        false otherwise.
+   *
+   * @param obj_pt: A pointer to an object of type T.
+   * @return true: If 'obj_pt' points to an object of type T in the pool.
+   * @return false: If 'obj_pt' does not point to an object of type T in the pool.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  bool MemoryPool<T, Policies...>::is_pool_member(const T* const obj_pt) const
+  {
+    auto byte_pt = reinterpret_cast<const Byte*>(obj_pt);
+    const SizeT segment_index = find_segment(byte_pt);
+    if (segment_index == Null_segment) return false;
+    return (byte_pt - Segments[segment_index].Pt) % block_size() == 0;
+  }
+
+  /****************************************************************************************
+   * @brief The number of bytes between the start of consecutive blocks. A block has to be
+   *        large enough for an object of type T and, while free, the index of the next free
+   *        block. The layout then decides how far this is rounded up; by default just far
+   *        enough to keep every block suitably aligned.
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  constexpr SizeT MemoryPool<T, Policies...>::block_size()
+  {
+    constexpr SizeT size = std::max<SizeT>(sizeof(T), Tracker::min_block_size());
+    constexpr SizeT align = std::max<SizeT>(alignof(T), Tracker::min_block_alignment());
+    constexpr SizeT stride = Layout::stride(size, align);
+    static_assert(stride >= size, "The layout must leave room for an object in each block");
+    static_assert(stride % block_alignment() == 0, "The layout must keep blocks aligned");
+    return stride;
+  }
+
+  /****************************************************************************************
+   * @brief The alignment of the blocks; at least alignof(T), but the layout may ask for more
+   *        (e.g. so that a block never straddles a cache line).
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  constexpr SizeT MemoryPool<T, Policies...>::block_alignment()
+  {
+    constexpr SizeT size = std::max<SizeT>(sizeof(T), Tracker::min_block_size());
+    constexpr SizeT align = std::max<SizeT>(alignof(T), Tracker::min_block_alignment());
+    constexpr SizeT alignment = Layout::alignment(size, align);
+    static_assert(alignment % align == 0, "The layout must keep objects of type T aligned");
+    return alignment;
+  }
+
+  /****************************************************************************************
+   * @brief Adds a segment with space for 'num_blocks' objects of type T. The new segment
+   *        becomes the one blocks are allocated from next. If the layout uses cache
+   *        colouring, the first block is offset by a (cycling) number of cache lines from
+   *        the start of the segment's memory. Throws a std::bad_alloc exception if the
+   *        segment would be too large to address.
+   *
+   * @param num_blocks: The number of objects the new segment should be able to hold.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::add_segment(const SizeT& num_blocks)
+  {
+    // The largest colour offset is checked too, so the sizes below cannot wrap around
+    const SizeT max_colour_offset =
+      (Layout::num_colours() - 1) * std::max<SizeT>(g_CacheLineSize, block_alignment());
+    if (num_blocks > (std::numeric_limits<SizeT>::max() - max_colour_offset) / block_size()) {
+      throw std::bad_alloc();
+    }
+
+    // Make sure the bookkeeping can't throw once the memory has been allocated
+    Segments.reserve(Segments.size() + 1);
+    Segment_ranges.reserve(Segments.size() + 1);
+    Available_segments.reserve(Segments.size() + 1);
+
+    SizeT colour_offset = 0;
+    if constexpr (Layout::num_colours() > 1) {
+      colour_offset = next_cache_colour(Layout::num_colours()) *
+                      std::max<SizeT>(g_CacheLineSize, block_alignment());
+    }
+    const SizeT num_bytes = colour_offset + num_blocks * block_size();
+    Byte* memory_pt = Storage::allocate(num_bytes, block_alignment());
+    Byte* segment_pt = memory_pt + colour_offset;
+    const SizeT segment_index = Segments.size();
+    try {
+      // Setting up the tracker may allocate (e.g. a bitmap)
+      Segments.push_back({segment_pt,
+                          colour_offset,
+                          num_blocks,
+                          Pool_size,
+                          Tracker(segment_pt, block_size(), num_blocks),
+                          {}});
+    }
+    catch (...) {
+      Storage::deallocate(memory_pt, num_bytes, block_alignment());
+      throw;
+    }
+
+    // Keep the ranges sorted by start address so find_segment() can binary search them
+    SegmentRange range{segment_pt, segment_pt + num_blocks * block_size(), segment_index};
+    auto it = std::upper_bound(Segment_ranges.begin(),
+                               Segment_ranges.end(),
+                               range,
+                               [](const SegmentRange& lhs, const SegmentRange& rhs) {
+                                 return std::less<const Byte*>()(lhs.Start, rhs.Start);
+                               });
+    Segment_ranges.insert(it, range);
+
+    Available_segments.push_back(segment_index);
+    Pool_size += num_blocks;
+    Num_available += num_blocks;
+    Stats::on_resize(Pool_size, Pool_size - Num_available);
+  }
+
+  /****************************************************************************************
+   * @brief Adds a new segment to a growable pool. The growth policy decides how many
+   *        objects the new segment holds. Throws if the pool is not growable.
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::grow()
+  {
+    if (Pool_size > 0) {
+      Stats::on_exhausted();
+    }
+    if (!is_growable()) {
+      throw_if_pool_has_no_more_available_space();
+    }
+    const SizeT num_blocks =
+      Segments.empty() ? g_DefaultNumberOfObjectsInPool
+                       : Growth_policy.next_segment_size(Segments.back().Num_blocks);
+    add_segment(num_blocks);
+    Stats::on_grow();
+  }
+
+  /****************************************************************************************
+   * @brief Frees the most recently added segment, which must have no blocks handed out,
+   *        and removes it from the lists of segments. A later growth adds a segment of the
+   *        same size again.
+   *
+   * @return SizeT: The number of bytes the segment used.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  SizeT MemoryPool<T, Policies...>::remove_last_segment()
+  {
+    const SizeT segment_index = Segments.size() - 1;
+    Segment& segment = Segments.back();
+    assert(segment.Free_blocks_tracker.size() == segment.Num_blocks);
+    const SizeT num_bytes = segment.Colour_offset + segment.Num_blocks * block_size();
+    Storage::deallocate(segment.Pt - segment.Colour_offset, num_bytes, block_alignment());
+
+    Segment_ranges.erase(std::find_if(Segment_ranges.begin(),
+                                      Segment_ranges.end(),
+                                      [&](const SegmentRange& range) {
+                                        return range.Segment_index == segment_index;
+                                      }));
+    Available_segments.erase(
+      std::remove(Available_segments.begin(), Available_segments.end(), segment_index),
+      Available_segments.end());
+    Pool_size -= segment.Num_blocks;
+    Num_available -= segment.Num_blocks;
+    Segments.pop_back();
+    return num_bytes;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the index of the segment containing 'byte_pt'. Uses a binary search
+   *        over the segment address ranges, so the cost grows only logarithmically with
+   *        the number of segments (which itself grows logarithmically with the pool size
+   *        for growth factors above 1).
+   *
+   * @param byte_pt: A pointer to a byte that may lie in the pool.
+   * @return SizeT: The index of the segment containing 'byte_pt', or 'Null_segment' if no
+   *                segment contains it.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  SizeT MemoryPool<T, Policies...>::find_segment(const Byte* byte_pt) const
+  {
+    const std::less<const Byte*> less;
+    auto it = std::upper_bound(Segment_ranges.begin(),
+                               Segment_ranges.end(),
+                               byte_pt,
+                               [&less](const Byte* pt, const SegmentRange& range) {
+                                 return less(pt, range.Start);
+                               });
+    if (it == Segment_ranges.begin()) return Null_segment;
+    --it;
+    if (!less(byte_pt, it->End)) return Null_segment;
+    return it->Segment_index;
+  }
+
+  /****************************************************************************************
+   * @brief Takes an entry from the handle table, reusing the most recently freed entry if
+   *        there is one, and points it at 'obj_pt'. The entry keeps the generation it was
+   *        freed with, so it differs from that of every handle to its previous object.
+   *
+   * @param obj_pt: The block the entry should refer to.
+   * @param max_index: The largest index the handle type can represent.
+   * @return SizeT: The index of the entry.
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  SizeT MemoryPool<T, Policies...>::acquire_handle_entry(T* obj_pt, const SizeT& max_index)
+  {
+    SizeT index;
+    if ((Free_handle_entry != Null_handle_entry) && (Free_handle_entry <= max_index)) {
+      index = Free_handle_entry;
+      Free_handle_entry = Handle_entries[index].Next_free;
+    }
+    else if (Handle_entries.size() <= std::min<SizeT>(max_index, Null_handle_entry - 1)) {
+      index = Handle_entries.size();
+      Handle_entries.push_back({nullptr, 0, Null_handle_entry});
+    }
+    else {
+      throw std::out_of_range("No more handles available; all " + std::to_string(max_index + 1) +
+                              " handle indices in use!");
+    }
+    Handle_entries[index].Pt = obj_pt;
+    return index;
+  }
+
+  /****************************************************************************************
+   * @brief Frees the handle table entry 'index' and bumps its generation, so that every
+   *        handle to it becomes stale.
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::release_handle_entry(const SizeT& index)
+  {
+    HandleEntry& entry = Handle_entries[index];
+    entry.Pt = nullptr;
+    entry.Generation++;
+    entry.Next_free = Free_handle_entry;
+    Free_handle_entry = static_cast<uint32_t>(index);
+  }
+
+  /****************************************************************************************
+   * @brief Frees every handle table entry still in use, making every handle to the pool
+   *        stale. Entries are not discarded, as their generations must survive.
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::release_all_handle_entries()
+  {
+    for (SizeT i = Handle_entries.size(); i > 0; i--) {
+      if (Handle_entries[i - 1].Pt != nullptr) {
+        release_handle_entry(i - 1);
+      }
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Checks if there is any more available space in the pool and throws if there is
+   *        no more space available. Does nothing otherwise.
+   *
+   ****************************************************************************************/
+  template<class T, class... Policies>
+  void MemoryPool<T, Policies...>::throw_if_pool_has_no_more_available_space()
   {
-    if (Free_blocks_tracker.size() > 0) return;
+    if (Num_available > 0) return;
     throw std::out_of_range("No more space available; all " + std::to_string(Pool_size) +
                             " blocks allocated!");
   }
@@ -0,0 +1,309 @@
+#ifndef MEMORY_POOL_MMAP_STORAGE_HEADER
+#define MEMORY_POOL_MMAP_STORAGE_HEADER
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  // The size of a (PMD-level) huge page on x86-64 and on most AArch64 configurations
+  constexpr SizeT g_HugePageSize = SizeT(2) << 20;
+
+  // How MmapStorage asks the kernel for huge pages
+  enum class HugePages {
+    // Only use normal pages
+    None,
+
+    // Align the mapping to a huge page boundary and ask for transparent huge pages with
+    // madvise(MADV_HUGEPAGE)
+    Transparent,
+
+    // Map pages from the reserved huge page pool with MAP_HUGETLB. Falls back to
+    // 'Transparent' if no huge pages are reserved (or MAP_HUGETLB is not supported)
+    Explicit
+  };
+
+  // How MmapStorage prefaults the memory it maps
+  enum class Prefault {
+    // Pages are faulted in when they are first touched
+    None,
+
+    // Every page is faulted in when the memory is mapped (MAP_POPULATE or equivalent)
+    Populate,
+
+    // The kernel is told the memory will be needed soon (madvise(MADV_WILLNEED)) but is free
+    // to ignore the hint
+    WillNeed
+  };
+
+  // How MmapStorage gives the pages of free blocks back to the OS when a pool is trimmed
+  enum class Decommit {
+    // The pages are dropped straight away (madvise(MADV_DONTNEED)), so the resident set
+    // shrinks at once; they read as zero and are faulted in again when next touched
+    DontNeed,
+
+    // The kernel may reclaim the pages when it is short of memory (madvise(MADV_FREE)).
+    // Cheaper, and pages that were not reclaimed need no page fault when next touched, but
+    // the resident set only shrinks under memory pressure. Falls back to 'DontNeed' where
+    // MADV_FREE is not supported
+    Free
+  };
+
+  /****************************************************************************************
+   * @brief A storage policy for MemoryPool that maps the memory for each segment directly
+   *        with mmap() instead of going through operator new[]. Large segments can be
+   *        backed by huge pages, which cuts the number of TLB misses when a big pool is
+   *        accessed at random, and can be prefaulted so that no page fault happens the
+   *        first time a block is handed out. For example
+   *
+   *          MemoryPool<Point, MmapStorage<HugePages::Transparent, Prefault::Populate>> pool;
+   *
+   *        Huge pages are only requested for segments of at least g_HugePageSize bytes;
+   *        smaller segments are rounded up to a whole number of normal pages. If huge pages
+   *        are not available the storage silently falls back to normal pages, so a pool
+   *        behaves the same whatever the system configuration. Only throws (std::bad_alloc)
+   *        if the memory cannot be mapped at all.
+   *
+   *        Pages holding only free blocks can be given back to the OS with
+   *        MemoryPool::trim(), which calls decommit().
+   *
+   * @tparam HugePagesMode: Whether/how to ask for huge pages.
+   * @tparam PrefaultMode: Whether/how to prefault the mapped memory.
+   * @tparam DecommitMode: How to give pages back to the OS.
+   ****************************************************************************************/
+  template<HugePages HugePagesMode = HugePages::Transparent,
+           Prefault PrefaultMode = Prefault::None,
+           Decommit DecommitMode = Decommit::DontNeed>
+  class MmapStorage {
+  public:
+    // Maps (at least) 'num_bytes' bytes of zeroed memory aligned to 'alignment'
+    static Byte* allocate(const SizeT& num_bytes, const SizeT& alignment);
+
+    // Unmaps memory returned by allocate(num_bytes, alignment)
+    static void deallocate(Byte* pt, const SizeT& num_bytes, const SizeT& alignment);
+
+    // Gives the whole pages in the 'num_bytes' bytes at 'pt' back to the OS, as chosen by
+    // 'DecommitMode', and returns how many bytes that was
+    static SizeT decommit(Byte* pt, const SizeT& num_bytes);
+
+    // The number of bytes actually mapped for a request of 'num_bytes' bytes
+    static SizeT mapping_size(const SizeT& num_bytes);
+
+  private:
+    // Returns true if a request for 'num_bytes' bytes should be backed by huge pages
+    static bool use_huge_pages(const SizeT& num_bytes);
+
+    // The size of a normal page
+    static SizeT page_size();
+
+    // Maps 'num_bytes' bytes (a multiple of the page size) at a multiple of 'alignment'
+    static void* map_aligned(const SizeT& num_bytes, const SizeT& alignment, const int& flags);
+
+    // Faults in every page of the given (writable) memory
+    static void populate(void* pt, const SizeT& num_bytes);
+  };
+
+  /****************************************************************************************
+   * @brief Maps (at least) 'num_bytes' bytes of zeroed memory, using huge pages and
+   *        prefaulting as requested by the template parameters.
+   *
+   * @param num_bytes: The number of bytes needed.
+   * @param alignment: The alignment needed; mappings are always at least page aligned.
+   * @return Byte*: A pointer to the start of the mapping; aligned to a huge page boundary
+   *                if huge pages were requested for it.
+   ****************************************************************************************/
+  template<HugePages HugePagesMode, Prefault PrefaultMode, Decommit DecommitMode>
+  Byte* MmapStorage<HugePagesMode, PrefaultMode, DecommitMode>::allocate(const SizeT& num_bytes,
+                                                                       const SizeT& alignment)
+  {
+    const SizeT size = mapping_size(num_bytes);
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* pt = MAP_FAILED;
+    [[maybe_unused]] bool is_populated = false;
+
+    if (use_huge_pages(num_bytes)) {
+#ifdef MAP_HUGETLB
+      if ((HugePagesMode == HugePages::Explicit) && (alignment <= g_HugePageSize)) {
+        int hugetlb_flags = flags | MAP_HUGETLB;
+#ifdef MAP_POPULATE
+        if constexpr (PrefaultMode == Prefault::Populate) hugetlb_flags |= MAP_POPULATE;
+#endif
+        pt = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, hugetlb_flags, -1, 0);
+        is_populated = (pt != MAP_FAILED);
+      }
+#endif
+      if (pt == MAP_FAILED) {
+        // Transparent huge pages have to be requested before the memory is populated,
+        // otherwise it is faulted in as normal pages
+        pt = map_aligned(size, std::max(g_HugePageSize, alignment), flags);
+#ifdef MADV_HUGEPAGE
+        if (pt != MAP_FAILED) ::madvise(pt, size, MADV_HUGEPAGE);
+#endif
+      }
+    }
+    else {
+      int page_flags = flags;
+#ifdef MAP_POPULATE
+      if constexpr (PrefaultMode == Prefault::Populate) page_flags |= MAP_POPULATE;
+      is_populated = (PrefaultMode == Prefault::Populate);
+#endif
+      if (alignment > page_size()) {
+        pt = map_aligned(size, alignment, page_flags);
+      }
+      else {
+        pt = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, page_flags, -1, 0);
+      }
+    }
+    if (pt == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+
+    if constexpr (PrefaultMode == Prefault::Populate) {
+      if (!is_populated) populate(pt, size);
+    }
+    else if constexpr (PrefaultMode == Prefault::WillNeed) {
+      ::madvise(pt, size, MADV_WILLNEED);
+    }
+    return static_cast<Byte*>(pt);
+  }
+
+  /****************************************************************************************
+   * @brief Unmaps memory returned by allocate(num_bytes, alignment).
+   *
+   * @param pt: The pointer returned by allocate().
+   * @param num_bytes: The number of bytes passed to allocate().
+   ****************************************************************************************/
+  template<HugePages HugePagesMode, Prefault PrefaultMode, Decommit DecommitMode>
+  void MmapStorage<HugePagesMode, PrefaultMode, DecommitMode>::deallocate(
+    Byte* pt,
+    const SizeT& num_bytes,
+    const SizeT& /* alignment */)
+  {
+    ::munmap(pt, mapping_size(num_bytes));
+  }
+
+  /****************************************************************************************
+   * @brief Gives the whole pages in the given memory back to the OS. The range is shrunk
+   *        to page boundaries, so the partly used pages at either end are kept. The pages
+   *        stay mapped and are faulted in again when they are next touched. A huge page is
+   *        split if only part of it is given back.
+   *
+   * @param pt: The start of memory returned by allocate().
+   * @param num_bytes: The number of bytes from 'pt' that hold only free blocks.
+   * @return SizeT: The number of bytes given back; 0 if the kernel refused (e.g. for part
+   *                of an explicit huge page).
+   ****************************************************************************************/
+  template<HugePages HugePagesMode, Prefault PrefaultMode, Decommit DecommitMode>
+  SizeT MmapStorage<HugePagesMode, PrefaultMode, DecommitMode>::decommit(Byte* pt,
+                                                                         const SizeT& num_bytes)
+  {
+    const auto start = reinterpret_cast<std::uintptr_t>(pt);
+    const std::uintptr_t first_page = (start + page_size() - 1) & ~(page_size() - 1);
+    const std::uintptr_t end_page = (start + num_bytes) & ~(page_size() - 1);
+    if (end_page <= first_page) return 0;
+
+    int advice = MADV_DONTNEED;
+#ifdef MADV_FREE
+    if constexpr (DecommitMode == Decommit::Free) advice = MADV_FREE;
+#endif
+    const SizeT size = end_page - first_page;
+    if (::madvise(reinterpret_cast<void*>(first_page), size, advice) != 0) return 0;
+    return size;
+  }
+
+  /****************************************************************************************
+   * @brief The number of bytes actually mapped for a request of 'num_bytes' bytes: rounded
+   *        up to a whole number of huge pages if huge pages are used for the request and to
+   *        a whole number of normal pages otherwise. Depends only on 'num_bytes' so the same
+   *        length is passed to munmap() as was mapped, whichever kind of page was used.
+   *
+   * @param num_bytes: The number of bytes requested.
+   ****************************************************************************************/
+  template<HugePages HugePagesMode, Prefault PrefaultMode, Decommit DecommitMode>
+  SizeT MmapStorage<HugePagesMode, PrefaultMode, DecommitMode>::mapping_size(
+    const SizeT& num_bytes)
+  {
+    const SizeT granularity = use_huge_pages(num_bytes) ? g_HugePageSize : page_size();
+    const SizeT size = (num_bytes > 0) ? num_bytes : 1;
+    return ((size + granularity - 1) / granularity) * granularity;
+  }
+
+  /****************************************************************************************
+   * @brief Returns true if a request for 'num_bytes' bytes should be backed by huge pages.
+   *        Requests smaller than a huge page never are, as most of the page would be wasted.
+   *
+   ****************************************************************************************/
+  template<HugePages HugePagesMode, Prefault PrefaultMode, Decommit DecommitMode>
+  bool MmapStorage<HugePagesMode, PrefaultMode, DecommitMode>::use_huge_pages(
+    const SizeT& num_bytes)
+  {
+    return (HugePagesMode != HugePages::None) && (num_bytes >= g_HugePageSize);
+  }
+
+  /****************************************************************************************
+   * @brief The size of a normal page, as reported by the system.
+   *
+   ****************************************************************************************/
+  template<HugePages HugePagesMode, Prefault PrefaultMode, Decommit DecommitMode>
+  SizeT MmapStorage<HugePagesMode, PrefaultMode, DecommitMode>::page_size()
+  {
+    static const SizeT size = static_cast<SizeT>(::sysconf(_SC_PAGESIZE));
+    return size;
+  }
+
+  /****************************************************************************************
+   * @brief Maps 'num_bytes' bytes at a multiple of 'alignment'. Used for huge pages, as the
+   *        kernel can only back memory at a huge page boundary with transparent huge pages,
+   *        and for alignments larger than a page. Maps an extra 'alignment' bytes and unmaps
+   *        the unaligned head and tail again.
+   *
+   * @param num_bytes: The number of bytes to map; a multiple of the page size.
+   * @param alignment: The alignment of the mapping; a power of two multiple of the page size.
+   * @param flags: The flags to pass to mmap().
+   * @return void*: The start of the aligned mapping, or MAP_FAILED.
+   ****************************************************************************************/
+  template<HugePages HugePagesMode, Prefault PrefaultMode, Decommit DecommitMode>
+  void* MmapStorage<HugePagesMode, PrefaultMode, DecommitMode>::map_aligned(
+    const SizeT& num_bytes,
+    const SizeT& alignment,
+    const int& flags)
+  {
+    const SizeT padded_size = num_bytes + alignment;
+    void* pt = ::mmap(nullptr, padded_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (pt == MAP_FAILED) return MAP_FAILED;
+
+    const auto start = reinterpret_cast<std::uintptr_t>(pt);
+    const auto aligned_start = (start + alignment - 1) & ~(alignment - 1);
+    const SizeT head_size = aligned_start - start;
+    const SizeT tail_size = padded_size - head_size - num_bytes;
+    if (head_size > 0) ::munmap(pt, head_size);
+    if (tail_size > 0) ::munmap(reinterpret_cast<void*>(aligned_start + num_bytes), tail_size);
+    return reinterpret_cast<void*>(aligned_start);
+  }
+
+  /****************************************************************************************
+   * @brief Faults in every page of the given (writable, anonymous) memory. Uses
+   *        madvise(MADV_POPULATE_WRITE) where available and otherwise writes to each page.
+   *        The memory is still zero afterwards.
+   *
+   * @param pt: The start of the memory.
+   * @param num_bytes: The number of bytes to fault in.
+   ****************************************************************************************/
+  template<HugePages HugePagesMode, Prefault PrefaultMode, Decommit DecommitMode>
+  void MmapStorage<HugePagesMode, PrefaultMode, DecommitMode>::populate(void* pt,
+                                                                      const SizeT& num_bytes)
+  {
+#ifdef MADV_POPULATE_WRITE
+    if (::madvise(pt, num_bytes, MADV_POPULATE_WRITE) == 0) return;
+#endif
+    volatile Byte* byte_pt = static_cast<volatile Byte*>(pt);
+    for (SizeT offset = 0; offset < num_bytes; offset += page_size()) {
+      byte_pt[offset] = Byte{0};
+    }
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_MMAP_STORAGE_HEADER
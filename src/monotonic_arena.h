@@ -0,0 +1,372 @@
+#ifndef MEMORY_POOL_MONOTONIC_ARENA_HEADER
+#define MEMORY_POOL_MONOTONIC_ARENA_HEADER
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief Number of bytes in an arena if no size is given
+   *
+   ****************************************************************************************/
+  constexpr SizeT g_DefaultArenaSize = SizeT(64) << 10;
+
+  /****************************************************************************************
+   * @brief A position in a MonotonicArena (see MonotonicArena::mark()). Rewinding the arena
+   *        to a marker frees everything allocated since the marker was taken.
+   *
+   ****************************************************************************************/
+  struct ArenaMarker {
+    // The index of the block the arena was allocating from, and the offset into it
+    SizeT Block;
+    SizeT Offset;
+  };
+
+  /****************************************************************************************
+   * @brief An arena for objects of any type that all die together, e.g. everything built
+   *        while handling one request or one frame. Allocation bumps a pointer through a
+   *        block of memory; there is no per-object free. reset() makes the whole arena
+   *        available again in O(1) time and keeps the memory for the next round, so a
+   *        warmed-up arena never allocates:
+   *
+   *          MonotonicArena<> arena(1 << 20);
+   *          for (const Request& request : requests) {
+   *            Reply* reply_pt = arena.emplace<Reply>(request);
+   *            ...
+   *            arena.reset();
+   *          }
+   *
+   *        mark()/rewind() (or an ArenaScope) free everything allocated since a point, for
+   *        scratch space inside a round.
+   *
+   *        A fixed-size arena throws a std::out_of_range exception when it runs out. A
+   *        growable arena chains a new block onto the last one instead; the new block is
+   *        'growth_factor' times the size of the previous one (or larger, if the allocation
+   *        needs it). Chained blocks are kept by reset() and reused in order, and can be
+   *        given back with trim().
+   *
+   *        The arena never runs destructors: objects that own resources must be destroyed
+   *        by hand before the arena is reset.
+   *
+   *        NOTE: Like MemoryPool, the arena is not thread-safe.
+   *
+   * @tparam Storage: Where the blocks of the arena are allocated; see HeapStorage.
+   ****************************************************************************************/
+  template<class Storage = HeapStorage>
+  class MonotonicArena {
+  public:
+    // Creates an arena with a first block of 'num_bytes' bytes. A 'growth_factor' of 0 makes
+    // the arena fixed-size (see set_growth_factor())
+    explicit MonotonicArena(const SizeT& num_bytes = g_DefaultArenaSize,
+                            const SizeT& growth_factor = 0);
+
+    ~MonotonicArena();
+
+    // Handed-out pointers point into the arena so it can be neither copied nor moved
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    // Returns 'num_bytes' bytes of uninitialised memory aligned to 'alignment', which must
+    // be a power of two
+    void* allocate(const SizeT& num_bytes, const SizeT& alignment = alignof(std::max_align_t))
+    {
+      assert((alignment != 0) && ((alignment & (alignment - 1)) == 0));
+      const SizeT padding = (SizeT(0) - reinterpret_cast<uintptr_t>(Cursor)) & (alignment - 1);
+      const auto num_left = SizeT(End - Cursor);
+      if ((padding <= num_left) && (num_bytes <= num_left - padding)) {
+        Byte* pt = Cursor + padding;
+        Cursor = pt + num_bytes;
+        return pt;
+      }
+      return allocate_from_next_block(num_bytes, alignment);
+    }
+
+    // Returns uninitialised memory for 'n' objects of type T. Throws a std::bad_alloc
+    // exception if 'n' objects would not fit in the address space
+    template<class T>
+    T* allocate(const SizeT& n = 1)
+    {
+      if (n > std::numeric_limits<SizeT>::max() / sizeof(T)) throw std::bad_alloc();
+      return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // Constructs an object of type T in the arena, forwarding 'args' to its constructor, and
+    // returns a pointer to it. If the constructor throws, the memory is given back
+    template<class T, class... Args>
+    T* emplace(Args&&... args);
+
+    // Frees everything allocated so far in O(1) time. The memory is kept for reuse. Do not
+    // try to access previously allocated objects afterwards
+    void reset();
+
+    // Returns the current position of the arena
+    ArenaMarker mark() const;
+
+    // Frees everything allocated since 'marker' was returned by mark(). The marker must not
+    // be older than the last reset() or than a marker already rewound to
+    void rewind(const ArenaMarker& marker);
+
+    // Gives the blocks after the one currently in use back to Storage and returns how many
+    // bytes that was
+    SizeT trim();
+
+    // Makes the arena growable (see the class comment); a growth factor of 0 makes it
+    // fixed-size
+    void set_growth_factor(const SizeT& growth_factor) { Growth_factor = growth_factor; }
+
+    // Returns true if the arena chains new blocks when it runs out
+    inline bool is_growable() const { return Growth_factor > 0; }
+
+    // The number of bytes handed out since the last reset, including alignment padding and
+    // the unused ends of blocks that were too small for the next allocation
+    SizeT used() const;
+
+    // The total number of bytes in all the blocks of the arena
+    inline SizeT capacity() const { return Capacity; }
+
+    // The number of blocks in the arena
+    inline SizeT num_blocks() const { return Blocks.size(); }
+
+  private:
+    // The alignment of the blocks
+    static constexpr SizeT Block_alignment = alignof(std::max_align_t);
+
+    // A block of memory bumped through by allocate()
+    struct Block {
+      Byte* Pt;
+      SizeT Size;
+    };
+
+    // Moves on to the next block that can hold 'num_bytes' bytes aligned to 'alignment',
+    // chaining a new one if there is none, and allocates from it. Throws if the arena is
+    // fixed-size
+    void* allocate_from_next_block(const SizeT& num_bytes, const SizeT& alignment);
+
+    // Starts allocating from the start of the block with the given index
+    void use_block(const SizeT& block_index);
+
+    // The blocks in the order they are used
+    std::vector<Block> Blocks;
+
+    // The index of the block being allocated from, the next free byte in it and its end
+    SizeT Current;
+    Byte* Cursor;
+    Byte* End;
+
+    // The sum of the sizes of the blocks
+    SizeT Capacity;
+
+    // How much larger each chained block is than the previous one; 0 if fixed-size
+    SizeT Growth_factor;
+  };
+
+  /****************************************************************************************
+   * @brief Rewinds an arena to where it was when the scope was created, when the scope goes
+   *        out of scope:
+   *
+   *          {
+   *            ArenaScope scope(arena);
+   *            ... scratch allocations ...
+   *          } // freed here
+   *
+   * @tparam Arena: The type of the arena; see MonotonicArena.
+   ****************************************************************************************/
+  template<class Arena>
+  class ArenaScope {
+  public:
+    explicit ArenaScope(Arena& arena) : Scoped_arena(arena), Marker(arena.mark()) {}
+    ~ArenaScope() { Scoped_arena.rewind(Marker); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+  private:
+    Arena& Scoped_arena;
+    const ArenaMarker Marker;
+  };
+
+  /****************************************************************************************
+   * @brief Creates an arena and allocates its first block.
+   *
+   * @param num_bytes: The size of the first block in bytes.
+   * @param growth_factor: How much larger each chained block is than the previous one; 0
+   *                       makes the arena fixed-size.
+   ****************************************************************************************/
+  template<class Storage>
+  MonotonicArena<Storage>::MonotonicArena(const SizeT& num_bytes, const SizeT& growth_factor)
+    : Current(0), Cursor(nullptr), End(nullptr), Capacity(0), Growth_factor(growth_factor)
+  {
+    if (num_bytes == 0) {
+      throw std::invalid_argument("A MonotonicArena needs at least one byte");
+    }
+    Blocks.reserve(8);
+    Blocks.push_back({Storage::allocate(num_bytes, Block_alignment), num_bytes});
+    Capacity = num_bytes;
+    use_block(0);
+  }
+
+  /****************************************************************************************
+   * @brief Gives every block back to Storage.
+   *
+   ****************************************************************************************/
+  template<class Storage>
+  MonotonicArena<Storage>::~MonotonicArena()
+  {
+    for (const Block& block : Blocks) Storage::deallocate(block.Pt, block.Size, Block_alignment);
+  }
+
+  /****************************************************************************************
+   * @brief Constructs an object of type T in the arena using placement new. If the
+   *        constructor throws, the arena is rewound and the exception is rethrown.
+   *
+   * @param args: The arguments to forward to the constructor of T.
+   * @return T*: A pointer to the new object.
+   ****************************************************************************************/
+  template<class Storage>
+  template<class T, class... Args>
+  T* MonotonicArena<Storage>::emplace(Args&&... args)
+  {
+    const ArenaMarker marker = mark();
+    void* pt = allocate(sizeof(T), alignof(T));
+    try {
+      return new (pt) T(std::forward<Args>(args)...);
+    }
+    catch (...) {
+      rewind(marker);
+      throw;
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Frees everything allocated so far in O(1) time; the blocks are kept.
+   *
+   ****************************************************************************************/
+  template<class Storage>
+  void MonotonicArena<Storage>::reset()
+  {
+    use_block(0);
+  }
+
+  /****************************************************************************************
+   * @brief Returns the current position of the arena, for rewind().
+   *
+   ****************************************************************************************/
+  template<class Storage>
+  ArenaMarker MonotonicArena<Storage>::mark() const
+  {
+    return {Current, SizeT(Cursor - Blocks[Current].Pt)};
+  }
+
+  /****************************************************************************************
+   * @brief Frees everything allocated since 'marker' was taken, in O(1) time.
+   *
+   * @param marker: A position returned by mark().
+   ****************************************************************************************/
+  template<class Storage>
+  void MonotonicArena<Storage>::rewind(const ArenaMarker& marker)
+  {
+    assert((marker.Block < Current) ||
+           ((marker.Block == Current) && (marker.Offset <= SizeT(Cursor - Blocks[Current].Pt))));
+    use_block(marker.Block);
+    Cursor += marker.Offset;
+  }
+
+  /****************************************************************************************
+   * @brief Gives the blocks after the one in use back to Storage.
+   *
+   * @return SizeT: The number of bytes given back.
+   ****************************************************************************************/
+  template<class Storage>
+  SizeT MonotonicArena<Storage>::trim()
+  {
+    SizeT num_bytes = 0;
+    while (Blocks.size() > Current + 1) {
+      const Block& block = Blocks.back();
+      Storage::deallocate(block.Pt, block.Size, Block_alignment);
+      num_bytes += block.Size;
+      Blocks.pop_back();
+    }
+    Capacity -= num_bytes;
+    return num_bytes;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the number of bytes handed out since the last reset.
+   *
+   ****************************************************************************************/
+  template<class Storage>
+  SizeT MonotonicArena<Storage>::used() const
+  {
+    SizeT num_bytes = SizeT(Cursor - Blocks[Current].Pt);
+    for (SizeT i = 0; i < Current; i++) num_bytes += Blocks[i].Size;
+    return num_bytes;
+  }
+
+  /****************************************************************************************
+   * @brief Allocates from the next block that is large enough, once the current block is
+   *        full. Blocks kept from before the last reset are reused first; blocks too small
+   *        for the allocation are skipped until the next reset. A fixed-size arena throws a
+   *        std::out_of_range exception instead.
+   *
+   * @param num_bytes: The number of bytes to allocate.
+   * @param alignment: The alignment of the allocation.
+   * @return void*: The allocated memory.
+   ****************************************************************************************/
+  template<class Storage>
+  void* MonotonicArena<Storage>::allocate_from_next_block(const SizeT& num_bytes,
+                                                          const SizeT& alignment)
+  {
+    if (!is_growable()) {
+      throw std::out_of_range("Cannot allocate " + std::to_string(num_bytes) +
+                              " bytes; the arena has " + std::to_string(End - Cursor) +
+                              " bytes left");
+    }
+
+    // Blocks start aligned to Block_alignment, so larger alignments may need padding
+    const SizeT max_padding = (alignment > Block_alignment) ? alignment - Block_alignment : 0;
+    if (num_bytes > std::numeric_limits<SizeT>::max() - max_padding) throw std::bad_alloc();
+    const SizeT min_size = num_bytes + max_padding;
+    SizeT next = Current + 1;
+    while ((next < Blocks.size()) && (Blocks[next].Size < min_size)) next++;
+    if (next == Blocks.size()) {
+      // The next size saturates rather than wraps around; allocating it then throws
+      const SizeT last_size = Blocks.back().Size;
+      const SizeT grown_size = (last_size > std::numeric_limits<SizeT>::max() / Growth_factor)
+                                 ? std::numeric_limits<SizeT>::max()
+                                 : last_size * Growth_factor;
+      const SizeT size = std::max(grown_size, min_size);
+
+      // Make room for the block first, so it cannot leak if the vector fails to grow
+      if (Blocks.size() == Blocks.capacity()) Blocks.reserve(2 * Blocks.size());
+      Blocks.push_back({Storage::allocate(size, Block_alignment), size});
+      Capacity += size;
+    }
+    use_block(next);
+    return allocate(num_bytes, alignment);
+  }
+
+  /****************************************************************************************
+   * @brief Starts allocating from the start of a block.
+   *
+   * @param block_index: The index of the block.
+   ****************************************************************************************/
+  template<class Storage>
+  void MonotonicArena<Storage>::use_block(const SizeT& block_index)
+  {
+    Current = block_index;
+    Cursor = Blocks[block_index].Pt;
+    End = Cursor + Blocks[block_index].Size;
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_MONOTONIC_ARENA_HEADER
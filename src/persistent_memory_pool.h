@@ -0,0 +1,480 @@
+#ifndef MEMORY_POOL_PERSISTENT_MEMORY_POOL_HEADER
+#define MEMORY_POOL_PERSISTENT_MEMORY_POOL_HEADER
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  // Identifies a persistent pool file ("MEMPPOOL" when read as little-endian bytes)
+  constexpr uint64_t g_PersistentPoolMagic = 0x4c4f4f5050504d45;
+
+  // The version of the file layout; bumped whenever PersistentPoolHeader changes
+  constexpr uint32_t g_PersistentPoolVersion = 1;
+
+  /****************************************************************************************
+   * @brief True if objects of type T can be stored in a file and used again by another
+   *        process: T must be trivially copyable (so it can be brought back without running
+   *        a constructor) and must not be a pointer. Pointer members cannot be detected, so
+   *        specialise this to std::false_type for types that have any; an address saved in
+   *        one process means nothing in the next.
+   *
+   ****************************************************************************************/
+  template<class T>
+  struct is_persistable
+    : std::bool_constant<std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> &&
+                         !std::is_member_pointer_v<T>> {};
+
+  template<class T, SizeT N>
+  struct is_persistable<T[N]> : is_persistable<T> {};
+
+  template<class T>
+  constexpr bool is_persistable_v = is_persistable<T>::value;
+
+  /****************************************************************************************
+   * @brief Returns a fingerprint of the type T as it is laid out in this build: a 64-bit
+   *        FNV-1a hash of its name, size and alignment, and of 'schema_version'. Bump the
+   *        schema version whenever the members of T change without changing its size.
+   *
+   ****************************************************************************************/
+  template<class T>
+  constexpr uint64_t type_fingerprint(const uint64_t& schema_version = 0)
+  {
+    uint64_t hash = 0xcbf29ce484222325;
+    auto add_byte = [&hash](const uint64_t& byte) {
+      hash ^= (byte & 0xFF);
+      hash *= 0x100000001b3;
+    };
+    for (const char c : type_name<T>()) add_byte(static_cast<unsigned char>(c));
+    for (const uint64_t value : {uint64_t(sizeof(T)), uint64_t(alignof(T)), schema_version}) {
+      for (int i = 0; i < 64; i += 8) add_byte(value >> i);
+    }
+    return hash;
+  }
+
+  /****************************************************************************************
+   * @brief The header at the start of a persistent pool file. It holds all of the pool's
+   *        state besides the blocks themselves, so reopening the file brings the pool back
+   *        exactly as it was. Only fixed-size fields, in the byte order of the machine.
+   *
+   ****************************************************************************************/
+  struct PersistentPoolHeader {
+    // g_PersistentPoolMagic once the header is valid
+    uint64_t Magic;
+
+    // g_PersistentPoolVersion
+    uint32_t Version;
+    uint32_t Reserved;
+
+    // The type_fingerprint() of the objects in the pool
+    uint64_t Fingerprint;
+
+    // The offset of the first block from the start of the file, and the block size
+    uint64_t Blocks_offset;
+    uint64_t Block_size;
+
+    // The number of blocks in the pool
+    uint64_t Num_blocks;
+
+    // The number of blocks that can currently be handed out
+    uint64_t Num_available;
+
+    // The index of the first block in the free list
+    uint64_t Head;
+
+    // Blocks with an index at or above this value have never been handed out
+    uint64_t Next_untouched;
+  };
+
+  /****************************************************************************************
+   * @brief A fixed-size memory pool kept in a memory-mapped file, so its objects outlive
+   *        the process. Creating the pool for a file that does not exist yet makes a new,
+   *        empty pool; creating it for an existing file maps the file and carries on where
+   *        the last process left off, with every live object and the free blocks just as
+   *        they were, without reading or converting anything. For example
+   *
+   *          PersistentMemoryPool<Point> pool("points.pool", 1 << 20);
+   *          if (!pool.was_reopened()) load_points(pool);
+   *          pool.for_each_live([](Point& point) { ... });
+   *
+   *        The file starts with a PersistentPoolHeader holding the capacity, the free list
+   *        head and a fingerprint of T (see type_fingerprint()), followed by the blocks.
+   *        Free blocks are tracked with an intrusive free list and a bump index as in
+   *        StaticMemoryPool, with the indices kept in the file. A file whose header does not
+   *        match this build (another type, schema version or layout version) is rejected.
+   *
+   *        Only types for which is_persistable holds can be stored. Objects are found again
+   *        after a restart with for_each_live() or by block index (see index_of() and
+   *        at()), never by address, as the file is mapped somewhere else each time.
+   *
+   *        Changes reach the file through the page cache, so they survive the process
+   *        exiting or crashing at any point between two calls to the pool. flush() writes
+   *        them to disk (msync) so they also survive the machine going down.
+   *
+   *        NOTE: Like MemoryPool, the pool is not thread-safe, and only one process may
+   *        have a file open at a time.
+   *
+   * @tparam T: The type of the objects to be allocated for in the memory pool.
+   * @tparam SchemaVersion: Folded into the fingerprint; see type_fingerprint().
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion = 0>
+  class PersistentMemoryPool : public PoolObjects<T, PersistentMemoryPool<T, SchemaVersion>> {
+  public:
+    static_assert(is_persistable_v<T>,
+                  "A PersistentMemoryPool can only hold trivially copyable types without "
+                  "pointers; see is_persistable");
+
+    // Opens the pool in the file at 'path', or creates a pool for 'num_blocks' objects there
+    // if the file does not exist. Throws a std::system_error if the file cannot be created
+    // or mapped and a std::runtime_error if it is not a pool of T from this build
+    PersistentMemoryPool(const std::string& path, const SizeT& num_blocks);
+
+    // Unmaps the file. Changes are written back by the OS; call flush() first to wait
+    ~PersistentMemoryPool();
+
+    // The pool owns the mapping so it can be neither copied nor moved
+    PersistentMemoryPool(const PersistentMemoryPool&) = delete;
+    PersistentMemoryPool& operator=(const PersistentMemoryPool&) = delete;
+
+    // Returns true if the pool was opened from an existing file rather than created
+    inline bool was_reopened() const { return Was_reopened; }
+
+    // Writes every change made to the pool so far to disk, and waits until it is there
+    void flush();
+
+    // Marks every block in the pool as free again in O(1) time
+    void reset();
+
+    // Returns a pointer to an available block in the memory pool. The block is uninitialised
+    // memory (zero the first time it is handed out); use emplace() to construct an object
+    T* new_block_pt();
+
+    // "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. As T is
+    // trivially copyable there is no destructor to run, so destroy() does the same
+    void delete_block_pt(T*& obj_pt);
+
+    // The index of the block holding 'obj_pt', and the object in the block with the given
+    // index. Indices stay the same when the file is reopened, so they can be stored
+    SizeT index_of(const T* obj_pt) const;
+    T* at(const SizeT& block_index);
+
+    // Calls 'function' with a reference to each object allocated in the pool, in address
+    // order. Takes O(pool size / 64 + number of free blocks) time
+    template<class Function>
+    void for_each_live(Function&& function);
+
+    // The total number of objects this pool can hold
+    inline SizeT size() const { return Header->Num_blocks; }
+
+    // The remaining number of objects this pool can hold
+    inline SizeT available_capacity() const { return Header->Num_available; }
+
+    // The path of the file
+    inline const std::string& path() const { return Path; }
+
+  private:
+    // Marks the end of the free list
+    static constexpr uint64_t Null_index = std::numeric_limits<uint64_t>::max();
+
+    // The alignment of the blocks
+    static constexpr SizeT Block_alignment = std::max(alignof(T), alignof(uint64_t));
+
+    // The number of bytes between the start of consecutive blocks. A block must be able to
+    // hold either an object of type T or, while free, the index of the next free block
+    static constexpr SizeT Block_size =
+      round_up(std::max(sizeof(T), sizeof(uint64_t)), Block_alignment);
+
+    // The offset of the first block from the start of the file
+    static constexpr SizeT Blocks_offset =
+      round_up(sizeof(PersistentPoolHeader), std::max(Block_alignment, g_CacheLineSize));
+
+    // The fingerprint of T stored in the header
+    static constexpr uint64_t Fingerprint = type_fingerprint<T>(SchemaVersion);
+
+    // Returns a pointer to the block with the given index
+    inline Byte* block_pt(const SizeT& block_index) const
+    {
+      return Blocks + block_index * Block_size;
+    }
+
+    // Throws unless the header of a file of 'file_size' bytes describes a pool of T
+    void check_header(const SizeT& file_size) const;
+
+    // Returns true if obj_pt points to an object of type T in the pool. Returns false otherwise
+    bool is_pool_member(const T* const obj_pt) const;
+
+    // The path of the file
+    std::string Path;
+
+    // The start of the mapping and its size
+    void* Mapping;
+    SizeT Mapping_size;
+
+    // The header at the start of the mapping, and the first block
+    PersistentPoolHeader* Header;
+    Byte* Blocks;
+
+    // True if the file existed already
+    bool Was_reopened;
+  };
+
+  /****************************************************************************************
+   * @brief Opens the pool in the file at 'path', creating the file if it does not exist.
+   *        A new file is sized for 'num_blocks' blocks (its blocks read as zero and take no
+   *        disk space until written) and its header is written last, so a file whose
+   *        creation was interrupted is rejected rather than half-used. An existing file
+   *        keeps its own capacity; 'num_blocks' is then ignored.
+   *
+   * @param path: The path of the file.
+   * @param num_blocks: The number of objects a new pool can hold.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  PersistentMemoryPool<T, SchemaVersion>::PersistentMemoryPool(const std::string& path,
+                                                               const SizeT& num_blocks)
+    : Path(path), Mapping(nullptr), Mapping_size(0), Header(nullptr), Blocks(nullptr),
+      Was_reopened(false)
+  {
+    const int fd = ::open(Path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "open(" + Path + ")");
+    }
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0) {
+      const int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "fstat(" + Path + ")");
+    }
+    Was_reopened = (file_stat.st_size > 0);
+    Mapping_size = Was_reopened ? static_cast<SizeT>(file_stat.st_size)
+                                : Blocks_offset + std::max<SizeT>(num_blocks, 1) * Block_size;
+    if (!Was_reopened && (::ftruncate(fd, static_cast<off_t>(Mapping_size)) != 0)) {
+      const int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "ftruncate(" + Path + ")");
+    }
+    if (Mapping_size < sizeof(PersistentPoolHeader)) {
+      ::close(fd);
+      throw std::runtime_error(Path + " is not a persistent pool file");
+    }
+    Mapping = ::mmap(nullptr, Mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (Mapping == MAP_FAILED) {
+      throw std::system_error(error, std::generic_category(), "mmap(" + Path + ")");
+    }
+    Header = static_cast<PersistentPoolHeader*>(Mapping);
+    Blocks = static_cast<Byte*>(Mapping) + Blocks_offset;
+
+    if (!Was_reopened) {
+      Header->Version = g_PersistentPoolVersion;
+      Header->Fingerprint = Fingerprint;
+      Header->Blocks_offset = Blocks_offset;
+      Header->Block_size = Block_size;
+      Header->Num_blocks = std::max<SizeT>(num_blocks, 1);
+      reset();
+      Header->Magic = g_PersistentPoolMagic;
+      return;
+    }
+    try {
+      check_header(Mapping_size);
+    }
+    catch (...) {
+      ::munmap(Mapping, Mapping_size);
+      throw;
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Unmaps the file. Dirty pages are written back by the OS in its own time.
+   *
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  PersistentMemoryPool<T, SchemaVersion>::~PersistentMemoryPool()
+  {
+    ::munmap(Mapping, Mapping_size);
+  }
+
+  /****************************************************************************************
+   * @brief Writes every change made to the pool so far (objects and free state alike) to
+   *        disk with msync(MS_SYNC). Throws a std::system_error if that fails.
+   *
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  void PersistentMemoryPool<T, SchemaVersion>::flush()
+  {
+    if (::msync(Mapping, Mapping_size, MS_SYNC) != 0) {
+      throw std::system_error(errno, std::generic_category(), "msync(" + Path + ")");
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Marks every block in the pool as free again in O(1) time. Do not try to access
+   *        previously allocated blocks afterwards.
+   *
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  void PersistentMemoryPool<T, SchemaVersion>::reset()
+  {
+    Header->Head = Null_index;
+    Header->Next_untouched = 0;
+    Header->Num_available = Header->Num_blocks;
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block in the memory pool. Throws a
+   *        std::out_of_range exception if every block has been allocated.
+   *
+   * @return T*: A pointer to a new object in the memory pool.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  T* PersistentMemoryPool<T, SchemaVersion>::new_block_pt()
+  {
+    SizeT block_index;
+    if (Header->Head != Null_index) {
+      block_index = Header->Head;
+      std::memcpy(&Header->Head, block_pt(block_index), sizeof(uint64_t));
+    }
+    else if (Header->Next_untouched < Header->Num_blocks) {
+      block_index = Header->Next_untouched++;
+    }
+    else {
+      throw std::out_of_range("No more space available; all " +
+                              std::to_string(Header->Num_blocks) + " blocks allocated!");
+    }
+    Header->Num_available--;
+    return reinterpret_cast<T*>(block_pt(block_index));
+  }
+
+  /****************************************************************************************
+   * @brief "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. The
+   *        block is pushed onto the front of the free list.
+   *
+   * @param obj_pt: A reference to the pointer to the underlying block in the memory pool.
+   *                Will be set to 'nullptr' after the underlying data has been deallocated.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  void PersistentMemoryPool<T, SchemaVersion>::delete_block_pt(T*& obj_pt)
+  {
+    if (obj_pt == nullptr) {
+      return;
+    }
+    assert(is_pool_member(obj_pt));
+    Byte* byte_pt = reinterpret_cast<Byte*>(obj_pt);
+    std::memcpy(byte_pt, &Header->Head, sizeof(uint64_t));
+    Header->Head = static_cast<uint64_t>(byte_pt - Blocks) / Block_size;
+    Header->Num_available++;
+    obj_pt = nullptr;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the index of the block holding 'obj_pt'. Block indices do not depend on
+   *        where the file is mapped.
+   *
+   * @param obj_pt: A pointer to an object in the pool.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  SizeT PersistentMemoryPool<T, SchemaVersion>::index_of(const T* obj_pt) const
+  {
+    assert(is_pool_member(obj_pt));
+    return static_cast<SizeT>(reinterpret_cast<const Byte*>(obj_pt) - Blocks) / Block_size;
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to the block with the given index, which should hold a live
+   *        object.
+   *
+   * @param block_index: An index returned by index_of(), possibly in an earlier process.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  T* PersistentMemoryPool<T, SchemaVersion>::at(const SizeT& block_index)
+  {
+    assert(block_index < Header->Next_untouched);
+    return reinterpret_cast<T*>(block_pt(block_index));
+  }
+
+  /****************************************************************************************
+   * @brief Calls 'function' with a reference to each object allocated in the pool, in
+   *        address order. The blocks below the bump index are marked in a bitmap, the
+   *        blocks on the free list are unmarked again, and the rest are visited with
+   *        count-trailing-zeros.
+   *
+   * @param function: A callable taking a T&. Must not allocate from or free to the pool.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  template<class Function>
+  void PersistentMemoryPool<T, SchemaVersion>::for_each_live(Function&& function)
+  {
+    const SizeT num_touched = Header->Next_untouched;
+    std::vector<uint64_t> words(bitmap_words(num_touched));
+    set_bits(words.data(), 0, num_touched);
+    for (uint64_t index = Header->Head; index != Null_index;) {
+      words[index / 64] &= ~(uint64_t(1) << (index % 64));
+      std::memcpy(&index, block_pt(index), sizeof(uint64_t));
+    }
+    for (SizeT i = 0; i < words.size(); i++) {
+      for (uint64_t bits = words[i]; bits != 0; bits &= bits - 1) {
+        function(*reinterpret_cast<T*>(block_pt(64 * i + count_trailing_zeros(bits))));
+      }
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Checks that the header of the mapped file describes a pool of T laid out as in
+   *        this build, and that the file is large enough for the pool it describes.
+   *
+   * @param file_size: The size of the file in bytes.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  void PersistentMemoryPool<T, SchemaVersion>::check_header(const SizeT& file_size) const
+  {
+    const PersistentPoolHeader& header = *Header;
+    if ((header.Magic != g_PersistentPoolMagic) || (header.Version != g_PersistentPoolVersion)) {
+      throw std::runtime_error(Path + " is not a persistent pool file (or a different version)");
+    }
+    if ((header.Fingerprint != Fingerprint) || (header.Block_size != Block_size) ||
+        (header.Blocks_offset != Blocks_offset)) {
+      throw std::runtime_error(Path + " holds objects of a different type than " +
+                               std::string(type_name<T>()) + " (or another schema version)");
+    }
+    if ((file_size < Blocks_offset) ||
+        (header.Num_blocks > (file_size - Blocks_offset) / Block_size) ||
+        (header.Next_untouched > header.Num_blocks) ||
+        (header.Num_available > header.Num_blocks) ||
+        ((header.Head != Null_index) && (header.Head >= header.Next_untouched))) {
+      throw std::runtime_error(Path + " is truncated or corrupt");
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Returns true if 'obj_pt' points to the start of a block in the pool. Returns
+   *        false otherwise.
+   *
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  bool PersistentMemoryPool<T, SchemaVersion>::is_pool_member(const T* const obj_pt) const
+  {
+    const std::less<const Byte*> less;
+    auto byte_pt = reinterpret_cast<const Byte*>(obj_pt);
+    if (less(byte_pt, Blocks) || !less(byte_pt, block_pt(Header->Num_blocks))) return false;
+    return (byte_pt - Blocks) % Block_size == 0;
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_PERSISTENT_MEMORY_POOL_HEADER
@@ -0,0 +1,290 @@
+#ifndef MEMORY_POOL_POOL_ALLOCATOR_HEADER
+#define MEMORY_POOL_POOL_ALLOCATOR_HEADER
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief The pools shared by a PoolAllocator and every allocator rebound or copied from
+   *        it. There is one (growable) pool per block size/alignment, created on first use.
+   *
+   ****************************************************************************************/
+  class PoolAllocatorState {
+  public:
+    // The pools add segments of 'num_blocks' objects, doubling in size as they grow
+    PoolAllocatorState(const SizeT& num_blocks) : Num_blocks(num_blocks) {}
+
+    // Returns the pool used for single objects of type U
+    template<class U>
+    MemoryPool<RawBlock<sizeof(U), alignof(U)>>& pool_for();
+
+    // The number of pools that have been created so far
+    inline SizeT num_pools() const { return Pools.size(); }
+
+  private:
+    // A type-erased pool together with the size/alignment of its blocks
+    struct Entry {
+      SizeT Size;
+      SizeT Alignment;
+      std::shared_ptr<void> Pool_pt;
+    };
+
+    // The number of objects in the first segment of each pool
+    SizeT Num_blocks;
+
+    // One entry per pool; there are only ever a handful, so a linear search is fastest
+    std::vector<Entry> Pools;
+  };
+
+  /****************************************************************************************
+   * @brief Returns the pool used for single objects of type U, creating it if needed.
+   *        Types with the same size and alignment share a pool.
+   *
+   ****************************************************************************************/
+  template<class U>
+  MemoryPool<RawBlock<sizeof(U), alignof(U)>>& PoolAllocatorState::pool_for()
+  {
+    using Pool = MemoryPool<RawBlock<sizeof(U), alignof(U)>>;
+    for (const auto& entry : Pools) {
+      if ((entry.Size == sizeof(U)) && (entry.Alignment == alignof(U))) {
+        return *static_cast<Pool*>(entry.Pool_pt.get());
+      }
+    }
+    auto pool_pt = std::make_shared<Pool>(Num_blocks, 2);
+    Pools.push_back({sizeof(U), alignof(U), pool_pt});
+    return *pool_pt;
+  }
+
+  /****************************************************************************************
+   * @brief An allocator that satisfies the standard Allocator requirements and draws single
+   *        objects from a MemoryPool. This makes it possible for node-based containers
+   *        (std::list, std::map, std::set, std::unordered_map, ...) to take their nodes
+   *        from a pool instead of the global heap. Requests for more than one object (e.g.
+   *        the bucket array of a std::unordered_map) go to the global operator new.
+   *
+   *        Copies of an allocator, and allocators rebound from it, share the same pools
+   *        and compare equal, so memory allocated by one can be deallocated by any other.
+   *        The pools are released when the last such allocator is destroyed.
+   *
+   *        NOTE: Like MemoryPool, the allocator is not thread-safe.
+   *
+   * @tparam T: The type of the objects to be allocated.
+   ****************************************************************************************/
+  template<class T>
+  class PoolAllocator {
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    // Creates an allocator with its own set of pools. Each pool starts with space for
+    // 'num_blocks' objects
+    PoolAllocator(const SizeT& num_blocks = g_DefaultNumberOfObjectsInPool)
+      : State_pt(std::make_shared<PoolAllocatorState>(num_blocks)), Pool_pt(nullptr)
+    {
+    }
+
+    // Copies share the pools of 'other'. There is deliberately no move constructor, so a
+    // moved-from allocator (e.g. in a moved-from container) can still be used
+    PoolAllocator(const PoolAllocator& other) noexcept = default;
+    PoolAllocator& operator=(const PoolAllocator& other) noexcept = default;
+
+    // Creates an allocator for objects of type T that shares the pools of 'other'
+    template<class U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept
+      : State_pt(other.State_pt), Pool_pt(nullptr)
+    {
+    }
+
+    // Allocates (uninitialised) memory for 'n' objects of type T
+    T* allocate(const std::size_t n);
+
+    // Deallocates the memory for 'n' objects of type T pointed to by 'obj_pt'
+    void deallocate(T* obj_pt, const std::size_t n);
+
+    // The pools shared by this allocator and its copies
+    inline const PoolAllocatorState& state() const { return *State_pt; }
+
+    template<class U, class V>
+    friend bool operator==(const PoolAllocator<U>& lhs, const PoolAllocator<V>& rhs) noexcept;
+
+  private:
+    template<class U>
+    friend class PoolAllocator;
+
+    using Block = RawBlock<sizeof(T), alignof(T)>;
+    using Pool = MemoryPool<Block>;
+
+    // Returns the pool used for single objects of type T
+    Pool& pool();
+
+    // Returns true if objects of type T need more alignment than operator new provides
+    static constexpr bool is_over_aligned()
+    {
+      return alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+    }
+
+    // The pools shared by this allocator and its copies
+    std::shared_ptr<PoolAllocatorState> State_pt;
+
+    // Caches the pool for objects of type T so it only has to be looked up once
+    Pool* Pool_pt;
+  };
+
+  /****************************************************************************************
+   * @brief Allocates (uninitialised) memory for 'n' objects of type T. A single object is
+   *        allocated from the pool; anything larger comes from the global operator new.
+   *
+   * @param n: The number of objects to allocate memory for.
+   * @return T*: A pointer to the allocated memory.
+   ****************************************************************************************/
+  template<class T>
+  T* PoolAllocator<T>::allocate(const std::size_t n)
+  {
+    if (n == 1) {
+      return reinterpret_cast<T*>(pool().new_block_pt());
+    }
+    if (n > std::allocator_traits<PoolAllocator>::max_size(*this)) {
+      throw std::bad_array_new_length();
+    }
+    if constexpr (is_over_aligned()) {
+      return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+    }
+    else {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Deallocates the memory for 'n' objects of type T pointed to by 'obj_pt'.
+   *
+   * @param obj_pt: A pointer returned by allocate(n) on this allocator or one equal to it.
+   * @param n: The number of objects passed to allocate().
+   ****************************************************************************************/
+  template<class T>
+  void PoolAllocator<T>::deallocate(T* obj_pt, const std::size_t n)
+  {
+    if (n == 1) {
+      auto block_pt = reinterpret_cast<Block*>(obj_pt);
+      pool().delete_block_pt(block_pt);
+      return;
+    }
+    if constexpr (is_over_aligned()) {
+      ::operator delete(obj_pt, std::align_val_t(alignof(T)));
+    }
+    else {
+      ::operator delete(obj_pt);
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Returns the pool used for single objects of type T.
+   *
+   ****************************************************************************************/
+  template<class T>
+  typename PoolAllocator<T>::Pool& PoolAllocator<T>::pool()
+  {
+    if (Pool_pt == nullptr) {
+      Pool_pt = &(State_pt->template pool_for<T>());
+    }
+    return *Pool_pt;
+  }
+
+  /****************************************************************************************
+   * @brief Two allocators compare equal if they share the same pools, i.e. if memory
+   *        allocated by one can be deallocated by the other.
+   *
+   ****************************************************************************************/
+  template<class U, class V>
+  bool operator==(const PoolAllocator<U>& lhs, const PoolAllocator<V>& rhs) noexcept
+  {
+    return lhs.State_pt == rhs.State_pt;
+  }
+
+  template<class U, class V>
+  bool operator!=(const PoolAllocator<U>& lhs, const PoolAllocator<V>& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+  /****************************************************************************************
+   * @brief A std::pmr::memory_resource that serves fixed-size requests from a (growable)
+   *        MemoryPool. Requests of at most 'BlockSize' bytes with an alignment of at most
+   *        'BlockAlignment' are served by the pool; anything else is passed on to the
+   *        upstream resource. Use it with the std::pmr containers, e.g.
+   *
+   *          PoolMemoryResource<64> resource;
+   *          std::pmr::map<int, Point> map(&resource);
+   *
+   *        NOTE: Like MemoryPool, the resource is not thread-safe.
+   *
+   * @tparam BlockSize: The size of the requests served by the pool, in bytes.
+   * @tparam BlockAlignment: The alignment of the blocks in the pool.
+   ****************************************************************************************/
+  template<SizeT BlockSize, SizeT BlockAlignment = alignof(std::max_align_t)>
+  class PoolMemoryResource : public std::pmr::memory_resource {
+  public:
+    using Block = RawBlock<BlockSize, BlockAlignment>;
+
+    // Creates a resource whose pool starts with space for 'num_blocks' blocks and doubles
+    // in size as it grows. Larger requests are passed on to 'upstream_pt'
+    PoolMemoryResource(const SizeT& num_blocks = g_DefaultNumberOfObjectsInPool,
+                       std::pmr::memory_resource* upstream_pt = std::pmr::get_default_resource())
+      : Pool(num_blocks, 2), Upstream_pt(upstream_pt)
+    {
+    }
+
+    // The resource owns its pool so it cannot be copied
+    PoolMemoryResource(const PoolMemoryResource&) = delete;
+    PoolMemoryResource& operator=(const PoolMemoryResource&) = delete;
+
+    // The resource that requests too large for the pool are passed on to
+    inline std::pmr::memory_resource* upstream_resource() const { return Upstream_pt; }
+
+    // The pool used for requests that fit into a block
+    inline const MemoryPool<Block>& pool() const { return Pool; }
+
+  private:
+    // Returns true if a request for 'bytes' bytes with the given alignment fits into a block
+    static bool fits_in_block(const std::size_t& bytes, const std::size_t& alignment)
+    {
+      return (bytes <= BlockSize) && (alignment <= BlockAlignment);
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+      if (fits_in_block(bytes, alignment)) return Pool.new_block_pt();
+      return Upstream_pt->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* pt, std::size_t bytes, std::size_t alignment) override
+    {
+      if (fits_in_block(bytes, alignment)) {
+        auto block_pt = static_cast<Block*>(pt);
+        Pool.delete_block_pt(block_pt);
+        return;
+      }
+      Upstream_pt->deallocate(pt, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+      return this == &other;
+    }
+
+    // The pool used for requests that fit into a block
+    MemoryPool<Block> Pool;
+
+    // The resource that requests too large for the pool are passed on to
+    std::pmr::memory_resource* Upstream_pt;
+  };
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_POOL_ALLOCATOR_HEADER
@@ -0,0 +1,78 @@
+#ifndef MEMORY_POOL_POOL_POLICIES_HEADER
+#define MEMORY_POOL_POOL_POLICIES_HEADER
+
+#include <atomic>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief A locking policy for MemoryPool that spins instead of sleeping. Taking a free
+   *        SpinLock costs one atomic exchange and releasing it one store, which is cheaper
+   *        than std::mutex when the pool is held for a few instructions at a time and
+   *        threads rarely collide. A waiting thread burns its CPU, so prefer std::mutex
+   *        when there are more threads than cores. E.g.
+   *
+   *          MemoryPool<Point, SpinLock> pool(1000);
+   *
+   ****************************************************************************************/
+  class SpinLock {
+  public:
+    void lock()
+    {
+      while (Is_locked.exchange(true, std::memory_order_acquire)) {
+        // Wait until the lock looks free before trying again, so waiting threads only read
+        // the cache line rather than fight over it
+        while (Is_locked.load(std::memory_order_relaxed)) pause();
+      }
+    }
+
+    bool try_lock()
+    {
+      return !Is_locked.load(std::memory_order_relaxed) &&
+             !Is_locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() { Is_locked.store(false, std::memory_order_release); }
+
+  private:
+    // Tells the CPU that this is a spin loop; does nothing where there is no such hint
+    static void pause()
+    {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+      __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+      asm volatile("yield");
+#endif
+    }
+
+    std::atomic<bool> Is_locked{false};
+  };
+
+  /****************************************************************************************
+   * @brief A growth policy for MemoryPool that never grows: the pool throws once the blocks
+   *        it was created with have run out. Unlike GrowthFactor with a factor of 0, the
+   *        pool cannot be made growable later and the check for growth compiles away.
+   *
+   ****************************************************************************************/
+  class FixedCapacity {
+  public:
+    static constexpr SizeT next_segment_size(const SizeT& /* num_blocks */) { return 0; }
+  };
+
+  /****************************************************************************************
+   * @brief A growth policy for MemoryPool that adds segments of 'NumBlocks' objects each,
+   *        however large the pool already is. Wastes less memory than GrowthFactor when the
+   *        number of live objects creeps up slowly, at the cost of more segments.
+   *
+   * @tparam NumBlocks: The number of objects each new segment holds.
+   ****************************************************************************************/
+  template<SizeT NumBlocks>
+  class LinearGrowth {
+  public:
+    static_assert(NumBlocks > 0, "A segment must hold at least one block");
+
+    static constexpr SizeT next_segment_size(const SizeT& /* num_blocks */) { return NumBlocks; }
+  };
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_POOL_POLICIES_HEADER
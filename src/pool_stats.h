@@ -0,0 +1,401 @@
+#ifndef MEMORY_POOL_POOL_STATS_HEADER
+#define MEMORY_POOL_POOL_STATS_HEADER
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief A point-in-time copy of the statistics of one pool.
+   *
+   ****************************************************************************************/
+  struct PoolStatsSnapshot {
+    // The type of the objects in the pool (see type_name())
+    std::string Type_name;
+
+    // Identifies the pool for as long as the process runs; ids are handed out in the order
+    // the pools are created and never reused
+    SizeT Id = 0;
+
+    // The number of blocks the pool can hold without growing
+    SizeT Capacity = 0;
+
+    // The number of blocks currently handed out, and the largest this has ever been
+    SizeT Live = 0;
+    SizeT Peak_live = 0;
+
+    // The total number of blocks handed out and given back since the pool was created
+    SizeT Allocations = 0;
+    SizeT Deallocations = 0;
+
+    // The number of times a request found every block in use (which makes a growable pool
+    // grow and a fixed-size pool throw)
+    SizeT Exhaustions = 0;
+
+    // The number of segments a growable pool has added
+    SizeT Growths = 0;
+  };
+
+  /****************************************************************************************
+   * @brief Appends 'text' to 'json' as a JSON string, escaping it as needed.
+   *
+   ****************************************************************************************/
+  inline void append_json_string(std::string& json, std::string_view text)
+  {
+    json += '"';
+    for (const char c : text) {
+      if ((c == '"') || (c == '\\')) {
+        json += '\\';
+        json += c;
+      }
+      else if (static_cast<unsigned char>(c) < 0x20) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+        json += escaped;
+      }
+      else {
+        json += c;
+      }
+    }
+    json += '"';
+  }
+
+  /****************************************************************************************
+   * @brief Formats pool statistics as a JSON document of the form
+   *
+   *          {"pools": [{"id": 0, "type": "Point", "capacity": 1000, "live": 10,
+   *                      "peak_live": 12, "allocations": 25, "deallocations": 15,
+   *                      "exhaustions": 0, "growths": 0}, ...]}
+   *
+   * @param snapshots: The statistics of each pool.
+   * @return std::string: The JSON document (on a single line).
+   ****************************************************************************************/
+  inline std::string to_json(const std::vector<PoolStatsSnapshot>& snapshots)
+  {
+    std::string json = "{\"pools\": [";
+    for (SizeT i = 0; i < snapshots.size(); i++) {
+      const PoolStatsSnapshot& snapshot = snapshots[i];
+      if (i > 0) json += ", ";
+      json += "{\"id\": " + std::to_string(snapshot.Id) + ", \"type\": ";
+      append_json_string(json, snapshot.Type_name);
+      json += ", \"capacity\": " + std::to_string(snapshot.Capacity);
+      json += ", \"live\": " + std::to_string(snapshot.Live);
+      json += ", \"peak_live\": " + std::to_string(snapshot.Peak_live);
+      json += ", \"allocations\": " + std::to_string(snapshot.Allocations);
+      json += ", \"deallocations\": " + std::to_string(snapshot.Deallocations);
+      json += ", \"exhaustions\": " + std::to_string(snapshot.Exhaustions);
+      json += ", \"growths\": " + std::to_string(snapshot.Growths) + "}";
+    }
+    json += "]}";
+    return json;
+  }
+
+  /****************************************************************************************
+   * @brief A statistics policy for MemoryPool that records how the pool is used, e.g.
+   *
+   *          MemoryPool<Point, HeapStorage, NaturalLayout, BlockTracker, PoolStats> pool;
+   *
+   *        The allocation and deallocation counts are the only statistics updated on every
+   *        call, so they are kept per thread: each thread adds to its own cache line sized
+   *        shard and the shards are summed when the statistics are read. A MemoryPool is
+   *        only ever used by one thread at a time, so the shards are updated with a plain
+   *        load and store rather than an atomic read-modify-write; the atomics only make it
+   *        safe for another thread to read the statistics while the pool is in use.
+   *
+   *        Every PoolStats adds itself to the PoolRegistry for as long as it exists, so the
+   *        statistics of all the pools in a process can be listed (and published) in one go.
+   *
+   ****************************************************************************************/
+  class PoolStats {
+  public:
+    // The number of shards the allocation counts are split into
+    static constexpr SizeT Num_shards = 8;
+
+    static constexpr bool Traces_blocks = false;
+
+    // Registers the statistics (of a pool of 'type_name' objects) with the PoolRegistry
+    explicit PoolStats(std::string_view type_name, const SizeT& object_size = 0);
+
+    // Removes the statistics from the PoolRegistry
+    ~PoolStats();
+
+    // The registry holds a pointer to the statistics so they can be neither copied nor moved
+    PoolStats(const PoolStats&) = delete;
+    PoolStats& operator=(const PoolStats&) = delete;
+
+    // The hooks called by MemoryPool; see NoStats
+    void on_allocate(const SizeT& n, const SizeT& num_live);
+    void on_deallocate(const SizeT& n, const SizeT& num_live);
+    void on_exhausted() { increment(Exhaustions, 1); }
+    void on_grow() { increment(Growths, 1); }
+    void on_resize(const SizeT& capacity, const SizeT& num_live);
+    void on_allocate_block(const SizeT& /* slot */) {}
+    void on_deallocate_block(const SizeT& /* slot */) {}
+    void on_relocate_block(const SizeT& /* from_slot */, const SizeT& /* to_slot */) {}
+
+    // Returns a copy of the statistics. May be called from any thread at any time
+    PoolStatsSnapshot snapshot() const;
+
+    // The type of the objects in the pool
+    inline const std::string& type_name() const { return Type_name; }
+
+    // Identifies the pool in the PoolRegistry
+    inline SizeT id() const { return Id; }
+
+  private:
+    // The per-thread part of the statistics
+    struct alignas(g_CacheLineSize) Shard {
+      std::atomic<SizeT> Allocations{0};
+      std::atomic<SizeT> Deallocations{0};
+    };
+
+    // Adds 'n' to a counter only ever written by the thread that owns the pool
+    static void increment(std::atomic<SizeT>& counter, const SizeT& n)
+    {
+      counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Returns the shard the calling thread adds to
+    static SizeT shard_index();
+
+    // Records the number of blocks handed out, and the peak if it is a new one
+    void set_live(const SizeT& num_live);
+
+    // The allocation counts, split by thread
+    std::array<Shard, Num_shards> Shards;
+
+    // The remaining statistics; see PoolStatsSnapshot
+    std::atomic<SizeT> Capacity{0};
+    std::atomic<SizeT> Live{0};
+    std::atomic<SizeT> Peak_live{0};
+    std::atomic<SizeT> Exhaustions{0};
+    std::atomic<SizeT> Growths{0};
+
+    // The type of the objects in the pool
+    const std::string Type_name;
+
+    // Identifies the pool in the PoolRegistry
+    SizeT Id;
+  };
+
+  /****************************************************************************************
+   * @brief Lists every pool in the process that keeps statistics (i.e. uses PoolStats) so
+   *        that their statistics can be read together, e.g. to log them as JSON:
+   *
+   *          std::cout << PoolRegistry::instance().to_json() << "\n";
+   *
+   *        or to publish them for mempool-stat with a StatsPublisher. Pools add and remove
+   *        themselves; the registry can be read from any thread at any time.
+   *
+   ****************************************************************************************/
+  class PoolRegistry {
+  public:
+    // The registry shared by every pool in the process
+    static PoolRegistry& instance();
+
+    // The number of pools currently registered
+    SizeT size() const;
+
+    // Returns the statistics of every registered pool, in the order the pools were created
+    std::vector<PoolStatsSnapshot> snapshot() const;
+
+    // Returns the statistics of every registered pool as a JSON document; see to_json()
+    std::string to_json() const { return memory_pool::to_json(snapshot()); }
+
+  private:
+    friend class PoolStats;
+
+    PoolRegistry() = default;
+
+    // Registers 'stats' and returns its id
+    SizeT add(const PoolStats* stats);
+
+    // Unregisters 'stats'
+    void remove(const PoolStats* stats);
+
+    // Guards the list of pools and the next id
+    mutable std::mutex Mutex;
+
+    // The registered pools, in the order they were created
+    std::vector<const PoolStats*> Pools;
+
+    // The id given to the next pool
+    SizeT Next_id = 0;
+  };
+
+  /****************************************************************************************
+   * @brief Registers the statistics with the PoolRegistry.
+   *
+   * @param type_name: The type of the objects in the pool.
+   * @param object_size: The size of the objects in the pool; not recorded.
+   ****************************************************************************************/
+  inline PoolStats::PoolStats(std::string_view type_name, const SizeT& /* object_size */)
+    : Type_name(type_name), Id(PoolRegistry::instance().add(this))
+  {}
+
+  /****************************************************************************************
+   * @brief Removes the statistics from the PoolRegistry. Any read of the statistics that is
+   *        in progress finishes first.
+   *
+   ****************************************************************************************/
+  inline PoolStats::~PoolStats()
+  {
+    PoolRegistry::instance().remove(this);
+  }
+
+  /****************************************************************************************
+   * @brief Records that 'n' blocks were handed out, leaving 'num_live' blocks in use.
+   *
+   ****************************************************************************************/
+  inline void PoolStats::on_allocate(const SizeT& n, const SizeT& num_live)
+  {
+    increment(Shards[shard_index()].Allocations, n);
+    set_live(num_live);
+  }
+
+  /****************************************************************************************
+   * @brief Records that 'n' blocks were given back, leaving 'num_live' blocks in use.
+   *
+   ****************************************************************************************/
+  inline void PoolStats::on_deallocate(const SizeT& n, const SizeT& num_live)
+  {
+    increment(Shards[shard_index()].Deallocations, n);
+    Live.store(num_live, std::memory_order_relaxed);
+  }
+
+  /****************************************************************************************
+   * @brief Records the new capacity of the pool and the number of blocks in use.
+   *
+   ****************************************************************************************/
+  inline void PoolStats::on_resize(const SizeT& capacity, const SizeT& num_live)
+  {
+    Capacity.store(capacity, std::memory_order_relaxed);
+    set_live(num_live);
+  }
+
+  /****************************************************************************************
+   * @brief Returns a copy of the statistics, summing the per-thread shards. The counters
+   *        are read one at a time while the pool may be in use, so the copy is not an
+   *        atomic snapshot (e.g. 'Live' may lag 'Allocations' by a call or two) but each
+   *        counter is exact at the time it is read.
+   *
+   ****************************************************************************************/
+  inline PoolStatsSnapshot PoolStats::snapshot() const
+  {
+    PoolStatsSnapshot snapshot;
+    snapshot.Type_name = Type_name;
+    snapshot.Id = Id;
+    snapshot.Capacity = Capacity.load(std::memory_order_relaxed);
+    snapshot.Live = Live.load(std::memory_order_relaxed);
+    snapshot.Peak_live = Peak_live.load(std::memory_order_relaxed);
+    for (const Shard& shard : Shards) {
+      snapshot.Allocations += shard.Allocations.load(std::memory_order_relaxed);
+      snapshot.Deallocations += shard.Deallocations.load(std::memory_order_relaxed);
+    }
+    snapshot.Exhaustions = Exhaustions.load(std::memory_order_relaxed);
+    snapshot.Growths = Growths.load(std::memory_order_relaxed);
+    return snapshot;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the shard the calling thread adds to. Threads are given shards in turn
+   *        the first time they touch any pool, so up to 'Num_shards' threads never share a
+   *        shard's cache line.
+   *
+   ****************************************************************************************/
+  inline SizeT PoolStats::shard_index()
+  {
+    static std::atomic<SizeT> next_shard{0};
+    // Constant initialised so reading it costs no more than reading any other variable
+    thread_local SizeT shard = Num_shards;
+    if (shard == Num_shards) {
+      shard = next_shard.fetch_add(1, std::memory_order_relaxed) % Num_shards;
+    }
+    return shard;
+  }
+
+  /****************************************************************************************
+   * @brief Records the number of blocks handed out, and the peak if it is a new one.
+   *
+   ****************************************************************************************/
+  inline void PoolStats::set_live(const SizeT& num_live)
+  {
+    Live.store(num_live, std::memory_order_relaxed);
+    if (num_live > Peak_live.load(std::memory_order_relaxed)) {
+      Peak_live.store(num_live, std::memory_order_relaxed);
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Returns the registry shared by every pool in the process. Created by the first
+   *        pool that keeps statistics, so it outlives every pool (even static ones).
+   *
+   ****************************************************************************************/
+  inline PoolRegistry& PoolRegistry::instance()
+  {
+    static PoolRegistry registry;
+    return registry;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the number of pools currently registered.
+   *
+   ****************************************************************************************/
+  inline SizeT PoolRegistry::size() const
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Pools.size();
+  }
+
+  /****************************************************************************************
+   * @brief Returns the statistics of every registered pool, in the order the pools were
+   *        created. Pools can neither register nor unregister while this runs, so every
+   *        pool listed is still alive while its statistics are read.
+   *
+   ****************************************************************************************/
+  inline std::vector<PoolStatsSnapshot> PoolRegistry::snapshot() const
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    std::vector<PoolStatsSnapshot> snapshots;
+    snapshots.reserve(Pools.size());
+    for (const PoolStats* stats : Pools) {
+      snapshots.push_back(stats->snapshot());
+    }
+    return snapshots;
+  }
+
+  /****************************************************************************************
+   * @brief Registers 'stats' and returns its id.
+   *
+   ****************************************************************************************/
+  inline SizeT PoolRegistry::add(const PoolStats* stats)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Pools.push_back(stats);
+    return Next_id++;
+  }
+
+  /****************************************************************************************
+   * @brief Unregisters 'stats'. Pools are usually destroyed in the reverse order they were
+   *        created, so the list is searched from the back.
+   *
+   ****************************************************************************************/
+  inline void PoolRegistry::remove(const PoolStats* stats)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    auto it = std::find(Pools.rbegin(), Pools.rend(), stats);
+    if (it != Pools.rend()) {
+      Pools.erase(std::next(it).base());
+    }
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_POOL_STATS_HEADER
@@ -0,0 +1,593 @@
+#ifndef MEMORY_POOL_POOL_TRACE_HEADER
+#define MEMORY_POOL_POOL_TRACE_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "memory_pool.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#endif
+
+namespace memory_pool {
+  // Identifies a trace file ("MEMPTRCE" when read as little-endian bytes)
+  constexpr uint64_t g_TraceFileMagic = 0x45435254504d454d;
+
+  // The version of the trace file format; bumped whenever it changes
+  constexpr uint32_t g_TraceFileVersion = 1;
+
+  // The number of records each thread's ring buffer holds unless set_buffer_capacity() says
+  // otherwise (3 MiB of records). Capacities are rounded up to a power of two
+  constexpr SizeT g_DefaultTraceBufferCapacity = SizeT(1) << 18;
+
+  /****************************************************************************************
+   * @brief What a trace record describes.
+   *
+   ****************************************************************************************/
+  enum class TraceOp : uint8_t {
+    // The block in 'Slot' was handed out
+    Allocate,
+    // The block in 'Slot' was given back
+    Deallocate,
+    // compact() is moving the object in 'Slot'; always followed by a Relocate_to record
+    Relocate_from,
+    // ... to the block in 'Slot'
+    Relocate_to,
+    // Every block in the pool was given back at once (clear() or reset())
+    Reset
+  };
+
+  /****************************************************************************************
+   * @brief One event in a trace, in 12 bytes. Slots are the block indices reported by the
+   *        pool (see NoStats). Timestamps are stored as the time since the previous record,
+   *        which stays small and keeps the record compact. In a TraceBuffer that time is in
+   *        TraceClock ticks; TraceRegistry::collect() converts it to nanoseconds.
+   *
+   ****************************************************************************************/
+  struct TraceRecord {
+    // The slot of the block the event concerns (0 for Reset)
+    uint32_t Slot;
+
+    // The time since the previous record (in the same buffer, or in the collected trace);
+    // saturates after 2^32 ticks (about a second at 4 GHz) or nanoseconds
+    uint32_t Delta;
+
+    // The pool the event happened in (see TracedPool)
+    uint16_t Pool_id;
+
+    TraceOp Op;
+    uint8_t Reserved;
+  };
+  static_assert(sizeof(TraceRecord) == 12, "Trace records should stay compact");
+
+  /****************************************************************************************
+   * @brief A pool that recorded events into a trace.
+   *
+   ****************************************************************************************/
+  struct TracedPool {
+    // The Pool_id of its records
+    uint16_t Id = 0;
+
+    // The size of its objects in bytes, and their type (see type_name())
+    SizeT Object_size = 0;
+    std::string Type_name;
+  };
+
+  /****************************************************************************************
+   * @brief A trace collected from every thread (see TraceRegistry::collect()) or read from a
+   *        file: the pools that took part, and their events in the order they happened.
+   *
+   ****************************************************************************************/
+  struct Trace {
+    std::vector<TracedPool> Pools;
+    std::vector<TraceRecord> Records;
+  };
+
+  /****************************************************************************************
+   * @brief The clock trace records are timed with. Reading the time stamp counter costs a
+   *        fraction of a std::chrono::steady_clock call, which would otherwise dominate the
+   *        cost of a record; ticks are converted to nanoseconds only when a trace is
+   *        collected. Other targets fall back on the steady clock, in nanoseconds.
+   *
+   ****************************************************************************************/
+  struct TraceClock {
+    static int64_t now()
+    {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+      return static_cast<int64_t>(__rdtsc());
+#else
+      return now_ns();
+#endif
+    }
+
+    // Nanoseconds on the steady clock
+    static int64_t now_ns()
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+    }
+  };
+
+  /****************************************************************************************
+   * @brief A ring buffer of trace records written by a single thread. Once it is full, each
+   *        new record overwrites the oldest one, so the buffer always holds the most recent
+   *        events at a fixed memory cost and recording never allocates.
+   *
+   ****************************************************************************************/
+  class TraceBuffer {
+  public:
+    // Creates a buffer for 'capacity' records (rounded up to a power of two)
+    explicit TraceBuffer(const SizeT& capacity);
+
+    // Appends a record, overwriting the oldest one if the buffer is full
+    void record(const TraceOp& op, const uint16_t& pool_id, const SizeT& slot);
+
+    // Appends the records in the buffer, oldest first, to 'records', along with the time of
+    // each one (in TraceClock ticks) to 'times'
+    void copy(std::vector<TraceRecord>& records, std::vector<int64_t>& times) const;
+
+    // Removes every record
+    void clear();
+
+  private:
+    // The smallest power of two that is at least 'n'
+    static SizeT power_of_two_at_least(const SizeT& n)
+    {
+      SizeT power = 1;
+      while (power < n) power *= 2;
+      return power;
+    }
+
+    // The records; slot 'i & Index_mask' holds the i-th record written
+    std::vector<TraceRecord> Records;
+    const SizeT Index_mask;
+
+    // The number of records ever written
+    std::atomic<SizeT> Num_written{0};
+
+    // The time of the last record written, and the time the oldest record in the buffer is
+    // relative to, in TraceClock ticks
+    int64_t Last_time;
+    int64_t Base_time;
+  };
+
+  /****************************************************************************************
+   * @brief Keeps track of every traced pool and of each thread's TraceBuffer, so the trace
+   *        of a whole process can be collected in one go:
+   *
+   *          ... run the workload with pools that use PoolTrace ...
+   *          write_trace(TraceRegistry::instance().collect(), "workload.trace");
+   *
+   *        Buffers belong to the registry, so the records of threads that have exited can
+   *        still be collected. Collect (or clear) the trace only while no traced thread is
+   *        allocating or freeing, e.g. after joining them.
+   *
+   ****************************************************************************************/
+  class TraceRegistry {
+  public:
+    // The registry shared by every traced pool in the process
+    static TraceRegistry& instance();
+
+    // Registers a pool of 'object_size'-byte 'type_name' objects and returns its id. Throws a
+    // std::length_error once 65536 pools have been registered
+    uint16_t add_pool(std::string_view type_name, const SizeT& object_size);
+
+    // The calling thread's buffer, which is created on first use
+    TraceBuffer& thread_buffer()
+    {
+      thread_local TraceBuffer* buffer_pt = nullptr;
+      if (buffer_pt == nullptr) buffer_pt = &create_thread_buffer();
+      return *buffer_pt;
+    }
+
+    // Sets the number of records in the buffers of threads that have not traced anything yet
+    void set_buffer_capacity(const SizeT& capacity);
+
+    // Merges the records of every thread's buffer into one trace, in time order
+    Trace collect() const;
+
+    // Removes the records from every thread's buffer
+    void clear();
+
+  private:
+    TraceRegistry() = default;
+
+    // Creates and registers a buffer for the calling thread
+    TraceBuffer& create_thread_buffer();
+
+    // Guards everything below
+    mutable std::mutex Mutex;
+
+    // The registered pools, by id
+    std::vector<TracedPool> Pools;
+
+    // Every thread's buffer
+    std::vector<std::unique_ptr<TraceBuffer>> Buffers;
+
+    // The capacity of new buffers
+    SizeT Buffer_capacity = g_DefaultTraceBufferCapacity;
+
+    // The times on both clocks when the registry was created, to convert ticks to nanoseconds
+    const int64_t Start_time = TraceClock::now();
+    const int64_t Start_ns = TraceClock::now_ns();
+  };
+
+  /****************************************************************************************
+   * @brief A statistics policy for MemoryPool that records every allocation and deallocation
+   *        (with the slot of the block and the time) in the calling thread's TraceBuffer,
+   *        so a real workload can be captured and replayed offline against other pool
+   *        configurations (see benchmark/replay_trace.cpp). For example
+   *
+   *          MemoryPool<Order, HeapStorage, NaturalLayout, BlockTracker, PoolTrace<>> orders;
+   *
+   *        records the events of 'orders', and PoolTrace<PoolStats> keeps statistics too. A
+   *        record takes a TraceClock read and a 12-byte store. Pools that do not use PoolTrace
+   *        are not affected at all.
+   *
+   * @tparam Base: The statistics policy to keep as well; see NoStats.
+   ****************************************************************************************/
+  template<class Base = NoStats>
+  class PoolTrace : public Base {
+  public:
+    static constexpr bool Traces_blocks = true;
+
+    // Registers the pool with the TraceRegistry
+    PoolTrace(std::string_view type_name, const SizeT& object_size)
+      : Base(type_name, object_size),
+        Id(TraceRegistry::instance().add_pool(type_name, object_size))
+    {}
+
+    // The hooks called by MemoryPool; see NoStats
+    void on_resize(const SizeT& capacity, const SizeT& num_live)
+    {
+      Base::on_resize(capacity, num_live);
+      if (num_live == 0) record(TraceOp::Reset, 0);
+    }
+    void on_allocate_block(const SizeT& slot) { record(TraceOp::Allocate, slot); }
+    void on_deallocate_block(const SizeT& slot) { record(TraceOp::Deallocate, slot); }
+    void on_relocate_block(const SizeT& from_slot, const SizeT& to_slot)
+    {
+      record(TraceOp::Relocate_from, from_slot);
+      record(TraceOp::Relocate_to, to_slot);
+    }
+
+    // Identifies the pool in the trace
+    inline uint16_t trace_id() const { return Id; }
+
+  private:
+    void record(const TraceOp& op, const SizeT& slot)
+    {
+      TraceRegistry::instance().thread_buffer().record(op, Id, slot);
+    }
+
+    // Identifies the pool in the trace
+    const uint16_t Id;
+  };
+
+  /****************************************************************************************
+   * @brief Creates an empty buffer for 'capacity' records.
+   *
+   ****************************************************************************************/
+  inline TraceBuffer::TraceBuffer(const SizeT& capacity)
+    : Records(power_of_two_at_least(capacity)),
+      Index_mask(Records.size() - 1),
+      Last_time(TraceClock::now()),
+      Base_time(Last_time)
+  {}
+
+  /****************************************************************************************
+   * @brief Appends a record, overwriting the oldest one (and moving the base time on past
+   *        it) if the buffer is full.
+   *
+   * @param op: What happened.
+   * @param pool_id: The pool it happened in.
+   * @param slot: The block it happened to.
+   ****************************************************************************************/
+  inline void TraceBuffer::record(const TraceOp& op, const uint16_t& pool_id, const SizeT& slot)
+  {
+    const int64_t time = TraceClock::now();
+    const auto delta = static_cast<uint32_t>(
+      std::clamp<int64_t>(time - Last_time, 0, std::numeric_limits<uint32_t>::max()));
+    Last_time = time;
+    const SizeT num_written = Num_written.load(std::memory_order_relaxed);
+    TraceRecord& record = Records[num_written & Index_mask];
+    if (num_written > Index_mask) Base_time += record.Delta;
+    record = TraceRecord{static_cast<uint32_t>(slot), delta, pool_id, op, 0};
+    Num_written.store(num_written + 1, std::memory_order_release);
+  }
+
+  /****************************************************************************************
+   * @brief Appends the records in the buffer, oldest first, and their times.
+   *
+   * @param records: The records are appended to this.
+   * @param times: The time of each record, in TraceClock ticks, is appended to this.
+   ****************************************************************************************/
+  inline void TraceBuffer::copy(std::vector<TraceRecord>& records,
+                                std::vector<int64_t>& times) const
+  {
+    const SizeT num_written = Num_written.load(std::memory_order_acquire);
+    const SizeT num_records = std::min(num_written, Records.size());
+    int64_t time = Base_time;
+    for (SizeT i = num_written - num_records; i < num_written; i++) {
+      const TraceRecord& record = Records[i & Index_mask];
+      time += record.Delta;
+      records.push_back(record);
+      times.push_back(time);
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Removes every record; the next record is timed from now.
+   *
+   ****************************************************************************************/
+  inline void TraceBuffer::clear()
+  {
+    Num_written.store(0, std::memory_order_relaxed);
+    Last_time = TraceClock::now();
+    Base_time = Last_time;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the registry shared by every traced pool in the process.
+   *
+   ****************************************************************************************/
+  inline TraceRegistry& TraceRegistry::instance()
+  {
+    static TraceRegistry registry;
+    return registry;
+  }
+
+  /****************************************************************************************
+   * @brief Registers a pool and returns the id its records carry.
+   *
+   * @param type_name: The type of the objects in the pool.
+   * @param object_size: The size of the objects in the pool in bytes.
+   ****************************************************************************************/
+  inline uint16_t TraceRegistry::add_pool(std::string_view type_name, const SizeT& object_size)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    if (Pools.size() > std::numeric_limits<uint16_t>::max()) {
+      throw std::length_error("At most 65536 pools can be traced in a process");
+    }
+    const auto id = static_cast<uint16_t>(Pools.size());
+    Pools.push_back({id, object_size, std::string(type_name)});
+    return id;
+  }
+
+  /****************************************************************************************
+   * @brief Sets the number of records in each buffer created from now on.
+   *
+   ****************************************************************************************/
+  inline void TraceRegistry::set_buffer_capacity(const SizeT& capacity)
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Buffer_capacity = capacity;
+  }
+
+  /****************************************************************************************
+   * @brief Merges the records of every thread's buffer into one trace, ordered by time, and
+   *        recomputes the time deltas, in nanoseconds, for the merged order.
+   *
+   ****************************************************************************************/
+  inline Trace TraceRegistry::collect() const
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Trace trace;
+    trace.Pools = Pools;
+    std::vector<TraceRecord> records;
+    std::vector<int64_t> times;
+    for (const auto& buffer : Buffers) buffer->copy(records, times);
+
+    // Work out the length of a tick from the time both clocks moved since the registry was
+    // created
+    const int64_t num_ticks = TraceClock::now() - Start_time;
+    const int64_t num_ns = TraceClock::now_ns() - Start_ns;
+    const double ns_per_tick = (num_ticks > 0) ? double(num_ns) / double(num_ticks) : 1.0;
+
+    // Each buffer is already in time order, so a stable sort keeps the events of a thread in
+    // the order they happened even when the clock did not move between them
+    std::vector<SizeT> order(records.size());
+    for (SizeT i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&times](const SizeT& lhs, const SizeT& rhs) {
+      return times[lhs] < times[rhs];
+    });
+    trace.Records.reserve(records.size());
+    for (SizeT i = 0; i < order.size(); i++) {
+      TraceRecord record = records[order[i]];
+      const int64_t delta = (i == 0) ? 0 : times[order[i]] - times[order[i - 1]];
+      record.Delta = static_cast<uint32_t>(
+        std::min<double>(double(delta) * ns_per_tick, std::numeric_limits<uint32_t>::max()));
+      trace.Records.push_back(record);
+    }
+    return trace;
+  }
+
+  /****************************************************************************************
+   * @brief Removes the records from every thread's buffer. The pools stay registered.
+   *
+   ****************************************************************************************/
+  inline void TraceRegistry::clear()
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    for (const auto& buffer : Buffers) buffer->clear();
+  }
+
+  /****************************************************************************************
+   * @brief Creates a buffer for the calling thread and registers it.
+   *
+   ****************************************************************************************/
+  inline TraceBuffer& TraceRegistry::create_thread_buffer()
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Buffers.push_back(std::make_unique<TraceBuffer>(Buffer_capacity));
+    return *Buffers.back();
+  }
+
+  /****************************************************************************************
+   * @brief What a trace says about the demand on one traced pool; enough to size a pool
+   *        that can replay it.
+   *
+   ****************************************************************************************/
+  struct PoolSummary {
+    // The size of the objects
+    SizeT Object_size = 0;
+
+    // The most objects allocated at once, and one more than the highest slot used
+    SizeT Peak_live = 0;
+    SizeT Num_slots = 0;
+  };
+
+  /****************************************************************************************
+   * @brief Works out the peak number of live objects and the number of slots of every pool
+   *        in a trace. An object moved by compact() leaves its old slot for its new one.
+   *
+   * @param trace: The trace to summarise.
+   * @return std::vector<PoolSummary>: The summary of each pool, indexed by pool id.
+   ****************************************************************************************/
+  inline std::vector<PoolSummary> summarise_trace(const Trace& trace)
+  {
+    std::vector<PoolSummary> summaries(trace.Pools.size());
+    std::vector<SizeT> num_live(trace.Pools.size(), 0);
+    std::vector<std::vector<bool>> is_live(trace.Pools.size());
+    for (const TracedPool& pool : trace.Pools) {
+      if (pool.Id < summaries.size()) summaries[pool.Id].Object_size = pool.Object_size;
+    }
+    for (const TraceRecord& record : trace.Records) {
+      if (record.Pool_id >= summaries.size()) continue;
+      PoolSummary& summary = summaries[record.Pool_id];
+      std::vector<bool>& live = is_live[record.Pool_id];
+      summary.Num_slots = std::max<SizeT>(summary.Num_slots, SizeT(record.Slot) + 1);
+      if (live.size() <= record.Slot) live.resize(SizeT(record.Slot) + 1, false);
+      SizeT& n = num_live[record.Pool_id];
+      switch (record.Op) {
+        case TraceOp::Allocate:
+        case TraceOp::Relocate_to:
+          if (!live[record.Slot]) {
+            live[record.Slot] = true;
+            summary.Peak_live = std::max(summary.Peak_live, ++n);
+          }
+          break;
+        case TraceOp::Deallocate:
+        case TraceOp::Relocate_from:
+          if (live[record.Slot]) {
+            live[record.Slot] = false;
+            n--;
+          }
+          break;
+        case TraceOp::Reset:
+          live.assign(live.size(), false);
+          n = 0;
+          break;
+      }
+    }
+    return summaries;
+  }
+
+  /****************************************************************************************
+   * @brief Writes a trace to a file: a header (magic number, version and counts), then each
+   *        pool (id, object size and type name) and then the records as they are in memory.
+   *        Throws a std::system_error if the file cannot be written.
+   *
+   * @param trace: The trace to write.
+   * @param path: The path of the file.
+   ****************************************************************************************/
+  inline void write_trace(const Trace& trace, const std::string& path)
+  {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+      throw std::system_error(errno, std::generic_category(), "fopen(" + path + ")");
+    }
+    bool is_ok = true;
+    auto write_value = [&](const auto& value) {
+      is_ok = is_ok && (std::fwrite(&value, sizeof(value), 1, file) == 1);
+    };
+    write_value(g_TraceFileMagic);
+    write_value(g_TraceFileVersion);
+    write_value(static_cast<uint32_t>(trace.Pools.size()));
+    write_value(static_cast<uint64_t>(trace.Records.size()));
+    for (const TracedPool& pool : trace.Pools) {
+      write_value(static_cast<uint32_t>(pool.Id));
+      write_value(static_cast<uint32_t>(pool.Type_name.size()));
+      write_value(static_cast<uint64_t>(pool.Object_size));
+      is_ok = is_ok && (std::fwrite(pool.Type_name.data(), 1, pool.Type_name.size(), file) ==
+                        pool.Type_name.size());
+    }
+    is_ok = is_ok && (std::fwrite(trace.Records.data(), sizeof(TraceRecord),
+                                  trace.Records.size(), file) == trace.Records.size());
+    is_ok = (std::fclose(file) == 0) && is_ok;
+    if (!is_ok) {
+      throw std::system_error(EIO, std::generic_category(), "Writing " + path);
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Reads a trace written by write_trace(). Throws a std::system_error if the file
+   *        cannot be opened and a std::runtime_error if it is not a (complete) trace file.
+   *
+   * @param path: The path of the file.
+   * @return Trace: The trace in the file.
+   ****************************************************************************************/
+  inline Trace read_trace(const std::string& path)
+  {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+      throw std::system_error(errno, std::generic_category(), "fopen(" + path + ")");
+    }
+    bool is_ok = true;
+    auto read_value = [&](auto& value) {
+      is_ok = is_ok && (std::fread(&value, sizeof(value), 1, file) == 1);
+    };
+    uint64_t magic = 0;
+    uint32_t version = 0;
+    uint32_t num_pools = 0;
+    uint64_t num_records = 0;
+    read_value(magic);
+    read_value(version);
+    read_value(num_pools);
+    read_value(num_records);
+    is_ok = is_ok && (magic == g_TraceFileMagic) && (version == g_TraceFileVersion);
+
+    Trace trace;
+    for (uint32_t i = 0; is_ok && (i < num_pools); i++) {
+      uint32_t id = 0;
+      uint32_t name_size = 0;
+      uint64_t object_size = 0;
+      read_value(id);
+      read_value(name_size);
+      read_value(object_size);
+      std::string type_name(is_ok ? name_size : 0, '\0');
+      is_ok = is_ok && (std::fread(type_name.data(), 1, name_size, file) == name_size);
+      trace.Pools.push_back({static_cast<uint16_t>(id), object_size, type_name});
+    }
+    if (is_ok) {
+      // Read in chunks so a corrupt count cannot make us allocate a huge vector up front
+      constexpr SizeT chunk_size = SizeT(1) << 16;
+      while (is_ok && (trace.Records.size() < num_records)) {
+        const SizeT num_read = trace.Records.size();
+        const SizeT n = std::min<SizeT>(chunk_size, num_records - num_read);
+        trace.Records.resize(num_read + n);
+        is_ok = (std::fread(trace.Records.data() + num_read, sizeof(TraceRecord), n, file) == n);
+      }
+    }
+    std::fclose(file);
+    if (!is_ok) {
+      throw std::runtime_error(path + " is not a (complete) trace file");
+    }
+    return trace;
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_POOL_TRACE_HEADER
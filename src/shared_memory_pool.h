@@ -0,0 +1,564 @@
+#ifndef MEMORY_POOL_SHARED_MEMORY_POOL_HEADER
+#define MEMORY_POOL_SHARED_MEMORY_POOL_HEADER
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include "persistent_memory_pool.h"
+
+namespace memory_pool {
+  // Identifies a shared pool ("MEMSPOOL" when read as little-endian bytes)
+  constexpr uint64_t g_SharedPoolMagic = 0x4c4f4f50534d454d;
+
+  // The version of the shared memory layout; bumped whenever SharedPoolHeader changes
+  constexpr uint32_t g_SharedPoolVersion = 2;
+
+  // How long opening a pool waits for the process creating it to finish setting it up
+  constexpr std::chrono::milliseconds g_SharedPoolSetupTimeout(1000);
+
+  /****************************************************************************************
+   * @brief The position of an object in a SharedMemoryPool: its offset in bytes from the
+   *        start of the shared memory object. Unlike a pointer it means the same thing in
+   *        every process that has the pool mapped, wherever the mapping is, so it can be
+   *        stored in shared memory or sent to another process. A default-constructed
+   *        offset is null (no block starts at offset 0).
+   *
+   ****************************************************************************************/
+  template<class T>
+  struct SharedOffset {
+    uint64_t Value = 0;
+
+    explicit operator bool() const { return Value != 0; }
+    bool operator==(const SharedOffset& other) const { return Value == other.Value; }
+    bool operator!=(const SharedOffset& other) const { return Value != other.Value; }
+  };
+
+  /****************************************************************************************
+   * @brief The header at the start of a SharedMemoryPool's shared memory object. The free
+   *        list head packs the index of the first free block (low 32 bits) with a tag that
+   *        is incremented by every update (high 32 bits), so a compare-and-swap fails if the
+   *        head was popped and pushed back in the meantime (the ABA problem).
+   *
+   ****************************************************************************************/
+  struct SharedPoolHeader {
+    // g_SharedPoolMagic once the creating process has finished setting up the pool
+    std::atomic<uint64_t> Magic;
+
+    // g_SharedPoolVersion
+    uint32_t Version;
+
+    // The process that created the shared memory object and is setting it up (0 until it
+    // has been stored). If it dies before storing the magic number, another process can
+    // take the object over and create the pool again
+    std::atomic<int32_t> Creator_pid;
+
+    // The type_fingerprint() of the objects in the pool
+    uint64_t Fingerprint;
+
+    // The offsets of the next-free-block array and of the first block, and the block size
+    uint64_t Links_offset;
+    uint64_t Blocks_offset;
+    uint64_t Block_size;
+
+    // The number of blocks in the pool
+    uint64_t Num_blocks;
+
+    // The tagged index of the first free block
+    alignas(g_CacheLineSize) std::atomic<uint64_t> Head;
+
+    // The number of blocks that can currently be handed out (see available_capacity())
+    alignas(g_CacheLineSize) std::atomic<uint64_t> Num_available;
+  };
+
+  /****************************************************************************************
+   * @brief A fixed-size memory pool in a POSIX shared memory object, which any number of
+   *        processes on the machine can map and allocate from and free to at the same time.
+   *        One process can construct an object in a block and hand its SharedOffset to
+   *        another, which reads it in place and frees it when done; nothing is copied.
+   *
+   *          // In every process
+   *          SharedMemoryPool<Record> pool("/records", 1 << 16);
+   *          // Producer
+   *          Record* record_pt = pool.emplace(...);
+   *          send(pool.offset_of(record_pt));
+   *          // Consumer
+   *          Record* record_pt = pool.from_offset(receive());
+   *          ...
+   *          pool.delete_block_pt(record_pt);
+   *
+   *        The first process to construct the pool for a name creates and sets up the shared
+   *        memory object; the others map it once it is ready (and take its capacity from
+   *        it). As every process maps the pool at a different address, objects are passed
+   *        around as SharedOffsets and must not hold pointers (see is_persistable); the pool
+   *        checks that every process uses it for the same type (see type_fingerprint()).
+   *
+   *        The free blocks form a lock-free stack (a Treiber stack). The links live in an
+   *        array of their own rather than in the free blocks, and the head is a tagged
+   *        index updated by compare-and-swap. Every allocation and deallocation takes effect
+   *        with a single atomic instruction, so a process that dies at any point leaves the
+   *        free list intact: at worst, the blocks it was holding (or was in the middle of
+   *        freeing) are never returned to the pool.
+   *
+   *        The shared memory object outlives the processes using it until it is removed
+   *        with SharedMemoryPool::unlink(). If the creating process dies while setting the
+   *        pool up, the next process to open it sees from the pid in the header that the
+   *        creator is gone, removes the object and creates the pool again. A creator that
+   *        dies before it has sized the object and stored its pid leaves nothing to go on:
+   *        opening the pool then throws until the object is removed with unlink().
+   *
+   * @tparam T: The type of the objects to be allocated for in the memory pool.
+   * @tparam SchemaVersion: Folded into the fingerprint; see type_fingerprint().
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion = 0>
+  class SharedMemoryPool : public PoolObjects<T, SharedMemoryPool<T, SchemaVersion>> {
+  public:
+    static_assert(is_persistable_v<T>,
+                  "A SharedMemoryPool can only hold trivially copyable types without pointers; "
+                  "see is_persistable");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                    std::atomic<uint32_t>::is_always_lock_free,
+                  "A SharedMemoryPool needs lock-free atomics to work across processes");
+
+    // Maps the pool in the shared memory object 'name' (e.g. "/records"), creating it for
+    // 'num_blocks' objects if it does not exist. Throws a std::system_error if the object
+    // cannot be created or mapped and a std::runtime_error if it does not hold a pool of T
+    SharedMemoryPool(const std::string& name, const SizeT& num_blocks);
+
+    // Unmaps the pool. The shared memory object itself stays; see unlink()
+    ~SharedMemoryPool();
+
+    // The pool owns the mapping so it can be neither copied nor moved
+    SharedMemoryPool(const SharedMemoryPool&) = delete;
+    SharedMemoryPool& operator=(const SharedMemoryPool&) = delete;
+
+    // Removes the shared memory object 'name'. Processes that have it mapped can go on using
+    // it; the next pool constructed with that name creates a new one
+    static void unlink(const std::string& name);
+
+    // Returns true if this process created the shared memory object
+    inline bool is_creator() const { return Is_creator; }
+
+    // Returns a pointer to an available block in the memory pool. Throws a std::out_of_range
+    // exception if every block has been allocated
+    T* new_block_pt();
+
+    // "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. Any process
+    // may free a block, not just the one that allocated it. As T is trivially copyable there
+    // is no destructor to run, so destroy() does the same
+    void delete_block_pt(T*& obj_pt);
+
+    // Converts between pointers into this process's mapping and SharedOffsets. An offset
+    // that is not the start of a block throws a std::out_of_range exception
+    SharedOffset<T> offset_of(const T* obj_pt) const;
+    T* from_offset(const SharedOffset<T>& offset) const;
+
+    // The total number of objects this pool can hold
+    inline SizeT size() const { return Num_blocks; }
+
+    // The remaining number of objects this pool can hold. Only a snapshot while other
+    // threads or processes use the pool. Blocks held by crashed processes count as allocated,
+    // and a process that crashed in the middle of a call can leave the count off by one
+    inline SizeT available_capacity() const
+    {
+      return Header->Num_available.load(std::memory_order_relaxed);
+    }
+
+    // The name of the shared memory object
+    inline const std::string& name() const { return Name; }
+
+  private:
+    // Marks the end of the free list
+    static constexpr uint32_t Null_index = std::numeric_limits<uint32_t>::max();
+
+    // The alignment of the blocks
+    static constexpr SizeT Block_alignment = alignof(T);
+
+    // The number of bytes between the start of consecutive blocks
+    static constexpr SizeT Block_size = round_up(sizeof(T), Block_alignment);
+
+    // The offset of the next-free-block array from the start of the shared memory object
+    static constexpr SizeT Links_offset = round_up(sizeof(SharedPoolHeader), g_CacheLineSize);
+
+    // The fingerprint of T stored in the header
+    static constexpr uint64_t Fingerprint = type_fingerprint<T>(SchemaVersion);
+
+    // The offset of the first block for a pool of 'num_blocks' blocks
+    static constexpr SizeT blocks_offset(const SizeT& num_blocks)
+    {
+      return round_up(Links_offset + num_blocks * sizeof(uint32_t),
+                      std::max(Block_alignment, g_CacheLineSize));
+    }
+
+    // Packs a block index and a tag into a free list head, and unpacks them again
+    static constexpr uint64_t make_head(const uint32_t& block_index, const uint64_t& tag)
+    {
+      return (tag << 32) | block_index;
+    }
+    static constexpr uint32_t head_index(const uint64_t& head) { return uint32_t(head); }
+    static constexpr uint64_t head_tag(const uint64_t& head) { return head >> 32; }
+
+    // Creates or maps the shared memory object. Returns false (with nothing mapped) if the
+    // object was abandoned by a creator that died while setting it up, and has been removed
+    bool open(const SizeT& num_blocks);
+
+    // Sets up the header and the free list of a newly created shared memory object
+    void set_up(const SizeT& num_blocks);
+
+    // Waits for the creating process to finish setting up the pool. Returns false if the
+    // creator died first, after removing the object (unless another process got there first)
+    bool wait_for_set_up();
+
+    // Checks that the header describes a pool of T that fits in the shared memory object
+    void check_header(const SizeT& object_size) const;
+
+    // Returns true if obj_pt points to the start of a block in the pool
+    bool is_pool_member(const T* const obj_pt) const;
+
+    // The name of the shared memory object
+    std::string Name;
+
+    // The mapping and its size
+    void* Mapping;
+    SizeT Mapping_size;
+
+    // The header, the next-free-block array and the first block in the mapping
+    SharedPoolHeader* Header;
+    std::atomic<uint32_t>* Links;
+    Byte* Blocks;
+
+    // A copy of the number of blocks, which never changes
+    SizeT Num_blocks;
+
+    // True if this process created the shared memory object
+    bool Is_creator;
+  };
+
+  /****************************************************************************************
+   * @brief Maps the pool in the shared memory object 'name', creating it if it does not
+   *        exist. If the object was abandoned by a creator that died while setting it up,
+   *        it is removed and the pool is created again (this is tried twice).
+   *
+   * @param name: The name of the shared memory object, starting with a '/'.
+   * @param num_blocks: The number of objects a new pool can hold (at most 2^32 - 1).
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  SharedMemoryPool<T, SchemaVersion>::SharedMemoryPool(const std::string& name,
+                                                       const SizeT& num_blocks)
+    : Name(name), Mapping(nullptr), Mapping_size(0), Header(nullptr), Links(nullptr),
+      Blocks(nullptr), Num_blocks(0), Is_creator(true)
+  {
+    if ((num_blocks == 0) || (num_blocks >= Null_index)) {
+      throw std::invalid_argument("A SharedMemoryPool holds between 1 and 2^32 - 2 blocks");
+    }
+    if (!open(num_blocks) && !open(num_blocks)) {
+      throw std::runtime_error(Name + " was abandoned by the processes creating it");
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Creates or maps the shared memory object. Creation uses O_EXCL, so exactly one
+   *        of several processes starting at once creates and sets up the pool; the others
+   *        wait (up to g_SharedPoolSetupTimeout) for it to publish the magic number in the
+   *        header, unless they find that it has died.
+   *
+   * @param num_blocks: The number of objects a new pool can hold.
+   * @return bool: False if the object was abandoned and has been removed, so the caller
+   *               should try again; true once the pool is mapped.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  bool SharedMemoryPool<T, SchemaVersion>::open(const SizeT& num_blocks)
+  {
+    Is_creator = true;
+    int fd = ::shm_open(Name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if ((fd < 0) && (errno == EEXIST)) {
+      Is_creator = false;
+      fd = ::shm_open(Name.c_str(), O_RDWR, 0);
+    }
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "shm_open(" + Name + ")");
+    }
+
+    // Joining processes only map the header until they know the size of the pool
+    Mapping_size = Is_creator ? blocks_offset(num_blocks) + num_blocks * Block_size
+                              : sizeof(SharedPoolHeader);
+    if (Is_creator && (::ftruncate(fd, static_cast<off_t>(Mapping_size)) != 0)) {
+      const int error = errno;
+      ::close(fd);
+      ::shm_unlink(Name.c_str());
+      throw std::system_error(error, std::generic_category(), "ftruncate(" + Name + ")");
+    }
+    struct stat object_stat;
+    if (!Is_creator) {
+      // The creating process may not have sized the object yet
+      const auto deadline = std::chrono::steady_clock::now() + g_SharedPoolSetupTimeout;
+      while ((::fstat(fd, &object_stat) == 0) &&
+             (static_cast<SizeT>(object_stat.st_size) < Mapping_size) &&
+             (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::yield();
+      }
+      if (static_cast<SizeT>(object_stat.st_size) < Mapping_size) {
+        ::close(fd);
+        throw std::runtime_error(Name + " is not a shared memory pool (if its creator died "
+                                        "before sizing it, remove it with unlink())");
+      }
+      Mapping_size = static_cast<SizeT>(object_stat.st_size);
+    }
+    Mapping = ::mmap(nullptr, Mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (Mapping == MAP_FAILED) {
+      if (Is_creator) ::shm_unlink(Name.c_str());
+      throw std::system_error(error, std::generic_category(), "mmap(" + Name + ")");
+    }
+    Header = static_cast<SharedPoolHeader*>(Mapping);
+
+    if (Is_creator) {
+      ::new (static_cast<void*>(&Header->Creator_pid)) std::atomic<int32_t>(::getpid());
+      set_up(num_blocks);
+      return true;
+    }
+    try {
+      if (!wait_for_set_up()) {
+        ::munmap(Mapping, Mapping_size);
+        return false;
+      }
+      check_header(Mapping_size);
+    }
+    catch (...) {
+      ::munmap(Mapping, Mapping_size);
+      throw;
+    }
+    Num_blocks = Header->Num_blocks;
+    Links = reinterpret_cast<std::atomic<uint32_t>*>(static_cast<Byte*>(Mapping) + Links_offset);
+    Blocks = static_cast<Byte*>(Mapping) + Header->Blocks_offset;
+    return true;
+  }
+
+  /****************************************************************************************
+   * @brief Unmaps the pool. The shared memory object and every object in it stay until the
+   *        object is removed with unlink().
+   *
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  SharedMemoryPool<T, SchemaVersion>::~SharedMemoryPool()
+  {
+    ::munmap(Mapping, Mapping_size);
+  }
+
+  /****************************************************************************************
+   * @brief Removes the shared memory object 'name', if it exists.
+   *
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  void SharedMemoryPool<T, SchemaVersion>::unlink(const std::string& name)
+  {
+    ::shm_unlink(name.c_str());
+  }
+
+  /****************************************************************************************
+   * @brief Pops the first block off the free list with a compare-and-swap on the tagged
+   *        head. Throws a std::out_of_range exception if the free list is empty.
+   *
+   * @return T*: A pointer to a new object in the memory pool.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  T* SharedMemoryPool<T, SchemaVersion>::new_block_pt()
+  {
+    uint64_t head = Header->Head.load(std::memory_order_acquire);
+    uint32_t block_index;
+    do {
+      block_index = head_index(head);
+      if (block_index == Null_index) {
+        throw std::out_of_range("No more space available; all " + std::to_string(Num_blocks) +
+                                " blocks allocated!");
+      }
+      // May read a stale link if another thread takes the block first; the tag then makes
+      // the compare-and-swap fail
+      const uint32_t next_index = Links[block_index].load(std::memory_order_relaxed);
+      if (Header->Head.compare_exchange_weak(head, make_head(next_index, head_tag(head) + 1),
+                                             std::memory_order_acquire,
+                                             std::memory_order_acquire)) {
+        break;
+      }
+    } while (true);
+    Header->Num_available.fetch_sub(1, std::memory_order_relaxed);
+    return reinterpret_cast<T*>(Blocks + SizeT(block_index) * Block_size);
+  }
+
+  /****************************************************************************************
+   * @brief Pushes the block onto the front of the free list: links it to the current head,
+   *        then swings the head to it with a compare-and-swap (with release semantics, so the
+   *        next process to allocate the block sees every write made to it before it was
+   *        freed). Nullifies the input pointer.
+   *
+   * @param obj_pt: A reference to the pointer to the underlying block in the memory pool.
+   *                Will be set to 'nullptr' after the underlying data has been deallocated.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  void SharedMemoryPool<T, SchemaVersion>::delete_block_pt(T*& obj_pt)
+  {
+    if (obj_pt == nullptr) {
+      return;
+    }
+    assert(is_pool_member(obj_pt));
+    const auto block_index =
+      static_cast<uint32_t>((reinterpret_cast<Byte*>(obj_pt) - Blocks) / Block_size);
+    uint64_t head = Header->Head.load(std::memory_order_relaxed);
+    do {
+      Links[block_index].store(head_index(head), std::memory_order_relaxed);
+    } while (!Header->Head.compare_exchange_weak(head, make_head(block_index, head_tag(head) + 1),
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+    Header->Num_available.fetch_add(1, std::memory_order_relaxed);
+    obj_pt = nullptr;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the SharedOffset of an object in the pool, or a null offset for nullptr.
+   *
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  SharedOffset<T> SharedMemoryPool<T, SchemaVersion>::offset_of(const T* obj_pt) const
+  {
+    if (obj_pt == nullptr) return SharedOffset<T>();
+    assert(is_pool_member(obj_pt));
+    return SharedOffset<T>{static_cast<uint64_t>(reinterpret_cast<const Byte*>(obj_pt) -
+                                                 static_cast<const Byte*>(Mapping))};
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer (in this process's mapping) to the object at 'offset', or
+   *        nullptr for a null offset. Offsets come from other processes, so they are checked
+   *        in every build: one that is not the start of a block throws a std::out_of_range
+   *        exception.
+   *
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  T* SharedMemoryPool<T, SchemaVersion>::from_offset(const SharedOffset<T>& offset) const
+  {
+    if (!offset) return nullptr;
+    const auto blocks_offset = static_cast<uint64_t>(Blocks - static_cast<Byte*>(Mapping));
+    if ((offset.Value < blocks_offset) ||
+        (offset.Value - blocks_offset >= Num_blocks * Block_size) ||
+        ((offset.Value - blocks_offset) % Block_size != 0)) {
+      throw std::out_of_range("Offset " + std::to_string(offset.Value) +
+                              " is not a block in " + Name);
+    }
+    return reinterpret_cast<T*>(static_cast<Byte*>(Mapping) + offset.Value);
+  }
+
+  /****************************************************************************************
+   * @brief Writes the header of a newly created pool and threads every block onto the free
+   *        list in address order. The magic number is stored last, with release semantics,
+   *        so processes waiting in check_header() see a complete pool.
+   *
+   * @param num_blocks: The number of blocks in the pool.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  void SharedMemoryPool<T, SchemaVersion>::set_up(const SizeT& num_blocks)
+  {
+    Num_blocks = num_blocks;
+    Links = reinterpret_cast<std::atomic<uint32_t>*>(static_cast<Byte*>(Mapping) + Links_offset);
+    Blocks = static_cast<Byte*>(Mapping) + blocks_offset(num_blocks);
+    for (SizeT i = 0; i < num_blocks; i++) {
+      ::new (static_cast<void*>(Links + i))
+        std::atomic<uint32_t>(i + 1 < num_blocks ? uint32_t(i + 1) : Null_index);
+    }
+    Header->Version = g_SharedPoolVersion;
+    Header->Fingerprint = Fingerprint;
+    Header->Links_offset = Links_offset;
+    Header->Blocks_offset = blocks_offset(num_blocks);
+    Header->Block_size = Block_size;
+    Header->Num_blocks = num_blocks;
+    ::new (static_cast<void*>(&Header->Head)) std::atomic<uint64_t>(make_head(0, 0));
+    ::new (static_cast<void*>(&Header->Num_available)) std::atomic<uint64_t>(num_blocks);
+    Header->Magic.store(g_SharedPoolMagic, std::memory_order_release);
+  }
+
+  /****************************************************************************************
+   * @brief Waits (up to g_SharedPoolSetupTimeout) for the magic number to appear in the
+   *        header. While it waits, it checks that the creator recorded in the header is
+   *        still running. If not, the first process to notice swaps its own pid in and
+   *        removes the shared memory object, and every process that noticed starts again.
+   *        A pid that has been reused by another process makes the creator look alive, so
+   *        the wait then times out as before.
+   *
+   * @return bool: False if the creator died before finishing the set-up; true otherwise
+   *               (including on a timeout, which check_header() reports).
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  bool SharedMemoryPool<T, SchemaVersion>::wait_for_set_up()
+  {
+    const auto deadline = std::chrono::steady_clock::now() + g_SharedPoolSetupTimeout;
+    while ((Header->Magic.load(std::memory_order_acquire) != g_SharedPoolMagic) &&
+           (std::chrono::steady_clock::now() < deadline)) {
+      int32_t creator_pid = Header->Creator_pid.load(std::memory_order_relaxed);
+      if ((creator_pid > 0) && (::kill(creator_pid, 0) != 0) && (errno == ESRCH)) {
+        if (Header->Creator_pid.compare_exchange_strong(creator_pid, ::getpid())) {
+          ::shm_unlink(Name.c_str());
+        }
+        return false;
+      }
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  /****************************************************************************************
+   * @brief Checks that the pool holds objects of type T laid out as in this build and fits
+   *        in the shared memory object.
+   *
+   * @param object_size: The size of the shared memory object in bytes.
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  void SharedMemoryPool<T, SchemaVersion>::check_header(const SizeT& object_size) const
+  {
+    const SharedPoolHeader& header = *Header;
+    if ((header.Magic.load(std::memory_order_acquire) != g_SharedPoolMagic) ||
+        (header.Version != g_SharedPoolVersion)) {
+      throw std::runtime_error(Name + " is not a shared memory pool (or a different version)");
+    }
+    if ((header.Fingerprint != Fingerprint) || (header.Block_size != Block_size) ||
+        (header.Links_offset != Links_offset)) {
+      throw std::runtime_error(Name + " holds objects of a different type than " +
+                               std::string(type_name<T>()) + " (or another schema version)");
+    }
+    if ((header.Num_blocks == 0) || (header.Num_blocks >= Null_index) ||
+        (header.Blocks_offset != blocks_offset(header.Num_blocks)) ||
+        (header.Blocks_offset + header.Num_blocks * Block_size > object_size)) {
+      throw std::runtime_error(Name + " is truncated or corrupt");
+    }
+  }
+
+  /****************************************************************************************
+   * @brief Returns true if 'obj_pt' points to the start of a block in the pool. Returns
+   *        false otherwise.
+   *
+   ****************************************************************************************/
+  template<class T, uint64_t SchemaVersion>
+  bool SharedMemoryPool<T, SchemaVersion>::is_pool_member(const T* const obj_pt) const
+  {
+    const std::less<const Byte*> less;
+    auto byte_pt = reinterpret_cast<const Byte*>(obj_pt);
+    if (less(byte_pt, Blocks) || !less(byte_pt, Blocks + Num_blocks * Block_size)) return false;
+    return (byte_pt - Blocks) % Block_size == 0;
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_SHARED_MEMORY_POOL_HEADER
@@ -0,0 +1,250 @@
+#ifndef MEMORY_POOL_SIZE_CLASS_ALLOCATOR_HEADER
+#define MEMORY_POOL_SIZE_CLASS_ALLOCATOR_HEADER
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <tuple>
+#include <utility>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  // The number of bytes in the first segment of each size class's pool if none is given
+  constexpr SizeT g_DefaultSlabBytes = SizeT(64) << 10;
+
+  /****************************************************************************************
+   * @brief Serves variable-sized requests for memory from a set of fixed-size slab pools,
+   *        one per size class. A request is rounded up to the smallest size class that
+   *        holds it and served by that class's (growable) MemoryPool; requests larger than
+   *        'MaxSize' go to the global operator new. For example
+   *
+   *          SizeClassAllocator<4096> allocator;
+   *          void* pt = allocator.allocate(300);  // from the 320-byte class
+   *          allocator.deallocate(pt, 300);
+   *
+   *        The size classes are multiples of 16 bytes up to 64 bytes, then four classes per
+   *        power of two (quarter steps): 80, 96, 112, 128, 160, 192, 224, 256, 320, ...
+   *        Rounding up wastes at most a quarter of a block above 64 bytes. The class of a
+   *        request is computed from the position of its highest set bit and the next two
+   *        bits, and the class's pool is reached through a table indexed by the class, so
+   *        both allocate() and deallocate() take O(1) time whatever the number of classes.
+   *
+   *        Every block is aligned to alignof(std::max_align_t), as with malloc(). Each pool
+   *        starts with a segment of about 'slab_bytes' bytes (at least one block) and
+   *        doubles in size whenever it runs out of space.
+   *
+   *        NOTE: Like MemoryPool, the allocator is not thread-safe. deallocate() must be
+   *        passed the same size as the matching allocate() so it finds the same class.
+   *
+   * @tparam MaxSize: The largest request served by the slab pools, in bytes.
+   ****************************************************************************************/
+  template<SizeT MaxSize = 4096>
+  class SizeClassAllocator {
+  public:
+    static_assert(MaxSize > 0, "There must be at least one size class");
+
+    // The alignment of every block handed out by the slab pools
+    static constexpr SizeT Alignment = alignof(std::max_align_t);
+
+    // Returns the index of the smallest size class holding 'bytes' bytes
+    static constexpr SizeT class_index(const SizeT& bytes);
+
+    // Returns the block size of size class 'index'
+    static constexpr SizeT class_size(const SizeT& index);
+
+    // The number of size classes; the largest holds (at least) 'MaxSize' bytes
+    static constexpr SizeT num_classes() { return class_index(MaxSize) + 1; }
+
+    // Creates the slab pools. Each starts with a segment of about 'slab_bytes' bytes
+    explicit SizeClassAllocator(const SizeT& slab_bytes = g_DefaultSlabBytes)
+      : SizeClassAllocator(slab_bytes, std::make_index_sequence<num_classes()>())
+    {
+    }
+
+    // The allocator owns its pools so it cannot be copied
+    SizeClassAllocator(const SizeClassAllocator&) = delete;
+    SizeClassAllocator& operator=(const SizeClassAllocator&) = delete;
+
+    // Returns a pointer to (uninitialised) memory for 'bytes' bytes
+    void* allocate(const SizeT& bytes);
+
+    // Returns the memory pointed to by 'pt', which was allocated with allocate(bytes)
+    void deallocate(void* pt, const SizeT& bytes);
+
+    // The slab pool used for size class 'Index'
+    template<SizeT Index>
+    inline const auto& pool() const { return std::get<Index>(Pools); }
+
+  private:
+    // The blocks of size class 'Index'
+    template<SizeT Index>
+    using Block = RawBlock<class_size(Index), Alignment>;
+
+    // The type of a tuple with a pool for each of the size classes 'Indices'
+    template<SizeT... Indices>
+    static std::tuple<MemoryPool<Block<Indices>>...> pool_tuple(
+      std::integer_sequence<SizeT, Indices...>);
+
+    using PoolTuple = decltype(pool_tuple(std::make_integer_sequence<SizeT, num_classes()>()));
+
+    template<std::size_t... Indices>
+    SizeClassAllocator(const SizeT& slab_bytes, std::index_sequence<Indices...>);
+
+    // Allocate/deallocate a block of size class 'Index'
+    template<SizeT Index>
+    void* allocate_from();
+    template<SizeT Index>
+    void deallocate_to(void* pt);
+
+    // Allocate/deallocate a block of size class 'index', looked up in a table of the
+    // functions above
+    template<std::size_t... Indices>
+    void* allocate_from(const SizeT& index, std::index_sequence<Indices...>);
+    template<std::size_t... Indices>
+    void deallocate_to(void* pt, const SizeT& index, std::index_sequence<Indices...>);
+
+    // One pool per size class, smallest first
+    PoolTuple Pools;
+  };
+
+  /****************************************************************************************
+   * @brief Returns the index of the smallest size class holding 'bytes' bytes. Classes 0
+   *        to 3 are 16, 32, 48 and 64 bytes; above that each power of two 2^k (k >= 6) is
+   *        followed by the four classes 2^k + i * 2^(k - 2), i = 1, ..., 4.
+   *
+   * @param bytes: The size of the request; must be at most 'MaxSize'. 0 is treated as 1.
+   ****************************************************************************************/
+  template<SizeT MaxSize>
+  constexpr SizeT SizeClassAllocator<MaxSize>::class_index(const SizeT& bytes)
+  {
+    if (bytes <= 64) {
+      return (std::max<SizeT>(bytes, 1) - 1) / 16;
+    }
+    const SizeT log = floor_log2(bytes - 1);
+    const SizeT step_log = log - 2;
+    return 4 * (log - 5) + ((bytes - 1 - (SizeT(1) << log)) >> step_log);
+  }
+
+  /****************************************************************************************
+   * @brief Returns the block size of size class 'index'; the inverse of class_index().
+   *
+   ****************************************************************************************/
+  template<SizeT MaxSize>
+  constexpr SizeT SizeClassAllocator<MaxSize>::class_size(const SizeT& index)
+  {
+    if (index < 4) {
+      return 16 * (index + 1);
+    }
+    const SizeT log = 6 + (index - 4) / 4;
+    return (SizeT(1) << log) + ((index - 4) % 4 + 1) * (SizeT(1) << (log - 2));
+  }
+
+  /****************************************************************************************
+   * @brief Creates a growable pool for each size class, holding about 'slab_bytes' bytes
+   *        (but at least one block) in its first segment.
+   *
+   ****************************************************************************************/
+  template<SizeT MaxSize>
+  template<std::size_t... Indices>
+  SizeClassAllocator<MaxSize>::SizeClassAllocator(const SizeT& slab_bytes,
+                                                  std::index_sequence<Indices...>)
+    : Pools(std::max<SizeT>(slab_bytes / class_size(Indices), 1)...)
+  {
+    (std::get<Indices>(Pools).set_growth_factor(2), ...);
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to (uninitialised) memory for 'bytes' bytes, aligned to
+   *        alignof(std::max_align_t). Requests of at most 'MaxSize' bytes are served by the
+   *        pool of their size class, larger ones by the global operator new.
+   *
+   * @param bytes: The number of bytes needed.
+   * @return void*: A pointer to the memory.
+   ****************************************************************************************/
+  template<SizeT MaxSize>
+  void* SizeClassAllocator<MaxSize>::allocate(const SizeT& bytes)
+  {
+    if (bytes > MaxSize) {
+      return ::operator new(bytes);
+    }
+    return allocate_from(class_index(bytes), std::make_index_sequence<num_classes()>());
+  }
+
+  /****************************************************************************************
+   * @brief Returns the memory pointed to by 'pt' to the pool of its size class, or to the
+   *        global operator delete if it was too large for the pools.
+   *
+   * @param pt: A pointer returned by allocate(bytes). Null pointers are ignored.
+   * @param bytes: The number of bytes passed to allocate().
+   ****************************************************************************************/
+  template<SizeT MaxSize>
+  void SizeClassAllocator<MaxSize>::deallocate(void* pt, const SizeT& bytes)
+  {
+    if (pt == nullptr) {
+      return;
+    }
+    if (bytes > MaxSize) {
+      ::operator delete(pt, bytes);
+      return;
+    }
+    deallocate_to(pt, class_index(bytes), std::make_index_sequence<num_classes()>());
+  }
+
+  /****************************************************************************************
+   * @brief Allocates a block from the pool of size class 'Index'.
+   *
+   ****************************************************************************************/
+  template<SizeT MaxSize>
+  template<SizeT Index>
+  void* SizeClassAllocator<MaxSize>::allocate_from()
+  {
+    return std::get<Index>(Pools).new_block_pt();
+  }
+
+  /****************************************************************************************
+   * @brief Returns a block to the pool of size class 'Index'.
+   *
+   ****************************************************************************************/
+  template<SizeT MaxSize>
+  template<SizeT Index>
+  void SizeClassAllocator<MaxSize>::deallocate_to(void* pt)
+  {
+    auto block_pt = static_cast<Block<Index>*>(pt);
+    std::get<Index>(Pools).delete_block_pt(block_pt);
+  }
+
+  /****************************************************************************************
+   * @brief Allocates a block from the pool of size class 'index', calling the right
+   *        allocate_from<Index>() through a table so the cost does not depend on the
+   *        number of classes.
+   *
+   ****************************************************************************************/
+  template<SizeT MaxSize>
+  template<std::size_t... Indices>
+  void* SizeClassAllocator<MaxSize>::allocate_from(const SizeT& index,
+                                                   std::index_sequence<Indices...>)
+  {
+    using AllocateFunction = void* (SizeClassAllocator::*)();
+    static constexpr AllocateFunction allocate_functions[] = {
+      &SizeClassAllocator::allocate_from<Indices>...};
+    return (this->*allocate_functions[index])();
+  }
+
+  /****************************************************************************************
+   * @brief Returns a block to the pool of size class 'index' through a table, as above.
+   *
+   ****************************************************************************************/
+  template<SizeT MaxSize>
+  template<std::size_t... Indices>
+  void SizeClassAllocator<MaxSize>::deallocate_to(void* pt,
+                                                  const SizeT& index,
+                                                  std::index_sequence<Indices...>)
+  {
+    using DeallocateFunction = void (SizeClassAllocator::*)(void*);
+    static constexpr DeallocateFunction deallocate_functions[] = {
+      &SizeClassAllocator::deallocate_to<Indices>...};
+    (this->*deallocate_functions[index])(pt);
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_SIZE_CLASS_ALLOCATOR_HEADER
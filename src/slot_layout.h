@@ -0,0 +1,78 @@
+#ifndef MEMORY_POOL_SLOT_LAYOUT_HEADER
+#define MEMORY_POOL_SLOT_LAYOUT_HEADER
+
+#include <algorithm>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief A slot layout that gives every block its own cache line(s): the stride is
+   *        rounded up to a whole number of cache lines and blocks start on a cache line
+   *        boundary. Objects used by different threads then never share a cache line
+   *        (no false sharing) and no object straddles more lines than it has to, at the
+   *        cost of the padding. For example, a 12-byte Point takes up 64 bytes.
+   *
+   ****************************************************************************************/
+  class CacheLineLayout {
+  public:
+    static constexpr SizeT stride(const SizeT& size, const SizeT& alignment)
+    {
+      return round_up(size, CacheLineLayout::alignment(size, alignment));
+    }
+    static constexpr SizeT alignment(const SizeT& /* size */, const SizeT& alignment)
+    {
+      return std::max(alignment, g_CacheLineSize);
+    }
+    static constexpr SizeT num_colours() { return 1; }
+  };
+
+  /****************************************************************************************
+   * @brief A slot layout that rounds the stride up to a power of two. Blocks are aligned to
+   *        their stride (up to a cache line), so a block no larger than a cache line never
+   *        straddles two lines while small blocks still share lines. Wastes less memory
+   *        than CacheLineLayout for small objects; e.g. a 12-byte Point takes up 16 bytes.
+   *
+   ****************************************************************************************/
+  class PowerOfTwoLayout {
+  public:
+    static constexpr SizeT stride(const SizeT& size, const SizeT& alignment)
+    {
+      SizeT stride = alignment;
+      while (stride < size) stride *= 2;
+      return stride;
+    }
+    static constexpr SizeT alignment(const SizeT& size, const SizeT& alignment)
+    {
+      return std::max(alignment, std::min(stride(size, alignment), g_CacheLineSize));
+    }
+    static constexpr SizeT num_colours() { return 1; }
+  };
+
+  /****************************************************************************************
+   * @brief Adds cache colouring to another slot layout. Each new segment (of any pool using
+   *        the layout) starts a different number of cache lines, cycling through
+   *        'NumColours', into its memory. Segments that would otherwise all start at the
+   *        same offset within a page (and so compete for the same cache sets) are spread
+   *        across the cache instead. Costs up to 'NumColours - 1' cache lines per segment.
+   *
+   * @tparam BaseLayout: The layout that decides the stride and alignment of the blocks.
+   * @tparam NumColours: The number of different start offsets to cycle through.
+   ****************************************************************************************/
+  template<class BaseLayout = NaturalLayout, SizeT NumColours = 8>
+  class ColouredLayout {
+  public:
+    static_assert(NumColours > 0, "There must be at least one colour");
+
+    static constexpr SizeT stride(const SizeT& size, const SizeT& alignment)
+    {
+      return BaseLayout::stride(size, alignment);
+    }
+    static constexpr SizeT alignment(const SizeT& size, const SizeT& alignment)
+    {
+      return BaseLayout::alignment(size, alignment);
+    }
+    static constexpr SizeT num_colours() { return NumColours; }
+  };
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_SLOT_LAYOUT_HEADER
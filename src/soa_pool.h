@@ -0,0 +1,586 @@
+#ifndef MEMORY_POOL_SOA_POOL_HEADER
+#define MEMORY_POOL_SOA_POOL_HEADER
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief A contiguous run of 'size()' values of type T, e.g. a column of a SoaPool. Can be
+   *        used in a range-for loop or indexed directly.
+   *
+   ****************************************************************************************/
+  template<class T>
+  class ColumnSpan {
+  public:
+    constexpr ColumnSpan(T* data_pt, const SizeT& size) : Data_pt(data_pt), Size(size) {}
+
+    constexpr T* data() const { return Data_pt; }
+    constexpr SizeT size() const { return Size; }
+    constexpr bool empty() const { return Size == 0; }
+    constexpr T* begin() const { return Data_pt; }
+    constexpr T* end() const { return Data_pt + Size; }
+    constexpr T& operator[](const SizeT& index) const { return Data_pt[index]; }
+
+  private:
+    T* Data_pt;
+    SizeT Size;
+  };
+
+  /****************************************************************************************
+   * @brief A struct-of-arrays pool: instead of storing whole objects next to each other, as
+   *        MemoryPool does, it keeps one contiguous column per field. A loop that reads one
+   *        field of every object then reads only that field's column, using every byte of
+   *        every cache line it loads, and compilers can vectorise it:
+   *
+   *          SoaPool<float, float, float> particles(1 << 16);
+   *          auto handle = particles.new_slot(1.f, 2.f, 3.f);
+   *          float sum = 0;
+   *          for (const float& x : particles.column<0>()) sum += x;
+   *
+   *        The columns are kept dense: the live objects are always the first size()
+   *        entries of every column, so a column can be traversed without checking which
+   *        entries are live. Freeing a slot moves the last object into the hole, so objects
+   *        are referred to with handles (see Handle), which stay valid while their object
+   *        moves, rather than with positions or pointers. get() and ref() look a handle up
+   *        in O(1) time.
+   *
+   *        The columns share one allocation and each starts on a cache line. Growing the
+   *        pool (see set_growth_factor()) reallocates the columns, which invalidates spans
+   *        and pointers into them, but not handles. A fixed-size pool throws a
+   *        std::out_of_range exception once it is full.
+   *
+   *        To use a struct's member names instead of column numbers, describe the struct
+   *        with SoaFields and use StructSoaPool.
+   *
+   *        NOTE: Like MemoryPool, the pool is not thread-safe.
+   *
+   * @tparam Fields: The type of each column. Fields are copied with memcpy when objects
+   *                 move, so they must be trivially copyable.
+   ****************************************************************************************/
+  template<class... Fields>
+  class SoaPool {
+  public:
+    static_assert(sizeof...(Fields) > 0, "A SoaPool needs at least one field");
+    static_assert((std::is_trivially_copyable_v<Fields> && ...),
+                  "SoaPool fields are moved with memcpy so must be trivially copyable");
+
+    // The number of fields (columns)
+    static constexpr SizeT num_fields() { return sizeof...(Fields); }
+
+    // The type of field 'I'
+    template<SizeT I>
+    using FieldT = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    // Handles to the objects in the pool; 8 bytes, so the pool can hold up to 2^32 - 1
+    // objects
+    using HandleT = Handle<SoaPool, uint64_t>;
+
+    // A reference to one object in the pool, from which each field can be read or written
+    class Ref {
+    public:
+      Ref(SoaPool& pool, const SizeT& index) : Pool(pool), Index(index) {}
+
+      // Field 'I' of the object
+      template<SizeT I>
+      FieldT<I>& get() const
+      {
+        return Pool.template column<I>()[Index];
+      }
+
+      // The position of the object in the columns
+      inline SizeT index() const { return Index; }
+
+    private:
+      SoaPool& Pool;
+      const SizeT Index;
+    };
+
+    // Creates a pool with room for 'num_slots' objects. A 'growth_factor' of 0 makes the pool
+    // fixed-size (see set_growth_factor())
+    explicit SoaPool(const SizeT& num_slots = g_DefaultNumberOfObjectsInPool,
+                     const SizeT& growth_factor = 0);
+
+    ~SoaPool();
+
+    // The columns belong to the pool so it cannot be copied
+    SoaPool(const SoaPool&) = delete;
+    SoaPool& operator=(const SoaPool&) = delete;
+
+    // Adds an object to the end of the columns, with its fields set to 'values' (or
+    // value-initialised if none are given), and returns a handle to it
+    HandleT new_slot();
+    HandleT new_slot(const Fields&... values);
+
+    // Frees the object 'handle' refers to, moving the last object in the columns into its
+    // place, and nullifies the handle. Every other copy of the handle becomes stale. Does
+    // nothing if the handle is null or stale
+    void delete_slot(HandleT& handle);
+
+    // Frees every object in O(size()) time (to retire their handles); every handle becomes
+    // stale
+    void reset();
+
+    // Returns true if 'handle' refers to an object in the pool
+    bool contains(const HandleT& handle) const;
+
+    // The position of the object 'handle' refers to in the columns. The handle must not be
+    // null or stale
+    SizeT index_of(const HandleT& handle) const;
+
+    // Field 'I' of the object 'handle' refers to. The handle must not be null or stale
+    template<SizeT I>
+    FieldT<I>& get(const HandleT& handle)
+    {
+      return std::get<I>(Columns)[index_of(handle)];
+    }
+    template<SizeT I>
+    const FieldT<I>& get(const HandleT& handle) const
+    {
+      return std::get<I>(Columns)[index_of(handle)];
+    }
+
+    // A reference to the object 'handle' refers to. The handle must not be null or stale
+    Ref ref(const HandleT& handle) { return Ref(*this, index_of(handle)); }
+
+    // The column of field 'I': the field of every object in the pool, in column order. Only
+    // valid until the pool grows
+    template<SizeT I>
+    ColumnSpan<FieldT<I>> column()
+    {
+      return ColumnSpan<FieldT<I>>(std::get<I>(Columns), Size);
+    }
+    template<SizeT I>
+    ColumnSpan<const FieldT<I>> column() const
+    {
+      return ColumnSpan<const FieldT<I>>(std::get<I>(Columns), Size);
+    }
+
+    // Makes the pool growable: when the pool is full, every column is reallocated with
+    // 'growth_factor' times the capacity. A growth factor of 0 makes the pool fixed-size
+    void set_growth_factor(const SizeT& growth_factor) { Growth_factor = growth_factor; }
+
+    // Returns true if the pool grows when it is full
+    inline bool is_growable() const { return Growth_factor > 0; }
+
+    // The number of objects in the pool
+    inline SizeT size() const { return Size; }
+
+    // The number of objects the pool can hold before it grows
+    inline SizeT capacity() const { return Capacity; }
+
+  private:
+    // The alignment of the columns
+    static constexpr SizeT Column_alignment = g_CacheLineSize;
+
+    // An entry in the handle table: the position of the object a handle refers to (or the
+    // next free entry, while the entry is free) and the generation of the entry
+    struct HandleEntry {
+      uint32_t Index;
+      uint32_t Generation;
+    };
+
+    // Marks the end of the list of free handle table entries
+    static constexpr uint32_t Null_handle_entry = std::numeric_limits<uint32_t>::max();
+
+    // The offset of column 'I' from the start of the columns' memory, or the size of that
+    // memory if I is the number of fields, when the columns hold 'capacity' objects
+    template<SizeT I>
+    static SizeT column_offset(const SizeT& capacity)
+    {
+      if constexpr (I == 0) {
+        return 0;
+      }
+      else {
+        const SizeT column_bytes = capacity * sizeof(FieldT<I - 1>);
+        return round_up(column_offset<I - 1>(capacity) + column_bytes, Column_alignment);
+      }
+    }
+
+    // Allocates the columns for 'capacity' objects and moves the objects in the pool into
+    // them
+    template<SizeT... I>
+    void reallocate(const SizeT& capacity, std::index_sequence<I...>);
+
+    // Makes room for one more object, growing the pool if it is growable and throwing
+    // otherwise, and returns a handle to position Size
+    HandleT add_slot();
+
+    // Sets the fields of the object at position 'index'
+    template<SizeT... I>
+    void set_fields(const SizeT& index, const Fields&... values, std::index_sequence<I...>);
+
+    // Copies the fields of the object at position 'from' to position 'to'
+    template<SizeT... I>
+    void copy_fields(const SizeT& from, const SizeT& to, std::index_sequence<I...>);
+
+    // The memory of the columns, and the columns within it
+    Byte* Columns_pt;
+    std::tuple<Fields*...> Columns;
+
+    // The number of objects in the pool and the number of objects the columns can hold
+    SizeT Size;
+    SizeT Capacity;
+
+    // How much larger each reallocation is than the previous capacity; 0 if fixed-size
+    SizeT Growth_factor;
+
+    // The objects handles refer to; handles hold an index into the table
+    std::vector<HandleEntry> Handle_entries;
+
+    // The index of the handle table entry referring to the object at each position
+    std::vector<uint32_t> Entry_indices;
+
+    // The index of the first free entry in the handle table
+    uint32_t Free_handle_entry = Null_handle_entry;
+  };
+
+  /****************************************************************************************
+   * @brief Describes a struct to StructSoaPool as a list of pointers to its data members,
+   *        one column per member. Specialise it for each struct, e.g.
+   *
+   *          template<>
+   *          struct memory_pool::SoaFields<Point> {
+   *            static constexpr auto Members = std::make_tuple(&Point::x, &Point::y, &Point::z);
+   *          };
+   *
+   * @tparam T: The struct to describe.
+   ****************************************************************************************/
+  template<class T>
+  struct SoaFields;
+
+  // The type of the data member a pointer to a member of a class points to
+  template<class MemberPointer>
+  struct member_type;
+  template<class Class, class Member>
+  struct member_type<Member Class::*> {
+    using type = Member;
+  };
+
+  // The SoaPool with a column for each member of T listed in SoaFields<T>
+  template<class T, class Members = std::remove_const_t<decltype(SoaFields<T>::Members)>>
+  struct struct_soa_pool;
+  template<class T, class... MemberPointers>
+  struct struct_soa_pool<T, std::tuple<MemberPointers...>> {
+    using type = SoaPool<typename member_type<MemberPointers>::type...>;
+  };
+
+  /****************************************************************************************
+   * @brief A SoaPool for the members of struct T listed in SoaFields<T>. Objects are added
+   *        and read back whole, and columns are chosen by member:
+   *
+   *          StructSoaPool<Point> points(1000);
+   *          auto handle = points.insert(Point{1, 2, 3});
+   *          for (int& x : points.column<&Point::x>()) x++;
+   *          Point point = points.load(handle);
+   *
+   *        Members not listed in SoaFields<T> are not stored.
+   *
+   * @tparam T: The struct whose members are stored.
+   ****************************************************************************************/
+  template<class T>
+  class StructSoaPool : public struct_soa_pool<T>::type {
+  public:
+    using Base = typename struct_soa_pool<T>::type;
+    using typename Base::HandleT;
+
+    using Base::Base;
+
+    // Adds a copy of the listed members of 'obj' and returns a handle to it
+    HandleT insert(const T& obj) { return insert(obj, member_indices()); }
+
+    // Returns an object with the listed members read from the pool (and the rest
+    // value-initialised)
+    T load(const HandleT& handle) const { return load(handle, member_indices()); }
+
+    // Writes the listed members of 'obj' over those of the object 'handle' refers to
+    void store(const HandleT& handle, const T& obj) { store(handle, obj, member_indices()); }
+
+    // The column of 'Member' (e.g. &Point::x), which must be listed in SoaFields<T>. Hides
+    // the columns by number
+    template<auto Member>
+    auto column()
+    {
+      return Base::template column<member_index<Member>()>();
+    }
+    template<auto Member>
+    auto column() const
+    {
+      return Base::template column<member_index<Member>()>();
+    }
+
+  private:
+    static constexpr auto member_indices()
+    {
+      return std::make_index_sequence<std::tuple_size_v<decltype(SoaFields<T>::Members)>>();
+    }
+
+    // The index of 'Member' in SoaFields<T>::Members
+    template<auto Member, SizeT I = 0>
+    static constexpr SizeT member_index()
+    {
+      static_assert(I < Base::num_fields(), "The member is not listed in SoaFields");
+      constexpr auto listed = std::get<I>(SoaFields<T>::Members);
+      if constexpr (std::is_same_v<std::remove_const_t<decltype(listed)>, decltype(Member)>) {
+        if constexpr (listed == Member) return I;
+        else return member_index<Member, I + 1>();
+      }
+      else {
+        return member_index<Member, I + 1>();
+      }
+    }
+
+    template<SizeT... I>
+    HandleT insert(const T& obj, std::index_sequence<I...>)
+    {
+      return Base::new_slot(obj.*std::get<I>(SoaFields<T>::Members)...);
+    }
+
+    template<SizeT... I>
+    T load(const HandleT& handle, std::index_sequence<I...>) const
+    {
+      T obj{};
+      const SizeT index = Base::index_of(handle);
+      ((obj.*std::get<I>(SoaFields<T>::Members) = Base::template column<I>()[index]), ...);
+      return obj;
+    }
+
+    template<SizeT... I>
+    void store(const HandleT& handle, const T& obj, std::index_sequence<I...>)
+    {
+      const SizeT index = Base::index_of(handle);
+      ((Base::template column<I>()[index] = obj.*std::get<I>(SoaFields<T>::Members)), ...);
+    }
+  };
+
+  /****************************************************************************************
+   * @brief Creates a pool with room for 'num_slots' objects.
+   *
+   * @param num_slots: The number of objects the pool can hold before it grows.
+   * @param growth_factor: How much larger each reallocation is than the previous capacity;
+   *                       0 makes the pool fixed-size.
+   ****************************************************************************************/
+  template<class... Fields>
+  SoaPool<Fields...>::SoaPool(const SizeT& num_slots, const SizeT& growth_factor)
+    : Columns_pt(nullptr), Size(0), Capacity(0), Growth_factor(growth_factor)
+  {
+    if (num_slots == 0) {
+      throw std::invalid_argument("A SoaPool must be able to hold at least one object");
+    }
+    reallocate(num_slots, std::index_sequence_for<Fields...>());
+  }
+
+  /****************************************************************************************
+   * @brief Frees the columns.
+   *
+   ****************************************************************************************/
+  template<class... Fields>
+  SoaPool<Fields...>::~SoaPool()
+  {
+    HeapStorage::deallocate(
+      Columns_pt, column_offset<sizeof...(Fields)>(Capacity), Column_alignment);
+  }
+
+  /****************************************************************************************
+   * @brief Adds an object with value-initialised fields to the end of the columns.
+   *
+   * @return HandleT: A handle to the new object.
+   ****************************************************************************************/
+  template<class... Fields>
+  typename SoaPool<Fields...>::HandleT SoaPool<Fields...>::new_slot()
+  {
+    return new_slot(Fields{}...);
+  }
+
+  /****************************************************************************************
+   * @brief Adds an object to the end of the columns.
+   *
+   * @param values: The value of each field of the new object.
+   * @return HandleT: A handle to the new object.
+   ****************************************************************************************/
+  template<class... Fields>
+  typename SoaPool<Fields...>::HandleT SoaPool<Fields...>::new_slot(const Fields&... values)
+  {
+    const HandleT handle = add_slot();
+    set_fields(Size, values..., std::index_sequence_for<Fields...>());
+    Size++;
+    return handle;
+  }
+
+  /****************************************************************************************
+   * @brief Frees an object by moving the last object in the columns into its place, so the
+   *        columns stay dense.
+   *
+   * @param handle: A handle to the object to free; nullified.
+   ****************************************************************************************/
+  template<class... Fields>
+  void SoaPool<Fields...>::delete_slot(HandleT& handle)
+  {
+    if (!contains(handle)) return;
+    HandleEntry& entry = Handle_entries[handle.index()];
+    const SizeT index = entry.Index;
+    const SizeT last = Size - 1;
+    if (index != last) {
+      copy_fields(last, index, std::index_sequence_for<Fields...>());
+      Entry_indices[index] = Entry_indices[last];
+      Handle_entries[Entry_indices[index]].Index = static_cast<uint32_t>(index);
+    }
+    Size--;
+    entry.Index = Free_handle_entry;
+    entry.Generation++;
+    Free_handle_entry = static_cast<uint32_t>(handle.index());
+    handle = HandleT();
+  }
+
+  /****************************************************************************************
+   * @brief Frees every object; every handle becomes stale.
+   *
+   ****************************************************************************************/
+  template<class... Fields>
+  void SoaPool<Fields...>::reset()
+  {
+    // The entries of the live objects are the only ones not in the free list
+    for (SizeT index = 0; index < Size; index++) {
+      HandleEntry& entry = Handle_entries[Entry_indices[index]];
+      entry.Index = Free_handle_entry;
+      entry.Generation++;
+      Free_handle_entry = Entry_indices[index];
+    }
+    Size = 0;
+  }
+
+  /****************************************************************************************
+   * @brief Returns true if 'handle' refers to an object in the pool.
+   *
+   ****************************************************************************************/
+  template<class... Fields>
+  bool SoaPool<Fields...>::contains(const HandleT& handle) const
+  {
+    if (handle.is_null() || (handle.index() >= Handle_entries.size())) return false;
+    const HandleEntry& entry = Handle_entries[handle.index()];
+    return ((entry.Generation & HandleT::Generation_mask) == handle.generation()) &&
+           (entry.Index < Size) && (Entry_indices[entry.Index] == handle.index());
+  }
+
+  /****************************************************************************************
+   * @brief Returns the position of the object 'handle' refers to in the columns.
+   *
+   ****************************************************************************************/
+  template<class... Fields>
+  SizeT SoaPool<Fields...>::index_of(const HandleT& handle) const
+  {
+    assert(contains(handle));
+    return Handle_entries[handle.index()].Index;
+  }
+
+  /****************************************************************************************
+   * @brief Allocates new columns and moves the objects into them. Everything that can throw
+   *        (the columns and the entry index table) is allocated before anything is changed,
+   *        so the pool is left as it was if an allocation fails.
+   *
+   * @param capacity: The number of objects the new columns hold.
+   ****************************************************************************************/
+  template<class... Fields>
+  template<SizeT... I>
+  void SoaPool<Fields...>::reallocate(const SizeT& capacity, std::index_sequence<I...>)
+  {
+    Byte* columns_pt =
+      HeapStorage::allocate(column_offset<sizeof...(Fields)>(capacity), Column_alignment);
+    try {
+      Entry_indices.resize(capacity);
+    }
+    catch (...) {
+      HeapStorage::deallocate(
+        columns_pt, column_offset<sizeof...(Fields)>(capacity), Column_alignment);
+      throw;
+    }
+    std::tuple<Fields*...> columns(
+      reinterpret_cast<Fields*>(columns_pt + column_offset<I>(capacity))...);
+    if (Size > 0) {
+      (std::memcpy(std::get<I>(columns), std::get<I>(Columns), Size * sizeof(Fields)), ...);
+    }
+    if (Columns_pt != nullptr) {
+      HeapStorage::deallocate(
+        Columns_pt, column_offset<sizeof...(Fields)>(Capacity), Column_alignment);
+    }
+    Columns_pt = columns_pt;
+    Columns = columns;
+    Capacity = capacity;
+  }
+
+  /****************************************************************************************
+   * @brief Makes room for an object at position Size and gives it a handle table entry.
+   *        Grows the pool if it is full and growable, and throws a std::out_of_range
+   *        exception if it is full and fixed-size.
+   *
+   * @return HandleT: A handle to the object at position Size.
+   ****************************************************************************************/
+  template<class... Fields>
+  typename SoaPool<Fields...>::HandleT SoaPool<Fields...>::add_slot()
+  {
+    if (Size == Capacity) {
+      if (!is_growable()) {
+        throw std::out_of_range("The SoaPool is full; it holds " + std::to_string(Capacity) +
+                                " objects");
+      }
+      reallocate(std::max(Capacity * Growth_factor, Capacity + 1),
+                 std::index_sequence_for<Fields...>());
+    }
+    uint32_t entry_index = Free_handle_entry;
+    if (entry_index == Null_handle_entry) {
+      if (Handle_entries.size() > HandleT::Max_index) {
+        throw std::length_error("A SoaPool can hold at most " +
+                                std::to_string(HandleT::Max_index + 1) + " objects");
+      }
+      entry_index = static_cast<uint32_t>(Handle_entries.size());
+      Handle_entries.push_back({0, 0});
+    }
+    else {
+      Free_handle_entry = Handle_entries[entry_index].Index;
+    }
+    HandleEntry& entry = Handle_entries[entry_index];
+    entry.Index = static_cast<uint32_t>(Size);
+    Entry_indices[Size] = entry_index;
+    return HandleT(entry_index, entry.Generation);
+  }
+
+  /****************************************************************************************
+   * @brief Sets every field of the object at position 'index'.
+   *
+   ****************************************************************************************/
+  template<class... Fields>
+  template<SizeT... I>
+  void SoaPool<Fields...>::set_fields(const SizeT& index,
+                                      const Fields&... values,
+                                      std::index_sequence<I...>)
+  {
+    ((new (std::get<I>(Columns) + index) Fields(values)), ...);
+  }
+
+  /****************************************************************************************
+   * @brief Copies every field of the object at position 'from' to position 'to'.
+   *
+   ****************************************************************************************/
+  template<class... Fields>
+  template<SizeT... I>
+  void SoaPool<Fields...>::copy_fields(const SizeT& from,
+                                       const SizeT& to,
+                                       std::index_sequence<I...>)
+  {
+    ((std::get<I>(Columns)[to] = std::get<I>(Columns)[from]), ...);
+  }
+
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_SOA_POOL_HEADER
@@ -0,0 +1,209 @@
+#ifndef MEMORY_POOL_STATIC_MEMORY_POOL_HEADER
+#define MEMORY_POOL_STATIC_MEMORY_POOL_HEADER
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief The narrowest unsigned integer type that can index 'N' blocks and still has a
+   *        value left over to mark the end of the free list.
+   *
+   ****************************************************************************************/
+  template<SizeT N>
+  using BlockIndexType = std::conditional_t<
+    (N < std::numeric_limits<uint8_t>::max()),
+    uint8_t,
+    std::conditional_t<(N < std::numeric_limits<uint16_t>::max()),
+                       uint16_t,
+                       std::conditional_t<(N < std::numeric_limits<uint32_t>::max()),
+                                          uint32_t,
+                                          uint64_t>>>;
+
+  /****************************************************************************************
+   * @brief A memory pool for exactly 'N' objects of type T whose storage is an aligned array
+   *        inside the pool object itself. Creating the pool allocates nothing, so it can
+   *        live on the stack, in a static or inside another object, and its capacity is a
+   *        compile-time constant.
+   *
+   *        Free blocks are tracked as in MemoryPool (an intrusive free list plus a bump
+   *        index for blocks that have never been handed out) but with the narrowest index
+   *        type that fits 'N' (see BlockIndexType), so small pools of small objects do not
+   *        have to pad every block to 8 bytes.
+   *
+   *        The pool cannot be copied or moved, as handed-out pointers point into it.
+   *
+   *        NOTE: Like MemoryPool, the pool is not thread-safe.
+   *
+   * @tparam T: The type of the objects to be allocated for in the memory pool.
+   * @tparam N: The number of objects the pool can hold.
+   ****************************************************************************************/
+  template<class T, SizeT N>
+  class StaticMemoryPool : public PoolObjects<T, StaticMemoryPool<T, N>> {
+  public:
+    static_assert(N > 0, "A StaticMemoryPool must be able to hold at least one object");
+
+    // The type used for block indices
+    using IndexT = BlockIndexType<N>;
+
+    // Creates an empty pool. Runs in O(1) time; the storage is not touched
+    StaticMemoryPool() : Head(Null_index), Next_untouched(0), Num_available(N) {}
+
+    // Handed-out pointers point into the pool so it can be neither copied nor moved
+    StaticMemoryPool(const StaticMemoryPool&) = delete;
+    StaticMemoryPool& operator=(const StaticMemoryPool&) = delete;
+
+    // Marks every block in the pool as free again in O(1) time. Do not try to access
+    // previously allocated blocks afterwards. Does not run the destructors of any objects
+    // still in the pool
+    void reset();
+
+    // Returns a pointer to an available block in the memory pool. The block is uninitialised
+    // memory; use emplace() to construct an object in it
+    T* new_block_pt();
+
+    // Returns a pointer to an available block in the memory pool, into which 'obj' has been
+    // moved
+    T* new_block_pt(T&& obj);
+
+    // "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. Do not try
+    // to access obj_pt after this function has been called. Does not run the destructor
+    void delete_block_pt(T*& obj_pt);
+
+    // The total number of objects this pool can hold
+    static constexpr SizeT size() { return N; }
+
+    // The remaining number of objects this pool can hold
+    inline SizeT available_capacity() const { return Num_available; }
+
+  private:
+    // Marks the end of the free list
+    static constexpr IndexT Null_index = std::numeric_limits<IndexT>::max();
+
+    // The alignment of the blocks
+    static constexpr SizeT Block_alignment = std::max(alignof(T), alignof(IndexT));
+
+    // The number of bytes between the start of consecutive blocks. A block must be able to
+    // hold either an object of type T or, while free, the index of the next free block
+    static constexpr SizeT Block_size =
+      round_up(std::max(sizeof(T), sizeof(IndexT)), Block_alignment);
+
+    // Returns a pointer to the block with the given index
+    inline Byte* block_pt(const SizeT& block_index)
+    {
+      return Storage + block_index * Block_size;
+    }
+
+    // Returns true if obj_pt points to an object of type T in the pool. Returns false otherwise
+    bool is_pool_member(const T* const obj_pt) const;
+
+    // The blocks themselves. Deliberately left uninitialised
+    alignas(Block_alignment) Byte Storage[N * Block_size];
+
+    // The index of the first block in the free list
+    IndexT Head;
+
+    // Blocks with an index at or above this value have never been handed out
+    IndexT Next_untouched;
+
+    // The number of blocks that can currently be handed out
+    IndexT Num_available;
+  };
+
+  /****************************************************************************************
+   * @brief Marks every block in the pool as free again in O(1) time.
+   *
+   ****************************************************************************************/
+  template<class T, SizeT N>
+  void StaticMemoryPool<T, N>::reset()
+  {
+    Head = Null_index;
+    Next_untouched = 0;
+    Num_available = N;
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block in the memory pool. Throws a
+   *        std::out_of_range exception if every block has been allocated.
+   *
+   * @return T*: A pointer to a new object in the memory pool.
+   ****************************************************************************************/
+  template<class T, SizeT N>
+  T* StaticMemoryPool<T, N>::new_block_pt()
+  {
+    SizeT block_index;
+    if (Head != Null_index) {
+      block_index = Head;
+      std::memcpy(&Head, block_pt(block_index), sizeof(IndexT));
+    }
+    else if (Next_untouched < N) {
+      block_index = Next_untouched++;
+    }
+    else {
+      throw std::out_of_range("No more space available; all " + std::to_string(N) +
+                              " blocks allocated!");
+    }
+    Num_available--;
+    return reinterpret_cast<T*>(block_pt(block_index));
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block in the memory pool, into which 'obj'
+   *        has been moved.
+   *
+   * @param obj: The object to move (using the move constructor of T) to the new block.
+   * @return T*: A pointer to a new object in the memory pool.
+   ****************************************************************************************/
+  template<class T, SizeT N>
+  T* StaticMemoryPool<T, N>::new_block_pt(T&& obj)
+  {
+    return this->emplace(std::move(obj));
+  }
+
+  /****************************************************************************************
+   * @brief "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. The
+   *        block is pushed onto the front of the free list.
+   *
+   * @param obj_pt: A reference to the pointer to the underlying block in the memory pool.
+   *                Will be set to 'nullptr' after the underlying data has been deallocated.
+   ****************************************************************************************/
+  template<class T, SizeT N>
+  void StaticMemoryPool<T, N>::delete_block_pt(T*& obj_pt)
+  {
+    if (obj_pt == nullptr) {
+      return;
+    }
+    assert(is_pool_member(obj_pt));
+    Byte* byte_pt = reinterpret_cast<Byte*>(obj_pt);
+    std::memcpy(byte_pt, &Head, sizeof(IndexT));
+    Head = static_cast<IndexT>((byte_pt - Storage) / Block_size);
+    Num_available++;
+    obj_pt = nullptr;
+  }
+
+  /****************************************************************************************
+   * @brief Returns true if 'obj_pt' points to the start of a block in the pool. Returns
+   *        false otherwise.
+   *
+   ****************************************************************************************/
+  template<class T, SizeT N>
+  bool StaticMemoryPool<T, N>::is_pool_member(const T* const obj_pt) const
+  {
+    const std::less<const Byte*> less;
+    auto byte_pt = reinterpret_cast<const Byte*>(obj_pt);
+    if (less(byte_pt, Storage) || !less(byte_pt, Storage + N * Block_size)) return false;
+    return (byte_pt - Storage) % Block_size == 0;
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_STATIC_MEMORY_POOL_HEADER
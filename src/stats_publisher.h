@@ -0,0 +1,426 @@
+#ifndef MEMORY_POOL_STATS_PUBLISHER_HEADER
+#define MEMORY_POOL_STATS_PUBLISHER_HEADER
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "pool_stats.h"
+
+namespace memory_pool {
+  // Identifies a page of pool statistics ("MEMPSTAT" when read as little-endian bytes)
+  constexpr uint64_t g_StatsPageMagic = 0x54415453504d454d;
+
+  // The version of the page layout; bumped whenever StatsPage changes
+  constexpr uint32_t g_StatsPageVersion = 1;
+
+  // The size of the shared memory object the statistics are published in
+  constexpr SizeT g_StatsPageSize = 4096;
+
+  // The longest type name stored in a page (longer names are truncated)
+  constexpr SizeT g_MaxStatsTypeNameLength = 71;
+
+  /****************************************************************************************
+   * @brief The statistics of one pool as stored in a StatsPage; see PoolStatsSnapshot.
+   *        Only fixed-size fields, so the page can be read by another process.
+   *
+   ****************************************************************************************/
+  struct StatsRecord {
+    char Type_name[g_MaxStatsTypeNameLength + 1];
+    uint64_t Id;
+    uint64_t Capacity;
+    uint64_t Live;
+    uint64_t Peak_live;
+    uint64_t Allocations;
+    uint64_t Deallocations;
+    uint64_t Exhaustions;
+    uint64_t Growths;
+  };
+
+  /****************************************************************************************
+   * @brief The start of a StatsPage.
+   *
+   ****************************************************************************************/
+  struct StatsPageHeader {
+    // g_StatsPageMagic and g_StatsPageVersion once the page has been set up
+    uint64_t Magic;
+    uint32_t Version;
+
+    // The number of records in the page
+    uint32_t Num_records;
+
+    // Odd while the page is being written; see read_stats_page()
+    std::atomic<uint64_t> Sequence;
+
+    // The number of pools registered when the page was written; more than 'Num_records'
+    // if not every pool fitted in the page
+    uint64_t Num_pools;
+
+    // When the page was written, in nanoseconds since the Unix epoch
+    int64_t Timestamp_ns;
+
+    // The process the statistics belong to
+    int64_t Pid;
+  };
+
+  // The number of pools whose statistics fit in a page
+  constexpr SizeT g_MaxStatsRecords =
+    (g_StatsPageSize - sizeof(StatsPageHeader)) / sizeof(StatsRecord);
+
+  /****************************************************************************************
+   * @brief The layout of the shared memory object a StatsPublisher writes to: a header
+   *        followed by one record per pool, filling (at most) one page.
+   *
+   ****************************************************************************************/
+  struct StatsPage {
+    StatsPageHeader Header;
+    StatsRecord Records[g_MaxStatsRecords];
+  };
+
+  static_assert(sizeof(StatsPage) <= g_StatsPageSize, "The statistics must fit in one page");
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "The page sequence number must be usable from several processes");
+
+  /****************************************************************************************
+   * @brief Returns the name of the shared memory object the statistics of process 'pid'
+   *        are published under by default.
+   *
+   ****************************************************************************************/
+  inline std::string stats_shm_name(const int64_t& pid = ::getpid())
+  {
+    return "/mempool-stat." + std::to_string(pid);
+  }
+
+  /****************************************************************************************
+   * @brief Publishes the statistics of every pool in the PoolRegistry into a page of
+   *        shared memory, from where the mempool-stat tool (or anything else that maps the
+   *        page) can read them without stopping or otherwise disturbing the process:
+   *
+   *          StatsPublisher publisher;
+   *          publisher.publish_every(std::chrono::seconds(1));
+   *
+   *        The shared memory object is named after the process (see stats_shm_name()) and
+   *        is removed again when the publisher is destroyed. Throws a std::system_error if
+   *        it cannot be created. Only available on POSIX systems.
+   *
+   ****************************************************************************************/
+  class StatsPublisher {
+  public:
+    // Creates (or takes over) the shared memory object 'name'
+    explicit StatsPublisher(const std::string& name = stats_shm_name());
+
+    // Stops publishing and removes the shared memory object
+    ~StatsPublisher();
+
+    // The publisher owns the shared memory object so it cannot be copied
+    StatsPublisher(const StatsPublisher&) = delete;
+    StatsPublisher& operator=(const StatsPublisher&) = delete;
+
+    // Writes the current statistics to the page
+    void publish();
+
+    // Starts a thread that calls publish() every 'period' until stop() is called (or the
+    // publisher is destroyed). Calling it again changes the period
+    void publish_every(const std::chrono::milliseconds& period);
+
+    // Stops the thread started by publish_every(), if any
+    void stop();
+
+    // The name of the shared memory object
+    inline const std::string& name() const { return Name; }
+
+  private:
+    // Publishes every 'Period' until told to stop
+    void run();
+
+    // The name of the shared memory object
+    std::string Name;
+
+    // The mapped page
+    StatsPage* Page;
+
+    // Serialises publish() calls
+    std::mutex Publish_mutex;
+
+    // Guards 'Period' and 'Is_stopping', and wakes the publishing thread
+    std::mutex Thread_mutex;
+    std::condition_variable Wake_up;
+    std::chrono::milliseconds Period{0};
+    bool Is_stopping = false;
+
+    // The publishing thread, if publish_every() has been called
+    std::thread Thread;
+  };
+
+  /****************************************************************************************
+   * @brief Creates the shared memory object 'name' (replacing any left behind by an
+   *        earlier process with the same name), sizes it to one page and maps it.
+   *
+   * @param name: The name of the shared memory object; must start with a '/'.
+   ****************************************************************************************/
+  inline StatsPublisher::StatsPublisher(const std::string& name) : Name(name), Page(nullptr)
+  {
+    const int fd = ::shm_open(Name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "shm_open(" + Name + ")");
+    }
+    if (::ftruncate(fd, g_StatsPageSize) != 0) {
+      const int error = errno;
+      ::close(fd);
+      ::shm_unlink(Name.c_str());
+      throw std::system_error(error, std::generic_category(), "ftruncate(" + Name + ")");
+    }
+    void* pt = ::mmap(nullptr, g_StatsPageSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (pt == MAP_FAILED) {
+      ::shm_unlink(Name.c_str());
+      throw std::system_error(error, std::generic_category(), "mmap(" + Name + ")");
+    }
+    // The page is zero-filled, so the magic number is only seen once the header is valid
+    Page = static_cast<StatsPage*>(pt);
+    Page->Header.Version = g_StatsPageVersion;
+    Page->Header.Pid = ::getpid();
+    std::atomic_thread_fence(std::memory_order_release);
+    Page->Header.Magic = g_StatsPageMagic;
+    publish();
+  }
+
+  /****************************************************************************************
+   * @brief Stops publishing, unmaps the page and removes the shared memory object.
+   *
+   ****************************************************************************************/
+  inline StatsPublisher::~StatsPublisher()
+  {
+    stop();
+    ::munmap(Page, g_StatsPageSize);
+    ::shm_unlink(Name.c_str());
+  }
+
+  /****************************************************************************************
+   * @brief Writes the current statistics of every registered pool to the page. The page
+   *        is written under a sequence lock: the sequence number is odd while the records
+   *        are being written, so a reader can tell it saw a partly written page and retry.
+   *        Pools beyond the first g_MaxStatsRecords are counted but not listed.
+   *
+   ****************************************************************************************/
+  inline void StatsPublisher::publish()
+  {
+    const std::vector<PoolStatsSnapshot> snapshots = PoolRegistry::instance().snapshot();
+    const SizeT num_records = std::min<SizeT>(snapshots.size(), g_MaxStatsRecords);
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+
+    std::lock_guard<std::mutex> lock(Publish_mutex);
+    StatsPageHeader& header = Page->Header;
+    const uint64_t sequence = header.Sequence.load(std::memory_order_relaxed);
+    header.Sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (SizeT i = 0; i < num_records; i++) {
+      const PoolStatsSnapshot& snapshot = snapshots[i];
+      StatsRecord record{};
+      snapshot.Type_name.copy(record.Type_name, g_MaxStatsTypeNameLength);
+      record.Id = snapshot.Id;
+      record.Capacity = snapshot.Capacity;
+      record.Live = snapshot.Live;
+      record.Peak_live = snapshot.Peak_live;
+      record.Allocations = snapshot.Allocations;
+      record.Deallocations = snapshot.Deallocations;
+      record.Exhaustions = snapshot.Exhaustions;
+      record.Growths = snapshot.Growths;
+      std::memcpy(&Page->Records[i], &record, sizeof(StatsRecord));
+    }
+    header.Num_records = static_cast<uint32_t>(num_records);
+    header.Num_pools = snapshots.size();
+    header.Timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+
+    header.Sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  /****************************************************************************************
+   * @brief Starts a thread that publishes the statistics every 'period'. If the thread is
+   *        already running, only the period is changed.
+   *
+   * @param period: How often to publish the statistics.
+   ****************************************************************************************/
+  inline void StatsPublisher::publish_every(const std::chrono::milliseconds& period)
+  {
+    std::lock_guard<std::mutex> lock(Thread_mutex);
+    Period = period;
+    if (Thread.joinable()) {
+      Wake_up.notify_one();
+      return;
+    }
+    Is_stopping = false;
+    Thread = std::thread([this] { run(); });
+  }
+
+  /****************************************************************************************
+   * @brief Stops the thread started by publish_every() and waits for it to finish. Does
+   *        nothing if no thread is running.
+   *
+   ****************************************************************************************/
+  inline void StatsPublisher::stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(Thread_mutex);
+      Is_stopping = true;
+    }
+    Wake_up.notify_one();
+    if (Thread.joinable()) {
+      Thread.join();
+    }
+  }
+
+  /****************************************************************************************
+   * @brief The body of the publishing thread.
+   *
+   ****************************************************************************************/
+  inline void StatsPublisher::run()
+  {
+    std::unique_lock<std::mutex> lock(Thread_mutex);
+    while (!Is_stopping) {
+      lock.unlock();
+      publish();
+      lock.lock();
+      Wake_up.wait_for(lock, Period, [this] { return Is_stopping; });
+    }
+  }
+
+  /****************************************************************************************
+   * @brief The statistics read back from a StatsPage.
+   *
+   ****************************************************************************************/
+  struct PublishedStats {
+    // The process the statistics belong to
+    int64_t Pid = 0;
+
+    // When the statistics were published, in nanoseconds since the Unix epoch
+    int64_t Timestamp_ns = 0;
+
+    // The number of pools registered in the process; may be more than Pools.size()
+    SizeT Num_pools = 0;
+
+    // The statistics of each pool that fitted in the page
+    std::vector<PoolStatsSnapshot> Pools;
+  };
+
+  /****************************************************************************************
+   * @brief Reads the statistics from a (possibly concurrently updated) StatsPage. The page
+   *        is copied and the copy kept only if the sequence number was even and unchanged
+   *        throughout; otherwise the read is retried. Throws a std::runtime_error if the
+   *        page is not a valid StatsPage or never settles (e.g. the writer died mid-write).
+   *
+   * @param page: The page to read.
+   * @return PublishedStats: The statistics in the page.
+   ****************************************************************************************/
+  inline PublishedStats read_stats_page(const StatsPage& page)
+  {
+    if ((page.Header.Magic != g_StatsPageMagic) || (page.Header.Version != g_StatsPageVersion)) {
+      throw std::runtime_error("Not a pool statistics page (or a different version)");
+    }
+    constexpr int Max_attempts = 1000;
+    for (int attempt = 0; attempt < Max_attempts; attempt++) {
+      const uint64_t before = page.Header.Sequence.load(std::memory_order_acquire);
+      if (before % 2 == 1) {
+        std::this_thread::yield();
+        continue;
+      }
+      PublishedStats stats;
+      stats.Pid = page.Header.Pid;
+      stats.Timestamp_ns = page.Header.Timestamp_ns;
+      stats.Num_pools = page.Header.Num_pools;
+      const SizeT num_records = std::min<SizeT>(page.Header.Num_records, g_MaxStatsRecords);
+      StatsRecord records[g_MaxStatsRecords];
+      std::memcpy(records, page.Records, num_records * sizeof(StatsRecord));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (page.Header.Sequence.load(std::memory_order_relaxed) != before) {
+        continue;
+      }
+
+      for (SizeT i = 0; i < num_records; i++) {
+        const StatsRecord& record = records[i];
+        PoolStatsSnapshot snapshot;
+        snapshot.Type_name.assign(record.Type_name,
+                                  strnlen(record.Type_name, g_MaxStatsTypeNameLength));
+        snapshot.Id = record.Id;
+        snapshot.Capacity = record.Capacity;
+        snapshot.Live = record.Live;
+        snapshot.Peak_live = record.Peak_live;
+        snapshot.Allocations = record.Allocations;
+        snapshot.Deallocations = record.Deallocations;
+        snapshot.Exhaustions = record.Exhaustions;
+        snapshot.Growths = record.Growths;
+        stats.Pools.push_back(snapshot);
+      }
+      return stats;
+    }
+    throw std::runtime_error("The pool statistics page is not being updated consistently");
+  }
+
+  /****************************************************************************************
+   * @brief Maps the shared memory object a StatsPublisher writes to (read-only) and reads
+   *        statistics from it; used by mempool-stat. Throws a std::system_error if the
+   *        object does not exist or cannot be mapped.
+   *
+   ****************************************************************************************/
+  class StatsReader {
+  public:
+    // Maps the shared memory object 'name'
+    explicit StatsReader(const std::string& name);
+
+    // Unmaps the shared memory object
+    ~StatsReader() { ::munmap(const_cast<StatsPage*>(Page), g_StatsPageSize); }
+
+    // The reader owns the mapping so it cannot be copied
+    StatsReader(const StatsReader&) = delete;
+    StatsReader& operator=(const StatsReader&) = delete;
+
+    // Reads the statistics currently in the page; see read_stats_page()
+    PublishedStats read() const { return read_stats_page(*Page); }
+
+  private:
+    // The mapped page
+    const StatsPage* Page;
+  };
+
+  /****************************************************************************************
+   * @brief Maps the shared memory object 'name' read-only.
+   *
+   * @param name: The name of the shared memory object, e.g. stats_shm_name(pid).
+   ****************************************************************************************/
+  inline StatsReader::StatsReader(const std::string& name) : Page(nullptr)
+  {
+    const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "shm_open(" + name + ")");
+    }
+    struct stat status;
+    if ((::fstat(fd, &status) != 0) || (static_cast<SizeT>(status.st_size) < sizeof(StatsPage))) {
+      ::close(fd);
+      throw std::system_error(EINVAL, std::generic_category(), name + " is too small");
+    }
+    void* pt = ::mmap(nullptr, g_StatsPageSize, PROT_READ, MAP_SHARED, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (pt == MAP_FAILED) {
+      throw std::system_error(error, std::generic_category(), "mmap(" + name + ")");
+    }
+    Page = static_cast<const StatsPage*>(pt);
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_STATS_PUBLISHER_HEADER
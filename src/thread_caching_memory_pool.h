@@ -0,0 +1,339 @@
+#ifndef MEMORY_POOL_THREAD_CACHING_MEMORY_POOL_HEADER
+#define MEMORY_POOL_THREAD_CACHING_MEMORY_POOL_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "memory_pool.h"
+
+namespace memory_pool {
+  /****************************************************************************************
+   * @brief Default number of free blocks each thread can cache in its magazine
+   *
+   ****************************************************************************************/
+  const SizeT g_DefaultMagazineSize = 64;
+
+  /****************************************************************************************
+   * @brief A memory pool whose new_block_pt() and delete_block_pt() can be called from many
+   *        threads, and which usually does not need to synchronise with other threads.
+   *
+   *        The blocks come from a shared MemoryPool (the depot), protected by a mutex. Each
+   *        thread keeps a small cache of free blocks (its magazine) in front of the depot.
+   *        Allocations are served from the calling thread's magazine and deallocations
+   *        return blocks to it; only when the magazine is empty (or full) does the thread
+   *        lock the depot, to move half a magazine of blocks in one go. A block may be
+   *        deallocated by a different thread to the one that allocated it; it simply ends
+   *        up in the deallocating thread's magazine.
+   *
+   *        NOTE: Blocks cached in the magazines of other threads cannot be handed out, so a
+   *        fixed-size pool can run out of space while it still has free blocks. Leave at
+   *        least (number of threads * magazine size) blocks of slack or make the pool
+   *        growable. A thread that is about to exit should call flush_thread_cache() so the
+   *        blocks in its magazine are not stranded.
+   *
+   * @tparam T: The type of the objects to be allocated for in the memory pool.
+   ****************************************************************************************/
+  template<class T>
+  class ThreadCachingMemoryPool : public PoolObjects<T, ThreadCachingMemoryPool<T>> {
+  public:
+    // Immediately creates a pool for 'num_blocks' objects of type T. Each thread can cache
+    // up to 'magazine_size' free blocks. If 'growth_factor' is non-zero, the depot is
+    // growable (see MemoryPool::set_growth_factor())
+    ThreadCachingMemoryPool(const SizeT& num_blocks,
+                            const SizeT& magazine_size = g_DefaultMagazineSize,
+                            const SizeT& growth_factor = 0);
+
+    // Destructor. The depot cleans up the memory
+    ~ThreadCachingMemoryPool() = default;
+
+    // The pool owns raw memory so it cannot be copied
+    ThreadCachingMemoryPool(const ThreadCachingMemoryPool&) = delete;
+    ThreadCachingMemoryPool& operator=(const ThreadCachingMemoryPool&) = delete;
+
+    // Returns a pointer to an available block in the memory pool
+    T* new_block_pt();
+
+    // Returns a pointer to an available block in the memory pool, into which 'obj' has been
+    // moved
+    T* new_block_pt(T&& obj);
+
+    // "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. Do not try
+    // to access obj_pt after this function has been called. Does not run the destructor
+    void delete_block_pt(T*& obj_pt);
+
+    // Returns every block cached by the calling thread to the depot
+    void flush_thread_cache();
+
+    // The total number of objects this pool can hold
+    SizeT size();
+
+    // The remaining number of objects this pool can hold, including the blocks cached by
+    // every thread. Only exact while no other thread is using the pool
+    SizeT available_capacity();
+
+    // The maximum number of free blocks each thread caches
+    inline SizeT magazine_size() const { return Magazine_size; }
+
+  private:
+    // A thread's cache of free blocks
+    struct Magazine {
+      std::vector<T*> Blocks;
+
+      // The number of blocks in 'Blocks'. Only the owning thread touches 'Blocks', so it
+      // publishes the count here for available_capacity() to read from other threads
+      std::atomic<SizeT> Num_blocks{0};
+
+      // Publishes the current number of blocks; called by the owning thread
+      void publish_size() { Num_blocks.store(Blocks.size(), std::memory_order_relaxed); }
+    };
+
+    // An entry in the per-thread lookup table used to find a thread's magazine quickly
+    struct ThreadCacheEntry {
+      SizeT Pool_id = 0;
+      Magazine* Magazine_pt = nullptr;
+    };
+
+    // The number of entries in the per-thread lookup table
+    static constexpr SizeT Num_thread_cache_entries = 8;
+
+    // Returns the calling thread's magazine for this pool, creating it if needed
+    Magazine& thread_magazine();
+
+    // Slow path of thread_magazine(): looks the magazine up (or creates it) under a lock
+    Magazine& find_or_create_thread_magazine();
+
+    // Moves up to half a magazine of blocks from the depot to 'magazine'
+    void refill(Magazine& magazine);
+
+    // Moves 'num_blocks' blocks from 'magazine' to the depot
+    void flush(Magazine& magazine, const SizeT& num_blocks);
+
+    // Returns a unique identifier for a new pool; identifiers are never reused, so a stale
+    // per-thread lookup table entry can never match a different pool
+    static SizeT next_pool_id()
+    {
+      static std::atomic<SizeT> id{0};
+      return ++id;
+    }
+
+    // The per-thread lookup table mapping a pool identifier to the thread's magazine
+    static ThreadCacheEntry* thread_cache_entries()
+    {
+      thread_local ThreadCacheEntry entries[Num_thread_cache_entries];
+      return entries;
+    }
+
+    // Identifies this pool in the per-thread lookup tables
+    const SizeT Pool_id;
+
+    // The maximum number of free blocks each thread caches
+    const SizeT Magazine_size;
+
+    // The shared pool the magazines are filled from and flushed to
+    MemoryPool<T> Depot;
+
+    // Protects the depot
+    std::mutex Depot_mutex;
+
+    // The magazine of every thread that has used the pool
+    std::unordered_map<std::thread::id, std::unique_ptr<Magazine>> Magazines;
+
+    // Protects the map of magazines
+    std::mutex Magazines_mutex;
+  };
+
+  /****************************************************************************************
+   * @brief Creates a pool for 'num_blocks' objects of type T.
+   *
+   * @param num_blocks: The number of objects the pool should initially be capable of holding.
+   * @param magazine_size: The maximum number of free blocks each thread caches; at least 2.
+   * @param growth_factor: If non-zero, the pool grows by this factor when it runs out of space.
+   ****************************************************************************************/
+  template<class T>
+  ThreadCachingMemoryPool<T>::ThreadCachingMemoryPool(const SizeT& num_blocks,
+                                                      const SizeT& magazine_size,
+                                                      const SizeT& growth_factor)
+    : Pool_id(next_pool_id()),
+      Magazine_size(magazine_size < 2 ? 2 : magazine_size),
+      Depot(num_blocks, growth_factor)
+  {
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block in the memory pool. Only locks the
+   *        depot if the calling thread's magazine is empty.
+   *
+   * @return T*: A pointer to a new object in the memory pool.
+   ****************************************************************************************/
+  template<class T>
+  T* ThreadCachingMemoryPool<T>::new_block_pt()
+  {
+    Magazine& magazine = thread_magazine();
+    if (magazine.Blocks.empty()) {
+      refill(magazine);
+    }
+    T* block_pt = magazine.Blocks.back();
+    magazine.Blocks.pop_back();
+    magazine.publish_size();
+    return block_pt;
+  }
+
+  /****************************************************************************************
+   * @brief Returns a pointer to an available block in the memory pool, into which 'obj'
+   *        has been moved.
+   *
+   * @param obj: The object to move (using the move constructor of T) to the new block.
+   * @return T*: A pointer to a new object in the memory pool.
+   ****************************************************************************************/
+  template<class T>
+  T* ThreadCachingMemoryPool<T>::new_block_pt(T&& obj)
+  {
+    return this->emplace(std::move(obj));
+  }
+
+  /****************************************************************************************
+   * @brief "Deletes" the data pointed to by 'obj_pt' and nullifies the input pointer. Only
+   *        locks the depot if the calling thread's magazine is full.
+   *
+   * @param obj_pt: A reference to the pointer to the underlying block in the memory pool.
+   *                Will be set to 'nullptr' after the underlying data has been deallocated.
+   ****************************************************************************************/
+  template<class T>
+  void ThreadCachingMemoryPool<T>::delete_block_pt(T*& obj_pt)
+  {
+    if (obj_pt == nullptr) {
+      return;
+    }
+    Magazine& magazine = thread_magazine();
+    if (magazine.Blocks.size() == Magazine_size) {
+      flush(magazine, Magazine_size / 2);
+    }
+    magazine.Blocks.push_back(obj_pt);
+    magazine.publish_size();
+    obj_pt = nullptr;
+  }
+
+  /****************************************************************************************
+   * @brief Returns every block cached by the calling thread to the depot.
+   *
+   ****************************************************************************************/
+  template<class T>
+  void ThreadCachingMemoryPool<T>::flush_thread_cache()
+  {
+    Magazine& magazine = thread_magazine();
+    flush(magazine, magazine.Blocks.size());
+  }
+
+  /****************************************************************************************
+   * @brief The total number of objects this pool can hold.
+   *
+   ****************************************************************************************/
+  template<class T>
+  SizeT ThreadCachingMemoryPool<T>::size()
+  {
+    std::lock_guard<std::mutex> lock(Depot_mutex);
+    return Depot.size();
+  }
+
+  /****************************************************************************************
+   * @brief The remaining number of objects this pool can hold, including the blocks cached
+   *        by every thread. The magazines are counted through the sizes their threads
+   *        publish, so the total is only exact while no other thread is using the pool.
+   *
+   ****************************************************************************************/
+  template<class T>
+  SizeT ThreadCachingMemoryPool<T>::available_capacity()
+  {
+    std::lock_guard<std::mutex> depot_lock(Depot_mutex);
+    std::lock_guard<std::mutex> magazines_lock(Magazines_mutex);
+    SizeT num_available = Depot.available_capacity();
+    for (const auto& entry : Magazines) {
+      num_available += entry.second->Num_blocks.load(std::memory_order_relaxed);
+    }
+    return num_available;
+  }
+
+  /****************************************************************************************
+   * @brief Returns the calling thread's magazine for this pool. The common case is a
+   *        lookup in a small thread-local table and does not need any synchronisation.
+   *
+   ****************************************************************************************/
+  template<class T>
+  typename ThreadCachingMemoryPool<T>::Magazine& ThreadCachingMemoryPool<T>::thread_magazine()
+  {
+    ThreadCacheEntry& entry = thread_cache_entries()[Pool_id % Num_thread_cache_entries];
+    if (entry.Pool_id == Pool_id) {
+      return *entry.Magazine_pt;
+    }
+    Magazine& magazine = find_or_create_thread_magazine();
+    entry.Pool_id = Pool_id;
+    entry.Magazine_pt = &magazine;
+    return magazine;
+  }
+
+  /****************************************************************************************
+   * @brief Looks up the calling thread's magazine under a lock, creating it if this is the
+   *        first time the thread has used the pool.
+   *
+   ****************************************************************************************/
+  template<class T>
+  typename ThreadCachingMemoryPool<T>::Magazine&
+  ThreadCachingMemoryPool<T>::find_or_create_thread_magazine()
+  {
+    std::lock_guard<std::mutex> lock(Magazines_mutex);
+    auto& magazine_pt = Magazines[std::this_thread::get_id()];
+    if (!magazine_pt) {
+      magazine_pt.reset(new Magazine);
+      magazine_pt->Blocks.reserve(Magazine_size);
+    }
+    return *magazine_pt;
+  }
+
+  /****************************************************************************************
+   * @brief Moves up to half a magazine of blocks from the depot to 'magazine'. Throws a
+   *        std::out_of_range exception if the depot is empty and cannot grow.
+   *
+   * @param magazine: The (empty) magazine to refill.
+   ****************************************************************************************/
+  template<class T>
+  void ThreadCachingMemoryPool<T>::refill(Magazine& magazine)
+  {
+    std::lock_guard<std::mutex> lock(Depot_mutex);
+
+    // Always take at least one block; new_blocks() grows the depot or throws if needed
+    const SizeT num_blocks =
+      std::max<SizeT>(1, std::min(Magazine_size / 2, Depot.available_capacity()));
+    const SizeT old_size = magazine.Blocks.size();
+    magazine.Blocks.resize(old_size + num_blocks);
+    try {
+      Depot.new_blocks(num_blocks, magazine.Blocks.data() + old_size);
+    }
+    catch (...) {
+      magazine.Blocks.resize(old_size);
+      throw;
+    }
+    magazine.publish_size();
+  }
+
+  /****************************************************************************************
+   * @brief Moves 'num_blocks' blocks from 'magazine' back to the depot.
+   *
+   * @param magazine: The magazine to flush.
+   * @param num_blocks: The number of blocks to move; must not exceed the magazine's size.
+   ****************************************************************************************/
+  template<class T>
+  void ThreadCachingMemoryPool<T>::flush(Magazine& magazine, const SizeT& num_blocks)
+  {
+    std::lock_guard<std::mutex> lock(Depot_mutex);
+    const SizeT new_size = magazine.Blocks.size() - num_blocks;
+    Depot.delete_blocks(magazine.Blocks.data() + new_size, num_blocks);
+    magazine.Blocks.resize(new_size);
+    magazine.publish_size();
+  }
+} // namespace memory_pool
+
+#endif // MEMORY_POOL_THREAD_CACHING_MEMORY_POOL_HEADER
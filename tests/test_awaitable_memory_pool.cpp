@@ -0,0 +1,194 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "awaitable_memory_pool.h"
+#include "bitmap_tracker.h"
+#include "pool_policies.h"
+
+
+using memory_pool::AwaitableMemoryPool;
+using memory_pool::BitmapTracker;
+using memory_pool::NoLock;
+using memory_pool::SpinLock;
+
+
+// The pool's lock also covers the MemoryPool inside, which takes none of its own
+using Locked = AwaitableMemoryPool<Point, BitmapTracker, SpinLock>;
+static_assert(std::is_same_v<Locked::Lock, SpinLock>);
+static_assert(std::is_same_v<Locked::Pool::Lock, NoLock>);
+static_assert(std::is_same_v<Locked::Pool::Tracker, BitmapTracker>);
+
+
+// A coroutine that starts running straight away and is destroyed with the Task (or when it
+// finishes, if the Task has already gone)
+struct Task {
+  struct promise_type {
+    Task get_return_object()
+    {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : Handle(handle) {}
+  Task(Task&& other) noexcept : Handle(std::exchange(other.Handle, nullptr)) {}
+  ~Task()
+  {
+    if (Handle) Handle.destroy();
+  }
+
+  bool is_done() const { return Handle.done(); }
+
+  std::coroutine_handle<promise_type> Handle;
+};
+
+// Acquires a block from 'pool', then records 'id' and the block
+template<class Pool>
+static Task acquire_into(Pool& pool, int id, std::vector<int>& order, std::vector<Point*>& blocks)
+{
+  Point* block_pt = co_await pool.acquire();
+  order.push_back(id);
+  blocks.push_back(block_pt);
+}
+
+// Acquires a block from 'pool', then records the block and the thread the coroutine is on
+template<class Pool>
+static Task acquire_on_thread(Pool& pool, Point*& block_pt, std::thread::id& thread_id)
+{
+  block_pt = co_await pool.acquire();
+  thread_id = std::this_thread::get_id();
+}
+
+
+TEST_CASE("AwaitableMemoryPool")
+{
+  AwaitableMemoryPool<Point> pool(2);
+  std::vector<int> order;
+  std::vector<Point*> blocks;
+
+  SUBCASE("A free block is acquired without suspending")
+  {
+    Task task = acquire_into(pool, 0, order, blocks);
+    CHECK(task.is_done());
+    CHECK(order == std::vector<int>{0});
+    CHECK(pool.available_capacity() == 1);
+    pool.release(blocks[0]);
+    CHECK(blocks[0] == nullptr);
+    CHECK(pool.available_capacity() == 2);
+  }
+
+  SUBCASE("Waiters are served first in, first out as blocks are released")
+  {
+    Point* first_pt = pool.try_acquire();
+    Point* second_pt = pool.try_acquire();
+    REQUIRE(second_pt != nullptr);
+    CHECK(pool.try_acquire() == nullptr);
+
+    std::vector<Task> tasks;
+    for (int id = 0; id < 3; id++) tasks.push_back(acquire_into(pool, id, order, blocks));
+    CHECK(pool.num_waiting() == 3);
+    CHECK(order.empty());
+
+    // The released block goes straight to the oldest waiter, not back to the pool
+    Point* released_pt = second_pt;
+    pool.release(second_pt);
+    CHECK(order == std::vector<int>{0});
+    CHECK(blocks[0] == released_pt);
+    CHECK(pool.available_capacity() == 0);
+    CHECK(pool.try_acquire() == nullptr);
+
+    pool.release(first_pt);
+    pool.release(blocks[0]);
+    CHECK(order == std::vector<int>{0, 1, 2});
+    CHECK(pool.num_waiting() == 0);
+    for (const Task& task : tasks) CHECK(task.is_done());
+
+    pool.release(blocks[1]);
+    pool.release(blocks[2]);
+    CHECK(pool.available_capacity() == 2);
+  }
+
+  SUBCASE("An executor can be given the waiter to resume instead of release()")
+  {
+    Point* first_pt = pool.try_acquire();
+    Point* second_pt = pool.try_acquire();
+    Task task = acquire_into(pool, 0, order, blocks);
+    std::vector<std::coroutine_handle<>> ready;
+    pool.release(first_pt, [&ready](std::coroutine_handle<> handle) { ready.push_back(handle); });
+    CHECK(first_pt == nullptr);
+    CHECK(pool.num_waiting() == 0);
+    CHECK(order.empty());
+    REQUIRE(ready.size() == 1);
+    ready[0].resume();
+    CHECK(order == std::vector<int>{0});
+    CHECK(task.is_done());
+    pool.release(second_pt);
+    pool.release(blocks[0]);
+    CHECK(pool.available_capacity() == 2);
+  }
+
+  SUBCASE("A block handed to a coroutine destroyed before it is resumed is released again")
+  {
+    Point* first_pt = pool.try_acquire();
+    Point* second_pt = pool.try_acquire();
+    std::optional<Task> abandoned(acquire_into(pool, 0, order, blocks));
+    pool.release(first_pt, [](std::coroutine_handle<>) {});
+    CHECK(pool.available_capacity() == 0);
+    abandoned.reset();
+    CHECK(order.empty());
+    CHECK(pool.available_capacity() == 1);
+    pool.release(second_pt);
+    CHECK(pool.available_capacity() == 2);
+  }
+
+  SUBCASE("A coroutine destroyed while it waits leaves the queue")
+  {
+    Point* first_pt = pool.try_acquire();
+    Point* second_pt = pool.try_acquire();
+    std::optional<Task> abandoned(acquire_into(pool, 0, order, blocks));
+    Task kept = acquire_into(pool, 1, order, blocks);
+    CHECK(pool.num_waiting() == 2);
+    abandoned.reset();
+    CHECK(pool.num_waiting() == 1);
+
+    pool.release(first_pt);
+    CHECK(order == std::vector<int>{1});
+    CHECK(kept.is_done());
+    pool.release(second_pt);
+    pool.release(blocks[0]);
+    CHECK(pool.available_capacity() == 2);
+  }
+}
+
+
+TEST_CASE("AwaitableMemoryPool shared between threads")
+{
+  AwaitableMemoryPool<Point, std::mutex> pool(1);
+  Point* held_pt = pool.try_acquire();
+  const Point* const held_block_pt = held_pt;
+
+  // The waiting coroutine is resumed on the thread that releases the block
+  Point* block_pt = nullptr;
+  std::thread::id resumed_on;
+  Task task = acquire_on_thread(pool, block_pt, resumed_on);
+  REQUIRE(pool.num_waiting() == 1);
+  std::thread releaser([&pool, &held_pt]() { pool.release(held_pt); });
+  const std::thread::id releaser_id = releaser.get_id();
+  releaser.join();
+  CHECK(task.is_done());
+  CHECK(block_pt == held_block_pt);
+  CHECK(resumed_on == releaser_id);
+  pool.release(block_pt);
+  CHECK(pool.available_capacity() == 1);
+}
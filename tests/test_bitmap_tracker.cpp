@@ -0,0 +1,175 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "bitmap_tracker.h"
+
+
+using memory_pool::BitmapTracker;
+using memory_pool::HeapStorage;
+using memory_pool::MemoryPool;
+using memory_pool::NaturalLayout;
+using memory_pool::SizeT;
+
+
+TEST_CASE("BitmapTracker")
+{
+  // Spans several summary words, and the last bitmap word is only partly used
+  const SizeT num_blocks = 3 * 64 * 64 + 5;
+  BitmapTracker tracker(nullptr, 1, num_blocks);
+  REQUIRE(tracker.size() == num_blocks);
+
+  std::vector<SizeT> indices;
+  for (SizeT i = 0; i < num_blocks; i++) indices.push_back(tracker.pop());
+  for (SizeT i = 0; i < num_blocks; i++) REQUIRE(indices[i] == i);
+  REQUIRE(tracker.size() == 0);
+
+  SUBCASE("Cannot pop from an empty tracker")
+  {
+    CHECK_THROWS_AS(tracker.pop(), std::runtime_error);
+  }
+
+  SUBCASE("The lowest free block is always handed out first")
+  {
+    std::shuffle(indices.begin(), indices.end(), std::default_random_engine{});
+    indices.resize(num_blocks / 2);
+    for (SizeT index : indices) tracker.push(index);
+    CHECK(tracker.size() == num_blocks / 2);
+
+    std::sort(indices.begin(), indices.end());
+    for (SizeT index : indices) CHECK(tracker.pop() == index);
+    CHECK(tracker.size() == 0);
+  }
+
+  SUBCASE("Batches are handed out in ascending order")
+  {
+    for (SizeT index : {4000, 5, 64, 63, 12000, 130}) tracker.push(index);
+    std::vector<SizeT> popped;
+    CHECK(tracker.pop_n(4, [&](const SizeT& index) { popped.push_back(index); }) == 4);
+    CHECK(popped == std::vector<SizeT>{5, 63, 64, 130});
+    CHECK(tracker.pop_n(4, [&](const SizeT& index) { popped.push_back(index); }) == 2);
+    CHECK(popped.back() == 12000);
+  }
+
+  SUBCASE("The occupancy bitmap marks the blocks that are handed out")
+  {
+    for (SizeT index : {0, 65, 12000}) tracker.push(index);
+    tracker.reset();
+    for (SizeT i = 0; i < 70; i++) tracker.pop();
+    tracker.push(3);
+    std::vector<uint64_t> words(memory_pool::bitmap_words(num_blocks), ~uint64_t(0));
+    tracker.occupancy(words.data());
+    CHECK(words[0] == ~uint64_t(8));
+    CHECK(words[1] == 0x3F);
+    CHECK(std::all_of(words.begin() + 2, words.end(), [](uint64_t word) { return word == 0; }));
+  }
+
+  SUBCASE("Rebuilding hands out exactly the blocks that are not marked live")
+  {
+    std::vector<uint64_t> words(memory_pool::bitmap_words(num_blocks), 0);
+    for (SizeT index : {3, 64, 200}) words[index / 64] |= uint64_t(1) << (index % 64);
+    tracker.rebuild(words.data());
+    CHECK(tracker.size() == num_blocks - 3);
+
+    std::vector<uint64_t> occupancy(words.size(), ~uint64_t(0));
+    tracker.occupancy(occupancy.data());
+    CHECK(occupancy == words);
+    for (SizeT index : {0, 1, 2, 4}) CHECK(tracker.pop() == index);
+    for (SizeT i = 4; i < num_blocks - 3; i++) tracker.pop();
+    CHECK(tracker.size() == 0);
+  }
+
+  SUBCASE("Trimming reports every run of free blocks")
+  {
+    std::vector<uint64_t> words(memory_pool::bitmap_words(num_blocks), 0);
+    for (SizeT index : {0, 1, 64, 130, 131}) words[index / 64] |= uint64_t(1) << (index % 64);
+    std::vector<std::pair<SizeT, SizeT>> runs;
+    tracker.trim(words.data(), [&](const SizeT& first, const SizeT& last) {
+      runs.emplace_back(first, last);
+    });
+    CHECK(runs == std::vector<std::pair<SizeT, SizeT>>{{2, 64}, {65, 130}, {132, num_blocks}});
+  }
+
+  SUBCASE("Resetting frees every block")
+  {
+    tracker.push(7);
+    tracker.reset();
+    CHECK(tracker.size() == num_blocks);
+    CHECK(tracker.pop() == 0);
+    CHECK(tracker.pop() == 1);
+  }
+}
+
+
+TEST_CASE("Memory pool with a bitmap tracker")
+{
+  using Pool = MemoryPool<Derived, HeapStorage, NaturalLayout, BitmapTracker>;
+
+  SUBCASE("Live objects stay packed at the start of the pool after churn")
+  {
+    Pool pool(1000);
+    std::vector<Derived*> block_pointers(1000);
+    pool.new_blocks(1000, block_pointers.data());
+    Derived* first_pt = block_pointers.front();
+
+    std::shuffle(block_pointers.begin(), block_pointers.end(), std::default_random_engine{});
+    for (auto& block_pt : block_pointers) pool.delete_block_pt(block_pt);
+
+    for (int i = 0; i < 500; i++) CHECK(pool.new_block_pt() == first_pt + i);
+  }
+
+  SUBCASE("Small types need no padding")
+  {
+    MemoryPool<char, HeapStorage, NaturalLayout, BitmapTracker> pool(100);
+    char* block1_pt = pool.new_block_pt();
+    char* block2_pt = pool.new_block_pt();
+    CHECK(block2_pt - block1_pt == 1);
+  }
+
+  SUBCASE("Live objects are visited in address order")
+  {
+    Pool pool(1000);
+    std::vector<Derived*> block_pointers(1000);
+    pool.new_blocks(1000, block_pointers.data());
+    for (SizeT i = 0; i < 1000; i += 3) pool.delete_block_pt(block_pointers[i]);
+
+    std::vector<Derived*> visited;
+    pool.for_each_live([&](Derived& obj) { visited.push_back(&obj); });
+    block_pointers.erase(std::remove(block_pointers.begin(), block_pointers.end(), nullptr),
+                         block_pointers.end());
+    CHECK(visited == block_pointers);
+  }
+
+  SUBCASE("Compaction packs the live objects at the start of the pool")
+  {
+    Pool pool(1000);
+    std::vector<Derived*> block_pointers(1000);
+    pool.emplace_blocks(1000, block_pointers.data());
+    Derived* first_pt = block_pointers.front();
+    for (SizeT i = 0; i < 1000; i++) {
+      if (i % 4 != 0) pool.destroy(block_pointers[i]);
+    }
+    CHECK(pool.compact().Num_moved == 187);
+
+    std::vector<Derived*> visited;
+    pool.for_each_live([&](Derived& obj) { visited.push_back(&obj); });
+    REQUIRE(visited.size() == 250);
+    CHECK(visited.back() == first_pt + 249);
+    CHECK(pool.new_block_pt() == first_pt + 250);
+    pool.destroy_blocks(visited.data(), visited.size());
+  }
+
+  SUBCASE("Growable pools")
+  {
+    Pool pool(8, 2);
+    std::vector<Derived*> block_pointers(100);
+    pool.emplace_blocks(100, block_pointers.data());
+    CHECK(pool.num_segments() == 4);
+    pool.destroy_blocks(block_pointers.data(), 100);
+    CHECK(pool.available_capacity() == pool.size());
+  }
+}
@@ -0,0 +1,107 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "concurrent_memory_pool.h"
+#include "slot_layout.h"
+
+
+using memory_pool::CacheLineLayout;
+using memory_pool::ConcurrentMemoryPool;
+
+
+TEST_CASE("Single thread")
+{
+  ConcurrentMemoryPool<Point> pool(3);
+  REQUIRE(pool.size() == 3);
+  REQUIRE(pool.available_capacity() == 3);
+
+  Point* block1_pt = pool.new_block_pt(Point{1, 2, 3});
+  Point* block2_pt = pool.new_block_pt();
+
+  SUBCASE("Allocating a block reduces the available capacity")
+  {
+    CHECK(block1_pt != block2_pt);
+    CHECK(block1_pt->z == 3);
+    CHECK(pool.available_capacity() == 1);
+  }
+
+  SUBCASE("A deallocated block is reused and the pointer is nulled out")
+  {
+    Point* freed_pt = block1_pt;
+    pool.delete_block_pt(block1_pt);
+    CHECK(block1_pt == nullptr);
+    CHECK(pool.available_capacity() == 2);
+    CHECK(pool.new_block_pt() == freed_pt);
+  }
+
+  SUBCASE("Cannot allocate more than is available")
+  {
+    pool.new_block_pt();
+    CHECK_THROWS_AS(pool.new_block_pt(), std::out_of_range);
+  }
+}
+
+
+TEST_CASE("Multiple threads")
+{
+  const int num_threads = 4;
+  const int num_blocks_per_thread = 256;
+  ConcurrentMemoryPool<Point> pool(num_threads * num_blocks_per_thread);
+
+  // Each thread repeatedly fills and empties its share of the pool; if two threads were ever
+  // handed the same block, one of them would see the other's values
+  std::vector<int> num_errors(num_threads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      std::vector<Point*> block_pointers(num_blocks_per_thread);
+      for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < num_blocks_per_thread; i++) {
+          block_pointers[i] = pool.new_block_pt(Point{t, i, round});
+        }
+        for (int i = 0; i < num_blocks_per_thread; i++) {
+          const Point& p = *block_pointers[i];
+          if ((p.x != t) || (p.y != i) || (p.z != round)) num_errors[t]++;
+          pool.delete_block_pt(block_pointers[i]);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (int t = 0; t < num_threads; t++) CHECK(num_errors[t] == 0);
+  CHECK(pool.available_capacity() == pool.size());
+
+  // Every block is on the free list exactly once
+  std::set<Point*> blocks;
+  for (int i = 0; i < num_threads * num_blocks_per_thread; i++) blocks.insert(pool.new_block_pt());
+  CHECK(blocks.size() == pool.size());
+}
+
+
+TEST_CASE("Layout")
+{
+  SUBCASE("Over-aligned types are aligned")
+  {
+    struct alignas(128) OverAligned {
+      int Value;
+    };
+    ConcurrentMemoryPool<OverAligned> pool(4);
+    for (int i = 0; i < 4; i++) {
+      CHECK(reinterpret_cast<std::uintptr_t>(pool.new_block_pt()) % 128 == 0);
+    }
+  }
+
+  SUBCASE("Blocks can be padded to a cache line")
+  {
+    ConcurrentMemoryPool<Point, CacheLineLayout> pool(4);
+    auto block1_pt = reinterpret_cast<std::uintptr_t>(pool.new_block_pt());
+    auto block2_pt = reinterpret_cast<std::uintptr_t>(pool.new_block_pt());
+    CHECK(block1_pt % 64 == 0);
+    CHECK(block2_pt - block1_pt == 64);
+  }
+}
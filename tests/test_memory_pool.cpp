@@ -1,10 +1,23 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <doctest/doctest.h>
 #include "ExampleClasses.h"
 #include "memory_pool.h"
 
 
 using memory_pool::MemoryPool;
+using memory_pool::SizeT;
 
 
 TEST_CASE("Point")
@@ -16,9 +29,17 @@ TEST_CASE("Point")
 
 TEST_CASE("Base1")
 {
-  SUBCASE("Cannot allocate more than 'g_MaxNumberOfObjectsInPool' objects")
+  SUBCASE("Can allocate more than 'g_DefaultNumberOfObjectsInPool' objects")
   {
-    CHECK_THROWS_AS(MemoryPool<Base1>(memory_pool::g_MaxNumberOfObjectsInPool + 1), std::bad_alloc);
+    MemoryPool<Base1> pool(memory_pool::g_DefaultNumberOfObjectsInPool + 1);
+    CHECK(pool.size() == memory_pool::g_DefaultNumberOfObjectsInPool + 1);
+  }
+
+  SUBCASE("Cannot allocate more objects than fit in the address space")
+  {
+    constexpr SizeT max_size = std::numeric_limits<SizeT>::max();
+    CHECK_THROWS_AS(MemoryPool<Base1>(max_size / sizeof(Base1) + 2), std::bad_alloc);
+    CHECK_THROWS_AS(MemoryPool<Base1>(max_size), std::bad_alloc);
   }
 }
 
@@ -33,7 +54,7 @@ TEST_CASE("Base2")
 
 TEST_CASE("Derived")
 {
-  const auto& num_objects = memory_pool::g_MaxNumberOfObjectsInPool;
+  const auto& num_objects = memory_pool::g_DefaultNumberOfObjectsInPool;
   MemoryPool<Derived> pool(num_objects);
   REQUIRE(pool.size() == num_objects);
 
@@ -78,14 +99,701 @@ TEST_CASE("NoDefaultConstructor")
     CHECK(block2_pt->GetNumber() == 19);
   }
 
-#ifndef NDEBUG
-  // NOTE: MemoryPool only checks that the pool has available space when asserts are enabled,
-  // and will produce a std::out_of_range exception. Otherwise, the attempt to allocate another
-  // block will produce a segmentation fault.
+  // NOTE: A pool that is not growable produces a std::out_of_range exception when it runs out
+  // of space
   SUBCASE("Cannot allocate more than is available")
   {
     REQUIRE(pool.available_capacity() == 0);
     CHECK_THROWS_AS(pool.new_block_pt(NoDefaultConstructor(3)), std::out_of_range);
   }
-#endif // NDEBUG
+
+  SUBCASE("try_new_block_pt() returns nullptr instead of throwing")
+  {
+    CHECK(pool.try_new_block_pt() == nullptr);
+    pool.delete_block_pt(block1_pt);
+    CHECK(pool.try_new_block_pt() != nullptr);
+    pool.set_growth_factor(2);
+    CHECK(pool.try_new_block_pt() != nullptr);
+    CHECK(pool.num_segments() == 2);
+  }
+}
+
+
+TEST_CASE("Block reuse")
+{
+  MemoryPool<Point> pool(4);
+  Point* block1_pt = pool.new_block_pt();
+  Point* block2_pt = pool.new_block_pt();
+  REQUIRE(pool.available_capacity() == 2);
+
+  SUBCASE("Blocks are handed out at distinct addresses")
+  {
+    CHECK(block1_pt != block2_pt);
+  }
+
+  SUBCASE("The most recently freed block is handed out next")
+  {
+    Point* freed_pt = block1_pt;
+    pool.delete_block_pt(block1_pt);
+    CHECK(pool.available_capacity() == 3);
+    CHECK(pool.new_block_pt() == freed_pt);
+    CHECK(pool.available_capacity() == 2);
+  }
+
+  SUBCASE("Resetting the pool frees every block without reallocating")
+  {
+    Point* first_pt = block1_pt;
+    pool.reset();
+    CHECK(pool.size() == 4);
+    CHECK(pool.available_capacity() == 4);
+    CHECK(pool.new_block_pt() == first_pt);
+  }
+}
+
+
+TEST_CASE("Growable pool")
+{
+  MemoryPool<Point> pool(4, 2);
+  REQUIRE(pool.is_growable());
+  REQUIRE(pool.num_segments() == 1);
+
+  std::vector<Point*> block_pointers;
+  for (int i = 0; i < 4; i++) block_pointers.push_back(pool.new_block_pt(Point{i, i, i}));
+  REQUIRE(pool.available_capacity() == 0);
+
+  SUBCASE("Allocating from a full pool adds a larger segment")
+  {
+    block_pointers.push_back(pool.new_block_pt(Point{4, 4, 4}));
+    CHECK(pool.num_segments() == 2);
+    CHECK(pool.size() == 12);
+    CHECK(pool.available_capacity() == 7);
+  }
+
+  SUBCASE("Existing pointers stay valid when the pool grows")
+  {
+    for (int i = 4; i < 100; i++) block_pointers.push_back(pool.new_block_pt(Point{i, i, i}));
+    CHECK(pool.num_segments() == 5);
+    for (int i = 0; i < 100; i++) CHECK(block_pointers[i]->x == i);
+  }
+
+  SUBCASE("Blocks from any segment can be deallocated and reused")
+  {
+    for (int i = 4; i < 100; i++) block_pointers.push_back(pool.new_block_pt(Point{i, i, i}));
+    const auto capacity = pool.available_capacity();
+    Point* first_pt = block_pointers.front();
+    pool.delete_block_pt(block_pointers.front());
+    pool.delete_block_pt(block_pointers.back());
+    CHECK(pool.available_capacity() == capacity + 2);
+    Point* reused_pt = pool.new_block_pt();
+    CHECK(reused_pt == first_pt);
+    CHECK(pool.num_segments() == 5);
+  }
+
+  SUBCASE("A segment too large to address is not added")
+  {
+    // 4 times this factor wraps around to 4 if it is not checked
+    pool.set_growth_factor((SizeT(1) << 62) + 1);
+    CHECK(pool.growth().next_segment_size(4) == std::numeric_limits<SizeT>::max());
+    CHECK_THROWS_AS(pool.new_block_pt(), std::bad_alloc);
+    CHECK(pool.num_segments() == 1);
+    CHECK(pool.size() == 4);
+  }
+}
+
+
+// Counts how many objects are alive
+struct Counted {
+  Counted(int value) : Value(value) { Num_alive++; }
+  Counted(Counted&& other) : Value(other.Value) { Num_alive++; }
+  ~Counted() { Num_alive--; }
+
+  int Value;
+  static int Num_alive;
+};
+int Counted::Num_alive = 0;
+
+
+// Throws from its constructor
+struct ThrowsOnConstruction {
+  ThrowsOnConstruction() { throw std::runtime_error("Failed to construct"); }
+};
+
+
+TEST_CASE("Construction in place")
+{
+  SUBCASE("Objects with virtual functions are constructed properly")
+  {
+    MemoryPool<Derived> pool(4);
+    Derived* derived_pt = pool.emplace();
+    Base1* base1_pt = derived_pt;
+    Base2* base2_pt = derived_pt;
+    CHECK(dynamic_cast<Derived*>(base1_pt) == derived_pt);
+    CHECK(dynamic_cast<Derived*>(base2_pt) == derived_pt);
+    pool.destroy(derived_pt);
+    CHECK(derived_pt == nullptr);
+    CHECK(pool.available_capacity() == 4);
+  }
+
+  SUBCASE("Constructor arguments are forwarded")
+  {
+    MemoryPool<NoDefaultConstructor> pool(2);
+    NoDefaultConstructor* block_pt = pool.emplace(42);
+    CHECK(block_pt->GetNumber() == 42);
+    CHECK(pool.available_capacity() == 1);
+  }
+
+  SUBCASE("Destroying an object runs its destructor")
+  {
+    MemoryPool<Counted> pool(4);
+    Counted* counted1_pt = pool.emplace(1);
+    Counted* counted2_pt = pool.new_block_pt(Counted(2));
+    CHECK(Counted::Num_alive == 2);
+    CHECK(counted2_pt->Value == 2);
+    pool.destroy(counted1_pt);
+    pool.destroy(counted2_pt);
+    CHECK(Counted::Num_alive == 0);
+    CHECK(pool.available_capacity() == 4);
+  }
+
+  SUBCASE("Destroying every object at once runs their destructors")
+  {
+    MemoryPool<Counted> pool(2, 2);
+    for (int i = 0; i < 5; i++) pool.emplace(i);
+    Counted* freed_pt = pool.emplace(5);
+    pool.destroy(freed_pt);
+    CHECK(Counted::Num_alive == 5);
+    pool.destroy_all();
+    CHECK(Counted::Num_alive == 0);
+    CHECK(pool.available_capacity() == pool.size());
+  }
+
+  SUBCASE("A block is returned to the pool if the constructor throws")
+  {
+    MemoryPool<ThrowsOnConstruction> pool(4);
+    CHECK_THROWS_AS(pool.emplace(), std::runtime_error);
+    CHECK(pool.available_capacity() == 4);
+  }
+}
+
+
+TEST_CASE("pool_unique_ptr")
+{
+  MemoryPool<Counted> pool(4);
+  {
+    memory_pool::pool_unique_ptr<Counted> counted_pt = pool.make_unique(7);
+    CHECK(counted_pt->Value == 7);
+    CHECK(Counted::Num_alive == 1);
+    CHECK(pool.available_capacity() == 3);
+  }
+  CHECK(Counted::Num_alive == 0);
+  CHECK(pool.available_capacity() == 4);
+}
+
+
+static_assert(sizeof(memory_pool::Handle<Point>) == 4);
+static_assert(sizeof(memory_pool::Handle<Point, uint64_t>) == 8);
+
+
+TEST_CASE("Handles")
+{
+  using memory_pool::Handle;
+
+  MemoryPool<Counted> pool(4);
+
+  SUBCASE("A handle resolves to its object until the object is freed")
+  {
+    Handle<Counted> handle = pool.emplace_handle(5);
+    REQUIRE(pool.resolve(handle) != nullptr);
+    CHECK(pool.resolve(handle)->Value == 5);
+    CHECK(pool.available_capacity() == 3);
+
+    const Handle<Counted> copy = handle;
+    pool.destroy(handle);
+    CHECK(handle.is_null());
+    CHECK(pool.resolve(handle) == nullptr);
+    CHECK(pool.resolve(copy) == nullptr);
+    CHECK(Counted::Num_alive == 0);
+    CHECK(pool.available_capacity() == 4);
+  }
+
+  SUBCASE("A stale handle does not resolve to the object that reuses its slot")
+  {
+    Handle<Counted> old_handle = pool.emplace_handle(1);
+    const Handle<Counted> stale_handle = old_handle;
+    pool.destroy(old_handle);
+    Handle<Counted> new_handle = pool.emplace_handle(2);
+    CHECK(new_handle.index() == stale_handle.index());
+    CHECK(new_handle != stale_handle);
+    CHECK(pool.resolve(stale_handle) == nullptr);
+    CHECK(pool.resolve(new_handle)->Value == 2);
+
+    // Freeing through a stale handle does nothing
+    Handle<Counted> stale_copy = stale_handle;
+    pool.destroy(stale_copy);
+    CHECK(pool.resolve(new_handle)->Value == 2);
+    CHECK(pool.available_capacity() == 3);
+    pool.destroy(new_handle);
+  }
+
+  SUBCASE("Null handles and handles from outside the table resolve to nullptr")
+  {
+    CHECK(pool.resolve(Handle<Counted>()) == nullptr);
+    CHECK(pool.resolve(Handle<Counted>(3, 0)) == nullptr);
+    CHECK_FALSE(Handle<Counted>());
+  }
+
+  SUBCASE("Handles are packed into a value and back")
+  {
+    const Handle<Counted> handle = pool.emplace_handle(3);
+    Handle<Counted> unpacked = Handle<Counted>::from_value(handle.value());
+    CHECK(pool.resolve(unpacked)->Value == 3);
+    pool.destroy(unpacked);
+  }
+
+  SUBCASE("Resetting or clearing the pool makes every handle stale")
+  {
+    const Handle<Counted> handle1 = pool.new_handle();
+    const Handle<Counted, uint64_t> handle2 = pool.new_handle<Handle<Counted, uint64_t>>();
+    pool.reset();
+    CHECK(pool.resolve(handle1) == nullptr);
+    CHECK(pool.resolve(handle2) == nullptr);
+
+    const Handle<Counted> handle3 = pool.new_handle();
+    pool.clear();
+    CHECK(pool.resolve(handle3) == nullptr);
+  }
+
+  SUBCASE("Running out of handle indices throws and leaves the pool unchanged")
+  {
+    using TinyHandle = Handle<Counted, uint8_t, 2>;
+    for (int i = 0; i < 3; i++) pool.new_handle<TinyHandle>();
+    CHECK_THROWS_AS(pool.new_handle<TinyHandle>(), std::out_of_range);
+    CHECK(pool.available_capacity() == 1);
+  }
+
+  SUBCASE("Handles survive the pool growing")
+  {
+    pool.set_growth_factor(2);
+    std::vector<Handle<Counted>> handles;
+    for (int i = 0; i < 100; i++) handles.push_back(pool.emplace_handle(i));
+    for (int i = 0; i < 100; i++) CHECK(pool.resolve(handles[i])->Value == i);
+    for (auto& handle : handles) pool.destroy(handle);
+    CHECK(Counted::Num_alive == 0);
+  }
+
+  SUBCASE("A block and its handle are returned to the pool if the constructor throws")
+  {
+    MemoryPool<ThrowsOnConstruction> throwing_pool(4);
+    CHECK_THROWS_AS(throwing_pool.emplace_handle(), std::runtime_error);
+    CHECK(throwing_pool.available_capacity() == 4);
+  }
+}
+
+
+// Throws from the constructor of the third object constructed
+struct ThrowsOnThirdConstruction : Counted {
+  ThrowsOnThirdConstruction(int value) : Counted(value)
+  {
+    if (++Num_constructed == 3) throw std::runtime_error("Failed to construct");
+  }
+
+  static int Num_constructed;
+};
+int ThrowsOnThirdConstruction::Num_constructed = 0;
+
+
+TEST_CASE("Batch allocation")
+{
+  SUBCASE("Blocks allocated in a batch are distinct and can be deleted in a batch")
+  {
+    MemoryPool<Point> pool(16);
+    std::vector<Point*> block_pointers(10);
+    pool.new_blocks(10, block_pointers.data());
+    CHECK(pool.available_capacity() == 6);
+    for (int i = 0; i < 10; i++) *block_pointers[i] = Point{i, i, i};
+    for (int i = 0; i < 10; i++) CHECK(block_pointers[i]->x == i);
+
+    std::vector<Point*> sorted_pointers(block_pointers);
+    std::sort(sorted_pointers.begin(), sorted_pointers.end());
+    CHECK(std::unique(sorted_pointers.begin(), sorted_pointers.end()) == sorted_pointers.end());
+
+    pool.delete_blocks(block_pointers.data(), 10);
+    CHECK(pool.available_capacity() == 16);
+    for (Point* block_pt : block_pointers) CHECK(block_pt == nullptr);
+  }
+
+  SUBCASE("Batches mix reused and never-used blocks")
+  {
+    MemoryPool<Point> pool(8);
+    std::vector<Point*> block_pointers(4);
+    pool.new_blocks(4, block_pointers.data());
+    pool.delete_blocks(block_pointers.data(), 2);
+    CHECK(pool.available_capacity() == 6);
+
+    std::vector<Point*> more_pointers(6);
+    pool.new_blocks(6, more_pointers.data());
+    CHECK(pool.available_capacity() == 0);
+    CHECK_THROWS_AS(pool.new_block_pt(), std::out_of_range);
+    pool.delete_blocks(more_pointers.data(), 6);
+    pool.delete_blocks(block_pointers.data(), 4);
+    CHECK(pool.available_capacity() == 8);
+  }
+
+  SUBCASE("A fixed-size pool allocates nothing if the batch does not fit")
+  {
+    MemoryPool<Point> pool(4);
+    std::vector<Point*> block_pointers(5);
+    CHECK_THROWS_AS(pool.new_blocks(5, block_pointers.data()), std::out_of_range);
+    CHECK(pool.available_capacity() == 4);
+  }
+
+  SUBCASE("A growable pool grows as often as a batch needs")
+  {
+    MemoryPool<Point> pool(4, 2);
+    std::vector<Point*> block_pointers(100);
+    pool.new_blocks(100, block_pointers.data());
+    CHECK(pool.num_segments() == 5);
+    for (int i = 0; i < 100; i++) *block_pointers[i] = Point{i, i, i};
+
+    // Deleting a batch spanning several segments returns every block to its own segment
+    std::shuffle(block_pointers.begin(), block_pointers.end(), std::default_random_engine{});
+    const auto capacity = pool.available_capacity();
+    pool.delete_blocks(block_pointers.data(), 100);
+    CHECK(pool.available_capacity() == capacity + 100);
+    pool.new_blocks(100, block_pointers.data());
+    CHECK(pool.num_segments() == 5);
+  }
+
+  SUBCASE("Objects can be constructed and destroyed in a batch")
+  {
+    MemoryPool<Counted> pool(8);
+    std::vector<Counted*> counted_pointers(5);
+    pool.emplace_blocks(5, counted_pointers.data(), 3);
+    CHECK(Counted::Num_alive == 5);
+    for (Counted* counted_pt : counted_pointers) CHECK(counted_pt->Value == 3);
+    pool.destroy_blocks(counted_pointers.data(), 5);
+    CHECK(Counted::Num_alive == 0);
+    CHECK(pool.available_capacity() == 8);
+  }
+
+  SUBCASE("Nothing is leaked if a constructor in a batch throws")
+  {
+    MemoryPool<ThrowsOnThirdConstruction> pool(8);
+    std::vector<ThrowsOnThirdConstruction*> pointers(5);
+    CHECK_THROWS_AS(pool.emplace_blocks(5, pointers.data(), 1), std::runtime_error);
+    CHECK(Counted::Num_alive == 0);
+    CHECK(pool.available_capacity() == 8);
+  }
+}
+
+
+// A type that needs more alignment than operator new provides by default
+struct alignas(128) OverAligned {
+  int Value;
+};
+
+
+TEST_CASE("Over-aligned types")
+{
+  MemoryPool<OverAligned> pool(10, 2);
+  std::vector<OverAligned*> block_pointers(100);
+  pool.new_blocks(100, block_pointers.data());
+  CHECK(pool.num_segments() == 4);
+  for (OverAligned* block_pt : block_pointers) {
+    CHECK(reinterpret_cast<std::uintptr_t>(block_pt) % alignof(OverAligned) == 0);
+  }
+  pool.delete_blocks(block_pointers.data(), 100);
+}
+
+
+TEST_CASE("Iterating over live objects")
+{
+  MemoryPool<Point> pool(64, 2);
+  std::vector<Point*> block_pointers(1000);
+  pool.new_blocks(1000, block_pointers.data());
+  for (size_t i = 0; i < block_pointers.size(); i++) {
+    block_pointers[i]->x = static_cast<float>(i);
+  }
+  std::shuffle(block_pointers.begin(), block_pointers.end(), std::default_random_engine{});
+  pool.delete_blocks(block_pointers.data(), 600);
+  std::vector<Point*> live_pointers(block_pointers.begin() + 600, block_pointers.end());
+  std::sort(live_pointers.begin(), live_pointers.end(), std::less<Point*>());
+
+  SUBCASE("Every live object is visited once, in address order")
+  {
+    std::vector<Point*> visited;
+    pool.for_each_live([&](Point& point) { visited.push_back(&point); });
+    CHECK(visited == live_pointers);
+  }
+
+  SUBCASE("The iterator visits the same objects")
+  {
+    auto live = pool.live_objects();
+    CHECK(live.size() == 400);
+    CHECK(std::distance(live.begin(), live.end()) == 400);
+    std::vector<Point*> visited;
+    for (Point& point : live) visited.push_back(&point);
+    CHECK(visited == live_pointers);
+  }
+
+  SUBCASE("Blocks handed out after others were freed are visited")
+  {
+    MemoryPool<Point> small_pool(200);
+    std::vector<Point*> pointers(100);
+    small_pool.new_blocks(100, pointers.data());
+    small_pool.delete_block_pt(pointers[10]);
+    small_pool.delete_block_pt(pointers[70]);
+    pointers.push_back(small_pool.new_block_pt());
+    std::vector<Point*> more_pointers(50);
+    small_pool.new_blocks(50, more_pointers.data());
+    pointers.insert(pointers.end(), more_pointers.begin(), more_pointers.end());
+    pointers.erase(std::remove(pointers.begin(), pointers.end(), nullptr), pointers.end());
+    std::sort(pointers.begin(), pointers.end(), std::less<Point*>());
+
+    std::vector<Point*> visited;
+    for (Point& point : small_pool.live_objects()) visited.push_back(&point);
+    CHECK(visited == pointers);
+  }
+
+  SUBCASE("An empty pool has no live objects")
+  {
+    MemoryPool<Point> empty_pool;
+    CHECK(empty_pool.live_objects().empty());
+    CHECK(empty_pool.live_objects().begin() == empty_pool.live_objects().end());
+    pool.delete_blocks(block_pointers.data() + 600, 400);
+    CHECK(pool.live_objects().begin() == pool.live_objects().end());
+  }
+
+  SUBCASE("Objects can be freed while they are visited")
+  {
+    pool.for_each_live([&](Point& point) {
+      Point* point_pt = &point;
+      pool.delete_block_pt(point_pt);
+    });
+    CHECK(pool.available_capacity() == pool.size());
+  }
+
+  SUBCASE("The parallel version visits every live object once")
+  {
+    std::vector<std::atomic<int>> num_visits(1000);
+    pool.for_each_live(memory_pool::ParallelPolicy{4, 1}, [&](Point& point) {
+      num_visits[static_cast<size_t>(point.x)]++;
+    });
+    int num_visited = 0;
+    for (const auto& num : num_visits) {
+      CHECK(num <= 1);
+      num_visited += num;
+    }
+    CHECK(num_visited == 400);
+  }
+
+  SUBCASE("Exceptions thrown by the parallel version are rethrown")
+  {
+    auto throw_on_first = [&](Point& point) {
+      if (&point == live_pointers.front()) throw std::runtime_error("first");
+    };
+    CHECK_THROWS_AS(pool.for_each_live(memory_pool::ParallelPolicy{4, 1}, throw_on_first),
+                    std::runtime_error);
+  }
+}
+
+
+TEST_CASE("Compaction")
+{
+  using memory_pool::Handle;
+
+  // Three segments, of 64, 128 and 256 blocks, with every fifth object still alive
+  MemoryPool<Counted> pool(64, 2);
+  std::vector<Counted*> block_pointers(300);
+  pool.emplace_blocks(300, block_pointers.data(), 0);
+  const std::vector<Counted*> blocks = block_pointers;
+  for (int i = 0; i < 300; i++) {
+    block_pointers[i]->Value = i;
+    if (i % 5 != 0) pool.destroy(block_pointers[i]);
+  }
+  block_pointers.erase(std::remove(block_pointers.begin(), block_pointers.end(), nullptr),
+                       block_pointers.end());
+  REQUIRE(pool.num_segments() == 3);
+  REQUIRE(Counted::Num_alive == 60);
+
+  auto live_values = [&]() {
+    std::vector<int> values;
+    pool.for_each_live([&](Counted& obj) { values.push_back(obj.Value); });
+    std::sort(values.begin(), values.end());
+    return values;
+  };
+  auto is_packed = [&]() {
+    std::vector<Counted*> visited;
+    pool.for_each_live([&](Counted& obj) { visited.push_back(&obj); });
+    for (SizeT i = 0; i < visited.size(); i++) {
+      if (visited[i] != blocks[i]) return false;
+    }
+    return true;
+  };
+  auto destroy_all = [&]() {
+    pool.for_each_live([&](Counted& obj) {
+      Counted* obj_pt = &obj;
+      pool.destroy(obj_pt);
+    });
+  };
+  const std::vector<int> values = live_values();
+
+  SUBCASE("Live objects are moved into the lowest blocks and relocations are reported")
+  {
+    std::vector<std::pair<Counted*, Counted*>> relocations;
+    const auto progress = pool.compact({}, [&](Counted* old_pt, Counted* new_pt) {
+      relocations.emplace_back(old_pt, new_pt);
+    });
+    CHECK(progress.Is_complete);
+    CHECK(progress.Num_moved == 48);
+    CHECK(relocations.size() == 48);
+    CHECK(Counted::Num_alive == 60);
+    CHECK(live_values() == values);
+    CHECK(is_packed());
+    CHECK(pool.available_capacity() == pool.size() - 60);
+
+    // The reported relocations bring the old pointers up to date
+    for (const auto& [old_pt, new_pt] : relocations) {
+      std::replace(block_pointers.begin(), block_pointers.end(), old_pt, new_pt);
+    }
+    for (SizeT i = 0; i < block_pointers.size(); i++) {
+      CHECK(block_pointers[i]->Value == values[i]);
+    }
+
+    // The free blocks are handed out from the lowest
+    CHECK(pool.emplace(-1) == blocks[60]);
+    CHECK(pool.emplace(-1) == blocks[61]);
+    CHECK(pool.compact().Num_moved == 0);
+    destroy_all();
+  }
+
+  SUBCASE("Compaction can be spread over several calls with a move budget")
+  {
+    memory_pool::CompactionBudget budget;
+    budget.Max_moves = 10;
+    SizeT num_moved = 0;
+    int num_calls = 0;
+    while (true) {
+      const auto progress = pool.compact(budget);
+      CHECK(progress.Num_moved <= 10);
+      num_moved += progress.Num_moved;
+      num_calls++;
+      if (progress.Is_complete) break;
+
+      // The pool can be used as normal between calls
+      Counted* obj_pt = pool.emplace(-1);
+      pool.destroy(obj_pt);
+    }
+    CHECK(num_moved == 48);
+    CHECK(num_calls == 5);
+    CHECK(live_values() == values);
+    CHECK(is_packed());
+    destroy_all();
+  }
+
+  SUBCASE("A time budget limits the work done per call")
+  {
+    memory_pool::CompactionBudget budget;
+    budget.Max_time = std::chrono::steady_clock::duration::zero();
+    const auto progress = pool.compact(budget);
+    CHECK(progress.Num_moved == 0);
+    CHECK_FALSE(progress.Is_complete);
+    CHECK(pool.compact().Is_complete);
+    CHECK(is_packed());
+    destroy_all();
+  }
+
+  SUBCASE("Handles are updated when their objects move")
+  {
+    std::vector<Handle<Counted>> handles;
+    for (int i = 0; i < 20; i++) handles.push_back(pool.emplace_handle(1000 + i));
+    Handle<Counted> stale_handle = handles.back();
+    pool.destroy(handles.back());
+    handles.pop_back();
+
+    pool.compact();
+    CHECK(is_packed());
+    for (int i = 0; i < 19; i++) {
+      Counted* obj_pt = pool.resolve(handles[i]);
+      REQUIRE(obj_pt != nullptr);
+      CHECK(obj_pt->Value == 1000 + i);
+      CHECK(std::find(blocks.begin(), blocks.begin() + 79, obj_pt) != blocks.begin() + 79);
+    }
+    CHECK(pool.resolve(stale_handle) == nullptr);
+    for (auto& handle : handles) pool.destroy(handle);
+    destroy_all();
+  }
+
+  SUBCASE("Empty and fully packed pools have nothing to move")
+  {
+    MemoryPool<Counted> empty_pool;
+    CHECK(empty_pool.compact().Is_complete);
+    CHECK(empty_pool.compact().Num_moved == 0);
+    destroy_all();
+    CHECK(pool.compact().Is_complete);
+    CHECK(pool.compact().Num_moved == 0);
+    CHECK(pool.available_capacity() == pool.size());
+  }
+}
+
+
+TEST_CASE("Trimming")
+{
+  // Three segments, of 64, 128 and 256 blocks
+  MemoryPool<Point> pool(64, 2);
+  std::vector<Point*> block_pointers(300);
+  pool.new_blocks(300, block_pointers.data());
+  REQUIRE(pool.num_segments() == 3);
+
+  SUBCASE("Empty segments added by growth are freed, most recent first")
+  {
+    pool.delete_blocks(block_pointers.data() + 100, 200);
+    CHECK(pool.trim() > 0);
+    CHECK(pool.num_segments() == 2);
+    CHECK(pool.size() == 192);
+    CHECK(pool.available_capacity() == 92);
+
+    // Growing again adds a segment of the same size as the one freed
+    std::vector<Point*> more_pointers(100);
+    pool.new_blocks(100, more_pointers.data());
+    CHECK(pool.num_segments() == 3);
+    CHECK(pool.size() == 448);
+  }
+
+  SUBCASE("Segments with live blocks and the first segment are kept")
+  {
+    pool.delete_blocks(block_pointers.data() + 1, 299);
+    pool.trim();
+    CHECK(pool.num_segments() == 1);
+    pool.delete_block_pt(block_pointers[0]);
+    pool.trim();
+    CHECK(pool.num_segments() == 1);
+    CHECK(pool.size() == 64);
+    CHECK(pool.available_capacity() == 64);
+  }
+
+  SUBCASE("Heap storage cannot release part of a segment")
+  {
+    MemoryPool<Point> fixed_pool(1000);
+    CHECK(fixed_pool.trim() == 0);
+    CHECK(fixed_pool.size() == 1000);
+  }
+
+  SUBCASE("Decay frees empty segments once the pool has been idle for the decay time")
+  {
+    pool.set_decay_time(std::chrono::milliseconds(20));
+    pool.delete_blocks(block_pointers.data(), 300);
+    CHECK(pool.decay() == 0);
+    CHECK(pool.num_segments() == 3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    CHECK(pool.decay() > 0);
+    CHECK(pool.num_segments() == 1);
+  }
+
+  SUBCASE("Decay is off by default")
+  {
+    pool.delete_blocks(block_pointers.data(), 300);
+    CHECK(pool.decay() == 0);
+    CHECK(pool.num_segments() == 3);
+  }
 }
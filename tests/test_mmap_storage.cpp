@@ -0,0 +1,211 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <sys/mman.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "bitmap_tracker.h"
+#include "mmap_storage.h"
+
+
+using memory_pool::BitmapTracker;
+using memory_pool::Byte;
+using memory_pool::Decommit;
+using memory_pool::g_HugePageSize;
+using memory_pool::HugePages;
+using memory_pool::MemoryPool;
+using memory_pool::MmapStorage;
+using memory_pool::NaturalLayout;
+using memory_pool::Prefault;
+using memory_pool::SizeT;
+
+
+// Allocates every block in 'pool', writes to each of them and checks they can be read back
+template<class Pool>
+void check_blocks_are_usable(Pool& pool)
+{
+  const SizeT num_blocks = pool.available_capacity();
+  std::vector<Point*> block_pointers(num_blocks);
+  pool.new_blocks(num_blocks, block_pointers.data());
+  for (SizeT i = 0; i < num_blocks; i++) {
+    const int value = static_cast<int>(i);
+    *block_pointers[i] = Point{value, value, value};
+  }
+  for (SizeT i = 0; i < num_blocks; i++) CHECK(block_pointers[i]->z == static_cast<int>(i));
+  pool.delete_blocks(block_pointers.data(), num_blocks);
+  CHECK(pool.available_capacity() == num_blocks);
+}
+
+
+// The number of pages in the 'num_bytes' bytes from the page-aligned 'pt' that are resident
+static SizeT num_resident_pages(const void* pt, const SizeT& num_bytes)
+{
+  const SizeT page_size = static_cast<SizeT>(::sysconf(_SC_PAGESIZE));
+  std::vector<unsigned char> is_resident((num_bytes + page_size - 1) / page_size);
+  REQUIRE(::mincore(const_cast<void*>(pt), num_bytes, is_resident.data()) == 0);
+  SizeT num_resident = 0;
+  for (unsigned char flags : is_resident) num_resident += (flags & 1);
+  return num_resident;
+}
+
+
+TEST_CASE("Mapping size")
+{
+  using SmallStorage = MmapStorage<HugePages::None>;
+  using HugeStorage = MmapStorage<HugePages::Transparent>;
+  const SizeT page_size = SmallStorage::mapping_size(1);
+  CHECK(page_size >= 4096);
+  CHECK(SmallStorage::mapping_size(0) == page_size);
+  CHECK(SmallStorage::mapping_size(page_size + 1) == 2 * page_size);
+  CHECK(SmallStorage::mapping_size(3 * g_HugePageSize) == 3 * g_HugePageSize);
+
+  // Huge pages are only used once a request fills at least one
+  CHECK(HugeStorage::mapping_size(g_HugePageSize - 1) == g_HugePageSize);
+  CHECK(HugeStorage::mapping_size(1) == page_size);
+  CHECK(HugeStorage::mapping_size(g_HugePageSize + 1) == 2 * g_HugePageSize);
+}
+
+
+TEST_CASE("Pools backed by normal pages")
+{
+  SUBCASE("Fixed-size pool")
+  {
+    MemoryPool<Point, MmapStorage<HugePages::None>> pool(1000);
+    check_blocks_are_usable(pool);
+  }
+
+  SUBCASE("Growable pool")
+  {
+    MemoryPool<Point, MmapStorage<HugePages::None, Prefault::Populate>> pool(16, 2);
+    std::vector<Point*> block_pointers(1000);
+    pool.new_blocks(1000, block_pointers.data());
+    CHECK(pool.num_segments() == 6);
+    check_blocks_are_usable(pool);
+  }
+
+  SUBCASE("Prefaulting with a hint")
+  {
+    MemoryPool<Point, MmapStorage<HugePages::None, Prefault::WillNeed>> pool(1000);
+    check_blocks_are_usable(pool);
+  }
+}
+
+
+TEST_CASE("Pools backed by huge pages")
+{
+  // Large enough for a segment to span several huge pages
+  const SizeT num_blocks = 4 * g_HugePageSize / sizeof(Point);
+
+  SUBCASE("Transparent huge pages")
+  {
+    MemoryPool<Point, MmapStorage<HugePages::Transparent>> pool(num_blocks);
+    Point* first_pt = pool.new_block_pt();
+    CHECK(reinterpret_cast<std::uintptr_t>(first_pt) % g_HugePageSize == 0);
+    pool.delete_block_pt(first_pt);
+    check_blocks_are_usable(pool);
+  }
+
+  SUBCASE("Explicit huge pages fall back cleanly if none are reserved")
+  {
+    MemoryPool<Point, MmapStorage<HugePages::Explicit, Prefault::Populate>> pool(num_blocks);
+    Point* first_pt = pool.new_block_pt();
+    CHECK(reinterpret_cast<std::uintptr_t>(first_pt) % g_HugePageSize == 0);
+    pool.delete_block_pt(first_pt);
+    check_blocks_are_usable(pool);
+  }
+
+  SUBCASE("Small segments use normal pages")
+  {
+    MemoryPool<Point, MmapStorage<HugePages::Explicit, Prefault::Populate>> pool(100, 2);
+    check_blocks_are_usable(pool);
+  }
+}
+
+
+TEST_CASE("Trimming")
+{
+  using Storage = MmapStorage<HugePages::None>;
+  const SizeT page_size = Storage::mapping_size(1);
+  const SizeT num_blocks = 1 << 14;
+  std::vector<Point*> block_pointers(num_blocks);
+
+  SUBCASE("Pages above the highest live block are released and committed again on reuse")
+  {
+    MemoryPool<Point, Storage> pool(num_blocks);
+    pool.new_blocks(num_blocks, block_pointers.data());
+    for (Point* point_pt : block_pointers) *point_pt = Point{1, 2, 3};
+    const auto start = reinterpret_cast<const Byte*>(block_pointers[0]);
+    const SizeT num_bytes = num_blocks * (reinterpret_cast<const Byte*>(block_pointers[1]) - start);
+    CHECK(num_resident_pages(start, num_bytes) == num_bytes / page_size);
+
+    pool.delete_blocks(block_pointers.data() + num_blocks / 4, num_blocks - num_blocks / 4);
+    CHECK(pool.trim() >= num_bytes / 4 * 3 - page_size);
+    CHECK(num_resident_pages(start, num_bytes) <= num_bytes / 4 / page_size + 1);
+    CHECK(block_pointers[0]->z == 3);
+    CHECK(pool.available_capacity() == num_blocks - num_blocks / 4);
+    check_blocks_are_usable(pool);
+  }
+
+  SUBCASE("With a bitmap tracker, free pages between live blocks are released too")
+  {
+    MemoryPool<Point, Storage, NaturalLayout, BitmapTracker> pool(num_blocks);
+    pool.new_blocks(num_blocks, block_pointers.data());
+    for (Point* point_pt : block_pointers) *point_pt = Point{1, 2, 3};
+    const auto start = reinterpret_cast<const Byte*>(block_pointers[0]);
+    const SizeT num_bytes = num_blocks * (reinterpret_cast<const Byte*>(block_pointers[1]) - start);
+
+    pool.delete_blocks(block_pointers.data() + 1, num_blocks - 2);
+    CHECK(pool.trim() >= num_bytes - 2 * page_size);
+    CHECK(num_resident_pages(start, num_bytes) <= 2);
+    CHECK(block_pointers.front()->z == 3);
+    CHECK(block_pointers.back()->z == 3);
+    check_blocks_are_usable(pool);
+  }
+
+  SUBCASE("Prefaulted pages of an empty pool are released")
+  {
+    MemoryPool<Point, MmapStorage<HugePages::None, Prefault::Populate>> pool(num_blocks);
+    Point* block_pt = pool.new_block_pt();
+    const Point* const first_pt = block_pt;
+    const SizeT num_bytes = Storage::mapping_size(num_blocks * sizeof(Point));
+    CHECK(num_resident_pages(first_pt, num_bytes) == num_bytes / page_size);
+    pool.delete_block_pt(block_pt);
+    pool.trim();
+    CHECK(num_resident_pages(first_pt, num_bytes) == 0);
+  }
+
+  SUBCASE("Lazily freed pages can be reused")
+  {
+    MemoryPool<Point, MmapStorage<HugePages::None, Prefault::None, Decommit::Free>> pool(
+      num_blocks);
+    pool.new_blocks(num_blocks, block_pointers.data());
+    for (Point* point_pt : block_pointers) *point_pt = Point{1, 2, 3};
+    pool.delete_blocks(block_pointers.data(), num_blocks);
+    CHECK(pool.trim() > 0);
+    check_blocks_are_usable(pool);
+  }
+
+  SUBCASE("Decay trims the pool once it has been idle for the decay time")
+  {
+    MemoryPool<Point, Storage> pool(num_blocks);
+    pool.set_decay_time(std::chrono::milliseconds(20));
+    pool.new_blocks(num_blocks, block_pointers.data());
+    CHECK(pool.decay() == 0);
+    pool.delete_blocks(block_pointers.data(), num_blocks);
+    CHECK(pool.decay() == 0);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    CHECK(pool.decay() > 0);
+    CHECK(pool.decay() == 0);
+
+    // The clock starts again once the number of live objects rises
+    Point* point_pt = pool.new_block_pt();
+    CHECK(pool.decay() == 0);
+    pool.delete_block_pt(point_pt);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    CHECK(pool.decay() > 0);
+  }
+}
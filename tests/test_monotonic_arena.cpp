@@ -0,0 +1,212 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "monotonic_arena.h"
+
+
+using memory_pool::ArenaMarker;
+using memory_pool::ArenaScope;
+using memory_pool::Byte;
+using memory_pool::HeapStorage;
+using memory_pool::MonotonicArena;
+using memory_pool::SizeT;
+
+
+// Returns true if 'pt' is aligned to 'alignment'
+static bool is_aligned(const void* pt, const SizeT& alignment)
+{
+  return reinterpret_cast<std::uintptr_t>(pt) % alignment == 0;
+}
+
+// A type with a stricter alignment than any fundamental type
+struct alignas(64) CacheLineAligned {
+  char Bytes[64];
+};
+
+// Storage that records the size of the last request and refuses requests over 1 MiB, so
+// oversized blocks can be tested without asking the real allocator for them
+struct RecordingStorage {
+  static Byte* allocate(const SizeT& num_bytes, const SizeT& alignment)
+  {
+    Last_request = num_bytes;
+    if (num_bytes > (SizeT(1) << 20)) throw std::bad_alloc();
+    return HeapStorage::allocate(num_bytes, alignment);
+  }
+  static void deallocate(Byte* pt, const SizeT& num_bytes, const SizeT& alignment)
+  {
+    HeapStorage::deallocate(pt, num_bytes, alignment);
+  }
+
+  static inline SizeT Last_request = 0;
+};
+
+// A type whose constructor throws when asked to
+struct Throwing {
+  explicit Throwing(const bool& should_throw)
+  {
+    if (should_throw) throw std::runtime_error("Throwing");
+  }
+  int Value = 1;
+};
+
+
+TEST_CASE("MonotonicArena")
+{
+  MonotonicArena<> arena(1024);
+  REQUIRE(arena.capacity() == 1024);
+  REQUIRE(arena.used() == 0);
+
+  SUBCASE("Objects of mixed types are allocated next to each other and correctly aligned")
+  {
+    char* char_pt = arena.allocate<char>();
+    Point* point_pt = arena.emplace<Point>(Point{1, 2, 3});
+    double* doubles_pt = arena.allocate<double>(4);
+    CacheLineAligned* aligned_pt = arena.allocate<CacheLineAligned>();
+    CHECK(is_aligned(point_pt, alignof(Point)));
+    CHECK(is_aligned(doubles_pt, alignof(double)));
+    CHECK(is_aligned(aligned_pt, 64));
+    CHECK(reinterpret_cast<char*>(point_pt) - char_pt < 16);
+    CHECK(point_pt->z == 3);
+    CHECK(arena.used() >= 1 + sizeof(Point) + 4 * sizeof(double) + sizeof(CacheLineAligned));
+  }
+
+  SUBCASE("reset() makes all the memory available again without giving it back")
+  {
+    Point* first_pt = arena.allocate<Point>();
+    arena.allocate<Point>(10);
+    arena.reset();
+    CHECK(arena.used() == 0);
+    CHECK(arena.capacity() == 1024);
+    CHECK(arena.allocate<Point>() == first_pt);
+  }
+
+  SUBCASE("A fixed-size arena throws when it runs out")
+  {
+    arena.allocate(1000, 1);
+    CHECK_THROWS_AS(arena.allocate(100, 1), std::out_of_range);
+    CHECK(arena.num_blocks() == 1);
+    arena.allocate(24, 1);
+    CHECK(arena.used() == 1024);
+  }
+
+  SUBCASE("Rewinding to a marker frees what was allocated since")
+  {
+    arena.allocate<Point>();
+    const ArenaMarker marker = arena.mark();
+    const SizeT used = arena.used();
+    Point* scratch_pt = arena.allocate<Point>(20);
+    arena.rewind(marker);
+    CHECK(arena.used() == used);
+    CHECK(arena.allocate<Point>() == scratch_pt);
+  }
+
+  SUBCASE("A scope rewinds the arena when it ends")
+  {
+    arena.allocate<Point>();
+    const SizeT used = arena.used();
+    {
+      ArenaScope<MonotonicArena<>> scope(arena);
+      arena.allocate<Point>(40);
+      CHECK(arena.used() > used);
+    }
+    CHECK(arena.used() == used);
+  }
+
+  SUBCASE("A failed emplace gives its memory back")
+  {
+    arena.emplace<Throwing>(false);
+    const SizeT used = arena.used();
+    CHECK_THROWS_AS(arena.emplace<Throwing>(true), std::runtime_error);
+    CHECK(arena.used() == used);
+  }
+}
+
+
+TEST_CASE("Growable MonotonicArena")
+{
+  MonotonicArena<> arena(256, 2);
+  REQUIRE(arena.is_growable());
+
+  SUBCASE("A new block is chained when the arena runs out")
+  {
+    arena.allocate(200, 1);
+    char* chained_pt = static_cast<char*>(arena.allocate(100, 1));
+    CHECK(arena.num_blocks() == 2);
+    CHECK(arena.capacity() == 256 + 512);
+    CHECK(arena.used() == 256 + 100);
+
+    // An allocation larger than the next block gets a block of its own
+    arena.allocate(2000, 1);
+    CHECK(arena.num_blocks() == 3);
+    CHECK(arena.capacity() == 256 + 512 + 2000);
+
+    // The chained blocks are reused after a reset
+    arena.reset();
+    arena.allocate(200, 1);
+    CHECK(arena.allocate(100, 1) == chained_pt);
+    CHECK(arena.num_blocks() == 3);
+  }
+
+  SUBCASE("Rewinding across blocks goes back to the earlier block")
+  {
+    arena.allocate(100, 1);
+    const ArenaMarker marker = arena.mark();
+    char* scratch_pt = static_cast<char*>(arena.allocate(100, 1));
+    arena.allocate(1000, 1);
+    CHECK(arena.num_blocks() == 2);
+    arena.rewind(marker);
+    CHECK(arena.used() == 100);
+    CHECK(arena.allocate(100, 1) == scratch_pt);
+  }
+
+  SUBCASE("Over-aligned allocations fit in a chained block")
+  {
+    arena.allocate(250, 1);
+    CacheLineAligned* aligned_pt = arena.allocate<CacheLineAligned>(8);
+    CHECK(is_aligned(aligned_pt, 64));
+    CHECK(arena.num_blocks() == 2);
+  }
+
+  SUBCASE("trim() gives back the blocks that are not in use")
+  {
+    arena.allocate(200, 1);
+    arena.allocate(200, 1);
+    arena.allocate(600, 1);
+    REQUIRE(arena.num_blocks() == 3);
+    arena.reset();
+    CHECK(arena.trim() == 512 + 1024);
+    CHECK(arena.num_blocks() == 1);
+    CHECK(arena.capacity() == 256);
+  }
+
+  SUBCASE("A growth factor of 0 makes the arena fixed-size")
+  {
+    arena.set_growth_factor(0);
+    arena.allocate(256, 1);
+    CHECK_THROWS_AS(arena.allocate(1, 1), std::out_of_range);
+  }
+
+  SUBCASE("A next block too large to size throws instead of wrapping around")
+  {
+    // 256 times this factor is 2^64 + 256, which would wrap around to a 256-byte block
+    MonotonicArena<RecordingStorage> recording_arena(256, (SizeT(1) << 56) + 1);
+    recording_arena.allocate(256, 1);
+    CHECK_THROWS_AS(recording_arena.allocate(1, 1), std::bad_alloc);
+    CHECK(RecordingStorage::Last_request == std::numeric_limits<SizeT>::max());
+    CHECK(recording_arena.num_blocks() == 1);
+  }
+
+  SUBCASE("An array too large to size throws instead of wrapping around")
+  {
+    const SizeT max_size = std::numeric_limits<SizeT>::max();
+    CHECK_THROWS_AS(arena.allocate<Point>(max_size / sizeof(Point) + 2), std::bad_alloc);
+    CHECK(arena.used() == 0);
+    CHECK(arena.num_blocks() == 1);
+  }
+
+  CHECK_THROWS_AS(MonotonicArena<>(0), std::invalid_argument);
+}
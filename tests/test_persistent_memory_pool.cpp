@@ -0,0 +1,120 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "persistent_memory_pool.h"
+
+
+using memory_pool::is_persistable_v;
+using memory_pool::PersistentMemoryPool;
+using memory_pool::SizeT;
+
+
+static_assert(is_persistable_v<Point>);
+static_assert(is_persistable_v<FixedStringType>);
+static_assert(!is_persistable_v<PointerType>);
+static_assert(!is_persistable_v<Derived>);
+static_assert(!is_persistable_v<std::string>);
+
+// A path no other test run uses at the same time
+static std::string test_pool_path()
+{
+  return "/tmp/mempool-persistent-test." + std::to_string(::getpid()) + ".pool";
+}
+
+// Returns the values of the objects in the pool, in address order
+static std::vector<int> live_values(PersistentMemoryPool<Point>& pool)
+{
+  std::vector<int> values;
+  pool.for_each_live([&values](const Point& point) { values.push_back(point.x); });
+  return values;
+}
+
+
+TEST_CASE("PersistentMemoryPool")
+{
+  const std::string path = test_pool_path();
+  std::remove(path.c_str());
+
+  SUBCASE("Objects and free blocks are restored when the file is reopened")
+  {
+    SizeT freed_index = 0;
+    SizeT kept_index = 0;
+    {
+      PersistentMemoryPool<Point> pool(path, 100);
+      CHECK(!pool.was_reopened());
+      CHECK(pool.size() == 100);
+      std::vector<Point*> points;
+      for (int i = 0; i < 10; i++) points.push_back(pool.emplace(Point{i, 2 * i, 3 * i}));
+      freed_index = pool.index_of(points[3]);
+      kept_index = pool.index_of(points[7]);
+      pool.delete_block_pt(points[5]);
+      pool.delete_block_pt(points[3]);
+      pool.flush();
+      CHECK(pool.available_capacity() == 92);
+    }
+    PersistentMemoryPool<Point> pool(path, 5);
+    CHECK(pool.was_reopened());
+    CHECK(pool.size() == 100);
+    CHECK(pool.available_capacity() == 92);
+    CHECK(live_values(pool) == std::vector<int>{0, 1, 2, 4, 6, 7, 8, 9});
+    CHECK(pool.at(kept_index)->z == 21);
+
+    // The free list carries on where it left off
+    Point* point_pt = pool.new_block_pt();
+    CHECK(pool.index_of(point_pt) == freed_index);
+    CHECK(pool.available_capacity() == 91);
+  }
+
+  SUBCASE("A full pool throws until a block is freed")
+  {
+    PersistentMemoryPool<Point> pool(path, 3);
+    Point* point_pt = nullptr;
+    for (int i = 0; i < 3; i++) point_pt = pool.emplace(Point{i, i, i});
+    CHECK_THROWS_AS(pool.new_block_pt(), std::out_of_range);
+    pool.delete_block_pt(point_pt);
+    CHECK(point_pt == nullptr);
+    CHECK(pool.new_block_pt() != nullptr);
+
+    pool.reset();
+    CHECK(pool.available_capacity() == 3);
+    CHECK(live_values(pool).empty());
+  }
+
+  SUBCASE("A file holding another type or schema version is rejected")
+  {
+    {
+      PersistentMemoryPool<Point> pool(path, 10);
+      pool.emplace(Point{1, 2, 3});
+    }
+    CHECK_THROWS_AS(PersistentMemoryPool<FixedStringType>(path, 10), std::runtime_error);
+    CHECK_THROWS_AS((PersistentMemoryPool<Point, 1>(path, 10)), std::runtime_error);
+    PersistentMemoryPool<Point> pool(path, 10);
+    CHECK(live_values(pool) == std::vector<int>{1});
+  }
+
+  SUBCASE("A file that is not a pool, or is truncated, is rejected")
+  {
+    std::ofstream(path) << "Not a memory pool";
+    CHECK_THROWS_AS(PersistentMemoryPool<Point>(path, 10), std::runtime_error);
+
+    std::remove(path.c_str());
+    { PersistentMemoryPool<Point> pool(path, 1000); }
+    REQUIRE(::truncate(path.c_str(), 4096) == 0);
+    CHECK_THROWS_AS(PersistentMemoryPool<Point>(path, 1000), std::runtime_error);
+  }
+
+  SUBCASE("A file that cannot be created throws a system error")
+  {
+    CHECK_THROWS_AS(PersistentMemoryPool<Point>("/nonexistent/dir/points.pool", 10),
+                    std::system_error);
+  }
+
+  std::remove(path.c_str());
+}
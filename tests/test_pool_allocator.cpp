@@ -0,0 +1,118 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <set>
+#include <unordered_map>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "pool_allocator.h"
+
+
+using memory_pool::PoolAllocator;
+using memory_pool::PoolMemoryResource;
+
+
+TEST_CASE("PoolAllocator")
+{
+  PoolAllocator<Point> allocator(16);
+
+  SUBCASE("Single objects come from the pool")
+  {
+    Point* point_pt = allocator.allocate(1);
+    *point_pt = Point{1, 2, 3};
+    CHECK(allocator.state().num_pools() == 1);
+    allocator.deallocate(point_pt, 1);
+  }
+
+  SUBCASE("Arrays come from the global heap")
+  {
+    Point* points_pt = allocator.allocate(100);
+    points_pt[99] = Point{1, 2, 3};
+    CHECK(allocator.state().num_pools() == 0);
+    allocator.deallocate(points_pt, 100);
+  }
+
+  SUBCASE("Copies and rebound allocators share the same pools")
+  {
+    PoolAllocator<Point> copy(allocator);
+    PoolAllocator<double> rebound(allocator);
+    CHECK(copy == allocator);
+    CHECK(rebound == allocator);
+    CHECK(PoolAllocator<Point>(16) != allocator);
+
+    Point* point_pt = allocator.allocate(1);
+    copy.deallocate(point_pt, 1);
+    CHECK(allocator.state().num_pools() == 1);
+  }
+}
+
+
+TEST_CASE("Containers")
+{
+  SUBCASE("std::list")
+  {
+    std::list<int, PoolAllocator<int>> list(PoolAllocator<int>(8));
+    for (int i = 0; i < 100; i++) list.push_back(i);
+    list.remove_if([](int i) { return i % 2 == 0; });
+    CHECK(list.size() == 50);
+    CHECK(list.front() == 1);
+    CHECK(list.get_allocator().state().num_pools() == 1);
+  }
+
+  SUBCASE("std::map")
+  {
+    using Allocator = PoolAllocator<std::pair<const int, Point>>;
+    std::map<int, Point, std::less<int>, Allocator> map;
+    for (int i = 0; i < 1000; i++) map[i] = Point{i, i, i};
+    for (int i = 0; i < 1000; i += 2) map.erase(i);
+    CHECK(map.size() == 500);
+    CHECK(map.at(501).y == 501);
+  }
+
+  SUBCASE("std::set")
+  {
+    std::set<int, std::less<int>, PoolAllocator<int>> set;
+    for (int i = 0; i < 1000; i++) set.insert(i % 100);
+    CHECK(set.size() == 100);
+  }
+
+  SUBCASE("std::unordered_map")
+  {
+    using Allocator = PoolAllocator<std::pair<const int, Point>>;
+    std::unordered_map<int, Point, std::hash<int>, std::equal_to<int>, Allocator> map;
+    for (int i = 0; i < 1000; i++) map[i] = Point{i, i, i};
+    for (int i = 0; i < 1000; i += 2) map.erase(i);
+    CHECK(map.size() == 500);
+    CHECK(map.at(999).z == 999);
+  }
+}
+
+
+TEST_CASE("PoolMemoryResource")
+{
+  PoolMemoryResource<64> resource(16);
+
+  SUBCASE("Small requests come from the pool")
+  {
+    std::pmr::map<int, Point> map(&resource);
+    for (int i = 0; i < 100; i++) map[i] = Point{i, i, i};
+    CHECK(resource.pool().size() - resource.pool().available_capacity() == 100);
+    map.clear();
+    CHECK(resource.pool().available_capacity() == resource.pool().size());
+  }
+
+  SUBCASE("Large requests go to the upstream resource")
+  {
+    void* pt = resource.allocate(1024);
+    CHECK(resource.pool().available_capacity() == resource.pool().size());
+    resource.deallocate(pt, 1024);
+  }
+
+  SUBCASE("A resource is only equal to itself")
+  {
+    PoolMemoryResource<64> other(16);
+    CHECK(resource.is_equal(resource));
+    CHECK_FALSE(resource.is_equal(other));
+  }
+}
@@ -0,0 +1,150 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "bitmap_tracker.h"
+#include "pool_policies.h"
+#include "pool_stats.h"
+#include "slot_layout.h"
+
+
+using memory_pool::BitmapTracker;
+using memory_pool::BlockTracker;
+using memory_pool::CacheLineLayout;
+using memory_pool::FixedCapacity;
+using memory_pool::GrowthFactor;
+using memory_pool::Handle;
+using memory_pool::HeapStorage;
+using memory_pool::LinearGrowth;
+using memory_pool::MemoryPool;
+using memory_pool::NaturalLayout;
+using memory_pool::NoLock;
+using memory_pool::NoStats;
+using memory_pool::PoolStats;
+using memory_pool::SizeT;
+using memory_pool::SpinLock;
+
+
+// Policies are recognised by their interface, whatever order they are given in
+using Ordered = MemoryPool<Point, HeapStorage, CacheLineLayout, BitmapTracker, PoolStats>;
+using Shuffled = MemoryPool<Point, PoolStats, BitmapTracker, std::mutex, CacheLineLayout>;
+static_assert(std::is_same_v<Ordered::Tracker, Shuffled::Tracker>);
+static_assert(std::is_same_v<Ordered::Layout, Shuffled::Layout>);
+static_assert(std::is_same_v<Ordered::Stats, Shuffled::Stats>);
+static_assert(std::is_same_v<Shuffled::Storage, HeapStorage>);
+static_assert(std::is_same_v<Shuffled::Lock, std::mutex>);
+static_assert(std::is_same_v<Shuffled::Growth, GrowthFactor>);
+
+// Kinds left out take their defaults, which add nothing to the pool
+static_assert(std::is_same_v<MemoryPool<Point>::Tracker, BlockTracker>);
+static_assert(std::is_same_v<MemoryPool<Point>::Layout, NaturalLayout>);
+static_assert(std::is_same_v<MemoryPool<Point>::Stats, NoStats>);
+static_assert(std::is_same_v<MemoryPool<Point>::Lock, NoLock>);
+static_assert(sizeof(MemoryPool<Point>) == sizeof(MemoryPool<Point, NoLock, NaturalLayout>));
+static_assert(std::is_empty_v<NoLock>);
+static_assert(std::is_empty_v<FixedCapacity>);
+
+static_assert(memory_pool::num_policy_kinds<SpinLock>() == 1);
+static_assert(memory_pool::num_policy_kinds<LinearGrowth<64>>() == 1);
+static_assert(memory_pool::num_policy_kinds<Point>() == 0);
+static_assert(!memory_pool::has_one_policy_of_each_kind<SpinLock, std::mutex>());
+
+
+TEST_CASE("Growth policies")
+{
+  SUBCASE("A FixedCapacity pool never grows")
+  {
+    MemoryPool<Point, FixedCapacity> pool(2);
+    CHECK_FALSE(pool.is_growable());
+    pool.new_block_pt();
+    pool.new_block_pt();
+    CHECK_THROWS_AS(pool.new_block_pt(), std::out_of_range);
+    CHECK(pool.num_segments() == 1);
+    CHECK_THROWS_AS((MemoryPool<Point, FixedCapacity>(2, 2)), std::invalid_argument);
+  }
+
+  SUBCASE("A LinearGrowth pool adds segments of the same size")
+  {
+    MemoryPool<Point, LinearGrowth<3>> pool(2);
+    CHECK(pool.is_growable());
+    std::vector<Point*> obj_pts(8);
+    pool.new_blocks(8, obj_pts.data());
+    CHECK(pool.num_segments() == 3);
+    CHECK(pool.size() == 2 + 3 + 3);
+    pool.delete_blocks(obj_pts.data(), obj_pts.size());
+    CHECK(pool.available_capacity() == 8);
+  }
+
+  SUBCASE("The default growth factor can be set at run time")
+  {
+    MemoryPool<Point> pool(2);
+    CHECK_FALSE(pool.is_growable());
+    pool.set_growth_factor(3);
+    CHECK(pool.growth().growth_factor() == 3);
+    for (int i = 0; i < 3; i++) pool.new_block_pt();
+    CHECK(pool.size() == 2 + 6);
+  }
+}
+
+
+// Allocates and frees objects from several threads at once, checking each thread only ever
+// sees its own objects
+template<class Pool>
+static void hammer(Pool& pool)
+{
+  constexpr int num_threads = 4;
+  constexpr int num_rounds = 2000;
+  std::vector<std::thread> threads;
+  std::vector<int> num_mismatches(num_threads, 0);
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&pool, &num_mismatches, t]() {
+      std::vector<Point*> obj_pts;
+      for (int round = 0; round < num_rounds; round++) {
+        obj_pts.push_back(pool.emplace(Point{t, round, 0}));
+        auto handle = pool.template emplace_handle<Handle<Point>>(Point{t, round, 1});
+        if (pool.resolve(handle)->x != t) num_mismatches[t]++;
+        pool.destroy(handle);
+        if (obj_pts.size() == 8) {
+          for (Point* obj_pt : obj_pts) {
+            if (obj_pt->x != t) num_mismatches[t]++;
+          }
+          pool.destroy_blocks(obj_pts.data(), obj_pts.size());
+          obj_pts.clear();
+        }
+      }
+      for (Point*& obj_pt : obj_pts) pool.destroy(obj_pt);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (int t = 0; t < num_threads; t++) CHECK(num_mismatches[t] == 0);
+  CHECK(pool.available_capacity() == pool.size());
+}
+
+TEST_CASE("Locking policies")
+{
+  SUBCASE("A pool with std::mutex can be shared between threads")
+  {
+    MemoryPool<Point, std::mutex> pool(64, 2);
+    hammer(pool);
+  }
+
+  SUBCASE("A pool with SpinLock can be shared between threads")
+  {
+    MemoryPool<Point, SpinLock, BitmapTracker> pool(64, 2);
+    hammer(pool);
+  }
+
+  SUBCASE("SpinLock can be taken by one thread at a time")
+  {
+    SpinLock lock;
+    CHECK(lock.try_lock());
+    CHECK_FALSE(lock.try_lock());
+    lock.unlock();
+    CHECK(lock.try_lock());
+    lock.unlock();
+  }
+}
@@ -0,0 +1,167 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "pool_stats.h"
+
+
+using memory_pool::BlockTracker;
+using memory_pool::HeapStorage;
+using memory_pool::MemoryPool;
+using memory_pool::NaturalLayout;
+using memory_pool::PoolRegistry;
+using memory_pool::PoolStats;
+using memory_pool::PoolStatsSnapshot;
+using memory_pool::SizeT;
+
+
+template<class T>
+using StatsPool = MemoryPool<T, HeapStorage, NaturalLayout, BlockTracker, PoolStats>;
+
+// A pool without statistics is no larger than it was before statistics existed
+static_assert(sizeof(MemoryPool<Point>) == sizeof(MemoryPool<Point, HeapStorage>));
+static_assert(std::is_empty_v<memory_pool::NoStats>);
+
+static_assert(memory_pool::type_name<Point>() == "Point");
+static_assert(memory_pool::type_name<int>() == "int");
+
+
+TEST_CASE("PoolStats")
+{
+  StatsPool<Point> pool(4);
+  std::vector<Point*> obj_pts;
+
+  SUBCASE("A new pool has allocated nothing")
+  {
+    const PoolStatsSnapshot stats = pool.stats().snapshot();
+    CHECK(stats.Type_name == "Point");
+    CHECK(stats.Capacity == 4);
+    CHECK(stats.Live == 0);
+    CHECK(stats.Peak_live == 0);
+    CHECK(stats.Allocations == 0);
+    CHECK(stats.Deallocations == 0);
+    CHECK(stats.Exhaustions == 0);
+    CHECK(stats.Growths == 0);
+  }
+
+  SUBCASE("Allocations and deallocations are counted, one at a time or in batches")
+  {
+    for (int i = 0; i < 3; i++) obj_pts.push_back(pool.new_block_pt());
+    pool.delete_block_pt(obj_pts[0]);
+    pool.delete_blocks(obj_pts.data() + 1, 2);
+    Point* batch[4];
+    pool.new_blocks(4, batch);
+    pool.delete_blocks(batch, 1);
+
+    const PoolStatsSnapshot stats = pool.stats().snapshot();
+    CHECK(stats.Allocations == 7);
+    CHECK(stats.Deallocations == 4);
+    CHECK(stats.Live == 3);
+    CHECK(stats.Peak_live == 4);
+  }
+
+  SUBCASE("A full fixed-size pool counts an exhaustion for every failed request")
+  {
+    Point* batch[4];
+    pool.new_blocks(4, batch);
+    CHECK_THROWS_AS(pool.new_block_pt(), std::out_of_range);
+    CHECK_THROWS_AS(pool.new_blocks(1, batch), std::out_of_range);
+    CHECK(pool.stats().snapshot().Exhaustions == 2);
+    CHECK(pool.stats().snapshot().Growths == 0);
+  }
+
+  SUBCASE("A growable pool counts its growth")
+  {
+    pool.set_growth_factor(2);
+    for (int i = 0; i < 13; i++) pool.new_block_pt();
+    const PoolStatsSnapshot stats = pool.stats().snapshot();
+    CHECK(stats.Exhaustions == 2);
+    CHECK(stats.Growths == 2);
+    CHECK(stats.Capacity == 4 + 8 + 16);
+    CHECK(stats.Live == 13);
+  }
+
+  SUBCASE("Resetting the pool frees every block but keeps the totals and the peak")
+  {
+    for (int i = 0; i < 3; i++) pool.new_block_pt();
+    pool.reset();
+    const PoolStatsSnapshot stats = pool.stats().snapshot();
+    CHECK(stats.Live == 0);
+    CHECK(stats.Peak_live == 3);
+    CHECK(stats.Allocations == 3);
+    CHECK(stats.Capacity == 4);
+  }
+
+  SUBCASE("Counts from different threads are added together")
+  {
+    // The pool is only used by one thread at a time, as a MemoryPool must be
+    for (int i = 0; i < 4; i++) {
+      std::thread([&] {
+        Point* obj_pt = pool.new_block_pt();
+        pool.delete_block_pt(obj_pt);
+      }).join();
+    }
+    const PoolStatsSnapshot stats = pool.stats().snapshot();
+    CHECK(stats.Allocations == 4);
+    CHECK(stats.Deallocations == 4);
+    CHECK(stats.Peak_live == 1);
+  }
+}
+
+
+TEST_CASE("PoolRegistry")
+{
+  PoolRegistry& registry = PoolRegistry::instance();
+  REQUIRE(registry.size() == 0);
+
+  SUBCASE("Pools are listed while they exist, in the order they were created")
+  {
+    auto points = std::make_unique<StatsPool<Point>>(10);
+    {
+      StatsPool<Derived> objects(20);
+      objects.new_block_pt();
+
+      const std::vector<PoolStatsSnapshot> pools = registry.snapshot();
+      REQUIRE(pools.size() == 2);
+      CHECK(pools[0].Type_name == "Point");
+      CHECK(pools[0].Capacity == 10);
+      CHECK(pools[1].Type_name == "Derived");
+      CHECK(pools[1].Live == 1);
+      CHECK(pools[1].Id > pools[0].Id);
+    }
+    CHECK(registry.size() == 1);
+    points.reset();
+    CHECK(registry.size() == 0);
+  }
+
+  SUBCASE("Pools without statistics are not listed")
+  {
+    MemoryPool<Point> pool(10);
+    CHECK(registry.size() == 0);
+  }
+
+  SUBCASE("The statistics can be dumped as JSON")
+  {
+    CHECK(registry.to_json() == "{\"pools\": []}");
+
+    StatsPool<Point> pool(10);
+    pool.new_block_pt();
+    const std::string id = std::to_string(pool.stats().id());
+    CHECK(registry.to_json() ==
+          "{\"pools\": [{\"id\": " + id + ", \"type\": \"Point\", \"capacity\": 10, " +
+            "\"live\": 1, \"peak_live\": 1, \"allocations\": 1, \"deallocations\": 0, " +
+            "\"exhaustions\": 0, \"growths\": 0}]}");
+  }
+
+  SUBCASE("Type names are escaped in JSON")
+  {
+    PoolStatsSnapshot snapshot;
+    snapshot.Type_name = "a\"b\\c\n";
+    const std::string json = memory_pool::to_json({snapshot});
+    CHECK(json.find("\"type\": \"a\\\"b\\\\c\\u000a\"") != std::string::npos);
+  }
+}
@@ -0,0 +1,186 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "pool_stats.h"
+#include "pool_trace.h"
+
+
+using memory_pool::BlockTracker;
+using memory_pool::HeapStorage;
+using memory_pool::MemoryPool;
+using memory_pool::NaturalLayout;
+using memory_pool::PoolStats;
+using memory_pool::PoolTrace;
+using memory_pool::SizeT;
+using memory_pool::Trace;
+using memory_pool::TraceBuffer;
+using memory_pool::TraceOp;
+using memory_pool::TraceRecord;
+using memory_pool::TraceRegistry;
+
+
+template<class T, class Stats = PoolTrace<>>
+using TracedPool = MemoryPool<T, HeapStorage, NaturalLayout, BlockTracker, Stats>;
+
+// Returns the records of the pool with the given id, as "<op><slot>" strings (e.g. "A3" for
+// an allocation of slot 3), in the order they were collected
+static std::vector<std::string> events(const Trace& trace, const uint16_t& pool_id)
+{
+  std::vector<std::string> result;
+  for (const TraceRecord& record : trace.Records) {
+    if (record.Pool_id != pool_id) continue;
+    result.push_back("ADFTR"[static_cast<int>(record.Op)] + std::to_string(record.Slot));
+  }
+  return result;
+}
+
+// The trace of a pool with the given id
+template<class Pool>
+static std::vector<std::string> events(const Pool& pool)
+{
+  return events(TraceRegistry::instance().collect(), pool.stats().trace_id());
+}
+
+
+TEST_CASE("PoolTrace")
+{
+  TraceRegistry::instance().clear();
+
+  SUBCASE("Allocations and deallocations are recorded with their slots")
+  {
+    TracedPool<Point> pool(4, 2);
+    Point* first_pt = pool.new_block_pt();
+    Point* second_pt = pool.new_block_pt();
+    pool.delete_block_pt(first_pt);
+    first_pt = pool.new_block_pt();
+    pool.delete_block_pt(second_pt);
+    pool.delete_block_pt(first_pt);
+    CHECK(events(pool) == std::vector<std::string>{"R0", "A0", "A1", "D0", "A0", "D1", "D0"});
+  }
+
+  SUBCASE("Slots count across segments and batches are recorded block by block")
+  {
+    TracedPool<Point> pool(2, 2);
+    std::vector<Point*> points(5);
+    pool.new_blocks(5, points.data());
+    pool.delete_blocks(points.data(), 2);
+    std::vector<std::string> trace = events(pool);
+    CHECK(trace.size() == 8);
+    CHECK(std::count(trace.begin(), trace.end(), "A4") == 1);
+    CHECK(std::count(trace.begin(), trace.end(), "D0") == 1);
+    CHECK(std::count(trace.begin(), trace.end(), "D1") == 1);
+  }
+
+  SUBCASE("Compaction and resets are recorded")
+  {
+    TracedPool<Point> pool(4);
+    Point* first_pt = pool.new_block_pt();
+    Point* second_pt = pool.new_block_pt();
+    pool.delete_block_pt(first_pt);
+    pool.compact();
+    pool.reset();
+    CHECK(events(pool) == std::vector<std::string>{"R0", "A0", "A1", "D0", "F1", "T0", "R0"});
+    (void)second_pt;
+  }
+
+  SUBCASE("A summary follows objects moved by compaction")
+  {
+    TracedPool<Point> pool(4);
+    Point* first_pt = pool.new_block_pt();
+    Point* second_pt = pool.new_block_pt();
+    pool.delete_block_pt(first_pt);
+    pool.compact();
+    pool.new_block_pt();
+    pool.new_block_pt();
+    const Trace trace = TraceRegistry::instance().collect();
+    const auto summaries = memory_pool::summarise_trace(trace);
+    const memory_pool::PoolSummary& summary = summaries.at(pool.stats().trace_id());
+    CHECK(events(trace, pool.stats().trace_id()) ==
+          std::vector<std::string>{"R0", "A0", "A1", "D0", "F1", "T0", "A1", "A2"});
+    CHECK(summary.Peak_live == 3);
+    CHECK(summary.Num_slots == 3);
+    CHECK(summary.Object_size == sizeof(Point));
+    (void)second_pt;
+  }
+
+  SUBCASE("Statistics can be kept as well")
+  {
+    TracedPool<Point, PoolTrace<PoolStats>> pool(4);
+    pool.new_block_pt();
+    CHECK(pool.stats().snapshot().Allocations == 1);
+    CHECK(events(pool) == std::vector<std::string>{"R0", "A0"});
+  }
+
+  SUBCASE("Records from several threads are merged in time order")
+  {
+    TracedPool<Point> first_pool(4);
+    TracedPool<Point> second_pool(4);
+    first_pool.new_block_pt();
+    std::thread([&second_pool]() { second_pool.new_block_pt(); }).join();
+    first_pool.new_block_pt();
+
+    const Trace trace = TraceRegistry::instance().collect();
+    const uint16_t first_id = first_pool.stats().trace_id();
+    const uint16_t second_id = second_pool.stats().trace_id();
+    CHECK(events(trace, first_id) == std::vector<std::string>{"R0", "A0", "A1"});
+    CHECK(events(trace, second_id) == std::vector<std::string>{"R0", "A0"});
+    CHECK(trace.Pools[first_id].Type_name == "Point");
+    CHECK(trace.Pools[first_id].Object_size == sizeof(Point));
+
+    // The other thread's allocation comes between the two on this thread
+    SizeT index = 0;
+    while ((trace.Records[index].Pool_id != second_id) ||
+           (trace.Records[index].Op != TraceOp::Allocate)) {
+      index++;
+    }
+    CHECK(trace.Records[index - 1].Pool_id == first_id);
+    CHECK(trace.Records[index + 1].Pool_id == first_id);
+  }
+
+  SUBCASE("A trace survives a round trip through a file")
+  {
+    TracedPool<Point> pool(4);
+    Point* point_pt = pool.new_block_pt();
+    pool.delete_block_pt(point_pt);
+    const Trace trace = TraceRegistry::instance().collect();
+    const std::string path = "/tmp/mempool-trace-test.trace";
+    memory_pool::write_trace(trace, path);
+    const Trace read = memory_pool::read_trace(path);
+    CHECK(read.Pools.size() == trace.Pools.size());
+    CHECK(read.Pools.back().Type_name == trace.Pools.back().Type_name);
+    CHECK(events(read, pool.stats().trace_id()) == std::vector<std::string>{"R0", "A0", "D0"});
+
+    std::ofstream(path) << "Not a trace";
+    CHECK_THROWS_AS(memory_pool::read_trace(path), std::runtime_error);
+    std::remove(path.c_str());
+  }
+}
+
+
+TEST_CASE("TraceBuffer")
+{
+  SUBCASE("A full buffer keeps the newest records")
+  {
+    TraceBuffer buffer(4);
+    for (SizeT i = 0; i < 10; i++) buffer.record(TraceOp::Allocate, 0, i);
+    std::vector<TraceRecord> records;
+    std::vector<int64_t> times;
+    buffer.copy(records, times);
+    REQUIRE(records.size() == 4);
+    CHECK(records.front().Slot == 6);
+    CHECK(records.back().Slot == 9);
+    CHECK(std::is_sorted(times.begin(), times.end()));
+
+    buffer.clear();
+    records.clear();
+    buffer.copy(records, times);
+    CHECK(records.empty());
+  }
+}
@@ -0,0 +1,190 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "shared_memory_pool.h"
+
+
+using memory_pool::SharedMemoryPool;
+using memory_pool::SharedOffset;
+using memory_pool::SharedPoolHeader;
+
+
+// A name no other test run uses at the same time
+static std::string test_shm_name()
+{
+  return "/mempool-shared-test." + std::to_string(::getpid());
+}
+
+// Runs 'function' in a child process and returns its exit status
+template<class Function>
+static int run_in_child(Function&& function)
+{
+  const pid_t pid = ::fork();
+  if (pid == 0) {
+    function();
+    ::_exit(0);
+  }
+  int status = -1;
+  ::waitpid(pid, &status, 0);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+
+TEST_CASE("SharedMemoryPool")
+{
+  const std::string name = test_shm_name();
+  SharedMemoryPool<Point>::unlink(name);
+
+  SUBCASE("A second mapping sees the same objects at the same offsets")
+  {
+    SharedMemoryPool<Point> first(name, 100);
+    CHECK(first.is_creator());
+    SharedMemoryPool<Point> second(name, 5);
+    CHECK(!second.is_creator());
+    CHECK(second.size() == 100);
+
+    Point* point_pt = first.emplace(Point{1, 2, 3});
+    const SharedOffset<Point> offset = first.offset_of(point_pt);
+    CHECK(offset);
+    Point* other_pt = second.from_offset(offset);
+    CHECK(other_pt != point_pt);
+    CHECK(other_pt->z == 3);
+    CHECK(second.available_capacity() == 99);
+
+    // A block can be freed through any mapping
+    second.delete_block_pt(other_pt);
+    CHECK(other_pt == nullptr);
+    CHECK(first.available_capacity() == 100);
+    CHECK(first.from_offset(SharedOffset<Point>()) == nullptr);
+  }
+
+  SUBCASE("Offsets that are not blocks in the pool are rejected")
+  {
+    SharedMemoryPool<Point> pool(name, 10);
+    const SharedOffset<Point> offset = pool.offset_of(pool.new_block_pt());
+    CHECK_THROWS_AS(pool.from_offset(SharedOffset<Point>{8}), std::out_of_range);
+    CHECK_THROWS_AS(pool.from_offset(SharedOffset<Point>{offset.Value + 1}), std::out_of_range);
+    CHECK_THROWS_AS(pool.from_offset(SharedOffset<Point>{offset.Value + 10 * sizeof(Point)}),
+                    std::out_of_range);
+    CHECK_THROWS_AS(pool.from_offset(SharedOffset<Point>{~uint64_t(0)}), std::out_of_range);
+  }
+
+  SUBCASE("A pool whose creator died while setting it up is created again")
+  {
+    // Leave behind a sized object whose recorded creator has exited without storing the
+    // magic number
+    const pid_t dead_pid = ::fork();
+    if (dead_pid == 0) ::_exit(0);
+    ::waitpid(dead_pid, nullptr, 0);
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    REQUIRE(fd >= 0);
+    REQUIRE(::ftruncate(fd, sizeof(SharedPoolHeader)) == 0);
+    void* mapping = ::mmap(nullptr, sizeof(SharedPoolHeader), PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd, 0);
+    ::close(fd);
+    REQUIRE(mapping != MAP_FAILED);
+    static_cast<SharedPoolHeader*>(mapping)->Creator_pid.store(dead_pid);
+    ::munmap(mapping, sizeof(SharedPoolHeader));
+
+    SharedMemoryPool<Point> pool(name, 10);
+    CHECK(pool.is_creator());
+    CHECK(pool.size() == 10);
+    CHECK(pool.available_capacity() == 10);
+  }
+
+  SUBCASE("A full pool throws until a block is freed")
+  {
+    SharedMemoryPool<Point> pool(name, 3);
+    Point* point_pt = nullptr;
+    for (int i = 0; i < 3; i++) point_pt = pool.new_block_pt();
+    CHECK_THROWS_AS(pool.new_block_pt(), std::out_of_range);
+    pool.delete_block_pt(point_pt);
+    CHECK(pool.new_block_pt() != nullptr);
+  }
+
+  SUBCASE("A pool of another type or schema version is rejected")
+  {
+    SharedMemoryPool<Point> pool(name, 10);
+    CHECK_THROWS_AS(SharedMemoryPool<FixedStringType>(name, 10), std::runtime_error);
+    CHECK_THROWS_AS((SharedMemoryPool<Point, 1>(name, 10)), std::runtime_error);
+    CHECK_THROWS_AS(SharedMemoryPool<Point>("/mempool-shared-test-empty", 0),
+                    std::invalid_argument);
+  }
+
+  SUBCASE("Objects are handed off to another process without copying")
+  {
+    SharedMemoryPool<Point> pool(name, 64);
+    int pipe_fds[2];
+    REQUIRE(::pipe(pipe_fds) == 0);
+    const int status = run_in_child([&]() {
+      SharedMemoryPool<Point> child_pool(name, 64);
+      for (int i = 0; i < 10; i++) {
+        const SharedOffset<Point> offset = child_pool.offset_of(child_pool.emplace(Point{i, 0, 0}));
+        if (::write(pipe_fds[1], &offset, sizeof(offset)) != sizeof(offset)) ::_exit(1);
+      }
+    });
+    CHECK(status == 0);
+    CHECK(pool.available_capacity() == 54);
+    for (int i = 0; i < 10; i++) {
+      SharedOffset<Point> offset;
+      REQUIRE(::read(pipe_fds[0], &offset, sizeof(offset)) == sizeof(offset));
+      Point* point_pt = pool.from_offset(offset);
+      CHECK(point_pt->x == i);
+      pool.delete_block_pt(point_pt);
+    }
+    CHECK(pool.available_capacity() == 64);
+    ::close(pipe_fds[0]);
+    ::close(pipe_fds[1]);
+  }
+
+  SUBCASE("A crashed process leaks its blocks but leaves the free list intact")
+  {
+    SharedMemoryPool<Point> pool(name, 100);
+    const int status = run_in_child([&]() {
+      SharedMemoryPool<Point> child_pool(name, 100);
+      for (int i = 0; i < 30; i++) child_pool.emplace(Point{-1, -1, -1});
+      ::_exit(3);
+    });
+    CHECK(status == 3);
+
+    std::set<Point*> blocks;
+    for (int i = 0; i < 70; i++) blocks.insert(pool.emplace(Point{i, i, i}));
+    CHECK(blocks.size() == 70);
+    CHECK_THROWS_AS(pool.new_block_pt(), std::out_of_range);
+  }
+
+  SUBCASE("Threads allocating and freeing at once never share a block")
+  {
+    SharedMemoryPool<Point> pool(name, 256);
+    std::atomic<int> num_clobbered(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+      threads.emplace_back([&pool, &num_clobbered, t]() {
+        std::vector<Point*> points;
+        for (int round = 0; round < 2000; round++) {
+          for (int i = 0; i < 16; i++) points.push_back(pool.emplace(Point{t, round, i}));
+          for (Point*& point_pt : points) {
+            if (point_pt->x != t) num_clobbered++;
+            pool.delete_block_pt(point_pt);
+          }
+          points.clear();
+        }
+      });
+    }
+    for (std::thread& thread : threads) thread.join();
+    CHECK(num_clobbered == 0);
+    CHECK(pool.available_capacity() == 256);
+  }
+
+  SharedMemoryPool<Point>::unlink(name);
+}
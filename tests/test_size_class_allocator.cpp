@@ -0,0 +1,108 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "size_class_allocator.h"
+
+
+using memory_pool::SizeClassAllocator;
+using memory_pool::SizeT;
+
+
+using Allocator = SizeClassAllocator<4096>;
+
+// The classes step by 16 bytes up to 64 bytes, then by a quarter of a power of two
+static_assert(Allocator::num_classes() == 28);
+static_assert(Allocator::class_size(0) == 16);
+static_assert(Allocator::class_size(3) == 64);
+static_assert(Allocator::class_size(4) == 80);
+static_assert(Allocator::class_size(12) == 320);
+static_assert(Allocator::class_size(Allocator::num_classes() - 1) == 4096);
+static_assert(Allocator::class_index(sizeof(FixedStringType)) == 11);
+
+// The largest class holds at least 'MaxSize' bytes even if 'MaxSize' is not a class size
+static_assert(SizeClassAllocator<100>::class_size(SizeClassAllocator<100>::num_classes() - 1) ==
+              112);
+
+
+TEST_CASE("Size classes")
+{
+  SUBCASE("Each size maps to the smallest class that holds it")
+  {
+    for (SizeT bytes = 1; bytes <= 4096; bytes++) {
+      const SizeT index = Allocator::class_index(bytes);
+      REQUIRE(Allocator::class_size(index) >= bytes);
+      if (index > 0) REQUIRE(Allocator::class_size(index - 1) < bytes);
+    }
+  }
+
+  SUBCASE("At most a quarter of a block is wasted above 64 bytes")
+  {
+    for (SizeT bytes = 65; bytes <= 4096; bytes++) {
+      REQUIRE(4 * (Allocator::class_size(Allocator::class_index(bytes)) - bytes) < bytes);
+    }
+  }
+}
+
+
+TEST_CASE("SizeClassAllocator")
+{
+  Allocator allocator(1024);
+
+  SUBCASE("Blocks are aligned like malloc() and can be written to")
+  {
+    std::vector<std::pair<void*, SizeT>> allocations;
+    for (SizeT bytes : {1, 16, 17, 64, 65, 200, 256, 1000, 4096}) {
+      void* pt = allocator.allocate(bytes);
+      CHECK(reinterpret_cast<std::uintptr_t>(pt) % alignof(std::max_align_t) == 0);
+      std::memset(pt, 0xAB, bytes);
+      allocations.emplace_back(pt, bytes);
+    }
+    for (const auto& [pt, bytes] : allocations) allocator.deallocate(pt, bytes);
+  }
+
+  SUBCASE("Requests are served by the pool of their size class")
+  {
+    void* pt = allocator.allocate(300);
+    CHECK(allocator.pool<12>().available_capacity() == allocator.pool<12>().size() - 1);
+    allocator.deallocate(pt, 300);
+    CHECK(allocator.pool<12>().available_capacity() == allocator.pool<12>().size());
+
+    // Any size in the same class reuses the freed block
+    CHECK(allocator.allocate(310) == pt);
+    allocator.deallocate(pt, 310);
+  }
+
+  SUBCASE("Oversized requests go to the system allocator")
+  {
+    void* pt = allocator.allocate(5000);
+    std::memset(pt, 0, 5000);
+    CHECK(allocator.pool<Allocator::num_classes() - 1>().available_capacity() ==
+          allocator.pool<Allocator::num_classes() - 1>().size());
+    allocator.deallocate(pt, 5000);
+  }
+
+  SUBCASE("Pools grow as needed")
+  {
+    std::vector<std::pair<void*, SizeT>> allocations;
+    std::default_random_engine engine;
+    std::uniform_int_distribution<SizeT> size_distribution(1, 4096);
+    for (int i = 0; i < 2000; i++) {
+      const SizeT bytes = size_distribution(engine);
+      allocations.emplace_back(allocator.allocate(bytes), bytes);
+    }
+    CHECK(allocator.pool<Allocator::num_classes() - 1>().num_segments() > 1);
+    for (const auto& [pt, bytes] : allocations) allocator.deallocate(pt, bytes);
+    CHECK(allocator.pool<0>().available_capacity() == allocator.pool<0>().size());
+  }
+
+  SUBCASE("Deallocating a null pointer does nothing")
+  {
+    allocator.deallocate(nullptr, 16);
+    CHECK(allocator.pool<0>().available_capacity() == allocator.pool<0>().size());
+  }
+}
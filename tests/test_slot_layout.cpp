@@ -0,0 +1,130 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "slot_layout.h"
+
+
+using memory_pool::CacheLineLayout;
+using memory_pool::ColouredLayout;
+using memory_pool::HeapStorage;
+using memory_pool::MemoryPool;
+using memory_pool::NaturalLayout;
+using memory_pool::PowerOfTwoLayout;
+using memory_pool::SizeT;
+
+
+// The number of bytes between the first two blocks handed out by a fresh pool
+template<class Pool>
+SizeT measure_stride(Pool& pool)
+{
+  auto block1_pt = reinterpret_cast<std::uintptr_t>(pool.new_block_pt());
+  auto block2_pt = reinterpret_cast<std::uintptr_t>(pool.new_block_pt());
+  return block2_pt - block1_pt;
+}
+
+
+// Returns true if the 'size' bytes at 'pt' span more cache lines than they need to
+bool straddles_cache_lines(const void* pt, const SizeT& size)
+{
+  const auto address = reinterpret_cast<std::uintptr_t>(pt);
+  const SizeT first_line = address / 64;
+  const SizeT last_line = (address + size - 1) / 64;
+  return (last_line - first_line + 1) > (size + 63) / 64;
+}
+
+
+TEST_CASE("Stride")
+{
+  SUBCASE("Natural layout packs blocks as tightly as alignment allows")
+  {
+    MemoryPool<Point, HeapStorage, NaturalLayout> point_pool(4);
+    CHECK(measure_stride(point_pool) == 16);
+    MemoryPool<Derived, HeapStorage, NaturalLayout> derived_pool(4);
+    CHECK(measure_stride(derived_pool) == sizeof(Derived));
+  }
+
+  SUBCASE("Cache line layout pads blocks to whole cache lines")
+  {
+    MemoryPool<Point, HeapStorage, CacheLineLayout> point_pool(4);
+    CHECK(measure_stride(point_pool) == 64);
+    MemoryPool<FixedStringType, HeapStorage, CacheLineLayout> string_pool(4);
+    CHECK(measure_stride(string_pool) == 256);
+  }
+
+  SUBCASE("Power of two layout rounds blocks up to a power of two")
+  {
+    MemoryPool<Point, HeapStorage, PowerOfTwoLayout> point_pool(4);
+    CHECK(measure_stride(point_pool) == 16);
+    MemoryPool<Derived, HeapStorage, PowerOfTwoLayout> derived_pool(4);
+    CHECK(measure_stride(derived_pool) == 64);
+  }
+}
+
+
+TEST_CASE("Blocks do not straddle cache lines")
+{
+  SUBCASE("Cache line layout")
+  {
+    MemoryPool<Derived, HeapStorage, CacheLineLayout> pool(100);
+    std::vector<Derived*> block_pointers(100);
+    pool.new_blocks(100, block_pointers.data());
+    for (Derived* block_pt : block_pointers) {
+      CHECK(reinterpret_cast<std::uintptr_t>(block_pt) % 64 == 0);
+    }
+  }
+
+  SUBCASE("Power of two layout")
+  {
+    MemoryPool<Derived, HeapStorage, PowerOfTwoLayout> pool(100);
+    std::vector<Derived*> block_pointers(100);
+    pool.new_blocks(100, block_pointers.data());
+    for (Derived* block_pt : block_pointers) {
+      CHECK_FALSE(straddles_cache_lines(block_pt, sizeof(Derived)));
+    }
+  }
+}
+
+
+// Storage whose memory always starts on a page boundary
+struct PageAlignedStorage {
+  static memory_pool::Byte* allocate(const SizeT& num_bytes, const SizeT& alignment)
+  {
+    return HeapStorage::allocate(num_bytes, std::max<SizeT>(alignment, 4096));
+  }
+  static void deallocate(memory_pool::Byte* pt, const SizeT& num_bytes, const SizeT& alignment)
+  {
+    HeapStorage::deallocate(pt, num_bytes, std::max<SizeT>(alignment, 4096));
+  }
+};
+
+
+TEST_CASE("Cache colouring")
+{
+  using Layout = ColouredLayout<CacheLineLayout, 4>;
+
+  SUBCASE("Consecutive segments start at different offsets within a page")
+  {
+    std::set<SizeT> offsets;
+    for (int i = 0; i < 4; i++) {
+      MemoryPool<Point, PageAlignedStorage, Layout> pool(8);
+      offsets.insert(reinterpret_cast<std::uintptr_t>(pool.new_block_pt()) % 4096);
+    }
+    CHECK(offsets == std::set<SizeT>{0, 64, 128, 192});
+  }
+
+  SUBCASE("Blocks stay aligned and usable")
+  {
+    MemoryPool<Derived, HeapStorage, Layout> pool(10, 2);
+    std::vector<Derived*> block_pointers(100);
+    pool.emplace_blocks(100, block_pointers.data());
+    for (Derived* block_pt : block_pointers) {
+      CHECK(reinterpret_cast<std::uintptr_t>(block_pt) % 64 == 0);
+    }
+    pool.destroy_blocks(block_pointers.data(), 100);
+    CHECK(pool.available_capacity() == pool.size());
+  }
+}
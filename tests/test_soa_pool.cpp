@@ -0,0 +1,158 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "soa_pool.h"
+
+
+using memory_pool::SoaPool;
+using memory_pool::StructSoaPool;
+
+
+// Describe Point to StructSoaPool
+template<>
+struct memory_pool::SoaFields<Point> {
+  static constexpr auto Members = std::make_tuple(&Point::x, &Point::y, &Point::z);
+};
+
+// A struct with members of different sizes, one of which is not stored
+struct Particle {
+  double Mass;
+  float Charge;
+  char Tag;
+  int Unstored;
+};
+
+template<>
+struct memory_pool::SoaFields<Particle> {
+  static constexpr auto Members =
+    std::make_tuple(&Particle::Mass, &Particle::Charge, &Particle::Tag);
+};
+
+using ParticlePool = SoaPool<double, float, char>;
+static_assert(std::is_base_of_v<ParticlePool, StructSoaPool<Particle>>);
+
+
+TEST_CASE("SoaPool")
+{
+  ParticlePool pool(4);
+  REQUIRE(pool.capacity() == 4);
+  auto first = pool.new_slot(1.0, 2.f, 'a');
+  auto second = pool.new_slot(3.0, 4.f, 'b');
+
+  SUBCASE("Each field lives in its own aligned, dense column")
+  {
+    CHECK(pool.size() == 2);
+    CHECK(pool.column<0>().size() == 2);
+    CHECK(pool.column<0>()[1] == 3.0);
+    CHECK(pool.column<2>()[0] == 'a');
+    CHECK(reinterpret_cast<std::uintptr_t>(pool.column<0>().data()) % 64 == 0);
+    CHECK(reinterpret_cast<std::uintptr_t>(pool.column<1>().data()) % 64 == 0);
+    CHECK(reinterpret_cast<std::uintptr_t>(pool.column<2>().data()) % 64 == 0);
+    const float sum = std::accumulate(pool.column<1>().begin(), pool.column<1>().end(), 0.f);
+    CHECK(sum == 6.f);
+  }
+
+  SUBCASE("Fields are read and written through handles and references")
+  {
+    pool.get<1>(second) = 5.f;
+    CHECK(pool.column<1>()[1] == 5.f);
+    auto ref = pool.ref(first);
+    ref.get<0>() = 10.0;
+    CHECK(pool.get<0>(first) == 10.0);
+    CHECK(pool.new_slot().index() != second.index());
+    CHECK(pool.column<0>()[2] == 0.0);
+  }
+
+  SUBCASE("Freeing a slot moves the last object into the hole")
+  {
+    auto third = pool.new_slot(5.0, 6.f, 'c');
+    pool.delete_slot(first);
+    CHECK(first.is_null());
+    CHECK(pool.size() == 2);
+    CHECK(pool.column<0>()[0] == 5.0);
+    CHECK(pool.index_of(third) == 0);
+    CHECK(pool.get<2>(third) == 'c');
+    CHECK(pool.get<2>(second) == 'b');
+  }
+
+  SUBCASE("Stale handles are detected")
+  {
+    auto copy = first;
+    pool.delete_slot(first);
+    CHECK(!pool.contains(copy));
+    pool.delete_slot(copy);
+    CHECK(pool.size() == 1);
+
+    auto reused = pool.new_slot(7.0, 8.f, 'd');
+    CHECK(reused.index() == copy.index());
+    CHECK(!pool.contains(copy));
+    CHECK(pool.contains(reused));
+
+    pool.reset();
+    CHECK(pool.size() == 0);
+    CHECK(!pool.contains(reused));
+    CHECK(!pool.contains(second));
+  }
+
+  SUBCASE("A fixed-size pool throws when it is full")
+  {
+    pool.new_slot();
+    pool.new_slot();
+    CHECK_THROWS_AS(pool.new_slot(), std::out_of_range);
+    CHECK(pool.size() == 4);
+  }
+
+  SUBCASE("A growable pool reallocates its columns but keeps its handles")
+  {
+    pool.set_growth_factor(2);
+    std::vector<ParticlePool::HandleT> handles{first, second};
+    for (int i = 2; i < 100; i++) handles.push_back(pool.new_slot(i, float(i), 'x'));
+    CHECK(pool.capacity() >= 100);
+    CHECK(pool.get<0>(first) == 1.0);
+    CHECK(pool.get<0>(handles[50]) == 50.0);
+    CHECK(reinterpret_cast<std::uintptr_t>(pool.column<1>().data()) % 64 == 0);
+  }
+
+  CHECK_THROWS_AS(ParticlePool(0), std::invalid_argument);
+}
+
+
+TEST_CASE("StructSoaPool")
+{
+  StructSoaPool<Point> points(16);
+  for (int i = 0; i < 10; i++) points.insert(Point{i, 2 * i, 3 * i});
+  auto handle = points.insert(Point{0, 0, 0});
+
+  SUBCASE("Columns are chosen by member")
+  {
+    int sum = 0;
+    for (const int& y : points.column<&Point::y>()) sum += y;
+    CHECK(sum == 90);
+    for (int& x : points.column<&Point::x>()) x = -x;
+    CHECK(points.column<&Point::x>()[9] == -9);
+  }
+
+  SUBCASE("Objects are stored and loaded whole")
+  {
+    points.store(handle, Point{7, 8, 9});
+    const Point point = points.load(handle);
+    CHECK(point.x == 7);
+    CHECK(point.z == 9);
+  }
+
+  SUBCASE("Members not listed are not stored")
+  {
+    StructSoaPool<Particle> particles(2);
+    auto particle = particles.insert(Particle{1.5, 2.5f, 'p', 42});
+    const Particle loaded = particles.load(particle);
+    CHECK(loaded.Mass == 1.5);
+    CHECK(loaded.Tag == 'p');
+    CHECK(loaded.Unstored == 0);
+    CHECK(particles.column<&Particle::Charge>()[0] == 2.5f);
+  }
+}
@@ -0,0 +1,117 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "static_memory_pool.h"
+
+
+using memory_pool::BlockIndexType;
+using memory_pool::StaticMemoryPool;
+
+
+// The index type is the narrowest that leaves room for the end-of-list marker
+static_assert(std::is_same_v<BlockIndexType<254>, uint8_t>);
+static_assert(std::is_same_v<BlockIndexType<255>, uint16_t>);
+static_assert(std::is_same_v<BlockIndexType<65534>, uint16_t>);
+static_assert(std::is_same_v<BlockIndexType<65535>, uint32_t>);
+static_assert(std::is_same_v<BlockIndexType<(uint64_t(1) << 32)>, uint64_t>);
+
+// The capacity is known at compile time and the storage is inline
+static_assert(StaticMemoryPool<Point, 16>::size() == 16);
+static_assert(sizeof(StaticMemoryPool<Point, 16>) < 16 * sizeof(Point) + 16);
+static_assert(sizeof(StaticMemoryPool<char, 100>) < 100 + 16);
+
+
+// A pool in static storage
+static StaticMemoryPool<Point, 8> g_StaticPool;
+
+
+TEST_CASE("Allocation")
+{
+  StaticMemoryPool<Point, 3> pool;
+  REQUIRE(pool.available_capacity() == 3);
+
+  Point* block1_pt = pool.new_block_pt(Point{1, 2, 3});
+  Point* block2_pt = pool.new_block_pt();
+
+  SUBCASE("Blocks lie inside the pool object")
+  {
+    auto pool_start = reinterpret_cast<std::uintptr_t>(&pool);
+    auto block_address = reinterpret_cast<std::uintptr_t>(block2_pt);
+    CHECK(block_address >= pool_start);
+    CHECK(block_address < pool_start + sizeof(pool));
+    CHECK(block1_pt->z == 3);
+    CHECK(pool.available_capacity() == 1);
+  }
+
+  SUBCASE("A deallocated block is reused and the pointer is nulled out")
+  {
+    Point* freed_pt = block1_pt;
+    pool.delete_block_pt(block1_pt);
+    CHECK(block1_pt == nullptr);
+    CHECK(pool.available_capacity() == 2);
+    CHECK(pool.new_block_pt() == freed_pt);
+  }
+
+  SUBCASE("Cannot allocate more than is available")
+  {
+    pool.new_block_pt();
+    CHECK_THROWS_AS(pool.new_block_pt(), std::out_of_range);
+    pool.delete_block_pt(block2_pt);
+    CHECK(pool.new_block_pt() != nullptr);
+  }
+
+  SUBCASE("Resetting frees every block")
+  {
+    pool.reset();
+    CHECK(pool.available_capacity() == 3);
+    for (int i = 0; i < 3; i++) pool.new_block_pt();
+    CHECK_THROWS_AS(pool.new_block_pt(), std::out_of_range);
+  }
+}
+
+
+TEST_CASE("Small types")
+{
+  // A char pool only needs one byte per block for its (8-bit) free list
+  StaticMemoryPool<char, 200> pool;
+  std::vector<char*> block_pointers;
+  for (int i = 0; i < 200; i++) {
+    block_pointers.push_back(pool.new_block_pt());
+    *block_pointers.back() = static_cast<char>(i);
+  }
+  CHECK(block_pointers[1] - block_pointers[0] == 1);
+  for (int i = 0; i < 200; i += 2) pool.delete_block_pt(block_pointers[i]);
+  CHECK(pool.available_capacity() == 100);
+  for (int i = 1; i < 200; i += 2) CHECK(*block_pointers[i] == static_cast<char>(i));
+  for (int i = 0; i < 200; i += 2) block_pointers[i] = pool.new_block_pt();
+  CHECK(pool.available_capacity() == 0);
+}
+
+
+TEST_CASE("Static storage")
+{
+  Point* block_pt = g_StaticPool.emplace(Point{4, 5, 6});
+  CHECK(block_pt->y == 5);
+  g_StaticPool.delete_block_pt(block_pt);
+  CHECK(g_StaticPool.available_capacity() == 8);
+}
+
+
+TEST_CASE("Construction in place")
+{
+  StaticMemoryPool<Derived, 4> pool;
+  Derived* derived_pt = pool.emplace();
+  Base1* base1_pt = derived_pt;
+  CHECK(dynamic_cast<Derived*>(base1_pt) == derived_pt);
+  pool.destroy(derived_pt);
+  CHECK(pool.available_capacity() == 4);
+
+  {
+    auto derived_unique_pt = pool.make_unique();
+    CHECK(pool.available_capacity() == 3);
+  }
+  CHECK(pool.available_capacity() == 4);
+}
@@ -0,0 +1,85 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "stats_publisher.h"
+
+
+using memory_pool::BlockTracker;
+using memory_pool::HeapStorage;
+using memory_pool::MemoryPool;
+using memory_pool::NaturalLayout;
+using memory_pool::PoolStats;
+using memory_pool::PublishedStats;
+using memory_pool::StatsPublisher;
+using memory_pool::StatsReader;
+
+
+template<class T>
+using StatsPool = MemoryPool<T, HeapStorage, NaturalLayout, BlockTracker, PoolStats>;
+
+// A name no other test run uses at the same time
+static std::string test_shm_name()
+{
+  return "/mempool-stat-test." + std::to_string(::getpid());
+}
+
+
+TEST_CASE("StatsPublisher")
+{
+  StatsPool<Point> points(100);
+  StatsPool<Derived> objects(10, 2);
+  for (int i = 0; i < 15; i++) objects.new_block_pt();
+  Point* point_pt = points.new_block_pt();
+  points.delete_block_pt(point_pt);
+
+  SUBCASE("Published statistics can be read back from another mapping")
+  {
+    StatsPublisher publisher(test_shm_name());
+    StatsReader reader(publisher.name());
+
+    const PublishedStats stats = reader.read();
+    CHECK(stats.Pid == ::getpid());
+    CHECK(stats.Num_pools == 2);
+    REQUIRE(stats.Pools.size() == 2);
+    CHECK(stats.Pools[0].Type_name == "Point");
+    CHECK(stats.Pools[0].Allocations == 1);
+    CHECK(stats.Pools[0].Deallocations == 1);
+    CHECK(stats.Pools[1].Type_name == "Derived");
+    CHECK(stats.Pools[1].Live == 15);
+    CHECK(stats.Pools[1].Capacity == 30);
+    CHECK(stats.Pools[1].Growths == 1);
+
+    // The page only changes when the statistics are published again
+    points.new_block_pt();
+    CHECK(reader.read().Pools[0].Allocations == 1);
+    publisher.publish();
+    CHECK(reader.read().Pools[0].Allocations == 2);
+  }
+
+  SUBCASE("Statistics can be published periodically")
+  {
+    StatsPublisher publisher(test_shm_name());
+    StatsReader reader(publisher.name());
+    publisher.publish_every(std::chrono::milliseconds(1));
+    points.new_block_pt();
+
+    bool is_published = false;
+    for (int i = 0; (i < 5000) && !is_published; i++) {
+      is_published = (reader.read().Pools[0].Allocations == 2);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(is_published);
+    publisher.stop();
+  }
+
+  SUBCASE("The shared memory object is removed with the publisher")
+  {
+    { StatsPublisher publisher(test_shm_name()); }
+    CHECK_THROWS_AS(StatsReader(test_shm_name()), std::system_error);
+  }
+}
@@ -0,0 +1,126 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <vector>
+#include <doctest/doctest.h>
+#include "ExampleClasses.h"
+#include "thread_caching_memory_pool.h"
+
+
+using memory_pool::SizeT;
+using memory_pool::ThreadCachingMemoryPool;
+
+
+TEST_CASE("Single thread")
+{
+  ThreadCachingMemoryPool<Point> pool(100, 8);
+  REQUIRE(pool.size() == 100);
+  REQUIRE(pool.magazine_size() == 8);
+
+  Point* block1_pt = pool.new_block_pt(Point{1, 2, 3});
+  Point* block2_pt = pool.new_block_pt();
+
+  SUBCASE("Blocks are handed out at distinct addresses")
+  {
+    CHECK(block1_pt != block2_pt);
+    CHECK(block1_pt->y == 2);
+    CHECK(pool.available_capacity() == 98);
+  }
+
+  SUBCASE("A deallocated block is cached by the thread and reused")
+  {
+    Point* freed_pt = block1_pt;
+    pool.delete_block_pt(block1_pt);
+    CHECK(block1_pt == nullptr);
+    CHECK(pool.new_block_pt() == freed_pt);
+  }
+
+  SUBCASE("Flushing the thread cache keeps every block available")
+  {
+    pool.delete_block_pt(block1_pt);
+    pool.delete_block_pt(block2_pt);
+    pool.flush_thread_cache();
+    CHECK(pool.available_capacity() == 100);
+  }
+}
+
+
+TEST_CASE("Exhaustion")
+{
+  SUBCASE("A fixed-size pool throws once every block has been handed out")
+  {
+    ThreadCachingMemoryPool<Point> pool(10, 4);
+    for (int i = 0; i < 10; i++) pool.new_block_pt();
+    CHECK_THROWS_AS(pool.new_block_pt(), std::out_of_range);
+  }
+
+  SUBCASE("A growable pool grows instead")
+  {
+    ThreadCachingMemoryPool<Point> pool(10, 4, 2);
+    for (int i = 0; i < 11; i++) pool.new_block_pt();
+    CHECK(pool.size() == 30);
+  }
+}
+
+
+TEST_CASE("Deallocating from another thread")
+{
+  ThreadCachingMemoryPool<Point> pool(1000, 16);
+
+  // Producer allocates, consumer deallocates
+  std::vector<Point*> block_pointers(500);
+  std::thread producer([&]() {
+    for (int i = 0; i < 500; i++) block_pointers[i] = pool.new_block_pt(Point{i, i, i});
+  });
+  producer.join();
+
+  std::thread consumer([&]() {
+    for (int i = 0; i < 500; i++) pool.delete_block_pt(block_pointers[i]);
+    pool.flush_thread_cache();
+  });
+  consumer.join();
+
+  CHECK(pool.available_capacity() == 1000);
+
+  // Every block can still be handed out exactly once
+  std::set<Point*> blocks;
+  for (int i = 0; i < 1000; i++) blocks.insert(pool.new_block_pt());
+  CHECK(blocks.size() == 1000);
+}
+
+
+TEST_CASE("Multiple threads")
+{
+  const int num_threads = 4;
+  const int num_blocks_per_thread = 200;
+  ThreadCachingMemoryPool<Point> pool(num_threads * (num_blocks_per_thread + 32), 32);
+
+  std::vector<int> num_errors(num_threads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      std::vector<Point*> block_pointers(num_blocks_per_thread);
+      for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < num_blocks_per_thread; i++) {
+          block_pointers[i] = pool.new_block_pt(Point{t, i, round});
+        }
+        for (int i = 0; i < num_blocks_per_thread; i++) {
+          const Point& p = *block_pointers[i];
+          if ((p.x != t) || (p.y != i) || (p.z != round)) num_errors[t]++;
+          pool.delete_block_pt(block_pointers[i]);
+        }
+      }
+    });
+  }
+
+  // The capacity can be read while the other threads are using their magazines
+  SizeT max_available = 0;
+  for (int i = 0; i < 1000; i++) max_available = std::max(max_available, pool.available_capacity());
+  CHECK(max_available <= pool.size());
+
+  for (auto& thread : threads) thread.join();
+
+  for (int t = 0; t < num_threads; t++) CHECK(num_errors[t] == 0);
+  CHECK(pool.available_capacity() == pool.size());
+}
@@ -0,0 +1,143 @@
+// mempool-stat: prints the statistics a process publishes with memory_pool::StatsPublisher.
+//
+//   mempool-stat [--json] [--interval SECONDS] <pid | /shm-name>
+//
+// By default the statistics are printed once as a table. With --interval the table is
+// reprinted every SECONDS seconds, with allocation/deallocation rates, until interrupted.
+// With --json the statistics are printed in the same JSON format as PoolRegistry::to_json().
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <map>
+#include <string>
+#include <thread>
+#include "stats_publisher.h"
+
+using memory_pool::PoolStatsSnapshot;
+using memory_pool::PublishedStats;
+using memory_pool::SizeT;
+using memory_pool::StatsReader;
+
+namespace {
+  void print_usage(const char* program)
+  {
+    std::fprintf(stderr, "usage: %s [--json] [--interval SECONDS] <pid | /shm-name>\n", program);
+  }
+
+  // Prints the statistics as a table. If 'previous' holds an earlier sample of the same
+  // process, the allocation and deallocation rates since then are printed as well
+  void print_table(const PublishedStats& stats, const PublishedStats* previous)
+  {
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    const double age =
+      static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() -
+                          stats.Timestamp_ns) * 1e-9;
+    std::printf("pid %lld: %llu pool(s), published %.1f s ago\n",
+                static_cast<long long>(stats.Pid),
+                static_cast<unsigned long long>(stats.Num_pools),
+                age);
+    if (stats.Num_pools > stats.Pools.size()) {
+      std::printf("(only the first %zu pools fit in the statistics page)\n", stats.Pools.size());
+    }
+
+    std::map<SizeT, const PoolStatsSnapshot*> previous_pools;
+    double elapsed = 0.0;
+    if (previous != nullptr) {
+      for (const PoolStatsSnapshot& pool : previous->Pools) previous_pools[pool.Id] = &pool;
+      elapsed = static_cast<double>(stats.Timestamp_ns - previous->Timestamp_ns) * 1e-9;
+    }
+    const bool show_rates = (elapsed > 0.0);
+
+    std::printf("%6s  %-24s %10s %10s %10s %12s %12s %7s %6s",
+                "ID", "TYPE", "CAPACITY", "LIVE", "PEAK", "ALLOCS", "FREES", "EXHAUST", "GROWN");
+    if (show_rates) std::printf(" %11s %11s", "ALLOCS/S", "FREES/S");
+    std::printf("\n");
+    for (const PoolStatsSnapshot& pool : stats.Pools) {
+      std::printf("%6llu  %-24.24s %10llu %10llu %10llu %12llu %12llu %7llu %6llu",
+                  static_cast<unsigned long long>(pool.Id),
+                  pool.Type_name.c_str(),
+                  static_cast<unsigned long long>(pool.Capacity),
+                  static_cast<unsigned long long>(pool.Live),
+                  static_cast<unsigned long long>(pool.Peak_live),
+                  static_cast<unsigned long long>(pool.Allocations),
+                  static_cast<unsigned long long>(pool.Deallocations),
+                  static_cast<unsigned long long>(pool.Exhaustions),
+                  static_cast<unsigned long long>(pool.Growths));
+      if (show_rates) {
+        auto it = previous_pools.find(pool.Id);
+        if (it != previous_pools.end()) {
+          const PoolStatsSnapshot& before = *it->second;
+          const double allocations = static_cast<double>(pool.Allocations - before.Allocations);
+          const double frees = static_cast<double>(pool.Deallocations - before.Deallocations);
+          std::printf(" %11.0f %11.0f", allocations / elapsed, frees / elapsed);
+        }
+        else {
+          std::printf(" %11s %11s", "-", "-");
+        }
+      }
+      std::printf("\n");
+    }
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  bool as_json = false;
+  double interval = 0.0;
+  std::string target;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--json") {
+      as_json = true;
+    }
+    else if ((arg == "--interval") && (i + 1 < argc)) {
+      interval = std::atof(argv[++i]);
+    }
+    else if ((arg == "-h") || (arg == "--help")) {
+      print_usage(argv[0]);
+      return EXIT_SUCCESS;
+    }
+    else if (target.empty() && (arg[0] != '-')) {
+      target = arg;
+    }
+    else {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (target.empty() || (interval < 0.0)) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  // A bare number is a process id
+  const std::string name =
+    (target[0] == '/') ? target : memory_pool::stats_shm_name(std::atoll(target.c_str()));
+
+  try {
+    StatsReader reader(name);
+    PublishedStats previous;
+    bool has_previous = false;
+    while (true) {
+      const PublishedStats stats = reader.read();
+      if (as_json) {
+        std::printf("%s\n", memory_pool::to_json(stats.Pools).c_str());
+      }
+      else {
+        print_table(stats, has_previous ? &previous : nullptr);
+      }
+      std::fflush(stdout);
+      if (interval <= 0.0) break;
+
+      previous = stats;
+      has_previous = true;
+      std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+      if (!as_json) std::printf("\n");
+    }
+  }
+  catch (const std::exception& e) {
+    std::fprintf(stderr, "mempool-stat: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}